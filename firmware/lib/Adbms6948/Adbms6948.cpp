@@ -930,6 +930,8 @@ Adbms6948_ReturnType  Adbms6948_ReadI1ADCConvCnt
 									[C(1), C(2), ..., C(M)]
                                     where X=first cell of the group.    \n
 									      M=Number of cells in the group
+									Reading all the groups gives every cell of
+									each device in turn, first device first.
 									@range: NA
 									@resolution: NA
 
@@ -293,6 +293,9 @@ typedef struct
 */
 typedef struct
 {
+    /*! Number of daisy chains in use, 1 to ADBMS6948_NO_OF_DAISY_CHAIN */
+    uint8_t                                   Adbms6948_nNoOfChains;
+
     /*! Array of configurations for all chains */
     const Adbms6948_DaisyChainCfgType *       Adbms6948_pDaisyChainCfg;
 
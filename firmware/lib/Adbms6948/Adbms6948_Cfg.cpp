@@ -165,6 +165,7 @@ static const Adbms6948_RunTimeErrorCfgType  Adbms6948_RunTimeErrorConfigData[1]
 
 const Adbms6948_CfgType  Adbms6948ConfigSet_0_PB =
 {
+	1u, /* No of chains */
 	Adbms6948_ChainConfigData,
 	Adbms6948_RunTimeErrorConfigData,
 };
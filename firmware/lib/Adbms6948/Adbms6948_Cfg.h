@@ -23,7 +23,7 @@ Analog Devices License Agreement.
 * @{
 */
 /*============= I N C L U D E S =============*/
-// #include "Std_Types.h"
+#include "adi_bms_platform.h"
 
 /*============== D E F I N E S ===============*/
 /**	Major Software Version number */
@@ -51,13 +51,29 @@ Analog Devices License Agreement.
 #define ADBMS6948_INSTANCE_ID_CFG                 	0U
 
 
-/** The configuration of the number of daisy chains connected to the BMS Controller */
+/** The maximum number of daisy chains connected to the BMS Controller, the
+    configuration set says how many are in use */
+#ifndef ADBMS6948_NO_OF_DAISY_CHAIN
 #define ADBMS6948_NO_OF_DAISY_CHAIN                   (1U)
-/** The maximum number of BMS devices connected in a single daisy chain */
+#endif
+/** The maximum number of BMS devices connected in a single daisy chain, the
+    configuration set says how many each chain has */
+#ifndef ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN
 #define ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN    (1U)
+#endif
 /** The configuration of the Development mode for the ADBMS6948 SW driver */
 #define ADBMS6948_DEVELOPMENT_MODE_EN    FALSE
 
+/** Cells monitored per device, unless the system configuration says otherwise */
+#ifndef SYS_MAX_CELL_MON_CELLS
+#define SYS_MAX_CELL_MON_CELLS                        (16U)
+#endif
+/** Devices present on the chain of Adbms6948ConfigSet_0_PB, unless the system
+    configuration says otherwise */
+#ifndef SYS_CM_DEVICES_PRESENT
+#define SYS_CM_DEVICES_PRESENT                        (1U)
+#endif
+
 
 /** Configuration to select the maximum divide factor to calculate the OW threshold for CADC.*/
 #define ADBMS6948_CADC_OW_MAX_DIV_FACTOR	((uint16_t)12u)
@@ -39,6 +39,12 @@ Adbms6948_ChainStateInfoType Adbms6948_aoChainStateInfo[ADBMS6948_NO_OF_DAISY_CH
 /* Un-Initialized Data section start */
 ADBMS6948_DRV_UNINIT_DATA_STOP
 
+/* Platforms without a lock per chain serialize the chains on the critical section */
+#ifndef ADI_PAL_CHAIN_LOCK
+#define ADI_PAL_CHAIN_LOCK(chain)		ADI_PAL_CRITICAL_SECTION_START
+#define ADI_PAL_CHAIN_UNLOCK(chain)		ADI_PAL_CRITICAL_SECTION_STOP
+#endif
+
 
 /*======Static Prototype==============*/
 static void  Adbms6948_lI2CUpdRdBuf
@@ -1115,7 +1121,7 @@ const uint8_t   			 knChainID
 {
     Adbms6948_ReturnType   nRet;
     uint8_t   nDevIdx, nNoOfDevOnChain,nDevStartIdx,
-            anRdRegData[ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN][ADBMS6948_MAX_FRAME_SIZE];
+            anRdRegData[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
     uint8_t   anTmpWrStat[3u];
     uint16_t   anCmdLst[1u];
 
@@ -1201,7 +1207,7 @@ Adbms6948_ReturnType  Adbms6948_Cmn_ReadRegGroup
 )
 {
 	Adbms6948_ReturnType  nRet = E_OK;
-    uint8_t  aRdDataBuff[ADBMS6948_NUMOF_REGGRP_SIX][ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN)] = {0u};
+    Adbms6948_FrameType  *aRdDataBuff;
     uint8_t  nDevIdx, nGrpIdx, nRegGrpDataLen;
     uint32_t nDataCfg;
     uint32_t nDataBufLen;
@@ -1210,8 +1216,17 @@ Adbms6948_ReturnType  Adbms6948_Cmn_ReadRegGroup
 
     nDataBufLen = (uint32_t)((uint32_t)ADBMS6948_CMD_DATA_LEN + (uint32_t)(Adbms6948_aoChainStateInfo[knChainID].nCurrNoOfDevices * (uint32_t)ADBMS6948_REG_DATA_LEN_WITH_PEC));
     nDataCfg = (((uint32_t)nCmdLstLen << 16u) | (nDataBufLen));
-    /* Read the configuration of the chain */
-    Adbms6948_Cmd_ExecuteCmdRD(pnCmdLst, aRdDataBuff, nDataCfg, FALSE, knChainID);
+    aRdDataBuff = Adbms6948_Cmn_AllocFrames(nCmdLstLen, knChainID);
+    if (NULL_PTR == aRdDataBuff)
+    {
+        nRet = E_NOT_OK;
+        nCmdLstLen = 0u;
+    }
+    else
+    {
+        /* Read the configuration of the chain */
+        Adbms6948_Cmd_ExecuteCmdRD(pnCmdLst, aRdDataBuff, nDataCfg, FALSE, knChainID);
+    }
 
     for (nGrpIdx = 0u; nGrpIdx < nCmdLstLen; nGrpIdx++)
     {
@@ -1236,6 +1251,7 @@ Adbms6948_ReturnType  Adbms6948_Cmn_ReadRegGroup
 			}
 		}
     }
+    Adbms6948_Cmn_FreeFrames(aRdDataBuff, knChainID);
 return(nRet);
 }
 /*****************************************************************************/
@@ -1505,7 +1521,7 @@ Adbms6948_ReturnType  Adbms6948_Cmn_UpdateChainStatus
 {
     Adbms6948_ReturnType                 nRet = E_OK;
 
-    Adbms6948_Cmn_EnterCriticalSection();
+    Adbms6948_Cmn_LockChain(knChainID);
     /* Get the current chain state. */
     if (eReqSt == Adbms6948_aoChainStateInfo[knChainID].eChainState)
     {
@@ -1517,7 +1533,7 @@ Adbms6948_ReturnType  Adbms6948_Cmn_UpdateChainStatus
         /* Update the chain state to requested state. */
         Adbms6948_aoChainStateInfo[knChainID].eChainState = eReqSt;
     }
-    Adbms6948_Cmn_ExitCriticalSection();
+    Adbms6948_Cmn_UnlockChain(knChainID);
     return nRet;
 }
 /*!
@@ -1570,6 +1586,89 @@ void
 	ADI_PAL_CRITICAL_SECTION_STOP;
 }
 
+/*!
+    @brief         This function is used to take the lock of a chain, which
+				   guards its state against the other chains' callers only.
+
+    @param  [in]   knChainID  The daisy chain ID to lock.
+
+    @return        None
+ */
+void Adbms6948_Cmn_LockChain
+(
+const uint8_t 	knChainID
+)
+{
+	ADI_PAL_CHAIN_LOCK(knChainID);
+}
+
+/*!
+    @brief         This function is used to release the lock of a chain
+
+    @param  [in]   knChainID  The daisy chain ID to unlock.
+
+    @return        None
+ */
+void Adbms6948_Cmn_UnlockChain
+(
+const uint8_t 	knChainID
+)
+{
+	ADI_PAL_CHAIN_UNLOCK(knChainID);
+}
+
+/*!
+    @brief         This function takes cleared frames from the top of the
+				   chain's scratch arena. Only the caller that set the chain
+				   busy uses its arena, so no lock is needed. Frames are given
+				   back in the reverse order with Adbms6948_Cmn_FreeFrames.
+
+    @param  [in]   nFrames    Number of frames.
+
+    @param  [in]   knChainID  The daisy chain ID to perform the operation.
+
+    @return        The frames, NULL_PTR if the arena has too few left
+ */
+Adbms6948_FrameType *  Adbms6948_Cmn_AllocFrames
+(
+	uint8_t  		nFrames,
+	const uint8_t  	knChainID
+)
+{
+	Adbms6948_FrameType  *pFrames = NULL_PTR;
+	uint8_t  nTop = Adbms6948_aoChainStateInfo[knChainID].nArenaTop;
+
+	if (nFrames <= (uint8_t)(ADBMS6948_FRAME_ARENA_FRAMES - nTop))
+	{
+		pFrames = &Adbms6948_aoChainStateInfo[knChainID].aoArena[nTop];
+		Adbms6948_Cmn_Memset(&pFrames[0u][0u], 0u, (uint32_t)nFrames * sizeof(Adbms6948_FrameType));
+		Adbms6948_aoChainStateInfo[knChainID].nArenaTop = (uint8_t)(nTop + nFrames);
+	}
+	return (pFrames);
+}
+
+/*!
+    @brief         This function gives frames back to the chain's scratch
+				   arena, with any taken after them.
+
+    @param  [in]   pFrames    Frames from Adbms6948_Cmn_AllocFrames, or NULL_PTR.
+
+    @param  [in]   knChainID  The daisy chain ID to perform the operation.
+
+    @return        None
+ */
+void Adbms6948_Cmn_FreeFrames
+(
+	Adbms6948_FrameType 	*pFrames,
+	const uint8_t  			 knChainID
+)
+{
+	if (NULL_PTR != pFrames)
+	{
+		Adbms6948_aoChainStateInfo[knChainID].nArenaTop = (uint8_t)(pFrames - &Adbms6948_aoChainStateInfo[knChainID].aoArena[0u]);
+	}
+}
+
 /*!
     @brief         This function is used to store values at particular memory
 				   location.
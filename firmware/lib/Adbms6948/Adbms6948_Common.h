@@ -273,6 +273,28 @@ void Adbms6948_Cmn_EnterCriticalSection
 void
 );
 
+void Adbms6948_Cmn_LockChain
+(
+const uint8_t 	knChainID
+);
+
+void Adbms6948_Cmn_UnlockChain
+(
+const uint8_t 	knChainID
+);
+
+Adbms6948_FrameType *  Adbms6948_Cmn_AllocFrames
+(
+	uint8_t  		nFrames,
+	const uint8_t  	knChainID
+);
+
+void Adbms6948_Cmn_FreeFrames
+(
+	Adbms6948_FrameType 	*pFrames,
+	const uint8_t  			 knChainID
+);
+
 void Adbms6948_Cmn_ExitCriticalSection
 (
 void
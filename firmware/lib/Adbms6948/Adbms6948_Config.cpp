@@ -135,9 +135,11 @@ const Adbms6948_CfgType 	*pkConfig
 		/*Store configuration address. */
 		Adbms6948_pConfig = pkConfig;
 		Adbms6948_pDaisyChainCfgInput=Adbms6948_pConfig->Adbms6948_pDaisyChainCfg;
+		/* Pick the PEC engine that matches the table one and times fastest on this host */
+		Adbms6948_PecInit();
 
 		/* Initialize all chain for which initialization is enabled. */
-		for (nChainIndex = 0u; nChainIndex < (uint8_t)ADBMS6948_NO_OF_DAISY_CHAIN; nChainIndex++)
+		for (nChainIndex = 0u; nChainIndex < pkConfig->Adbms6948_nNoOfChains; nChainIndex++)
 		{
 			/* Clear the state information and initialize the number of devices in the state for the chain */
 			(void) Adbms6948_Cmn_Memset((uint8_t*)&Adbms6948_aoChainStateInfo[nChainIndex],0,
@@ -209,7 +211,7 @@ void
 		nRet = E_OK;
 
 		/* DeInitialize all chain for which initialization is enabled. */
-		for (nChainIndex = 0u; nChainIndex < (uint8_t)ADBMS6948_NO_OF_DAISY_CHAIN; nChainIndex++)
+		for (nChainIndex = 0u; nChainIndex < Adbms6948_pConfig->Adbms6948_nNoOfChains; nChainIndex++)
 		{
 			if (TRUE == Adbms6948_pConfig->Adbms6948_pDaisyChainCfg[nChainIndex].Adbms6948_bEnableInit)
 			{
@@ -290,7 +292,7 @@ const uint8_t  	 knChainID
 		ADBMS6948_CFGSOAKCTRL_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR==pEnable) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR==pEnable) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -378,7 +380,7 @@ const uint8_t  					 knChainID
 		ADBMS6948_CFGAUXSOAKTIME_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pAuxSoakTimeCfg) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pAuxSoakTimeCfg) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -470,7 +472,7 @@ const uint8_t  					 knChainID
 		ADBMS6948_CFGOVTHRSLD_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pOVThreshold) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pOVThreshold) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -564,7 +566,7 @@ const uint8_t  					 knChainID
 		ADBMS6948_CFGUVTHRSLD_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pUVThreshold) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pUVThreshold) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -654,7 +656,7 @@ const uint8_t  					 knChainID
 		ADBMS6948_CFGIIRFILTER_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pCornerFreq) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pCornerFreq) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -739,7 +741,7 @@ const uint8_t  					 knChainID
 		ADBMS6948_CFGCSTHRES_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pCSCompThresVolt) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pCSCompThresVolt) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -827,7 +829,7 @@ const uint8_t 				 knChainID
 		ADBMS6948_CFGGPIO_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pGpioPinCfg) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID) )
+	else if ((NULL_PTR == pGpioPinCfg) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID) )
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -916,7 +918,7 @@ Adbms6948_ReturnType Adbms6948_Int_CfgCoulombCounter
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CFGCCNTR_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((NULL_PTR == pnNumConversions) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((NULL_PTR == pnNumConversions) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -993,7 +995,7 @@ Adbms6948_ReturnType Adbms6948_Int_CfgOC1Params
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CFGOC1PARAMS_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((NULL_PTR == poOC1CfgType) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((NULL_PTR == poOC1CfgType) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -1062,7 +1064,7 @@ Adbms6948_ReturnType  Adbms6948_Int_CfgOC2Params
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CFGOC2PARAMS_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((NULL_PTR == poOC2CfgType) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((NULL_PTR == poOC2CfgType) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -1117,7 +1119,12 @@ static boolean  Adbms6948_lIsInvalidConfig
     boolean  bRet = FALSE;
     uint8_t  nChainIndex,nDeviceIndex,nAdbms6948Devices;
 
-    for (nChainIndex = 0u; nChainIndex < ADBMS6948_NO_OF_DAISY_CHAIN; nChainIndex++)
+    if ((0u == pConfig->Adbms6948_nNoOfChains) || (pConfig->Adbms6948_nNoOfChains > ADBMS6948_NO_OF_DAISY_CHAIN))
+    {
+        bRet = TRUE;
+    }
+
+    for (nChainIndex = 0u; (FALSE == bRet) && (nChainIndex < pConfig->Adbms6948_nNoOfChains); nChainIndex++)
     {
     	nAdbms6948Devices = pConfig->Adbms6948_pDaisyChainCfg[nChainIndex].Adbms6948_nNoOfDevices;
 
@@ -1186,16 +1193,19 @@ static boolean  Adbms6948_lIsAnyOfChainsBusy
     boolean     bRet = FALSE;
     uint8_t      nChainIndex;
 
-	Adbms6948_Cmn_EnterCriticalSection();
-    for (nChainIndex = 0u; nChainIndex < ADBMS6948_NO_OF_DAISY_CHAIN; nChainIndex++)
+    for (nChainIndex = 0u; nChainIndex < Adbms6948_pConfig->Adbms6948_nNoOfChains; nChainIndex++)
     {
+        Adbms6948_Cmn_LockChain(nChainIndex);
         if (ADBMS6948_ST_CHAIN_BUSY == Adbms6948_aoChainStateInfo[nChainIndex].eChainState)
         {
             bRet = TRUE;
+        }
+        Adbms6948_Cmn_UnlockChain(nChainIndex);
+        if (TRUE == bRet)
+        {
             break;
         }
     }
-   Adbms6948_Cmn_ExitCriticalSection();
 return (bRet);
 }
 
@@ -21,6 +21,10 @@ Analog Devices License Agreement.
 #include "Adbms6948_Common.h"
 #include "Adbms6948_Pec.h"
 /*============= D A T A =============*/
+/*! Register group reads that fit in one transfer, a command and a receive
+    segment each */
+#define ADBMS6948_RD_GRPS_PER_XFER  (((ADBMS6948_MAX_SPI_SEGS / 2u) < ADBMS6948_MAX_QUEUED_FRAMES) ? \
+                                     (uint16_t)(ADBMS6948_MAX_SPI_SEGS / 2u) : (uint16_t)ADBMS6948_MAX_QUEUED_FRAMES)
 
 /*============ Static Function Prototypes ============*/
 static void  Adbms6948_lIncCmdCntAllDev
@@ -28,6 +32,26 @@ static void  Adbms6948_lIncCmdCntAllDev
 const uint8_t  knChainID
 );
 
+static void  Adbms6948_lOnXferSeg
+(
+    Adbms6948_SpiXferType   *pXfer,
+    uint8_t                 nSegIdx
+);
+
+static void  Adbms6948_lWriteFrame
+(
+    const uint8_t  *pTxBuf,
+    uint16_t       nLen,
+    const uint8_t  knChainID
+);
+
+#ifndef ADI_PAL_SPISUBMIT
+static void  Adbms6948_lRunXfer
+(
+    const uint8_t  knChainID
+);
+#endif
+
 /*============= C O D E =============*/
 /* Start of code section */
 /* Code section start */
@@ -61,28 +85,22 @@ boolean   		bIncrementCmdCount,
 const uint8_t   knChainID
 )
 {
-    uint16_t   nCmdPec;
-    uint8_t   aCmd[ADBMS6948_CMD_DATA_LEN];
     uint8_t   nDevIdx, nNoOfDevInChain;
 
-    aCmd[0] = (uint8_t)((nCommand & 0xFF00u) >> ADBMS6948_SHIFT_BY_8);
-    aCmd[1] = (uint8_t)((nCommand & 0x00FFu));
-    /* Calculate the 15-bit PEC for the command bytes */
-    nCmdPec = (uint16_t)Adbms6948_Pec15Calculate(&aCmd[0], 2u);
-    /* Append the PEC to the command buffer */
-    aCmd[2] = (uint8_t)(nCmdPec >> ADBMS6948_SHIFT_BY_8);
-    aCmd[3] = (uint8_t)(nCmdPec);
-
+    Adbms6948_Cmd_BeginXfer(knChainID);
     if(nCommand == ADBMS6948_CMD_STCOMM)
     {
-    	/* Transmit the command buffer on the SPI bus */
-    	ADI_PAL_SPIWRITE(&aCmd[0], (uint8_t)(ADBMS6948_CMD_DATA_LEN + ADBMS6948_I2C_STCOMM_BYTES), knChainID);
+    	/* The devices clock their I2C or SPI out during the idle bytes after the command */
+    	(void)Adbms6948_Cmd_AddCmd(nCommand, FALSE, FALSE, knChainID);
+    	(void)Adbms6948_Cmd_AddSeg(NULL_PTR, NULL_PTR, ADBMS6948_I2C_STCOMM_BYTES, ADBMS6948_SPI_SEG_CS_RELEASE, knChainID);
     }
     else
     {
-    	/* Transmit the command buffer on the SPI bus */
-    	ADI_PAL_SPIWRITE(&aCmd[0], ADBMS6948_CMD_DATA_LEN, knChainID);
+    	(void)Adbms6948_Cmd_AddCmd(nCommand, TRUE, FALSE, knChainID);
     }
+    /* Transmit the command on the SPI bus */
+    Adbms6948_Cmd_SubmitXfer(NULL_PTR, NULL_PTR, knChainID);
+    (void)Adbms6948_Cmd_WaitXfer(knChainID);
 
     /* Does the command increment the device command count */
     if (bIncrementCmdCount == TRUE)
@@ -136,7 +154,7 @@ void Adbms6948_Cmd_ExecuteCmdCLR
     uint8_t nDevIndex, nByteIndex, nNoOfDevices;
     uint8_t	*pDevCfgArray;
     uint16_t nCfgPec, nCmdPec;
-    uint8_t nLen = 0u;
+    uint16_t nLen = 0u;
 
     aTxBuf[nLen++] = (uint8_t)((uint16_t)(nCommand & (uint16_t)0xFF00U) >> 8U);
     aTxBuf[nLen++] = (uint8_t)(nCommand & (uint16_t)0x00FFU);
@@ -164,7 +182,7 @@ void Adbms6948_Cmd_ExecuteCmdCLR
     }
 
     /* Transmit the command + data buffer on the SPI bus */
-    ADI_PAL_SPIWRITE(aTxBuf, nLen, knChainID);
+    Adbms6948_lWriteFrame(aTxBuf, nLen, knChainID);
 
     /* Increment the command counter for all the devices in the daisy chain */
     Adbms6948_lIncCmdCntAllDev(knChainID);
@@ -197,7 +215,7 @@ void  Adbms6948_Cmd_ExecuteCmdWR
     uint8_t  nDevIndex, nByteIndex, nNoOfDevices;
     uint8_t *   pDevCfgArray;
     uint16_t  nCfgPec, nCmdPec;
-    uint8_t  nLen = 0u;
+    uint16_t  nLen = 0u;
 
     aTxBuf[nLen++] = (uint8_t)((uint16_t)(nCommand & (uint16_t)0xFF00U) >> 8U);
     aTxBuf[nLen++] = (uint8_t)(nCommand & (uint16_t)0x00FFU);
@@ -225,7 +243,7 @@ void  Adbms6948_Cmd_ExecuteCmdWR
     }
 
     /* Transmit the command + data buffer on the SPI bus */
-    ADI_PAL_SPIWRITE(aTxBuf, nLen, knChainID);
+    Adbms6948_lWriteFrame(aTxBuf, nLen, knChainID);
 
     /* Increment the command counter for all the devices in the daisy chain */
     Adbms6948_lIncCmdCntAllDev(knChainID);
@@ -261,39 +279,32 @@ void  Adbms6948_Cmd_ExecuteCmdRD
     const uint8_t        knChainID
 )
 {
-    uint8_t   aTxBuf[ADBMS6948_CMD_MAX_RX_FRAMES][ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN)];
-    uint16_t  nCmdPec;
     uint16_t  nRegGroups, nGroupDataLen;
-    uint16_t   nGrpIdx, nGrpDataIdx;
-    uint16_t  nFrameStartIdx;
+    uint16_t  nGrpIdx;
 
     nRegGroups = (uint16_t)(nDataCfg >> 16u);
     nGroupDataLen = (uint16_t)(((uint16_t)nDataCfg) - ADBMS6948_CMD_DATA_LEN);
+    /* A frame per register group, its command from the chain's buffers and the
+       reply straight into the caller's frame after the command bytes. As many
+       groups go out in one transfer as fit. */
     for (nGrpIdx = 0u; nGrpIdx < nRegGroups; nGrpIdx++)
     {
-    	nFrameStartIdx = 0u;
-    	/* Populate the command code */
-    	aTxBuf[nGrpIdx][nFrameStartIdx++] = (uint8_t)((uint16_t)(pnCmdLst[nGrpIdx] & (uint16_t)0xFF00U) >> 8U);
-    	aTxBuf[nGrpIdx][nFrameStartIdx++] = (uint8_t)(pnCmdLst[nGrpIdx] & (uint16_t)0x00FFU);
-
-        /* Calculate the 15-bit PEC for the command bytes */
-        nCmdPec = Adbms6948_Pec15Calculate((uint8_t*)&aTxBuf[nGrpIdx][0u], 2u);
-
-        /* Append the PEC to the command buffer */
-        aTxBuf[nGrpIdx][nFrameStartIdx++] = (uint8_t)(nCmdPec >> 8U);
-        aTxBuf[nGrpIdx][nFrameStartIdx++] = (uint8_t)(nCmdPec);
-
-        for (nGrpDataIdx = 0u; nGrpDataIdx < nGroupDataLen; nGrpDataIdx++)
+        if (0u == (nGrpIdx % ADBMS6948_RD_GRPS_PER_XFER))
         {
-			aTxBuf[nGrpIdx][nFrameStartIdx++] = (uint8_t)0xFFu;
+            Adbms6948_Cmd_BeginXfer(knChainID);
+        }
+        (void)Adbms6948_Cmd_AddCmd(pnCmdLst[nGrpIdx], FALSE, FALSE, knChainID);
+        (void)Adbms6948_Cmd_AddSeg(NULL_PTR, &pRxBuf[nGrpIdx][ADBMS6948_CMD_DATA_LEN], nGroupDataLen,
+                ADBMS6948_SPI_SEG_CS_RELEASE, knChainID);
+        if ((((nGrpIdx + 1u) % ADBMS6948_RD_GRPS_PER_XFER) == 0u) || ((nGrpIdx + 1u) == nRegGroups))
+        {
+            Adbms6948_Cmd_SubmitXfer(NULL_PTR, NULL_PTR, knChainID);
+            (void)Adbms6948_Cmd_WaitXfer(knChainID);
         }
     }
 
-    /* Transmit the command buffer on the SPI bus */
-    ADI_PAL_SPIWRITEREADS(aTxBuf, pRxBuf, nDataCfg, knChainID);
-
     /* Does the command increment the device command count */
-    if (bIsPollCmd == TRUE)
+    if ((bIsPollCmd == TRUE) && (nRegGroups > 0u))
     {
         /* Increment the command counter maintained by the driver for all the devices in the daisy chain */
         Adbms6948_lIncCmdCntAllDev(knChainID);
@@ -320,7 +331,7 @@ void  Adbms6948_Cmd_SendDummyBytes
     const uint8_t    knChainID
 )
 {
-	ADI_PAL_SPIWRITE(pBuff, nLen, knChainID);
+	Adbms6948_lWriteFrame(pBuff, nLen, knChainID);
 }
 
 
@@ -361,7 +372,7 @@ const uint8_t  	knChainID
     aCmd[3] = (uint8_t)(nCmdPec);
 
 	/* Transmit the command buffer on the SPI bus */
-	ADI_PAL_SPIWRITE(&aCmd[0], ADBMS6948_CMD_DATA_LEN, knChainID);
+	Adbms6948_lWriteFrame(&aCmd[0], ADBMS6948_CMD_DATA_LEN, knChainID);
 
 }
 
@@ -393,7 +404,7 @@ void Adbms6948_Cmd_ExecCmdWRWithDPECBitFLip
 	uint8_t nDevIndex, nByteIndex, nNoOfDevices;
 	uint8_t *pDevCfgArray;
     uint16_t nCfgPec, nCmdPec;
-    uint8_t nLen = 0u;
+    uint16_t nLen = 0u;
 
     aTxBuf[nLen++] = (uint8_t)((uint16_t)(nCommand & (uint16_t)0xFF00U) >> 8U);
     aTxBuf[nLen++] = (uint8_t)(nCommand & (uint16_t)0x00FFU);
@@ -425,7 +436,7 @@ void Adbms6948_Cmd_ExecCmdWRWithDPECBitFLip
     }
 
     /* Transmit the command + data buffer on the SPI bus */
-    ADI_PAL_SPIWRITE(aTxBuf, nLen, knChainID);
+    Adbms6948_lWriteFrame(aTxBuf, nLen, knChainID);
 
     return;
 }
@@ -465,12 +476,149 @@ const uint8_t  knChainID
     }
 }
 
+/*!
+    @brief  Moves the command count on as each command of the chain's transfer
+            goes through, then passes the segment on.
+
+    @param [in]  pXfer      The chain's transfer
+    @param [in]  nSegIdx    The segment received
+*/
+static void  Adbms6948_lOnXferSeg
+(
+    Adbms6948_SpiXferType   *pXfer,
+    uint8_t                 nSegIdx
+)
+{
+    Adbms6948_ChainStateInfoType  *pChain = (Adbms6948_ChainStateInfoType *)pXfer->pArg;
+
+    if (0u != (pXfer->pSegs[nSegIdx].nFlags & ADBMS6948_SPI_SEG_INC_CMD_CNT))
+    {
+        Adbms6948_lIncCmdCntAllDev((uint8_t)(pChain - &Adbms6948_aoChainStateInfo[0u]));
+    }
+    if (NULL_PTR != pChain->pfnSegRx)
+    {
+        pChain->pfnSegRx(pChain->pSegRxArg, &pXfer->pSegs[nSegIdx], nSegIdx);
+    }
+}
+
+/*!
+    @brief  Sends one chip-select frame of the caller's bytes as a transfer of
+            its own, and waits for it.
+
+    @param [in]  pTxBuf     Bytes to send
+    @param [in]  nLen       Length of the frame in bytes
+    @param [in]  knChainID  The daisy chain ID to perform the operation.
+*/
+static void  Adbms6948_lWriteFrame
+(
+    const uint8_t  *pTxBuf,
+    uint16_t       nLen,
+    const uint8_t  knChainID
+)
+{
+    Adbms6948_Cmd_BeginXfer(knChainID);
+    (void)Adbms6948_Cmd_AddSeg(pTxBuf, NULL_PTR, nLen, ADBMS6948_SPI_SEG_CS_RELEASE, knChainID);
+    Adbms6948_Cmd_SubmitXfer(NULL_PTR, NULL_PTR, knChainID);
+    (void)Adbms6948_Cmd_WaitXfer(knChainID);
+}
+
+#ifndef ADI_PAL_SPISUBMIT
+/*!
+    @brief  Sends the chain's transfer a frame at a time, for a platform
+            without background transfers: each frame is gathered into the
+            chain's arena, sent, and its reply scattered to the segments.
+
+    @param [in]  knChainID  The daisy chain ID to perform the operation.
+*/
+static void  Adbms6948_lRunXfer
+(
+    const uint8_t  knChainID
+)
+{
+    Adbms6948_SpiXferType  *pXfer = &Adbms6948_aoChainStateInfo[knChainID].oXfer;
+    const Adbms6948_SpiSegType  *pSeg;
+    Adbms6948_FrameType  *pBuf;
+    uint16_t  nFrameLen, nOffset;
+    uint8_t  nFirstSeg = 0u;
+    uint8_t  nSegIdx, nIdx;
+    boolean  bRx;
+
+    for (nSegIdx = 0u; nSegIdx < pXfer->nSegs; nSegIdx++)
+    {
+        if ((0u != (pXfer->pSegs[nSegIdx].nFlags & ADBMS6948_SPI_SEG_CS_RELEASE)) || ((nSegIdx + 1u) == pXfer->nSegs))
+        {
+            nFrameLen = 0u;
+            bRx = FALSE;
+            for (nIdx = nFirstSeg; nIdx <= nSegIdx; nIdx++)
+            {
+                nFrameLen += pXfer->pSegs[nIdx].nLen;
+                if (NULL_PTR != pXfer->pSegs[nIdx].pRxBuf)
+                {
+                    bRx = TRUE;
+                }
+            }
+            pBuf = Adbms6948_Cmn_AllocFrames((uint8_t)((nFrameLen + ADBMS6948_MAX_FRAME_SIZE - 1u) / ADBMS6948_MAX_FRAME_SIZE), knChainID);
+            if (NULL_PTR == pBuf)
+            {
+                pXfer->bError = TRUE;
+            }
+            else
+            {
+                nOffset = 0u;
+                for (nIdx = nFirstSeg; nIdx <= nSegIdx; nIdx++)
+                {
+                    pSeg = &pXfer->pSegs[nIdx];
+                    if (NULL_PTR == pSeg->pTxBuf)
+                    {
+                        Adbms6948_Cmn_Memset(&pBuf[0u][nOffset], 0xFFu, pSeg->nLen);
+                    }
+                    else
+                    {
+                        Adbms6948_Cmn_Memcpy(&pBuf[0u][nOffset], (uint8_t *)pSeg->pTxBuf, pSeg->nLen);
+                    }
+                    nOffset += pSeg->nLen;
+                }
+                if (TRUE == bRx)
+                {
+                    ADI_PAL_SPIWRITEREADALL(&pBuf[0u][0u], &pBuf[0u][ADBMS6948_CMD_DATA_LEN], nFrameLen - ADBMS6948_CMD_DATA_LEN, knChainID);
+                }
+                else
+                {
+                    ADI_PAL_SPIWRITE(&pBuf[0u][0u], nFrameLen, knChainID);
+                }
+                nOffset = 0u;
+                for (nIdx = nFirstSeg; nIdx <= nSegIdx; nIdx++)
+                {
+                    pSeg = &pXfer->pSegs[nIdx];
+                    if (NULL_PTR != pSeg->pRxBuf)
+                    {
+                        Adbms6948_Cmn_Memcpy(pSeg->pRxBuf, &pBuf[0u][nOffset], pSeg->nLen);
+                    }
+                    nOffset += pSeg->nLen;
+                }
+            }
+            Adbms6948_Cmn_FreeFrames(pBuf, knChainID);
+            for (nIdx = nFirstSeg; nIdx <= nSegIdx; nIdx++)
+            {
+                if (0u != (pXfer->pSegs[nIdx].nFlags & ADBMS6948_SPI_SEG_NOTIFY))
+                {
+                    Adbms6948_lOnXferSeg(pXfer, nIdx);
+                }
+            }
+            nFirstSeg = (uint8_t)(nSegIdx + 1u);
+        }
+    }
+    pXfer->bBusy = FALSE;
+}
+#endif
+
 /*!
     @brief          Executes the command to read all register values
 
     @param[in]      nCmd        Command to send
     @param[in]      pRxBuf      Pointer to the receive buffer
-    @param[in]      nRegGrps    Number of register groups to read
+    @param[in]      nRegGrps    Number of bytes to read, data and PEC of
+                                every device that answers
     @param[in]      bIsPollCmd  Specifies poll command
     @param[in]      knChainID   The daisy chain ID to perform the operation.
  */
@@ -478,40 +626,207 @@ void  Adbms6948_Cmd_ExecuteCmdRDAll
 (
     uint8_t             *pRxBuf,
     uint16_t            nCmd,
-    uint8_t             nRegGrps,
+    uint16_t            nRegGrps,
     boolean             bIsPollCmd,
     const uint8_t       knChainID
 )
 {
-    uint8_t aTxBuf[ADBMS6948_CMD_DATA_LEN];
-	uint16_t  nCmdPec;
-    uint16_t  nFrameStartIdx;
+    /* The command, then the reply of every device straight into pRxBuf */
+    Adbms6948_Cmd_BeginXfer(knChainID);
+    (void)Adbms6948_Cmd_AddCmd(nCmd, FALSE, FALSE, knChainID);
+    (void)Adbms6948_Cmd_AddSeg(NULL_PTR, pRxBuf, nRegGrps, ADBMS6948_SPI_SEG_CS_RELEASE, knChainID);
+    Adbms6948_Cmd_SubmitXfer(NULL_PTR, NULL_PTR, knChainID);
+    (void)Adbms6948_Cmd_WaitXfer(knChainID);
+
+    /* Does the command increment the device command count */
+    if (bIsPollCmd == TRUE)
+    {
+        /* Increment the command counter maintained by the driver for all the devices in the daisy chain */
+        Adbms6948_lIncCmdCntAllDev(knChainID);
+    }
+return;
+}
+
+/*!
+    @brief          Starts a new transfer on the chain, with no segments yet.
+
+    @param[in]      knChainID   The daisy chain ID to perform the operation.
+ */
+void  Adbms6948_Cmd_BeginXfer
+(
+    const uint8_t               knChainID
+)
+{
+    Adbms6948_aoChainStateInfo[knChainID].oXfer.nSegs = 0u;
+    Adbms6948_aoChainStateInfo[knChainID].oXfer.bError = FALSE;
+    Adbms6948_aoChainStateInfo[knChainID].nXferCmds = 0u;
+return;
+}
 
-    nFrameStartIdx = 0u;
+/*!
+    @brief          Adds a segment to the chain's transfer. A transfer with
+                    more segments than fit is not sent.
 
-    /* Populate the command code */
-    aTxBuf[nFrameStartIdx++] = (uint8_t)((uint16_t)(nCmd & (uint16_t)0xFF00U) >> 8U);
-    aTxBuf[nFrameStartIdx++] = (uint8_t)(nCmd & (uint16_t)0x00FFU);
+    @param[in]      pTxBuf      Bytes to send, or NULL_PTR to send 0xFF
+    @param[in]      pRxBuf      Where the received bytes go, or NULL_PTR
+    @param[in]      nLen        Length of the segment in bytes
+    @param[in]      nFlags      ADBMS6948_SPI_SEG_ flags
+    @param[in]      knChainID   The daisy chain ID to perform the operation.
 
-    /* Calculate the 15-bit PEC for the command bytes */
-    nCmdPec = Adbms6948_Pec15Calculate((uint8_t*)&aTxBuf[0u], 2u);
+    @return         Index of the segment in the transfer
+ */
+uint8_t  Adbms6948_Cmd_AddSeg
+(
+    const uint8_t               *pTxBuf,
+    uint8_t                     *pRxBuf,
+    uint16_t                    nLen,
+    uint8_t                     nFlags,
+    const uint8_t               knChainID
+)
+{
+    Adbms6948_ChainStateInfoType  *pChain = &Adbms6948_aoChainStateInfo[knChainID];
+    uint8_t  nSegIdx = pChain->oXfer.nSegs;
 
-    /* Append the PEC to the command buffer */
-    aTxBuf[nFrameStartIdx++] = (uint8_t)(nCmdPec >> 8U);
-    aTxBuf[nFrameStartIdx++] = (uint8_t)(nCmdPec);
+    if (nSegIdx < ADBMS6948_MAX_SPI_SEGS)
+    {
+        pChain->aoSegs[nSegIdx].pTxBuf = pTxBuf;
+        pChain->aoSegs[nSegIdx].pRxBuf = pRxBuf;
+        pChain->aoSegs[nSegIdx].nLen = nLen;
+        pChain->aoSegs[nSegIdx].nFlags = nFlags;
+        pChain->oXfer.nSegs++;
+    }
+    else
+    {
+        pChain->oXfer.bError = TRUE;
+    }
+return(nSegIdx);
+}
 
-    /* Transmit the command buffer on the SPI bus */
-    ADI_PAL_SPIWRITEREADALL(aTxBuf, pRxBuf, nRegGrps, knChainID);
+/*!
+    @brief          Adds a command and its PEC to the chain's transfer, from
+                    the chain's own command buffers.
+
+    @param[in]      nCommand    Command to send
+    @param[in]      bEndOfFrame The command is a frame of its own. Otherwise
+                                the segments added next are its data.
+    @param[in]      bIncrementCmdCount  The command increments the command
+                                count on the devices. Taken for a command
+                                that is a frame of its own only.
+    @param[in]      knChainID   The daisy chain ID to perform the operation.
 
-    /* Does the command increment the device command count */
-    if (bIsPollCmd == TRUE)
+    @return         Index of the segment in the transfer
+ */
+uint8_t  Adbms6948_Cmd_AddCmd
+(
+    uint16_t                    nCommand,
+    boolean                     bEndOfFrame,
+    boolean                     bIncrementCmdCount,
+    const uint8_t               knChainID
+)
+{
+    Adbms6948_ChainStateInfoType  *pChain = &Adbms6948_aoChainStateInfo[knChainID];
+    uint8_t  *pCmd;
+    uint8_t  nFlags = 0u;
+    uint8_t  nSegIdx;
+    uint16_t  nCmdPec;
+
+    if (pChain->nXferCmds < ADBMS6948_MAX_QUEUED_FRAMES)
     {
-        /* Increment the command counter maintained by the driver for all the devices in the daisy chain */
-        Adbms6948_lIncCmdCntAllDev(knChainID);
+        pCmd = pChain->aCmdBuf[pChain->nXferCmds];
+        pChain->nXferCmds++;
+        pCmd[0u] = (uint8_t)((uint16_t)(nCommand & (uint16_t)0xFF00U) >> 8U);
+        pCmd[1u] = (uint8_t)(nCommand & (uint16_t)0x00FFU);
+        /* Calculate the 15-bit PEC for the command bytes */
+        nCmdPec = Adbms6948_Pec15Calculate(&pCmd[0u], 2u);
+        /* Append the PEC to the command buffer */
+        pCmd[2u] = (uint8_t)(nCmdPec >> 8U);
+        pCmd[3u] = (uint8_t)(nCmdPec);
+        if (TRUE == bEndOfFrame)
+        {
+            nFlags = ADBMS6948_SPI_SEG_CS_RELEASE;
+            if (TRUE == bIncrementCmdCount)
+            {
+                nFlags |= (uint8_t)(ADBMS6948_SPI_SEG_NOTIFY | ADBMS6948_SPI_SEG_INC_CMD_CNT);
+            }
+        }
+        nSegIdx = Adbms6948_Cmd_AddSeg(pCmd, NULL_PTR, ADBMS6948_CMD_DATA_LEN, nFlags, knChainID);
+    }
+    else
+    {
+        pChain->oXfer.bError = TRUE;
+        nSegIdx = pChain->oXfer.nSegs;
+    }
+return(nSegIdx);
+}
+
+/*!
+    @brief          Hands the chain's transfer to the PAL, which sends it in
+                    the background and returns. pfnSegRx takes each notified
+                    segment as it comes in, from the PAL's completion context.
+                    The driver's command count moves on as each command goes
+                    through, before pfnSegRx hears of the segments after it.
+
+    @param[in]      pfnSegRx    Takes the notified segments, or NULL_PTR
+    @param[in]      pArg        Passed to pfnSegRx
+    @param[in]      knChainID   The daisy chain ID to perform the operation.
+ */
+void  Adbms6948_Cmd_SubmitXfer
+(
+    Adbms6948_SegRxType         pfnSegRx,
+    void                        *pArg,
+    const uint8_t               knChainID
+)
+{
+    Adbms6948_ChainStateInfoType  *pChain = &Adbms6948_aoChainStateInfo[knChainID];
+
+    pChain->pfnSegRx = pfnSegRx;
+    pChain->pSegRxArg = pArg;
+    pChain->oXfer.pSegs = pChain->aoSegs;
+    pChain->oXfer.pfnSegDone = Adbms6948_lOnXferSeg;
+    pChain->oXfer.pArg = pChain;
+    if (TRUE == pChain->oXfer.bError)
+    {
+        /* Did not fit, nothing is sent */
+        pChain->oXfer.bBusy = FALSE;
+    }
+    else
+    {
+        pChain->oXfer.bBusy = TRUE;
+#ifdef ADI_PAL_SPISUBMIT
+        ADI_PAL_SPISUBMIT(&pChain->oXfer, knChainID);
+#else
+        Adbms6948_lRunXfer(knChainID);
+#endif
     }
 return;
 }
 
+/*!
+    @brief          Waits for the chain's transfer to finish.
+
+    @param[in]      knChainID   The daisy chain ID to perform the operation.
+
+    @return         E_OK: Every frame was sent \n
+                    E_NOT_OK: The transfer failed \n
+ */
+Adbms6948_ReturnType  Adbms6948_Cmd_WaitXfer
+(
+    const uint8_t               knChainID
+)
+{
+    Adbms6948_ReturnType  nRet = E_OK;
+
+#ifdef ADI_PAL_SPIWAIT
+    /* Also once bBusy has cleared, for the PAL to finish with the transfer */
+    ADI_PAL_SPIWAIT(&Adbms6948_aoChainStateInfo[knChainID].oXfer, knChainID);
+#endif
+    if (TRUE == Adbms6948_aoChainStateInfo[knChainID].oXfer.bError)
+    {
+        nRet = E_NOT_OK;
+    }
+return(nRet);
+}
+
 /* End of code section */
 /* Code section stop */
 ADBMS6948_DRV_CODE_STOP
@@ -383,11 +383,45 @@ void  Adbms6948_Cmd_ExecuteCmdRDAll
 (
     uint8_t             *pRxBuf,
     uint16_t            nCmd,
-    uint8_t             nRegGrps,
+    uint16_t            nRegGrps,
     boolean             bIsPollCmd,
     const uint8_t       knChainID
 );
 
+void  Adbms6948_Cmd_BeginXfer
+(
+    const uint8_t               knChainID
+);
+
+uint8_t  Adbms6948_Cmd_AddSeg
+(
+    const uint8_t               *pTxBuf,
+    uint8_t                     *pRxBuf,
+    uint16_t                    nLen,
+    uint8_t                     nFlags,
+    const uint8_t               knChainID
+);
+
+uint8_t  Adbms6948_Cmd_AddCmd
+(
+    uint16_t                    nCommand,
+    boolean                     bEndOfFrame,
+    boolean                     bIncrementCmdCount,
+    const uint8_t               knChainID
+);
+
+void  Adbms6948_Cmd_SubmitXfer
+(
+    Adbms6948_SegRxType         pfnSegRx,
+    void                        *pArg,
+    const uint8_t               knChainID
+);
+
+Adbms6948_ReturnType  Adbms6948_Cmd_WaitXfer
+(
+    const uint8_t               knChainID
+);
+
 
 #endif /* ADBMS6948_EXEC_CMD_H */
 
@@ -181,7 +181,7 @@ const uint8_t 					 knChainID
         #endif
     }
 	else if ((NULL_PTR == pOVThreshold) || (NULL_PTR == pEvalResult) ||
-			(ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+			(Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -275,7 +275,7 @@ const uint8_t 					 knChainID
         #endif
     }
 	else if ((NULL_PTR == pUVThreshold)|| (NULL_PTR == pEvalResult) ||
-			(ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+			(Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -356,7 +356,7 @@ const uint8_t            knChainID
                 ADBMS6948_READERRCNT_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((NULL_PTR == pErrCnt) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((NULL_PTR == pErrCnt) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Null pointer error. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -421,7 +421,7 @@ const uint8_t         knChainID
                 ADBMS6948_CLRERRCNT_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+    else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
     {
         /* Invalid ADC operation mode and/or Invalid chain ID. */
         #if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
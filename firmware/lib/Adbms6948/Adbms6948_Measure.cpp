@@ -69,6 +69,20 @@ static const uint8_t Adbms6948_ReadAllCommandBytes[ADBMS6948_READALL_COMMAND_TYP
 /* Const 16 section stop */
 ADBMS6948_DRV_CONST_DATA_16_STOP
 
+/*! A read of all the cell voltages in one transfer, checked and decoded in
+    place as each device's segment comes in */
+typedef struct
+{
+	int16_t 				*pnCellData;
+	uint16_t 				 nBufIdx;
+	uint8_t 				 nDataLenBytesWithPec;
+	uint8_t 				 nDevsDone;
+	uint8_t 				 nFirstDevSeg;
+	uint8_t 				 nVerifySeg;
+	uint8_t 				 nChainID;
+	Adbms6948_ReturnType 	 nRet;
+}Adbms6948_lCellVoltRxType;
+
 /*============= C O D E =============*/
 /* Start of code section */
 /* Code section start */
@@ -123,6 +137,12 @@ static Adbms6948_ReturnType  Adbms6948_lReadAllCellVolt
 	Adbms6948_SnapSelType 			eSnapSel,
     const uint8_t                   knChainID
 );
+static void  Adbms6948_lOnCellVoltRx
+(
+	void 							*pArg,
+	const Adbms6948_SpiSegType 		*pSeg,
+	uint8_t 						 nSegIdx
+);
 static Adbms6948_ReturnType  Adbms6948_lReadAllAverageCellVoltages
 (
 	int16_t 					   *pnCellData,
@@ -333,7 +353,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigCADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGCADC_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -416,7 +436,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigSADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGSADC_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidCellOWSelType(eOWSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidCellOWSelType(eOWSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -497,7 +517,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigAuxADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGAUXADC_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidAuxChSelType(eAuxChSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidAuxChSelType(eAuxChSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -571,7 +591,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigRedAuxADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGREDAUXADC_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidRedAuxChSelType(eRedAuxChSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidRedAuxChSelType(eRedAuxChSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -649,7 +669,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigI1ADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGI1ADC_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -729,7 +749,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigI2ADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGI2ADC_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -808,7 +828,7 @@ Adbms6948_ReturnType  Adbms6948_Int_TrigIVADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_TRIGI1CADC_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -893,7 +913,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadCADCConvCnt
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCADCCONVCNT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -971,7 +991,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadI1ADCConvCnt
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READI1ADCCONVCNT_ID, ADBMS6948_E_PARAM_POINTER);
         #endif
     }
-    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1053,7 +1073,7 @@ Adbms6948_ReturnType Adbms6948_Int_ReadVoltageCurrentCTValues
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READIVADCCONVCNT_ID, ADBMS6948_E_PARAM_POINTER);
         #endif
     }
-    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1138,7 +1158,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadCellVolt
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCellMeasDataType(eCellMeasData)) || (TRUE == Adbms6948_lIsInvalidCellGrpSelType(eCellGrpSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCellMeasDataType(eCellMeasData)) || (TRUE == Adbms6948_lIsInvalidCellGrpSelType(eCellGrpSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1218,7 +1238,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadAllCellVolt
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCellMeasDataType(eCellMeasData)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCellMeasDataType(eCellMeasData)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1293,7 +1313,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadAllAverageCellVoltages
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1375,7 +1395,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadGPIOInputVolt
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READGPIOINPUTVOLT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidGpioMeasDataType(eGpioMeasData)) || (TRUE == Adbms6948_lIsInvalidGpioGrpSelType(eGpioGrpSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidGpioMeasDataType(eGpioMeasData)) || (TRUE == Adbms6948_lIsInvalidGpioGrpSelType(eGpioGrpSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1452,7 +1472,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadDevParam
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READDEVPARAM_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidDevParamGrpSelType(eDevParamGrpSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidDevParamGrpSelType(eDevParamGrpSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1538,7 +1558,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadAllAuxStatusRegisters
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READDEVPARAM_ID, ADBMS6948_E_PARAM_POINTER);
         #endif
     }
-    else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+    else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1623,7 +1643,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadCurrent
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCURRENT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCurrentMeasDataType(eCurrentMeasData)) || (TRUE == Adbms6948_lIsInvalidCurrentSelType(eCurrentSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCurrentMeasDataType(eCurrentMeasData)) || (TRUE == Adbms6948_lIsInvalidCurrentSelType(eCurrentSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1702,7 +1722,7 @@ Adbms6948_ReturnType Adbms6948_Int_ReadCADCI1ADC
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLTAGECURRENT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1790,7 +1810,7 @@ Adbms6948_ReturnType  Adbms6948_Int_ReadCellVoltCurrentAverage
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLTAGECURRENT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1858,7 +1878,7 @@ const uint8_t  				knChainID
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_SENDCTRLCMD_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidCtrlCmdSelType(eCtrlCmdSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidCtrlCmdSelType(eCtrlCmdSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -1937,7 +1957,7 @@ const uint8_t  			 knChainID
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_POLLADCSTATUS_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_lIsInvalidADCSelType(eADCSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_lIsInvalidADCSelType(eADCSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2082,7 +2102,7 @@ Adbms6948_ReturnType Adbms6948_Int_ReadCoulombCountAndTimeBase
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLVOLTAGECURRENT_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2144,7 +2164,7 @@ Adbms6948_ReturnType Adbms6948_Int_ClearAllFlags
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CLRFLAG_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+    else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2224,7 +2244,7 @@ const uint8_t  			 knChainID
 		Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_READCELLOVUVSTATUS_ID, ADBMS6948_E_PARAM_POINTER);
 		#endif
 	}
-	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Invalid chain ID. */
 		#if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2291,7 +2311,7 @@ Adbms6948_ReturnType Adbms6948_Int_ClearCellVoltageRegisters
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CLRCELL_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2362,7 +2382,7 @@ Adbms6948_ReturnType Adbms6948_Int_ClearCurrentRegisters
         Adbms6948_Cmn_ReportDevErr(ADBMS6948_MODULE_ID, ADBMS6948_INSTANCE_ID, ADBMS6948_CLRCURRENTREGS_ID, ADBMS6948_E_MODULESTATE);
         #endif
     }
-    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCurrentSelType(eCurrentSel)) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+    else if ((TRUE == Adbms6948_Cmn_IsInvalidSnapSelType(eSnapSel)) || (TRUE == Adbms6948_lIsInvalidCurrentSelType(eCurrentSel)) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
     {
         /* Invalid chain ID. */
         #if (TRUE == ADBMS6948_DEVELOPMENT_MODE_EN)
@@ -2489,7 +2509,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadI1ADCConvCnt
 {
     Adbms6948_ReturnType  nRet;
     uint16_t  nCmdCode;
-    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
     uint16_t  anCmdList[ADBMS6948_NUMOF_REGGRP_CONVCNT];
     uint16_t  nConvCnt, nRdBufIdx;
     boolean bCfgRead = FALSE;
@@ -2553,7 +2573,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadVoltageCurrentCTValues
 {
     Adbms6948_ReturnType  nRet;
     uint16_t nCmdCode;
-    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
     uint16_t anCmdList[ADBMS6948_NUMOF_REGGRP_CONVCNT];
     uint16_t nRdBufIdx;
     boolean  bCfgRead = FALSE;
@@ -2709,7 +2729,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadCellVolt
 )
 {
 	Adbms6948_ReturnType  nRet;
-	uint8_t  anReadCellDataBuf[ADBMS6948_MAX_CELLDATA_REGGRPS][ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN)];
+	Adbms6948_FrameType  *anReadCellDataBuf;
 	uint16_t  anCmdList[ADBMS6948_MAX_CELLDATA_REGGRPS];
 	uint16_t  nCmdCode, nCellData, nRdBufIdx, nBufIdx = 0u;
 	uint8_t  nRegGrpIdx, nDevIdx, nNumOfCmds;
@@ -2725,7 +2745,15 @@ static Adbms6948_ReturnType  Adbms6948_lReadCellVolt
 	}
 	/* Send Read commands*/
 	Adbms6948_lGetCellCmdList(eCellMeasData, eCellGrpSel, anCmdList, &nNumOfCmds, knChainID);
-	nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadCellDataBuf, nNumOfCmds, knChainID);
+	anReadCellDataBuf = Adbms6948_Cmn_AllocFrames(nNumOfCmds, knChainID);
+	if (NULL_PTR == anReadCellDataBuf)
+	{
+		nRet = E_NOT_OK;
+	}
+	else
+	{
+		nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadCellDataBuf, nNumOfCmds, knChainID);
+	}
 
 	if (E_OK == nRet)
 	{
@@ -2776,6 +2804,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadCellVolt
 	/* Verify the command counter if UNSNAP command was sent*/
 	nRet |= Adbms6948_Cmn_VerifyCmdCnt(TRUE, knChainID);
 
+	Adbms6948_Cmn_FreeFrames(anReadCellDataBuf, knChainID);
 return(nRet);
 }
 /*****************************************************************************/
@@ -2807,65 +2836,167 @@ static Adbms6948_ReturnType  Adbms6948_lReadAllCellVolt
     const uint8_t                   knChainID
 )
 {
-	Adbms6948_ReturnType  nRet;
-	uint8_t  anReadCellDataBuf[ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITHOUT_PEC * ADBMS6948_MAX_CELLDATA_REGGRPS) + ADBMS6948_PEC_LEN];
-	uint16_t  nCmd;
-	uint16_t  nCmdCode, nCellData, nRdBufIdx;
-	uint8_t  nDataLenBytesWithPec;
+	Adbms6948_lCellVoltRxType  oRx;
+	Adbms6948_FrameType  *pBuf;
+	uint8_t  *pRdAllRxBuf, *pVerifyRxBuf;
+	uint16_t  nCmd, nCmdCode;
+	uint16_t  nRdAllLen, nVerifyLen;
+	uint8_t  nRdAllBufFrames, nDevIdx, nNoOfDevices, nFlags;
 	boolean  bSendSnap, bSendUnsnap;
 
-	nRdBufIdx = 0u;
-
 	bSendSnap = (boolean)((uint8_t)eSnapSel & 0x01u);
 	bSendUnsnap = (boolean)(((uint8_t)eSnapSel & 0x02u) >> 1u);
-	nDataLenBytesWithPec = Adbms6948_ReadAllCommandBytes[ADBMS6948_READALL_CELLVOLTAGES];
-	if(TRUE == bSendSnap)
-	{
-		/*Send SNAP command */
-		nCmdCode = ADBMS6948_CMD_SNAP;
-		Adbms6948_Cmn_SendCommandOnly(nCmdCode, TRUE, knChainID);
+	nNoOfDevices = Adbms6948_aoChainStateInfo[knChainID].nCurrNoOfDevices;
+
+	oRx.pnCellData = pnCellData;
+	oRx.nBufIdx = 0u;
+	oRx.nDataLenBytesWithPec = Adbms6948_ReadAllCommandBytes[ADBMS6948_READALL_CELLVOLTAGES];
+	oRx.nDevsDone = 0u;
+	oRx.nChainID = knChainID;
+	oRx.nRet = E_OK;
+
+	/* Receive buffers of the read all and of the command count check, in
+	   whole frames of the chain's arena. Commands and the idle bytes are
+	   sent from the chain's own buffers. */
+	nRdAllLen = (uint16_t)((uint16_t)oRx.nDataLenBytesWithPec * nNoOfDevices);
+	nVerifyLen = (uint16_t)((uint16_t)ADBMS6948_REG_DATA_LEN_WITH_PEC * nNoOfDevices);
+	nRdAllBufFrames = (uint8_t)((nRdAllLen + ADBMS6948_MAX_FRAME_SIZE - 1u) / ADBMS6948_MAX_FRAME_SIZE);
+	pBuf = Adbms6948_Cmn_AllocFrames((uint8_t)(nRdAllBufFrames + 1u), knChainID);
+	if (NULL_PTR == pBuf)
+	{
+		oRx.nRet = E_NOT_OK;
 	}
-	/* Send Read commands*/
-	Adbms6948_lGetCellCmd(eCellMeasData, ADBMS6948_CELL_GRP_SEL_ALL, &nCmd, knChainID);
+	else
+	{
+		pRdAllRxBuf = &pBuf[0u][0u];
+		pVerifyRxBuf = &pBuf[nRdAllBufFrames][0u];
 
-	nRet = Adbms6948_Cmn_ReadAllRegGroups(nCmd, anReadCellDataBuf, nDataLenBytesWithPec, knChainID);
+		/* SNAP, the read, UNSNAP, the clear and the command count check go out
+		   in one transfer. The reply of the read lands a device per segment,
+		   each checked and decoded in place as it comes in. */
+		Adbms6948_Cmd_BeginXfer(knChainID);
+		if(TRUE == bSendSnap)
+		{
+			(void)Adbms6948_Cmd_AddCmd(ADBMS6948_CMD_SNAP, TRUE, TRUE, knChainID);
+		}
+		Adbms6948_lGetCellCmd(eCellMeasData, ADBMS6948_CELL_GRP_SEL_ALL, &nCmd, knChainID);
+		(void)Adbms6948_Cmd_AddCmd(nCmd, FALSE, FALSE, knChainID);
+		oRx.nFirstDevSeg = Adbms6948_aoChainStateInfo[knChainID].oXfer.nSegs;
+		for (nDevIdx = 0u; nDevIdx < nNoOfDevices; nDevIdx++)
+		{
+			nFlags = ADBMS6948_SPI_SEG_NOTIFY;
+			if ((nDevIdx + 1u) == nNoOfDevices)
+			{
+				nFlags |= ADBMS6948_SPI_SEG_CS_RELEASE;
+			}
+			(void)Adbms6948_Cmd_AddSeg(NULL_PTR, &pRdAllRxBuf[(uint16_t)nDevIdx * oRx.nDataLenBytesWithPec],
+					oRx.nDataLenBytesWithPec, nFlags, knChainID);
+		}
+		if(TRUE == bSendUnsnap)
+		{
+			(void)Adbms6948_Cmd_AddCmd(ADBMS6948_CMD_UNSNAP, TRUE, TRUE, knChainID);
+		}
 
-	if (E_OK == nRet)
-	{
-		for(uint8_t nCellIdx = 0; nCellIdx < ADBMS6948_MAX_NO_OF_CELLS_PER_DEVICE; ++nCellIdx)
+		/*Clear the Cell Voltage registers*/
+		if (ADBMS6948_CELL_MEAS_DATA == eCellMeasData || ADBMS6948_CELL_MEAS_DATA_AVERAGED == eCellMeasData)
 		{
-			/* Populate the user data buffer. */
-        	nCellData = (int16_t)(((uint16_t)anReadCellDataBuf[nRdBufIdx + 1u] << 8u) | (uint16_t)anReadCellDataBuf[nRdBufIdx]);
-        	pnCellData[nCellIdx] = nCellData;
-			nRdBufIdx += 2;
+			nCmdCode = ADBMS6948_CMD_CLRCELL;
+		}
+		else if (ADBMS6948_CELL_MEAS_DATA_REDUNDANT == eCellMeasData)
+		{
+			nCmdCode = ADBMS6948_CMD_CLRSPIN;
+		}
+		else
+		{
+			nCmdCode = ADBMS6948_CMD_CLRFC;
+		}
+		(void)Adbms6948_Cmd_AddCmd(nCmdCode, TRUE, TRUE, knChainID);
+
+		/* Verify the command counter */
+		(void)Adbms6948_Cmd_AddCmd(ADBMS6948_CMD_RDCFGA, FALSE, FALSE, knChainID);
+		oRx.nVerifySeg = Adbms6948_Cmd_AddSeg(NULL_PTR, pVerifyRxBuf, nVerifyLen,
+				(uint8_t)(ADBMS6948_SPI_SEG_NOTIFY | ADBMS6948_SPI_SEG_CS_RELEASE), knChainID);
+
+		Adbms6948_Cmd_SubmitXfer(Adbms6948_lOnCellVoltRx, &oRx, knChainID);
+		if ((E_OK != Adbms6948_Cmd_WaitXfer(knChainID)) || (oRx.nDevsDone < nNoOfDevices))
+		{
+			/* The transfer failed or came back short */
+			oRx.nRet = E_NOT_OK;
 		}
-	}
-	if ((E_OK == nRet) && (TRUE == bSendUnsnap))
-	{
-		nCmdCode = ADBMS6948_CMD_UNSNAP;
-		Adbms6948_Cmn_SendCommandOnly(nCmdCode, TRUE, knChainID);
 	}
 
-	/*Clear the Cell Voltage registers*/
-	if (ADBMS6948_CELL_MEAS_DATA == eCellMeasData || ADBMS6948_CELL_MEAS_DATA_AVERAGED == eCellMeasData)
+	Adbms6948_Cmn_FreeFrames(pBuf, knChainID);
+return(oRx.nRet);
+}
+/*****************************************************************************/
+/*!
+    @brief	Local function that takes in the segments of a read of all the
+    		cell voltages. Each device's data is checked and decoded in its
+    		receive buffer as soon as its segment is in, while the devices
+    		after it are still coming in.
+
+	@param [in] 	pArg			The read, Adbms6948_lCellVoltRxType
+	@param [in] 	pSeg			The segment received
+	@param [in] 	nSegIdx			Index of the segment in the transfer
+ */
+/*****************************************************************************/
+static void  Adbms6948_lOnCellVoltRx
+(
+	void 							*pArg,
+	const Adbms6948_SpiSegType 		*pSeg,
+	uint8_t 						 nSegIdx
+)
+{
+	Adbms6948_lCellVoltRxType  *pRx = (Adbms6948_lCellVoltRxType *)pArg;
+	const uint8_t  *pData = pSeg->pRxBuf;
+	uint16_t  nRdBufIdx, nCellData;
+	uint8_t  nDevIdx, nNoOfDevices;
+	boolean  bValidData;
+
+	nNoOfDevices = Adbms6948_aoChainStateInfo[pRx->nChainID].nCurrNoOfDevices;
+	if ((nSegIdx >= pRx->nFirstDevSeg) && (nSegIdx < (pRx->nFirstDevSeg + nNoOfDevices)))
 	{
-		nCmdCode = ADBMS6948_CMD_CLRCELL;
+		nDevIdx = (uint8_t)(nSegIdx - pRx->nFirstDevSeg);
+		if (ADBMS6948_DEVICE == Adbms6948_aoChainStateInfo[pRx->nChainID].Adbms6948_eDevChain[nDevIdx])
+		{
+			bValidData = Adbms6948_Cmn_ValidatePEC((uint8_t *)pData, pRx->nDataLenBytesWithPec,
+					nDevIdx, pRx->nChainID);
+			if (TRUE == bValidData)
+			{
+				/* Populate the user data buffer. */
+				for(uint8_t nCellIdx = 0; nCellIdx < ADBMS6948_MAX_NO_OF_CELLS_PER_DEVICE; ++nCellIdx)
+				{
+					nCellData = (int16_t)(((uint16_t)pData[(2u * nCellIdx) + 1u] << 8u) |
+							(uint16_t)pData[2u * nCellIdx]);
+					pRx->pnCellData[pRx->nBufIdx + nCellIdx] = nCellData;
+				}
+			}
+			else
+			{
+				pRx->nRet = E_NOT_OK;
+			}
+			pRx->nBufIdx += ADBMS6948_MAX_NO_OF_CELLS_PER_DEVICE;
+		}
+		pRx->nDevsDone++;
 	}
-	else if (ADBMS6948_CELL_MEAS_DATA_REDUNDANT == eCellMeasData)
+	else if (nSegIdx == pRx->nVerifySeg)
 	{
-		nCmdCode = ADBMS6948_CMD_CLRSPIN;
+		for (nDevIdx = 0u; nDevIdx < nNoOfDevices; nDevIdx++)
+		{
+			nRdBufIdx = (uint16_t)((uint16_t)nDevIdx * ADBMS6948_REG_DATA_LEN_WITH_PEC);
+			bValidData = Adbms6948_Cmn_ValidatePEC((uint8_t *)&pData[nRdBufIdx], ADBMS6948_REG_DATA_LEN_WITH_PEC,
+					nDevIdx, pRx->nChainID);
+			if ((ADBMS6948_DEVICE == Adbms6948_aoChainStateInfo[pRx->nChainID].Adbms6948_eDevChain[nDevIdx]) &&
+				(TRUE != bValidData))
+			{
+				pRx->nRet = E_NOT_OK;
+			}
+		}
 	}
-	else if (ADBMS6948_CELL_MEAS_DATA_FILTERED == eCellMeasData)
+	else
 	{
-		nCmdCode = ADBMS6948_CMD_CLRFC;
+		/* Nothing to take from a command */
 	}
-
-	Adbms6948_Cmn_SendCommandOnly(nCmdCode, TRUE, knChainID);
-
-	/* Verify the command counter if UNSNAP command was sent*/
-	nRet |= Adbms6948_Cmn_VerifyCmdCnt(TRUE, knChainID);
-
-return(nRet);
 }
 /*****************************************************************************/
 /*!
@@ -2890,7 +3021,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadAllAverageCellVoltages
 )
 {
 	Adbms6948_ReturnType  nRet;
-	uint8_t anRDSTATBuff[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+	uint8_t anRDSTATBuff[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
 	uint8_t anReadDataBuf[(ADBMS6948_REG_DATA_LEN_WITHOUT_PEC * ADBMS6948_MAX_CELLDATA_REGGRPS) + ADBMS6948_PEC_LEN];
 	uint16_t nVoltageCT;
 	uint16_t nRdBufIdx = 0u;
@@ -2990,7 +3121,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadCurrent
 )
 {
 	Adbms6948_ReturnType  nRet;
-	uint8_t		anReadCurrentDataBuf[ADBMS6948_MAX_CURRENT_REGGRPS][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+	uint8_t		anReadCurrentDataBuf[ADBMS6948_MAX_CURRENT_REGGRPS][ADBMS6948_MAX_FRAME_SIZE];
 	uint16_t	anCmdList[ADBMS6948_MAX_CURRENT_REGGRPS];
 	uint16_t	nCmdCode, nRdBufIdx, nBufIdx = 0u;
 	uint32_t	nCurrentData;
@@ -3234,7 +3365,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadCellVoltCurrentAverage
 )
 {
 	Adbms6948_ReturnType  nRet;
-	uint8_t anRDSTATBuff[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+	uint8_t anRDSTATBuff[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
 	uint8_t anReadDataBuf[ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITHOUT_PEC * ADBMS6948_NUMOF_REGGRP_RDCIV) + ADBMS6948_PEC_LEN];
 	uint16_t nVoltageCT, nCurrentCT;
 	uint16_t nRdBufIdx = 0u;
@@ -3402,14 +3533,22 @@ static Adbms6948_ReturnType  Adbms6948_lReadGPIOInputVolt
 )
 {
 	Adbms6948_ReturnType  nRet;
-	uint8_t  anReadGpioDataBuf[ADBMS6948_MAX_GPIODATA_REGGRPS][ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN)];
+	Adbms6948_FrameType  *anReadGpioDataBuf;
 	uint16_t  anCmdList[ADBMS6948_MAX_GPIODATA_REGGRPS];
 	uint16_t  nGpioData, nRdBufIdx;
 	uint8_t  nRegGrpIdx, nNumOfCmds, nBufIdx = 0u;
 
 	/* Send Read commands*/
 	Adbms6948_lGetGPIOCmdList(eGpioMeasData, eGpioGrpSel, anCmdList, &nNumOfCmds);
-	nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadGpioDataBuf, nNumOfCmds, knChainID);
+	anReadGpioDataBuf = Adbms6948_Cmn_AllocFrames(nNumOfCmds, knChainID);
+	if (NULL_PTR == anReadGpioDataBuf)
+	{
+		nRet = E_NOT_OK;
+	}
+	else
+	{
+		nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadGpioDataBuf, nNumOfCmds, knChainID);
+	}
 
 	if (E_OK == nRet)
 	{
@@ -3434,6 +3573,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadGPIOInputVolt
             }
         }
     }
+	Adbms6948_Cmn_FreeFrames(anReadGpioDataBuf, knChainID);
 return(nRet);
 }
 /*****************************************************************************/
@@ -3505,14 +3645,22 @@ static Adbms6948_ReturnType  Adbms6948_lReadDevParam
 )
 {
 	Adbms6948_ReturnType nRet;
-	uint8_t  anReadDevParamBuf[ADBMS6948_MAX_DEV_PARAM_REGGRPS][ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN)];
+	Adbms6948_FrameType  *anReadDevParamBuf;
 	uint16_t  anCmdList[ADBMS6948_MAX_DEV_PARAM_REGGRPS];
 	uint16_t  nDevParam, nRdBufIdx;
 	uint8_t  nRegGrpIdx, nNumOfCmds, nBufIdx = 0u;
 
 	/* Send Read commands*/
 	Adbms6948_lGetDevParamCmdList(eDevParamGrpSel, anCmdList, &nNumOfCmds);
-	nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadDevParamBuf, nNumOfCmds, knChainID);
+	anReadDevParamBuf = Adbms6948_Cmn_AllocFrames(nNumOfCmds, knChainID);
+	if (NULL_PTR == anReadDevParamBuf)
+	{
+		nRet = E_NOT_OK;
+	}
+	else
+	{
+		nRet = Adbms6948_Cmn_ReadRegGroup(anCmdList, anReadDevParamBuf, nNumOfCmds, knChainID);
+	}
 
 	if (E_OK == nRet)
 	{
@@ -3536,6 +3684,7 @@ static Adbms6948_ReturnType  Adbms6948_lReadDevParam
             }
 		}
 	}
+	Adbms6948_Cmn_FreeFrames(anReadDevParamBuf, knChainID);
 return(nRet);
 }
 /*****************************************************************************/
@@ -3944,7 +4093,7 @@ static Adbms6948_ReturnType Adbms6948_lReadCoulombCountAndTimeBase
 {
     Adbms6948_ReturnType  nRet;
     uint16_t  nCmdCode;
-    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+    uint8_t  anRdBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
     uint16_t  anCmdList[ADBMS6948_NUMOF_REGGRP_ONE];
     uint16_t  nTimeBase, nRdBufIdx;
     uint32_t nCoulombCnt;
@@ -4002,7 +4151,7 @@ static Adbms6948_ReturnType Adbms6948_lClearFlags
     Adbms6948_ReturnType nRet;
     uint16_t  nCmdCode;
 
-    uint8_t anWrBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITH_PEC];
+    uint8_t anWrBuf[ADBMS6948_NUMOF_REGGRP_ONE][ADBMS6948_MAX_FRAME_SIZE];
 
     /*Set all the bits that have to be cleared*/
     anWrBuf[0][ADBMS6948_CMD_DATA_LEN] = 0xFF;
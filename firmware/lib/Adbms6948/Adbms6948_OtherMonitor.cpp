@@ -135,7 +135,7 @@ const uint8_t    knChainID
 		ADBMS6948_READDEVREVCODE_ID,ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pRevCode) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pRevCode) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -244,7 +244,7 @@ const uint8_t  						knChainID
 		ADBMS6948_SOFTRESET_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID)
+	else if (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID)
 	{
 		/* Invalid chain ID. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -312,7 +312,7 @@ const uint8_t 	 knChainID
 		ADBMS6948_READDEVSERID_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((NULL_PTR == pSerialidCode) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((NULL_PTR == pSerialidCode) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* Null pointer error. */
 		#if (ADBMS6948_DEVELOPMENT_MODE_EN == TRUE)
@@ -405,7 +405,7 @@ const uint8_t				knChainID
 		ADBMS6948_AOMEMWRITE_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((panData == NULL_PTR) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((panData == NULL_PTR) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* NULL pointer passed */
 		#if ( ADBMS6948_DEVELOPMENT_MODE_EN == TRUE )
@@ -478,7 +478,7 @@ const uint8_t				knChainID
 		ADBMS6948_AOMEMREAD_ID, ADBMS6948_E_MODULESTATE);
 		#endif
 	}
-	else if ((panData == NULL_PTR) || (ADBMS6948_NO_OF_DAISY_CHAIN <= knChainID))
+	else if ((panData == NULL_PTR) || (Adbms6948_pConfig->Adbms6948_nNoOfChains <= knChainID))
 	{
 		/* NULL pointer passed */
 		#if ( ADBMS6948_DEVELOPMENT_MODE_EN == TRUE )
@@ -17,12 +17,61 @@ Analog Devices License Agreement.
 */
 /*============= I N C L U D E S =============*/
 #include "Adbms6948_Pec.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <cpuid.h>
+#include <wmmintrin.h>
+/** The carry-less multiply engine is built for this host */
+#define ADBMS6948_PEC_CLMUL_BUILT
+#define ADBMS6948_PEC_CLMUL_TARGET	__attribute__((target("pclmul,sse2")))
+#endif
+
+/*============== D E F I N E S ===============*/
+/** Tables in the slice-by-4 engines */
+#define ADBMS6948_PEC_SLICES			(4u)
+/** PEC15 polynomial with its x^15 term, x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1 */
+#define ADBMS6948_PEC15_POLY			((uint16_t)0xC599u)
+/** PEC10 polynomial with its x^10 term, x^10 + x^7 + x^3 + x^2 + x + 1 */
+#define ADBMS6948_PEC10_POLY			((uint16_t)0x048Fu)
+#define ADBMS6948_PEC15_MASK			((uint16_t)0x7FFFu)
+#define ADBMS6948_PEC10_MASK			((uint16_t)0x03FFu)
+#define ADBMS6948_PEC_SEED				((uint16_t)16u)
+/** Buffers the self-check compares per engine, and the longest of them */
+#define ADBMS6948_PEC_CHECK_BUFFERS		(256u)
+#define ADBMS6948_PEC_CHECK_MAX_LEN		(96u)
+/** Rounds over the timed lengths per trial, and trials per engine, the best one counting */
+#define ADBMS6948_PEC_TIME_RUNS			(64u)
+#define ADBMS6948_PEC_TIME_TRIALS		(3u)
+#define ADBMS6948_PEC_TIME_LENGTHS		(3u)
+
+/*============= D A T A T Y P E S =============*/
+/** An engine: the remainder after the data, from a starting remainder */
+typedef uint16_t (*Adbms6948_PecEngineFnType)(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+
+/*============ Static Function Prototypes ============*/
+static uint16_t Adbms6948_lPec15Table(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+static uint16_t Adbms6948_lPec10Table(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+static uint16_t Adbms6948_lPec15Slice4(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+static uint16_t Adbms6948_lPec10Slice4(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+#ifdef ADBMS6948_PEC_CLMUL_BUILT
+static uint16_t Adbms6948_lPec15Clmul(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+static uint16_t Adbms6948_lPec10Clmul(const uint8_t *pDataBuf, uint8_t nLength, uint16_t nRemainder);
+#endif
+static uint64_t Adbms6948_lPolyQuotient(uint8_t nDividendDeg, uint16_t nPoly, uint8_t nPolyDeg);
+static boolean Adbms6948_lPecSelfCheck(Adbms6948_PecEngineFnType pfPec15, Adbms6948_PecEngineFnType pfPec10);
+#ifdef ADI_PAL_CPU_TIME_NS
+static uint32_t Adbms6948_lPecTime(Adbms6948_PecEngineFnType pfPec15, Adbms6948_PecEngineFnType pfPec10);
+#endif
 /*============= D A T A =============*/
 /* Const 16 section start */
 ADBMS6948_DRV_CONST_DATA_16_START
 
+/** The data lengths the driver checks PECs over: a register group, and one device of a read
+    all of the cells and of the aux and status groups */
+static const uint16_t  Adbms6948_aPecTimeLen[ADBMS6948_PEC_TIME_LENGTHS] = {6u, 32u, 82u};
+
 /* Pre-computed CRC15 Table */
-static const int Adbms6948_Crc15Table[256] = {0x0u,0xc599u, 0xceabu, 0xb32u, 0xd8cfu, 0x1d56u, 0x1664u, 0xd3fdu, 0xf407u, 0x319eu, 0x3aacu,
+static const uint16_t  Adbms6948_Crc15Table[256] = {0x0u,0xc599u, 0xceabu, 0xb32u, 0xd8cfu, 0x1d56u, 0x1664u, 0xd3fdu, 0xf407u, 0x319eu, 0x3aacu,
         0xff35u, 0x2cc8u, 0xe951u, 0xe263u, 0x27fau, 0xad97u, 0x680eu, 0x633cu, 0xa6a5u, 0x7558u, 0xb0c1u,
         0xbbf3u, 0x7e6au, 0x5990u, 0x9c09u, 0x973bu, 0x52a2u, 0x815fu, 0x44c6u, 0x4ff4u, 0x8a6du, 0x5b2eu,
         0x9eb7u, 0x9585u, 0x501cu, 0x83e1u, 0x4678u, 0x4d4au, 0x88d3u, 0xaf29u, 0x6ab0u, 0x6182u, 0xa41bu,
@@ -70,12 +119,217 @@ static const uint16_t  Adbms6948_Crc10Table[256] =
 /* Const 16 section stop */
 ADBMS6948_DRV_CONST_DATA_16_STOP
 
+/* Uninitialized Data section start */
+ADBMS6948_DRV_UNINIT_DATA_START
+
+/** Slice-by-4 tables, [k][v] is v * x^(8k + PEC width) mod the polynomial */
+static uint16_t  Adbms6948_aPec15Slice[ADBMS6948_PEC_SLICES][256];
+static uint16_t  Adbms6948_aPec10Slice[ADBMS6948_PEC_SLICES][256];
+
+/* Uninitialized Data section stop */
+ADBMS6948_DRV_UNINIT_DATA_STOP
+
+/* Initialized Data section start */
+ADBMS6948_DRV_INIT_DATA_START
+
+/** floor(x^(64 + PEC width) / polynomial) without its x^64 term, for the carry-less multiply engine */
+static uint64_t  Adbms6948_nPec15Mu = 0u;
+static uint64_t  Adbms6948_nPec10Mu = 0u;
+
+/** Engines that passed the self-check in Adbms6948_PecInit */
+static boolean  Adbms6948_abPecEngineOk[ADBMS6948_PEC_ENGINE_INVALID] = { TRUE, FALSE, FALSE };
+
+/** What each engine took on the timed lengths in Adbms6948_PecInit, 0 if not timed */
+static uint32_t  Adbms6948_anPecEngineNs[ADBMS6948_PEC_ENGINE_INVALID] = { 0u, 0u, 0u };
+
+/** The engine in use, the table one until Adbms6948_PecInit picks one */
+static Adbms6948_PecEngineType  Adbms6948_ePecEngine = ADBMS6948_PEC_ENGINE_TABLE;
+static Adbms6948_PecEngineFnType  Adbms6948_pfPec15Engine = Adbms6948_lPec15Table;
+static Adbms6948_PecEngineFnType  Adbms6948_pfPec10Engine = Adbms6948_lPec10Table;
+
+/* Initialized Data section stop */
+ADBMS6948_DRV_INIT_DATA_STOP
+
 
 /*============= C O D E =============*/
 /* Start of code section */
 /* Code section start */
 ADBMS6948_DRV_CODE_START
 
+/*!
+    @brief  Builds the slice-by-4 tables and the carry-less multiply constants, checks every
+    engine the host can run against the table engine on pseudo-random buffers and seeds, times
+    the ones that matched on the lengths the driver checks and selects the fastest. A platform
+    without ADI_PAL_CPU_TIME_NS gets slice-by-4, which beats the table engine on every host
+    measured. Called from Adbms6948_Init, and safe to call again.
+
+    @return  None.
+ */
+void Adbms6948_PecInit
+(
+    void
+)
+{
+    uint16_t  nValue;
+    uint8_t   nSlice;
+    Adbms6948_PecEngineType  eEngine;
+    Adbms6948_PecEngineType  eFastest = ADBMS6948_PEC_ENGINE_TABLE;
+
+    for (nValue = 0u; nValue < 256u; nValue++)
+    {
+        /* The byte tables carry a junk bit above the PEC, masked here */
+        Adbms6948_aPec15Slice[0u][nValue] = (uint16_t)(Adbms6948_Crc15Table[nValue] & ADBMS6948_PEC15_MASK);
+        Adbms6948_aPec10Slice[0u][nValue] = (uint16_t)(Adbms6948_Crc10Table[nValue] & ADBMS6948_PEC10_MASK);
+    }
+    for (nSlice = 1u; nSlice < ADBMS6948_PEC_SLICES; nSlice++)
+    {
+        for (nValue = 0u; nValue < 256u; nValue++)
+        {
+            /* One more zero byte through the previous table */
+            Adbms6948_aPec15Slice[nSlice][nValue] = Adbms6948_lPec15Table((const uint8_t*)"\0", 1u,
+                Adbms6948_aPec15Slice[nSlice - 1u][nValue]);
+            Adbms6948_aPec10Slice[nSlice][nValue] = Adbms6948_lPec10Table((const uint8_t*)"\0", 1u,
+                Adbms6948_aPec10Slice[nSlice - 1u][nValue]);
+        }
+    }
+    Adbms6948_abPecEngineOk[ADBMS6948_PEC_ENGINE_SLICE4] =
+        Adbms6948_lPecSelfCheck(Adbms6948_lPec15Slice4, Adbms6948_lPec10Slice4);
+
+    Adbms6948_nPec15Mu = Adbms6948_lPolyQuotient(79u, ADBMS6948_PEC15_POLY, 15u);
+    Adbms6948_nPec10Mu = Adbms6948_lPolyQuotient(74u, ADBMS6948_PEC10_POLY, 10u);
+    Adbms6948_abPecEngineOk[ADBMS6948_PEC_ENGINE_CLMUL] = FALSE;
+#ifdef ADBMS6948_PEC_CLMUL_BUILT
+    {
+        unsigned int  nEax, nEbx, nEcx, nEdx;
+        /* CPUID leaf 1, ECX bit 1 is PCLMULQDQ */
+        if ((__get_cpuid(1u, &nEax, &nEbx, &nEcx, &nEdx) != 0) && ((nEcx & bit_PCLMUL) != 0u))
+        {
+            Adbms6948_abPecEngineOk[ADBMS6948_PEC_ENGINE_CLMUL] =
+                Adbms6948_lPecSelfCheck(Adbms6948_lPec15Clmul, Adbms6948_lPec10Clmul);
+        }
+    }
+#endif
+
+#ifdef ADI_PAL_CPU_TIME_NS
+    for (eEngine = ADBMS6948_PEC_ENGINE_TABLE; eEngine < ADBMS6948_PEC_ENGINE_INVALID;
+         eEngine = (Adbms6948_PecEngineType)(eEngine + 1u))
+    {
+        Adbms6948_anPecEngineNs[eEngine] = 0u;
+        if (E_OK == Adbms6948_PecSelectEngine(eEngine))
+        {
+            Adbms6948_anPecEngineNs[eEngine] = Adbms6948_lPecTime(Adbms6948_pfPec15Engine, Adbms6948_pfPec10Engine);
+            if (Adbms6948_anPecEngineNs[eEngine] < Adbms6948_anPecEngineNs[eFastest])
+            {
+                eFastest = eEngine;
+            }
+        }
+    }
+#else
+    if (TRUE == Adbms6948_abPecEngineOk[ADBMS6948_PEC_ENGINE_SLICE4])
+    {
+        eFastest = ADBMS6948_PEC_ENGINE_SLICE4;
+    }
+#endif
+    (void)Adbms6948_PecSelectEngine(eFastest);
+}
+
+/*!
+    @brief  Tells whether an engine passed the self-check and can be selected.
+
+    @param  [in]  eEngine  The engine.
+
+    @return  TRUE if the engine can be selected.
+ */
+boolean Adbms6948_PecIsEngineAvailable
+(
+    Adbms6948_PecEngineType  eEngine
+)
+{
+    boolean  bAvailable = FALSE;
+
+    if (eEngine < ADBMS6948_PEC_ENGINE_INVALID)
+    {
+        bAvailable = Adbms6948_abPecEngineOk[eEngine];
+    }
+    return (bAvailable);
+}
+
+/*!
+    @brief  Selects the engine behind Adbms6948_Pec15Calculate and Adbms6948_Pec10Calculate.
+    Not to be called while another task is computing a PEC.
+
+    @param  [in]  eEngine  The engine.
+
+    @return  E_OK: Success \n
+             E_NOT_OK: The engine is not available on this host \n
+ */
+Adbms6948_ReturnType Adbms6948_PecSelectEngine
+(
+    Adbms6948_PecEngineType  eEngine
+)
+{
+    Adbms6948_ReturnType  nRet = E_NOT_OK;
+
+    if (TRUE == Adbms6948_PecIsEngineAvailable(eEngine))
+    {
+        nRet = E_OK;
+        Adbms6948_ePecEngine = eEngine;
+        switch (eEngine)
+        {
+            case ADBMS6948_PEC_ENGINE_SLICE4:
+                Adbms6948_pfPec15Engine = Adbms6948_lPec15Slice4;
+                Adbms6948_pfPec10Engine = Adbms6948_lPec10Slice4;
+                break;
+#ifdef ADBMS6948_PEC_CLMUL_BUILT
+            case ADBMS6948_PEC_ENGINE_CLMUL:
+                Adbms6948_pfPec15Engine = Adbms6948_lPec15Clmul;
+                Adbms6948_pfPec10Engine = Adbms6948_lPec10Clmul;
+                break;
+#endif
+            default:
+                Adbms6948_pfPec15Engine = Adbms6948_lPec15Table;
+                Adbms6948_pfPec10Engine = Adbms6948_lPec10Table;
+                break;
+        }
+    }
+    return (nRet);
+}
+
+/*!
+    @brief  Tells what an engine took on the lengths Adbms6948_PecInit times them on, the best
+    of its trials.
+
+    @param  [in]  eEngine  The engine.
+
+    @return  Nanoseconds, 0 if the engine is not available or the platform has no clock.
+ */
+uint32_t Adbms6948_PecGetEngineTime
+(
+    Adbms6948_PecEngineType  eEngine
+)
+{
+    uint32_t  nTime = 0u;
+
+    if (TRUE == Adbms6948_PecIsEngineAvailable(eEngine))
+    {
+        nTime = Adbms6948_anPecEngineNs[eEngine];
+    }
+    return (nTime);
+}
+
+/*!
+    @brief  Returns the engine in use.
+
+    @return  The engine behind Adbms6948_Pec15Calculate and Adbms6948_Pec10Calculate.
+ */
+Adbms6948_PecEngineType Adbms6948_PecGetEngine
+(
+    void
+)
+{
+    return (Adbms6948_ePecEngine);
+}
+
 /*!
     @brief  This function is used to calculate the 15-bit PEC for a data buffer. It is used for
     command words.
@@ -92,21 +346,11 @@ uint16_t Adbms6948_Pec15Calculate
     uint8_t   	 nLength
 )
 {
-    uint16_t  nRemainder, nTableAddr;
-    uint8_t   nByteIndex;
-
-    nRemainder = 16u;/* initialize the PEC */
+    uint16_t  nRemainder;
 
-    /* loops for each byte in data array */
-    for (nByteIndex = 0u; nByteIndex < nLength; nByteIndex++)
-    {
-        /* calculate PEC table address */
-        nTableAddr = (uint16_t)(((uint16_t)(nRemainder >> 7) ^ (uint8_t)pDataBuf[nByteIndex]) &
-                (uint8_t)0xff);
-        nRemainder = (uint16_t)((nRemainder << 8) ^ Adbms6948_Crc15Table[nTableAddr]);
-    }
+    nRemainder = Adbms6948_pfPec15Engine(pDataBuf, nLength, ADBMS6948_PEC_SEED);
     /* The CRC15 has a 0 in the LSB so the remainder must be multiplied by 2 */
-    return(nRemainder * 2u);
+    return((uint16_t)(nRemainder * 2u));
 }
 
 /*!
@@ -128,19 +372,12 @@ boolean  	 bIsRxCmd,
 uint8_t   	 nLength
 )
 {
-    uint16_t   nRemainder = 16u;/* PEC_SEED */
+    uint16_t   nRemainder;
     /* x10 + x7 + x3 + x2 + x + 1 <- the CRC10 polynomial 100 1000 1111 */
     uint16_t   nPolynomial = 0x8Fu;
-    uint8_t   nByteIndex, nBitIndex;
-    uint16_t   nTableAddr;
+    uint8_t   nBitIndex;
 
-    for (nByteIndex = 0u; nByteIndex < nLength; ++nByteIndex)
-    {
-        /* calculate PEC table address */
-        nTableAddr = (uint16_t)(((uint16_t)(nRemainder >> 2) ^ (uint8_t)pDataBuf[nByteIndex]) &
-                (uint8_t)0xff);
-        nRemainder = (uint16_t)(((uint16_t)(nRemainder << 8)) ^ Adbms6948_Crc10Table[nTableAddr]);
-    }
+    nRemainder = Adbms6948_pfPec10Engine(pDataBuf, nLength, ADBMS6948_PEC_SEED);
     /* If array is from received buffer add command counter to crc calculation */
     if (bIsRxCmd == TRUE)
     {
@@ -163,6 +400,314 @@ uint8_t   	 nLength
     return ((uint16_t)(nRemainder & 0x3FFu));
 }
 
+/*!
+    @brief  PEC15 one byte at a time through the 256-entry table. The reference engine.
+ */
+static uint16_t Adbms6948_lPec15Table
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint16_t  nTableAddr;
+    uint8_t   nByteIndex;
+
+    /* loops for each byte in data array */
+    for (nByteIndex = 0u; nByteIndex < nLength; nByteIndex++)
+    {
+        /* calculate PEC table address */
+        nTableAddr = (uint16_t)(((uint16_t)(nRemainder >> 7) ^ (uint8_t)pDataBuf[nByteIndex]) &
+                (uint8_t)0xff);
+        nRemainder = (uint16_t)((nRemainder << 8) ^ Adbms6948_Crc15Table[nTableAddr]);
+    }
+    return ((uint16_t)(nRemainder & ADBMS6948_PEC15_MASK));
+}
+
+/*!
+    @brief  PEC10 one byte at a time through the 256-entry table. The reference engine.
+ */
+static uint16_t Adbms6948_lPec10Table
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint16_t  nTableAddr;
+    uint8_t   nByteIndex;
+
+    for (nByteIndex = 0u; nByteIndex < nLength; ++nByteIndex)
+    {
+        /* calculate PEC table address */
+        nTableAddr = (uint16_t)(((uint16_t)(nRemainder >> 2) ^ (uint8_t)pDataBuf[nByteIndex]) &
+                (uint8_t)0xff);
+        nRemainder = (uint16_t)(((uint16_t)(nRemainder << 8)) ^ Adbms6948_Crc10Table[nTableAddr]);
+    }
+    return ((uint16_t)(nRemainder & ADBMS6948_PEC10_MASK));
+}
+
+/*!
+    @brief  PEC15 four bytes at a time: the remainder is folded into the top of the next 32 data
+    bits, and each of their bytes is looked up in the table for its distance from the end.
+ */
+static uint16_t Adbms6948_lPec15Slice4
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint32_t  nWord;
+
+    while (nLength >= 4u)
+    {
+        nWord = ((uint32_t)pDataBuf[0] << 24) | ((uint32_t)pDataBuf[1] << 16) |
+                ((uint32_t)pDataBuf[2] << 8) | (uint32_t)pDataBuf[3];
+        nWord ^= (uint32_t)nRemainder << 17;
+        nRemainder = (uint16_t)(Adbms6948_aPec15Slice[3u][nWord >> 24] ^
+                                Adbms6948_aPec15Slice[2u][(nWord >> 16) & 0xFFu] ^
+                                Adbms6948_aPec15Slice[1u][(nWord >> 8) & 0xFFu] ^
+                                Adbms6948_aPec15Slice[0u][nWord & 0xFFu]);
+        pDataBuf += 4u;
+        nLength -= 4u;
+    }
+    return (Adbms6948_lPec15Table(pDataBuf, nLength, nRemainder));
+}
+
+/*!
+    @brief  PEC10 four bytes at a time, as Adbms6948_lPec15Slice4.
+ */
+static uint16_t Adbms6948_lPec10Slice4
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint32_t  nWord;
+
+    while (nLength >= 4u)
+    {
+        nWord = ((uint32_t)pDataBuf[0] << 24) | ((uint32_t)pDataBuf[1] << 16) |
+                ((uint32_t)pDataBuf[2] << 8) | (uint32_t)pDataBuf[3];
+        nWord ^= (uint32_t)nRemainder << 22;
+        nRemainder = (uint16_t)(Adbms6948_aPec10Slice[3u][nWord >> 24] ^
+                                Adbms6948_aPec10Slice[2u][(nWord >> 16) & 0xFFu] ^
+                                Adbms6948_aPec10Slice[1u][(nWord >> 8) & 0xFFu] ^
+                                Adbms6948_aPec10Slice[0u][nWord & 0xFFu]);
+        pDataBuf += 4u;
+        nLength -= 4u;
+    }
+    return (Adbms6948_lPec10Table(pDataBuf, nLength, nRemainder));
+}
+
+#ifdef ADBMS6948_PEC_CLMUL_BUILT
+/*!
+    @brief  Carry-less product of two polynomials of up to 64 terms, as low and high halves.
+ */
+ADBMS6948_PEC_CLMUL_TARGET static inline __m128i Adbms6948_lClmul
+(
+    uint64_t  nA,
+    uint64_t  nB
+)
+{
+    return (_mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)nA), _mm_cvtsi64_si128((long long)nB), 0x00));
+}
+
+/*!
+    @brief  Reads 8 bytes, the first the most significant.
+ */
+static inline uint64_t Adbms6948_lLoadBE64
+(
+    const uint8_t 	*pDataBuf
+)
+{
+    uint64_t  nWord = 0u;
+    uint8_t   nByteIndex;
+
+    for (nByteIndex = 0u; nByteIndex < 8u; nByteIndex++)
+    {
+        nWord = (nWord << 8) | pDataBuf[nByteIndex];
+    }
+    return (nWord);
+}
+
+/*!
+    @brief  PEC15 eight bytes at a time by Barrett reduction. With T the next 64 data bits and
+    the remainder folded into their top, the new remainder is T * x^15 mod P. The quotient is
+    (T * mu) >> 64 with mu = floor(x^79 / P) = x^64 + mu', which is T + ((T * mu') >> 64), and
+    the remainder is the low 15 bits of quotient * P.
+ */
+ADBMS6948_PEC_CLMUL_TARGET static uint16_t Adbms6948_lPec15Clmul
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint64_t  nWord, nQuotient;
+    __m128i   nProduct;
+
+    while (nLength >= 8u)
+    {
+        nWord = Adbms6948_lLoadBE64(pDataBuf) ^ ((uint64_t)nRemainder << 49);
+        nProduct = Adbms6948_lClmul(nWord, Adbms6948_nPec15Mu);
+        nQuotient = nWord ^ (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(nProduct, nProduct));
+        nRemainder = (uint16_t)((uint64_t)_mm_cvtsi128_si64(Adbms6948_lClmul(nQuotient, ADBMS6948_PEC15_POLY)) &
+                                ADBMS6948_PEC15_MASK);
+        pDataBuf += 8u;
+        nLength -= 8u;
+    }
+    return (Adbms6948_lPec15Slice4(pDataBuf, nLength, nRemainder));
+}
+
+/*!
+    @brief  PEC10 eight bytes at a time, as Adbms6948_lPec15Clmul with mu = floor(x^74 / P).
+ */
+ADBMS6948_PEC_CLMUL_TARGET static uint16_t Adbms6948_lPec10Clmul
+(
+    const uint8_t 	*pDataBuf,
+    uint8_t   		 nLength,
+    uint16_t  		 nRemainder
+)
+{
+    uint64_t  nWord, nQuotient;
+    __m128i   nProduct;
+
+    while (nLength >= 8u)
+    {
+        nWord = Adbms6948_lLoadBE64(pDataBuf) ^ ((uint64_t)nRemainder << 54);
+        nProduct = Adbms6948_lClmul(nWord, Adbms6948_nPec10Mu);
+        nQuotient = nWord ^ (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(nProduct, nProduct));
+        nRemainder = (uint16_t)((uint64_t)_mm_cvtsi128_si64(Adbms6948_lClmul(nQuotient, ADBMS6948_PEC10_POLY)) &
+                                ADBMS6948_PEC10_MASK);
+        pDataBuf += 8u;
+        nLength -= 8u;
+    }
+    return (Adbms6948_lPec10Slice4(pDataBuf, nLength, nRemainder));
+}
+#endif
+
+/*!
+    @brief  The low 64 bits of floor(x^nDividendDeg / P), by long division through a window
+    one bit wider than P, for the Barrett constants.
+ */
+static uint64_t Adbms6948_lPolyQuotient
+(
+    uint8_t   nDividendDeg,
+    uint16_t  nPoly,
+    uint8_t   nPolyDeg
+)
+{
+    /* The dividend bits from nBit down to nBit - nPolyDeg, x^nDividendDeg alone to start */
+    uint32_t  nWindow = (uint32_t)1u << nPolyDeg;
+    uint64_t  nQuotient = 0u;
+    uint8_t   nBit;
+
+    for (nBit = nDividendDeg; nBit >= nPolyDeg; nBit--)
+    {
+        if ((nWindow >> nPolyDeg) != 0u)
+        {
+            if ((uint8_t)(nBit - nPolyDeg) < 64u)
+            {
+                nQuotient |= (uint64_t)1u << (nBit - nPolyDeg);
+            }
+            nWindow ^= nPoly;
+        }
+        nWindow <<= 1;
+    }
+    return (nQuotient);
+}
+
+/*!
+    @brief  Compares an engine pair with the table engines on pseudo-random buffers of every
+    length up to ADBMS6948_PEC_CHECK_MAX_LEN, from pseudo-random starting remainders.
+
+    @return  TRUE if every remainder matched.
+ */
+static boolean Adbms6948_lPecSelfCheck
+(
+    Adbms6948_PecEngineFnType  pfPec15,
+    Adbms6948_PecEngineFnType  pfPec10
+)
+{
+    uint8_t   aBuf[ADBMS6948_PEC_CHECK_MAX_LEN];
+    uint32_t  nState = 0x6948u;
+    uint16_t  nBufIdx, nSeed;
+    uint8_t   nByteIdx, nLength;
+    boolean   bMatch = TRUE;
+
+    for (nBufIdx = 0u; (nBufIdx < ADBMS6948_PEC_CHECK_BUFFERS) && (TRUE == bMatch); nBufIdx++)
+    {
+        nLength = (uint8_t)(nBufIdx % (ADBMS6948_PEC_CHECK_MAX_LEN + 1u));
+        for (nByteIdx = 0u; nByteIdx < nLength; nByteIdx++)
+        {
+            /* Numerical Recipes LCG, top byte */
+            nState = (nState * 1664525u) + 1013904223u;
+            aBuf[nByteIdx] = (uint8_t)(nState >> 24);
+        }
+        nState = (nState * 1664525u) + 1013904223u;
+        nSeed = (uint16_t)(nState >> 16);
+        if ((pfPec15(aBuf, nLength, (uint16_t)(nSeed & ADBMS6948_PEC15_MASK)) !=
+             Adbms6948_lPec15Table(aBuf, nLength, (uint16_t)(nSeed & ADBMS6948_PEC15_MASK))) ||
+            (pfPec10(aBuf, nLength, (uint16_t)(nSeed & ADBMS6948_PEC10_MASK)) !=
+             Adbms6948_lPec10Table(aBuf, nLength, (uint16_t)(nSeed & ADBMS6948_PEC10_MASK))))
+        {
+            bMatch = FALSE;
+        }
+    }
+    return (bMatch);
+}
+
+#ifdef ADI_PAL_CPU_TIME_NS
+/*!
+    @brief  Times an engine pair over the lengths the driver checks PECs over, the best of
+    ADBMS6948_PEC_TIME_TRIALS trials so a preempted one does not count.
+
+    @return  Nanoseconds of the best trial, at least 1.
+ */
+static uint32_t Adbms6948_lPecTime
+(
+    Adbms6948_PecEngineFnType  pfPec15,
+    Adbms6948_PecEngineFnType  pfPec10
+)
+{
+    uint8_t   aBuf[ADBMS6948_PEC_CHECK_MAX_LEN];
+    uint8_t   nByteIdx, nLenIdx, nTrial;
+    uint16_t  nRun;
+    uint16_t  nRemainder = ADBMS6948_PEC_SEED;
+    uint64_t  nStart, nTime;
+    uint32_t  nBest = 0xFFFFFFFFu;
+
+    for (nByteIdx = 0u; nByteIdx < ADBMS6948_PEC_CHECK_MAX_LEN; nByteIdx++)
+    {
+        aBuf[nByteIdx] = (uint8_t)((nByteIdx * 37u) + 11u);
+    }
+    for (nTrial = 0u; nTrial < ADBMS6948_PEC_TIME_TRIALS; nTrial++)
+    {
+        nStart = ADI_PAL_CPU_TIME_NS();
+        for (nRun = 0u; nRun < ADBMS6948_PEC_TIME_RUNS; nRun++)
+        {
+            for (nLenIdx = 0u; nLenIdx < ADBMS6948_PEC_TIME_LENGTHS; nLenIdx++)
+            {
+                /* Each result feeds the next, so none of the runs can be left out */
+                aBuf[0] = (uint8_t)nRemainder;
+                nRemainder = pfPec15(aBuf, (uint8_t)Adbms6948_aPecTimeLen[nLenIdx], ADBMS6948_PEC_SEED);
+                aBuf[0] = (uint8_t)nRemainder;
+                nRemainder = pfPec10(aBuf, (uint8_t)Adbms6948_aPecTimeLen[nLenIdx], 0u);
+            }
+        }
+        nTime = ADI_PAL_CPU_TIME_NS() - nStart;
+        if (nTime < nBest)
+        {
+            nBest = (uint32_t)nTime;
+        }
+    }
+    return ((nBest > 0u) ? nBest : 1u);
+}
+#endif
+
 /* End of code section */
 /* Code section stop */
 ADBMS6948_DRV_CODE_STOP
@@ -24,8 +24,43 @@ Analog Devices License Agreement.
 /*============= I N C L U D E S =============*/
 #include "Adbms6948_Types.h"
 
+/*============= D A T A T Y P E S =============*/
+/** PEC engines */
+typedef enum
+{
+    ADBMS6948_PEC_ENGINE_TABLE = 0u,	/*!< One byte per step through a 256-entry table */
+    ADBMS6948_PEC_ENGINE_SLICE4,		/*!< Four bytes per step through four 256-entry tables */
+    ADBMS6948_PEC_ENGINE_CLMUL,			/*!< Eight bytes per step by carry-less multiply, x86-64 hosts with PCLMULQDQ */
+    ADBMS6948_PEC_ENGINE_INVALID		/*!< Invalid */
+}Adbms6948_PecEngineType;
+
 /*======= P U B L I C P R O T O T Y P E S ========*/
 
+void Adbms6948_PecInit
+(
+    void
+);
+
+boolean Adbms6948_PecIsEngineAvailable
+(
+    Adbms6948_PecEngineType  eEngine
+);
+
+Adbms6948_ReturnType Adbms6948_PecSelectEngine
+(
+    Adbms6948_PecEngineType  eEngine
+);
+
+uint32_t Adbms6948_PecGetEngineTime
+(
+    Adbms6948_PecEngineType  eEngine
+);
+
+Adbms6948_PecEngineType Adbms6948_PecGetEngine
+(
+    void
+);
+
 uint16_t Adbms6948_Pec15Calculate
 (
     uint8_t 	*pDataBuf,
@@ -231,6 +231,33 @@ Analog Devices License Agreement.
 /** Maximum size of a frame */
 #define ADBMS6948_MAX_FRAME_SIZE				(ADBMS6948_CMD_DATA_LEN + (ADBMS6948_REG_DATA_LEN_WITH_PEC * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN))
 
+/** Frames in the scratch arena of each chain. The deepest user is a six group
+    read: the caller's frames, Adbms6948_Cmn_ReadRegGroup's and the transmit
+    frames of Adbms6948_Cmd_ExecuteCmdRD. */
+#define ADBMS6948_FRAME_ARENA_FRAMES			((uint8_t)18u)
+
+/** Maximum number of frames queued in one transfer */
+#define ADBMS6948_MAX_QUEUED_FRAMES				((uint8_t)0x05u)
+
+/** Maximum number of segments in one transfer: one for each command, one for
+    each device of a read all and one for the data of a read */
+#define ADBMS6948_MAX_SPI_SEGS					(ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN + ADBMS6948_MAX_QUEUED_FRAMES + 1u)
+
+/** Chip select goes high after the segment, ending the frame */
+#define ADBMS6948_SPI_SEG_CS_RELEASE			((uint8_t)0x01u)
+
+/** The PAL calls pfnSegDone once the segment is received */
+#define ADBMS6948_SPI_SEG_NOTIFY				((uint8_t)0x02u)
+
+/** The segment ends a command that increments the command count on the
+    devices. Used by the driver only. */
+#define ADBMS6948_SPI_SEG_INC_CMD_CNT			((uint8_t)0x04u)
+
+#ifndef ADI_PAL_DMA_ALIGNED
+/** Alignment the platform's SPI DMA takes buffers at */
+#define ADI_PAL_DMA_ALIGNED
+#endif
+
 /** Maximum frame size of "read All" frame*/
 /**FIXME: Above macro will fail for ReadCIV types of commands*/
 #define ADBMS6948_MAX_READALL_FRAME_SIZE        (ADBMS6948_CMD_DATA_LEN + ADBMS6948_REG_DATA_LEN_WITHOUT_PEC * ADBMS6948_MAX_REGISTERS_IN_A_GRP)
@@ -818,6 +845,61 @@ typedef uint16_t Adbms6948_RuntimeErrorIdType;
  */
 typedef uint8_t Adbms6948_RuntimeErrorStatusType;
 
+/**
+ * One command frame for a full chain: command, PEC and every device's data.
+ */
+typedef uint8_t Adbms6948_FrameType[ADBMS6948_MAX_FRAME_SIZE];
+
+/*! \struct Adbms6948_SpiSeg
+   One piece of a frame of a transfer: a frame is its segments up to the one
+   with ADBMS6948_SPI_SEG_CS_RELEASE, sent under one chip select.
+*/
+typedef struct Adbms6948_SpiSeg
+{
+    /*! Bytes to send, nLen of them, or NULL_PTR to send 0xFF */
+    const uint8_t *    pTxBuf;
+    /*! Where the received bytes go, or NULL_PTR to drop them */
+    uint8_t *    pRxBuf;
+    /*! Length of the segment in bytes */
+    uint16_t    nLen;
+    /*! ADBMS6948_SPI_SEG_ flags */
+    uint8_t    nFlags;
+}Adbms6948_SpiSegType;
+
+struct Adbms6948_SpiXfer;
+
+/**
+ * Called by the PAL once a segment flagged ADBMS6948_SPI_SEG_NOTIFY is
+ * received, in segment order, while the rest of the transfer goes on.
+ */
+typedef void (*Adbms6948_SpiSegDoneType)(struct Adbms6948_SpiXfer *pXfer, uint8_t nSegIdx);
+
+/*! \struct Adbms6948_SpiXfer
+   A transfer the PAL runs in the background: its frames go out back to back.
+   Segment buffers must stay put and be DMA capable until bBusy clears.
+*/
+typedef struct Adbms6948_SpiXfer
+{
+    /*! Segments of the transfer, in order */
+    const Adbms6948_SpiSegType *    pSegs;
+    /*! Number of segments */
+    uint8_t    nSegs;
+    /*! Called as notified segments come in, or NULL_PTR */
+    Adbms6948_SpiSegDoneType    pfnSegDone;
+    /*! Context of the driver's callbacks */
+    void *    pArg;
+    /*! Set on submit, cleared by the PAL once the last callback returned */
+    volatile boolean    bBusy;
+    /*! Set by the PAL if a frame could not be sent */
+    volatile boolean    bError;
+}Adbms6948_SpiXferType;
+
+/**
+ * Takes a received segment of the chain's transfer, reading it where the DMA
+ * left it.
+ */
+typedef void (*Adbms6948_SegRxType)(void *pArg, const Adbms6948_SpiSegType *pSeg, uint8_t nSegIdx);
+
 /* Enumerations */
 
 /*! \enum Adbms6948_eDevChainType
@@ -911,6 +993,31 @@ typedef struct
     /*! Chain State */
     volatile Adbms6948_ChainStateType    eChainState;
 
+    /*! Frames in use at the top of the chain's scratch arena */
+    uint8_t     nArenaTop;
+
+    /*! Scratch frames of the chain, so a long chain's frames are not on the
+        stack. The PAL's DMA reads and writes them in place. */
+    ADI_PAL_DMA_ALIGNED Adbms6948_FrameType    aoArena[ADBMS6948_FRAME_ARENA_FRAMES];
+
+    /*! Commands of the chain's transfer */
+    ADI_PAL_DMA_ALIGNED uint8_t    aCmdBuf[ADBMS6948_MAX_QUEUED_FRAMES][ADBMS6948_CMD_DATA_LEN];
+
+    /*! Segments of the chain's transfer */
+    Adbms6948_SpiSegType    aoSegs[ADBMS6948_MAX_SPI_SEGS];
+
+    /*! The chain's transfer */
+    Adbms6948_SpiXferType    oXfer;
+
+    /*! Commands in the chain's transfer */
+    uint8_t    nXferCmds;
+
+    /*! Takes the notified segments of the chain's transfer */
+    Adbms6948_SegRxType    pfnSegRx;
+
+    /*! Context of pfnSegRx */
+    void *    pSegRxArg;
+
     /*! Device type in the chain */
     Adbms6948_eDevChainType	Adbms6948_eDevChain[ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
 	/*! Wakeup enable flag for LPCM services */
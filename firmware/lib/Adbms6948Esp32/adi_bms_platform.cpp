@@ -0,0 +1,294 @@
+#include "adi_bms_platform.h"
+#include "Adbms6948_Types.h"
+#include "Adbms6948_Measure.h"
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace
+{
+
+const char* TAG = "adbms6948";
+// Longest frame the driver builds: a read all of the status of a full chain
+const size_t MAX_FRAME = ADBMS6948_CMD_DATA_LEN + ADBMS6948_RDALL_AUX_STATUS_BYTES * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN;
+// Above the Arduino loop task, so the segments are decoded as they come in
+const UBaseType_t CHAIN_TASK_PRIORITY = 5;
+const uint32_t CHAIN_TASK_STACK = 4096;
+
+struct Chain
+{
+    spi_device_handle_t spi;
+    // Transfers submitted and not yet taken by the chain's task
+    QueueHandle_t xfers;
+    // Given once a transfer's last segment is through
+    SemaphoreHandle_t done;
+    SemaphoreHandle_t lock;
+    // 0xFF for the segments without transmit data, for the devices to answer on
+    uint8_t* idle;
+    // One transaction per run of segments, and the last segment of each
+    spi_transaction_t trans[ADBMS6948_MAX_SPI_SEGS];
+    uint8_t last_seg[ADBMS6948_MAX_SPI_SEGS];
+    volatile bool error;
+};
+
+Chain chains[ADBMS6948_NO_OF_DAISY_CHAIN];
+SemaphoreHandle_t critical;
+// The hosts this layer initialized, which the chains after the first may share
+bool host_ours[SPI_HOST_MAX];
+
+bool isUp(uint8_t chain_id)
+{
+    return chain_id < ADBMS6948_NO_OF_DAISY_CHAIN && chains[chain_id].spi;
+}
+
+// The next segment carries on where this one stopped, in both buffers
+bool contiguous(const Adbms6948_SpiSeg& seg, const Adbms6948_SpiSeg& next)
+{
+    bool tx = seg.pTxBuf ? next.pTxBuf == seg.pTxBuf + seg.nLen : !next.pTxBuf;
+    bool rx = seg.pRxBuf ? next.pRxBuf == seg.pRxBuf + seg.nLen : !next.pRxBuf;
+    return tx && rx;
+}
+
+// Turns the segments into transactions. A segment that ends off a word
+// boundary takes the contiguous segments after it along, so the DMA reads and
+// writes the driver's buffers in place rather than through a bounce buffer.
+uint8_t buildTransactions(Chain& chain, const Adbms6948_SpiXfer* xfer)
+{
+    const Adbms6948_SpiSeg* segs = xfer->pSegs;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < xfer->nSegs; i++) {
+        uint8_t first = i;
+        size_t length = segs[i].nLen;
+        while ((length & 3) && i + 1 < xfer->nSegs && !(segs[i].nFlags & ADBMS6948_SPI_SEG_CS_RELEASE) &&
+               contiguous(segs[i], segs[i + 1]) && (segs[first].pTxBuf || length + segs[i + 1].nLen <= MAX_FRAME)) {
+            i++;
+            length += segs[i].nLen;
+        }
+        spi_transaction_t& t = chain.trans[count];
+        memset(&t, 0, sizeof(t));
+        t.length = length * 8;
+        t.tx_buffer = segs[first].pTxBuf ? segs[first].pTxBuf : chain.idle;
+        t.rx_buffer = segs[first].pRxBuf;
+        // Chip select stays low into the next segment of the frame
+        bool frame_ends = (segs[i].nFlags & ADBMS6948_SPI_SEG_CS_RELEASE) || i + 1 == xfer->nSegs;
+        if (!frame_ends) t.flags = SPI_TRANS_CS_KEEP_ACTIVE;
+        chain.last_seg[count] = i;
+        count++;
+    }
+    return count;
+}
+
+void runXfer(Chain& chain, Adbms6948_SpiXfer* xfer)
+{
+    uint8_t count = buildTransactions(chain, xfer);
+    uint8_t queued = 0;
+    bool failed = false;
+    // Keeping chip select low between transactions takes the bus to ourselves
+    spi_device_acquire_bus(chain.spi, portMAX_DELAY);
+    while (queued < count && spi_device_queue_trans(chain.spi, &chain.trans[queued], portMAX_DELAY) == ESP_OK) {
+        queued++;
+    }
+    failed = queued < count;
+
+    uint8_t next_seg = 0;
+    for (uint8_t i = 0; i < queued; i++) {
+        spi_transaction_t* t = nullptr;
+        if (spi_device_get_trans_result(chain.spi, &t, portMAX_DELAY) != ESP_OK) failed = true;
+        for (; !failed && next_seg <= chain.last_seg[i]; next_seg++) {
+            if ((xfer->pSegs[next_seg].nFlags & ADBMS6948_SPI_SEG_NOTIFY) && xfer->pfnSegDone) {
+                xfer->pfnSegDone(xfer, next_seg);
+            }
+        }
+    }
+    spi_device_release_bus(chain.spi);
+    if (failed) {
+        chain.error = true;
+        xfer->bError = TRUE;
+    }
+}
+
+void chainTask(void* arg)
+{
+    Chain& chain = *static_cast<Chain*>(arg);
+    for (;;) {
+        Adbms6948_SpiXfer* xfer = nullptr;
+        if (xQueueReceive(chain.xfers, &xfer, portMAX_DELAY) != pdTRUE) continue;
+        runXfer(chain, xfer);
+        xfer->bBusy = FALSE;
+        xSemaphoreGive(chain.done);
+    }
+}
+
+// One chip-select frame from the caller's task, the command and then either
+// the rest of tx or length bytes of 0xFF
+void frame(uint8_t chain_id, const uint8_t* tx, uint8_t* rx, size_t length, const uint8_t* command = nullptr)
+{
+    if (!isUp(chain_id) || length > MAX_FRAME) {
+        if (chain_id < ADBMS6948_NO_OF_DAISY_CHAIN) chains[chain_id].error = true;
+        return;
+    }
+    Chain& chain = chains[chain_id];
+    spi_transaction_t t[2] = {};
+    uint8_t count = 0;
+    if (command) {
+        t[0].length = ADBMS6948_CMD_DATA_LEN * 8;
+        t[0].tx_buffer = command;
+        t[0].flags = SPI_TRANS_CS_KEEP_ACTIVE;
+        count++;
+    }
+    t[count].length = length * 8;
+    t[count].tx_buffer = tx ? tx : chain.idle;
+    t[count].rx_buffer = rx;
+    count++;
+    spi_device_acquire_bus(chain.spi, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++) {
+        if (spi_device_polling_transmit(chain.spi, &t[i]) != ESP_OK) chain.error = true;
+    }
+    spi_device_release_bus(chain.spi);
+}
+
+} // namespace
+
+bool adiPalBeginChain(uint8_t chain_id, spi_host_device_t host, const AdiPalSpiPins& pins, uint32_t clock_hz)
+{
+    if (chain_id >= ADBMS6948_NO_OF_DAISY_CHAIN || chains[chain_id].spi) return false;
+    Chain& chain = chains[chain_id];
+    if (!critical) critical = xSemaphoreCreateRecursiveMutex();
+
+    spi_bus_config_t bus = {};
+    bus.sclk_io_num = pins.sck;
+    bus.mosi_io_num = pins.mosi;
+    bus.miso_io_num = pins.miso;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = MAX_FRAME;
+    // A host some other driver initialized, like the W5500's SPI2, is not ours
+    // to put a device on
+    if (host >= SPI_HOST_MAX) return false;
+    if (!host_ours[host]) {
+        if (spi_bus_initialize(host, &bus, SPI_DMA_CH_AUTO) != ESP_OK) return false;
+        host_ours[host] = true;
+    }
+
+    // The ADBMS6948 and its isoSPI transceivers take SPI mode 3
+    spi_device_interface_config_t device = {};
+    device.mode = 3;
+    device.clock_speed_hz = clock_hz;
+    device.spics_io_num = pins.cs;
+    device.queue_size = ADBMS6948_MAX_SPI_SEGS;
+    spi_device_handle_t spi = nullptr;
+    if (spi_bus_add_device(host, &device, &spi) != ESP_OK) return false;
+
+    chain.idle = static_cast<uint8_t*>(heap_caps_malloc((MAX_FRAME + 3) & ~3u, MALLOC_CAP_DMA));
+    chain.xfers = xQueueCreate(1, sizeof(Adbms6948_SpiXfer*));
+    chain.done = xSemaphoreCreateBinary();
+    chain.lock = xSemaphoreCreateMutex();
+    if (!chain.idle || !chain.xfers || !chain.done || !chain.lock || !critical) return false;
+    memset(chain.idle, 0xFF, MAX_FRAME);
+    chain.spi = spi;
+    if (xTaskCreate(chainTask, "adbms6948", CHAIN_TASK_STACK, &chain, CHAIN_TASK_PRIORITY, nullptr) != pdPASS) {
+        chain.spi = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void adiPalSpiWrite(const uint8_t* data, uint16_t length, uint8_t chain_id)
+{
+    frame(chain_id, data, nullptr, length);
+}
+
+void adiPalSpiWriteReads(const uint8_t* tx, size_t tx_stride, uint8_t* rx, size_t rx_stride,
+                         uint32_t config, uint8_t chain_id)
+{
+    uint16_t length = config & 0xFFFF;
+    uint16_t frames = config >> 16;
+    if (length > tx_stride || length > rx_stride) {
+        if (chain_id < ADBMS6948_NO_OF_DAISY_CHAIN) chains[chain_id].error = true;
+        return;
+    }
+    for (uint16_t i = 0; i < frames; i++) {
+        frame(chain_id, tx + i * tx_stride, rx + i * rx_stride, length);
+    }
+}
+
+void adiPalSpiWriteReadAll(const uint8_t* command, uint8_t* rx, uint16_t length, uint8_t chain_id)
+{
+    frame(chain_id, nullptr, rx, length, command);
+}
+
+void adiPalSpiSubmit(Adbms6948_SpiXfer* xfer, uint8_t chain_id)
+{
+    if (!isUp(chain_id)) {
+        if (chain_id < ADBMS6948_NO_OF_DAISY_CHAIN) chains[chain_id].error = true;
+        xfer->bError = TRUE;
+        xfer->bBusy = FALSE;
+        return;
+    }
+    xQueueSend(chains[chain_id].xfers, &xfer, portMAX_DELAY);
+}
+
+void adiPalSpiWait(Adbms6948_SpiXfer* xfer, uint8_t chain_id)
+{
+    if (!isUp(chain_id)) return;
+    // A transfer that was never sent leaves nothing to take
+    while (xfer->bBusy) xSemaphoreTake(chains[chain_id].done, portMAX_DELAY);
+}
+
+void adiPalTimerDelay(uint32_t us, uint8_t chain_id)
+{
+    // Whole ticks go to the other tasks
+    if (us >= 1000 * portTICK_PERIOD_MS) {
+        vTaskDelay(us / (1000 * portTICK_PERIOD_MS));
+        us %= 1000 * portTICK_PERIOD_MS;
+    }
+    delayMicroseconds(us);
+}
+
+uint64_t adiPalCpuTimeNs()
+{
+    return static_cast<uint64_t>(esp_timer_get_time()) * 1000;
+}
+
+boolean adiPalIsError(uint8_t chain_id)
+{
+    if (chain_id >= ADBMS6948_NO_OF_DAISY_CHAIN) return TRUE;
+    boolean error = chains[chain_id].error ? TRUE : FALSE;
+    chains[chain_id].error = false;
+    return error;
+}
+
+void adiPalReportRuntimeError(uint16_t error_id, uint8_t status)
+{
+    if (status == 0) return;
+    ESP_LOGW(TAG, "runtime error %u", error_id);
+}
+
+void adiPalReportDevelopmentError(uint16_t module_id, uint8_t instance_id, uint8_t api_id, uint8_t error)
+{
+    ESP_LOGE(TAG, "development error %u in API %u", error, api_id);
+}
+
+void adiPalEnterCritical()
+{
+    if (critical) xSemaphoreTakeRecursive(critical, portMAX_DELAY);
+}
+
+void adiPalExitCritical()
+{
+    if (critical) xSemaphoreGiveRecursive(critical);
+}
+
+void adiPalLockChain(uint8_t chain_id)
+{
+    if (isUp(chain_id)) xSemaphoreTake(chains[chain_id].lock, portMAX_DELAY);
+}
+
+void adiPalUnlockChain(uint8_t chain_id)
+{
+    if (isUp(chain_id)) xSemaphoreGive(chains[chain_id].lock);
+}
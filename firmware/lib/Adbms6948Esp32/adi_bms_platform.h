@@ -0,0 +1,94 @@
+#ifndef ADI_BMS_PLATFORM_H
+#define ADI_BMS_PLATFORM_H
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+#include <string.h>
+
+// The platform layer the Adbms6948 driver is written against, on the ESP32-S3:
+// each chain ID is an isoSPI transceiver on an SPI host of its own, and the
+// frames move by DMA straight from and to the driver's buffers. Transfers run
+// from the SPI driver's queue while the driver goes on; a task per chain hands
+// their segments back to the driver as they come in.
+// The host build supplies its own adi_bms_platform.h in lib/NativeSim.
+
+#ifndef TRUE
+#define TRUE 1u
+#endif
+#ifndef FALSE
+#define FALSE 0u
+#endif
+#define E_OK 0u
+#define E_NOT_OK 1u
+#define STD_ON 1u
+#define STD_OFF 0u
+#define NULL_PTR nullptr
+
+struct Adbms6948_SpiXfer;
+
+struct AdiPalSpiPins
+{
+    int sck;
+    int mosi;
+    int miso;
+    int cs;
+};
+
+// Board setup, not used by the driver. The ESP32-S3 has two SPI hosts for
+// peripherals, SPI2 and SPI3, and the W5500 takes SPI2 (src/ethernet.cpp), so
+// next to Ethernet the chains all go on SPI3. The first chain on a host
+// initializes it with its pins; the next ones share its clock and data lines
+// with a chip select of their own, and their transfers take turns on the bus.
+// False for a host another driver owns, or if the bus, the chain's DMA
+// buffers or its task can't be set up.
+bool adiPalBeginChain(uint8_t chain_id, spi_host_device_t host, const AdiPalSpiPins& pins, uint32_t clock_hz);
+
+// What the macros below call
+void adiPalSpiWrite(const uint8_t* data, uint16_t length, uint8_t chain_id);
+// One frame per buffer row: config bits 15:0 are the frame length, 31:16 the
+// number of frames
+void adiPalSpiWriteReads(const uint8_t* tx, size_t tx_stride, uint8_t* rx, size_t rx_stride,
+                         uint32_t config, uint8_t chain_id);
+// A read all command: length is the data and PEC of as many devices as are
+// read, copied to the start of rx
+void adiPalSpiWriteReadAll(const uint8_t* command, uint8_t* rx, uint16_t length, uint8_t chain_id);
+// Queues the transfer's segments with the SPI driver and returns. The chain's
+// task calls pfnSegDone for the notified segments as their transactions
+// complete and clears bBusy once the last is through. Wait blocks until then.
+void adiPalSpiSubmit(Adbms6948_SpiXfer* xfer, uint8_t chain_id);
+void adiPalSpiWait(Adbms6948_SpiXfer* xfer, uint8_t chain_id);
+void adiPalTimerDelay(uint32_t us, uint8_t chain_id);
+// Microseconds since boot, in nanoseconds
+uint64_t adiPalCpuTimeNs();
+boolean adiPalIsError(uint8_t chain_id);
+void adiPalReportRuntimeError(uint16_t error_id, uint8_t status);
+void adiPalReportDevelopmentError(uint16_t module_id, uint8_t instance_id, uint8_t api_id, uint8_t error);
+void adiPalEnterCritical();
+void adiPalExitCritical();
+void adiPalLockChain(uint8_t chain_id);
+void adiPalUnlockChain(uint8_t chain_id);
+
+#define ADI_PAL_SPIWRITE(buf, len, chain) adiPalSpiWrite((buf), (len), (chain))
+#define ADI_PAL_SPIWRITEREADS(tx, rx, cfg, chain) \
+    adiPalSpiWriteReads(&(tx)[0][0], sizeof((tx)[0]), &(rx)[0][0], sizeof((rx)[0]), (cfg), (chain))
+#define ADI_PAL_SPIWRITEREADALL(tx, rx, len, chain) adiPalSpiWriteReadAll((tx), (rx), (len), (chain))
+#define ADI_PAL_SPISUBMIT(xfer, chain) adiPalSpiSubmit((xfer), (chain))
+#define ADI_PAL_SPIWAIT(xfer, chain) adiPalSpiWait((xfer), (chain))
+// The SPI DMA takes buffers in internal RAM at word boundaries and whole words
+// long; others go through a bounce buffer the SPI driver allocates per
+// transaction
+#define ADI_PAL_DMA_ALIGNED alignas(4)
+#define ADI_PAL_TIMERDELAY(us, chain) adiPalTimerDelay((us), (chain))
+#define ADI_PAL_CPU_TIME_NS() adiPalCpuTimeNs()
+#define ADI_PAL_ISERROR(chain) adiPalIsError(chain)
+#define ADI_PAL_REPORT_RUNTIME_ERROR(id, status) adiPalReportRuntimeError((id), (status))
+#define ADI_PAL_REPORT_DEVELOPMENT_ERROR(module, instance, api, error) \
+    adiPalReportDevelopmentError((module), (instance), (api), (error))
+#define ADI_PAL_CRITICAL_SECTION_START adiPalEnterCritical()
+#define ADI_PAL_CRITICAL_SECTION_STOP adiPalExitCritical()
+#define ADI_PAL_CHAIN_LOCK(chain) adiPalLockChain(chain)
+#define ADI_PAL_CHAIN_UNLOCK(chain) adiPalUnlockChain(chain)
+#define ADI_PAL_MEMSET(dst, value, len) memset((dst), (value), (len))
+#define ADI_PAL_MEMCPY(dst, src, len) memcpy((dst), (src), (len))
+
+#endif // ADI_BMS_PLATFORM_H
@@ -0,0 +1,217 @@
+#include "Arduino.h"
+
+HWCDC USBSerial;
+HWCDC Serial;
+EspClass ESP;
+
+namespace
+{
+    // Per thread, so chains driven from their own threads each keep the time
+    // of their own bus. Firmware runs on one thread and sees a single clock.
+    thread_local uint64_t sim_time_us = 0;
+    void (*yield_hook)() = nullptr;
+    bool in_yield = false;
+    uint8_t pin_values[64];
+}
+
+// Simulation control
+
+uint64_t Sim::now()
+{
+    return sim_time_us;
+}
+
+void Sim::advance(uint64_t us)
+{
+    sim_time_us += us;
+}
+
+void Sim::setYieldHook(void (*hook)())
+{
+    yield_hook = hook;
+}
+
+// Time
+
+uint32_t micros()
+{
+    return (uint32_t)sim_time_us;
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(sim_time_us / 1000);
+}
+
+void delay(uint32_t ms)
+{
+    // The other tasks get a turn every tick, as under the FreeRTOS scheduler
+    do {
+        if (ms > 0) {
+            sim_time_us += 1000;
+            ms--;
+        }
+        yield();
+    } while (ms > 0);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    sim_time_us += us;
+}
+
+void yield()
+{
+    // A job that waits inside the hook must not re-enter it
+    if (!yield_hook || in_yield) return;
+    in_yield = true;
+    yield_hook();
+    in_yield = false;
+}
+
+// GPIO
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < sizeof(pin_values)) pin_values[pin] = value;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < sizeof(pin_values) ? pin_values[pin] : LOW;
+}
+
+// String
+
+static std::string formatInteger(unsigned long value, bool negative, unsigned char base)
+{
+    if (base < 2) base = 10;
+    std::string digits;
+    do {
+        digits.insert(digits.begin(), "0123456789ABCDEF"[value % base]);
+        value /= base;
+    } while (value);
+    if (negative) digits.insert(digits.begin(), '-');
+    return digits;
+}
+
+static std::string formatFloat(double value, unsigned char decimals)
+{
+    if (isnan(value)) return "nan";
+    if (isinf(value)) return "inf";
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    return buffer;
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+String::String(long value, unsigned char base) :
+    text(base == DEC ? formatInteger(value < 0 ? -(unsigned long)value : value, value < 0, base) :
+                       formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(float value, unsigned char decimals) : text(formatFloat(value, decimals)) {}
+String::String(double value, unsigned char decimals) : text(formatFloat(value, decimals)) {}
+
+int String::indexOf(char c, unsigned int from) const
+{
+    size_t index = text.find(c, from);
+    return index == std::string::npos ? -1 : (int)index;
+}
+
+int String::indexOf(const String& s, unsigned int from) const
+{
+    size_t index = text.find(s.text, from);
+    return index == std::string::npos ? -1 : (int)index;
+}
+
+String String::substring(unsigned int from) const
+{
+    return substring(from, text.length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to) std::swap(from, to);
+    if (from >= text.length()) return String();
+    return String(text.substr(from, to - from));
+}
+
+void String::trim()
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        text.clear();
+        return;
+    }
+    size_t last = text.find_last_not_of(" \t\r\n");
+    text = text.substr(first, last - first + 1);
+}
+
+void String::toUpperCase()
+{
+    for (char& c : text) c = toupper(c);
+}
+
+void String::toLowerCase()
+{
+    for (char& c : text) c = tolower(c);
+}
+
+// Print and Stream
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long value, int base)
+{
+    return print(String(value, base));
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    return print(String(value, base));
+}
+
+size_t Print::print(double value, int digits)
+{
+    return print(String(value, digits));
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    // Input is injected up front, so there is nothing to wait for
+    std::string line;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) line += (char)c;
+    return String(line);
+}
+
+int HWCDC::read()
+{
+    if (input.empty()) return -1;
+    int c = input.front();
+    input.pop_front();
+    return c;
+}
+
+size_t HWCDC::write(const uint8_t* buffer, size_t size)
+{
+    output.append((const char*)buffer, size);
+    return size;
+}
+
+std::string HWCDC::takeOutput()
+{
+    std::string taken;
+    taken.swap(output);
+    return taken;
+}
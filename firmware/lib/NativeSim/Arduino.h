@@ -0,0 +1,180 @@
+#ifndef NATIVE_SIM_ARDUINO_H
+#define NATIVE_SIM_ARDUINO_H
+
+// Just enough of the Arduino-ESP32 core to build the firmware on the host.
+// Time is simulated: micros() only moves when the firmware waits or talks on
+// a simulated bus, so runs are deterministic and bus time can be measured.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <utility>
+
+using std::max;
+using std::min;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define DEC 10
+#define HEX 16
+
+// No hardware SPI, so Adafruit BusIO only builds its software SPI path
+#define SPI_INTERFACES_COUNT 0
+typedef enum { LSBFIRST = 0, MSBFIRST = 1 } BitOrder;
+
+#define F(string) (string)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Time
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// GPIO, recorded so tests can check them
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+class String
+{
+public:
+    String(const char* text = "") : text(text ? text : "") {}
+    String(const std::string& text) : text(text) {}
+    String(char c) : text(1, c) {}
+    String(int value, unsigned char base = DEC);
+    String(unsigned int value, unsigned char base = DEC);
+    String(long value, unsigned char base = DEC);
+    String(unsigned long value, unsigned char base = DEC);
+    String(float value, unsigned char decimals = 2);
+    String(double value, unsigned char decimals = 2);
+
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.length(); }
+    char charAt(unsigned int index) const { return index < text.length() ? text[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& s, unsigned int from = 0) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+    bool equals(const String& s) const { return text == s.text; }
+
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    long toInt() const { return atol(text.c_str()); }
+    float toFloat() const { return atof(text.c_str()); }
+
+    bool operator==(const String& s) const { return text == s.text; }
+    bool operator==(const char* s) const { return text == s; }
+    bool operator!=(const String& s) const { return text != s.text; }
+    bool operator!=(const char* s) const { return text != s; }
+    String& operator+=(const String& s) { text += s.text; return *this; }
+    String& operator+=(const char* s) { text += s; return *this; }
+    String& operator+=(char c) { text += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+
+private:
+    std::string text;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return print("\r\n"); }
+    template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long ms) { timeout_ms = ms; }
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeout_ms = 1000;
+};
+
+// USB CDC port. Tests push host input with inject() and collect replies with
+// takeOutput().
+class HWCDC : public Stream
+{
+public:
+    void begin(unsigned long baud = 0) {}
+    size_t setTxBufferSize(size_t size) { return size; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    int available() override { return input.size(); }
+    int read() override;
+    int peek() override { return input.empty() ? -1 : input.front(); }
+    size_t write(uint8_t c) override { output += (char)c; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int availableForWrite() override { return 4096; }
+    using Print::write;
+
+    void inject(const char* text) { inject((const uint8_t*)text, strlen(text)); }
+    void inject(const uint8_t* data, size_t size) { input.insert(input.end(), data, data + size); }
+    std::string takeOutput();
+
+private:
+    std::deque<uint8_t> input;
+    std::string output;
+};
+
+extern HWCDC USBSerial;
+extern HWCDC Serial;
+
+struct EspClass
+{
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+};
+extern EspClass ESP;
+
+// Simulation control
+namespace Sim
+{
+    uint64_t now();
+    void advance(uint64_t us);
+
+    // Called whenever the firmware waits, standing in for the tasks that would
+    // run meanwhile on the board. Calls are not nested.
+    void setYieldHook(void (*hook)());
+}
+
+#endif // NATIVE_SIM_ARDUINO_H
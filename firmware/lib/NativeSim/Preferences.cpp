@@ -0,0 +1,54 @@
+#include "Preferences.h"
+
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> flash;
+
+bool Preferences::begin(const char* name, bool read_only, const char* partition)
+{
+    entries = &flash[name];
+    return true;
+}
+
+bool Preferences::clear()
+{
+    if (!entries) return false;
+    entries->clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key)
+{
+    return entries && entries->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key)
+{
+    return entries && entries->count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length)
+{
+    if (!entries) return 0;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    (*entries)[key].assign(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+    if (!isKey(key)) return 0;
+    return (*entries)[key].size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t max_length)
+{
+    if (!isKey(key)) return 0;
+    const std::vector<uint8_t>& bytes = (*entries)[key];
+    if (bytes.size() > max_length) return 0;
+    memcpy(buffer, bytes.data(), bytes.size());
+    return bytes.size();
+}
+
+void Preferences::eraseAll()
+{
+    flash.clear();
+}
@@ -0,0 +1,29 @@
+#ifndef NATIVE_SIM_PREFERENCES_H
+#define NATIVE_SIM_PREFERENCES_H
+
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+// NVS stand-in. Contents live for the whole process, like flash across a
+// reboot, until Preferences::eraseAll() is called.
+class Preferences
+{
+public:
+    bool begin(const char* name, bool read_only = false, const char* partition = nullptr);
+    void end() {}
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+    size_t putBytes(const char* key, const void* value, size_t length);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t max_length);
+
+    static void eraseAll();
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+    Namespace* entries = nullptr;
+};
+
+#endif // NATIVE_SIM_PREFERENCES_H
@@ -0,0 +1,7 @@
+#ifndef NATIVE_SIM_SPI_H
+#define NATIVE_SIM_SPI_H
+
+// There is no SPI device in the simulation; the firmware only includes this
+#include "Arduino.h"
+
+#endif // NATIVE_SIM_SPI_H
@@ -0,0 +1,116 @@
+#include "Wire.h"
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+    if (frequency) setClock(frequency);
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency)
+{
+    if (frequency == 0) return false;
+    clock_hz = frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+    transmitting = true;
+    tx_address = address;
+    tx_buffer.clear();
+}
+
+uint8_t TwoWire::endTransmission(bool send_stop)
+{
+    if (!transmitting) return 4;
+    transmitting = false;
+
+    // Every device at the address takes the write, it is acked if any of them acks
+    bool acked = false;
+    for (SimI2CDevice* device : find(tx_address)) {
+        if (device->receive(tx_buffer.data(), tx_buffer.size())) acked = true;
+    }
+    account(tx_buffer.size(), acked);
+    // 2 is the ESP32 core's code for an address NACK
+    return acked ? 0 : 2;
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t size, bool send_stop)
+{
+    // SDA is open drain: with several devices answering, a bit reads 1 only if
+    // all of them send a 1
+    rx_buffer.assign(size, 0xFF);
+    rx_index = 0;
+
+    bool acked = false;
+    std::vector<uint8_t> data(size);
+    for (SimI2CDevice* device : size > 0 ? find(address) : std::vector<SimI2CDevice*>()) {
+        if (!device->transmit(data.data(), size)) continue;
+        for (size_t i = 0; i < size; i++) rx_buffer[i] &= data[i];
+        acked = true;
+    }
+    account(acked ? size : 0, acked);
+    if (!acked) {
+        rx_buffer.clear();
+        return 0;
+    }
+    return size;
+}
+
+size_t TwoWire::write(uint8_t c)
+{
+    if (!transmitting || tx_buffer.size() >= I2C_BUFFER_LENGTH) return 0;
+    tx_buffer.push_back(c);
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t size)
+{
+    size_t n = 0;
+    while (n < size && write(data[n])) n++;
+    return n;
+}
+
+void TwoWire::attach(uint8_t address, SimI2CDevice* device)
+{
+    devices.push_back({address, device});
+}
+
+void TwoWire::attach(SimI2CRouter* router)
+{
+    routers.push_back(router);
+}
+
+void TwoWire::detachAll()
+{
+    devices.clear();
+    routers.clear();
+}
+
+// Everything that answers at the address: the devices on the bus itself and
+// those behind the selected mux channels, as they would on the board
+std::vector<SimI2CDevice*> TwoWire::find(uint8_t address)
+{
+    std::vector<SimI2CDevice*> found;
+    for (auto& entry : devices) {
+        if (entry.first == address) found.push_back(entry.second);
+    }
+    for (SimI2CRouter* router : routers) router->route(address, found);
+    return found;
+}
+
+void TwoWire::account(size_t data_bytes, bool acked)
+{
+    // Start, address byte plus ack, data bytes plus acks, stop
+    uint64_t bits = 1 + 9 + (acked ? 9 * data_bytes : 0) + 1;
+    uint64_t duration = TRANSACTION_OVERHEAD_US + (bits * 1000000 + clock_hz - 1) / clock_hz;
+
+    stats.transactions++;
+    stats.bytes += data_bytes;
+    if (!acked) stats.nacks++;
+    stats.bus_time_us += duration;
+    Sim::advance(duration);
+}
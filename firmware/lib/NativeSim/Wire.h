@@ -0,0 +1,105 @@
+#ifndef NATIVE_SIM_WIRE_H
+#define NATIVE_SIM_WIRE_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define I2C_BUFFER_LENGTH 128
+
+// A device on a simulated bus. One call per transaction, after the address
+// byte; returning false NACKs it. Devices sharing an address all get the call.
+class SimI2CDevice
+{
+public:
+    virtual ~SimI2CDevice() {}
+    virtual bool receive(const uint8_t* data, size_t length) = 0;
+    virtual bool transmit(uint8_t* data, size_t length) = 0;
+};
+
+// Devices behind a mux. The bus asks it which devices the selected channels
+// currently connect at an address, and it adds them to found.
+class SimI2CRouter
+{
+public:
+    virtual ~SimI2CRouter() {}
+    virtual void route(uint8_t address, std::vector<SimI2CDevice*>& found) = 0;
+};
+
+// Simulated I2C controller with the Arduino-ESP32 TwoWire interface. Every
+// transaction advances simulated time by its length on the wire at the set
+// clock plus a fixed driver overhead, and is counted.
+class TwoWire : public Stream
+{
+public:
+    // Cost of one transaction in the ESP32 I2C driver beyond the bits themselves
+    static const uint32_t TRANSACTION_OVERHEAD_US = 30;
+
+    struct Stats
+    {
+        uint32_t transactions = 0;
+        uint32_t bytes = 0;
+        uint32_t nacks = 0;
+        uint64_t bus_time_us = 0;
+    };
+
+    TwoWire(uint8_t bus_num) : bus_num(bus_num) {}
+
+    bool setPins(int sda, int scl) { return true; }
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frequency = 0);
+    bool end() { return true; }
+    bool setClock(uint32_t frequency);
+    uint32_t getClock() { return clock_hz; }
+
+    void beginTransmission(uint16_t address);
+    void beginTransmission(uint8_t address) { beginTransmission((uint16_t)address); }
+    void beginTransmission(int address) { beginTransmission((uint16_t)address); }
+    uint8_t endTransmission(bool send_stop = true);
+    uint8_t endTransmission(uint8_t send_stop) { return endTransmission((bool)send_stop); }
+    uint8_t endTransmission(int send_stop) { return endTransmission((bool)send_stop); }
+
+    size_t requestFrom(uint16_t address, size_t size, bool send_stop = true);
+    size_t requestFrom(uint8_t address, size_t size, bool send_stop = true) { return requestFrom((uint16_t)address, size, send_stop); }
+    uint8_t requestFrom(uint8_t address, uint8_t size, uint8_t send_stop) { return requestFrom((uint16_t)address, (size_t)size, (bool)send_stop); }
+    uint8_t requestFrom(int address, int size) { return requestFrom((uint16_t)address, (size_t)size, true); }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    size_t write(int n) { return write((uint8_t)n); }
+    size_t write(unsigned int n) { return write((uint8_t)n); }
+    size_t write(long n) { return write((uint8_t)n); }
+    size_t write(unsigned long n) { return write((uint8_t)n); }
+    using Print::write;
+    int available() override { return rx_buffer.size() - rx_index; }
+    int read() override { return rx_index < rx_buffer.size() ? rx_buffer[rx_index++] : -1; }
+    int peek() override { return rx_index < rx_buffer.size() ? rx_buffer[rx_index] : -1; }
+
+    // Simulation
+    void attach(uint8_t address, SimI2CDevice* device);
+    void attach(SimI2CRouter* router);
+    void detachAll();
+    const Stats& getStats() const { return stats; }
+    void resetStats() { stats = Stats(); }
+
+private:
+    std::vector<SimI2CDevice*> find(uint8_t address);
+    void account(size_t data_bytes, bool acked);
+
+    uint8_t bus_num;
+    uint32_t clock_hz = 100000;
+    Stats stats;
+
+    std::vector<std::pair<uint8_t, SimI2CDevice*>> devices;
+    std::vector<SimI2CRouter*> routers;
+
+    bool transmitting = false;
+    uint8_t tx_address = 0;
+    std::vector<uint8_t> tx_buffer;
+    std::vector<uint8_t> rx_buffer;
+    size_t rx_index = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif // NATIVE_SIM_WIRE_H
@@ -0,0 +1,339 @@
+#include "adi_bms_platform.h"
+#include "Adbms6948_Types.h"
+#include "sim_adbms6948.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+const uint8_t MAX_CHAINS = 4;
+// Chip select setup and hold around each frame
+const uint32_t FRAME_OVERHEAD_US = 10;
+// A frame of a transfer follows the one before it with only the isoSPI chip
+// select pulses in between. Both are modeled, not the datasheet's isoSPI
+// timing, so the bus time queueing saves is the model's too.
+const uint32_t QUEUED_FRAME_OVERHEAD_US = 2;
+// Longest frame the driver builds: a read all of the cell voltages of a full
+// chain
+const size_t MAX_FRAME = 4096;
+
+SimADBMS6948Chain* chains[MAX_CHAINS];
+// Only touched by the thread driving the chain
+bool errors[MAX_CHAINS];
+AdiPalStats chain_stats[MAX_CHAINS];
+uint32_t spi_hz = 1000000;
+bool queueing = true;
+AdiPalSegmentHook segment_hook = nullptr;
+void* segment_hook_arg = nullptr;
+// The errors the driver reports without a chain
+AdiPalStats error_stats;
+std::mutex error_lock;
+std::recursive_mutex critical;
+std::mutex chain_locks[MAX_CHAINS];
+
+// Puts a frame on the chain, full duplex, without taking its time yet
+bool exchange(const uint8_t* tx, uint8_t* rx, size_t length, uint8_t chain_id)
+{
+    if (chain_id >= MAX_CHAINS || !chains[chain_id] || length > MAX_FRAME) {
+        if (chain_id < MAX_CHAINS) errors[chain_id] = true;
+        return false;
+    }
+    chains[chain_id]->transfer(tx, rx, length, 8000000000ULL / spi_hz);
+    chain_stats[chain_id].transactions++;
+    chain_stats[chain_id].bytes += length;
+    return true;
+}
+
+// Time on the wire of the first bytes of a frame
+uint64_t wireUs(size_t bytes)
+{
+    return ((uint64_t)bytes * (8000000000ULL / spi_hz) + 999) / 1000;
+}
+
+void spend(uint64_t us, uint8_t chain_id)
+{
+    Sim::advance(us);
+    chain_stats[chain_id].bus_time_us += us;
+}
+
+// One chip-select frame, full duplex, taking its time on the wire
+bool frame(const uint8_t* tx, uint8_t* rx, size_t length, uint8_t chain_id,
+           uint32_t overhead_us = FRAME_OVERHEAD_US)
+{
+    if (!exchange(tx, rx, length, chain_id)) return false;
+    spend(overhead_us + wireUs(length), chain_id);
+    return true;
+}
+
+// Runs the submitted transfers of a chain in the background, as the SPI DMA
+// and its interrupt would
+struct XferWorker
+{
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable changed;
+    Adbms6948_SpiXfer* pending = nullptr;
+    // The submitter's clock at submit, and the bus's once the transfer is done
+    uint64_t start_us = 0;
+    uint64_t end_us = 0;
+    bool stop = false;
+};
+
+// One chip-select frame of a transfer: its segments are gathered into one
+// buffer and the reply scattered back, as the DMA descriptors would. Each
+// segment lands once its last byte is off the wire, and its notification goes
+// out then, while the rest of the frame is still coming in.
+bool xferFrame(Adbms6948_SpiXfer* xfer, uint8_t first, uint8_t last, uint8_t chain_id, uint32_t overhead_us)
+{
+    const Adbms6948_SpiSeg* segs = xfer->pSegs;
+    uint8_t tx[MAX_FRAME];
+    uint8_t rx[MAX_FRAME];
+    size_t length = 0;
+    if (last < first) return false;
+    for (uint8_t i = first; i <= last; i++) {
+        if (length + segs[i].nLen > MAX_FRAME) return false;
+        if (segs[i].pTxBuf) memcpy(tx + length, segs[i].pTxBuf, segs[i].nLen);
+        else memset(tx + length, 0xFF, segs[i].nLen);
+        length += segs[i].nLen;
+    }
+    if (!exchange(tx, rx, length, chain_id)) return false;
+    spend(overhead_us, chain_id);
+    length = 0;
+    for (uint8_t i = first; i <= last; i++) {
+        spend(wireUs(length + segs[i].nLen) - wireUs(length), chain_id);
+        if (segs[i].pRxBuf) memcpy(segs[i].pRxBuf, rx + length, segs[i].nLen);
+        length += segs[i].nLen;
+        if ((segs[i].nFlags & ADBMS6948_SPI_SEG_NOTIFY) && xfer->pfnSegDone) {
+            xfer->pfnSegDone(xfer, i);
+            if (segment_hook) segment_hook(chain_id, i, segment_hook_arg);
+        }
+    }
+    return true;
+}
+
+void runXfer(Adbms6948_SpiXfer* xfer, uint8_t chain_id)
+{
+    uint8_t first = 0;
+    bool queued = false;
+    for (uint8_t i = 0; i < xfer->nSegs; i++) {
+        if (!(xfer->pSegs[i].nFlags & ADBMS6948_SPI_SEG_CS_RELEASE) && i + 1 < xfer->nSegs) continue;
+        uint32_t overhead = (queueing && queued) ? QUEUED_FRAME_OVERHEAD_US : FRAME_OVERHEAD_US;
+        if (!xferFrame(xfer, first, i, chain_id, overhead)) {
+            xfer->bError = TRUE;
+            return;
+        }
+        queued = true;
+        first = i + 1;
+    }
+}
+
+void workerLoop(XferWorker& worker, uint8_t chain_id)
+{
+    std::unique_lock<std::mutex> lock(worker.lock);
+    for (;;) {
+        worker.changed.wait(lock, [&] { return worker.stop || worker.pending; });
+        if (!worker.pending) return;
+        Adbms6948_SpiXfer* xfer = worker.pending;
+        lock.unlock();
+        // Take the submitter's time, behind or ahead of this thread's own
+        Sim::advance(worker.start_us - Sim::now());
+        runXfer(xfer, chain_id);
+        lock.lock();
+        worker.end_us = Sim::now();
+        worker.pending = nullptr;
+        xfer->bBusy = FALSE;
+        worker.changed.notify_all();
+    }
+}
+
+struct XferWorkers
+{
+    XferWorker chain[MAX_CHAINS];
+
+    ~XferWorkers()
+    {
+        for (XferWorker& worker : chain) {
+            {
+                std::lock_guard<std::mutex> lock(worker.lock);
+                worker.stop = true;
+            }
+            worker.changed.notify_all();
+            if (worker.thread.joinable()) worker.thread.join();
+        }
+    }
+} workers;
+
+} // namespace
+
+void adiPalAttach(uint8_t chain_id, SimADBMS6948Chain* chain)
+{
+    if (chain_id >= MAX_CHAINS) return;
+    chains[chain_id] = chain;
+    errors[chain_id] = false;
+}
+
+void adiPalSetSpiClock(uint32_t hz)
+{
+    if (hz > 0) spi_hz = hz;
+}
+
+AdiPalStats adiPalGetStats()
+{
+    AdiPalStats total;
+    {
+        std::lock_guard<std::mutex> lock(error_lock);
+        total = error_stats;
+    }
+    for (uint8_t i = 0; i < MAX_CHAINS; i++) {
+        total.transactions += chain_stats[i].transactions;
+        total.bytes += chain_stats[i].bytes;
+        total.bus_time_us += chain_stats[i].bus_time_us;
+    }
+    return total;
+}
+
+AdiPalStats adiPalGetChainStats(uint8_t chain_id)
+{
+    if (chain_id >= MAX_CHAINS) return AdiPalStats();
+    return chain_stats[chain_id];
+}
+
+void adiPalResetStats()
+{
+    std::lock_guard<std::mutex> lock(error_lock);
+    error_stats = AdiPalStats();
+    for (uint8_t i = 0; i < MAX_CHAINS; i++) chain_stats[i] = AdiPalStats();
+}
+
+void adiPalInjectError(uint8_t chain_id)
+{
+    if (chain_id < MAX_CHAINS) errors[chain_id] = true;
+}
+
+void adiPalSetQueueing(bool on)
+{
+    queueing = on;
+}
+
+void adiPalSetSegmentHook(AdiPalSegmentHook hook, void* arg)
+{
+    segment_hook = hook;
+    segment_hook_arg = arg;
+}
+
+void adiPalSpiWrite(const uint8_t* data, uint16_t length, uint8_t chain_id)
+{
+    uint8_t rx[MAX_FRAME];
+    frame(data, rx, length, chain_id);
+}
+
+void adiPalSpiWriteReads(const uint8_t* tx, size_t tx_stride, uint8_t* rx, size_t rx_stride,
+                         uint32_t config, uint8_t chain_id)
+{
+    uint16_t length = config & 0xFFFF;
+    uint16_t frames = config >> 16;
+    if (length > tx_stride || length > rx_stride) {
+        if (chain_id < MAX_CHAINS) errors[chain_id] = true;
+        return;
+    }
+    for (uint16_t i = 0; i < frames; i++) {
+        frame(tx + i * tx_stride, rx + i * rx_stride, length, chain_id);
+    }
+}
+
+void adiPalSpiWriteReadAll(const uint8_t* command, uint8_t* rx, uint16_t length, uint8_t chain_id)
+{
+    uint8_t tx[MAX_FRAME];
+    uint8_t reply[MAX_FRAME];
+    size_t total = 4 + length;
+    if (total > MAX_FRAME) {
+        if (chain_id < MAX_CHAINS) errors[chain_id] = true;
+        return;
+    }
+    memcpy(tx, command, 4);
+    memset(tx + 4, 0xFF, length);
+    if (frame(tx, reply, total, chain_id)) memcpy(rx, reply + 4, length);
+}
+
+void adiPalSpiSubmit(Adbms6948_SpiXfer* xfer, uint8_t chain_id)
+{
+    if (chain_id >= MAX_CHAINS || !chains[chain_id]) {
+        if (chain_id < MAX_CHAINS) errors[chain_id] = true;
+        xfer->bError = TRUE;
+        xfer->bBusy = FALSE;
+        return;
+    }
+    XferWorker& worker = workers.chain[chain_id];
+    std::lock_guard<std::mutex> lock(worker.lock);
+    if (!worker.thread.joinable()) worker.thread = std::thread(workerLoop, std::ref(worker), chain_id);
+    worker.start_us = Sim::now();
+    worker.pending = xfer;
+    worker.changed.notify_all();
+}
+
+void adiPalSpiWait(Adbms6948_SpiXfer* xfer, uint8_t chain_id)
+{
+    if (chain_id >= MAX_CHAINS) return;
+    XferWorker& worker = workers.chain[chain_id];
+    std::unique_lock<std::mutex> lock(worker.lock);
+    worker.changed.wait(lock, [&] { return !xfer->bBusy; });
+    // The caller waited out the transfer's time on the bus
+    if (worker.end_us > Sim::now()) Sim::advance(worker.end_us - Sim::now());
+}
+
+void adiPalTimerDelay(uint32_t us, uint8_t chain_id)
+{
+    delayMicroseconds(us);
+}
+
+uint64_t adiPalCpuTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+boolean adiPalIsError(uint8_t chain_id)
+{
+    if (chain_id >= MAX_CHAINS) return TRUE;
+    boolean error = errors[chain_id] ? TRUE : FALSE;
+    errors[chain_id] = false;
+    return error;
+}
+
+void adiPalReportRuntimeError(uint16_t error_id, uint8_t status)
+{
+    // The driver only reports failures, but the status says so too
+    if (status == 0) return;
+    std::lock_guard<std::mutex> lock(error_lock);
+    error_stats.runtime_errors++;
+    error_stats.last_runtime_error = error_id;
+}
+
+void adiPalReportDevelopmentError(uint16_t module_id, uint8_t instance_id, uint8_t api_id, uint8_t error)
+{
+    std::lock_guard<std::mutex> lock(error_lock);
+    error_stats.development_errors++;
+}
+
+void adiPalEnterCritical()
+{
+    critical.lock();
+}
+
+void adiPalExitCritical()
+{
+    critical.unlock();
+}
+
+void adiPalLockChain(uint8_t chain_id)
+{
+    if (chain_id < MAX_CHAINS) chain_locks[chain_id].lock();
+}
+
+void adiPalUnlockChain(uint8_t chain_id)
+{
+    if (chain_id < MAX_CHAINS) chain_locks[chain_id].unlock();
+}
@@ -0,0 +1,103 @@
+#ifndef ADI_BMS_PLATFORM_H
+#define ADI_BMS_PLATFORM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// The platform layer the Adbms6948 driver is written against, for the host:
+// each chain ID is backed by a SimADBMS6948Chain and time is simulated time.
+// Chains may be driven from their own threads, each with its own lock.
+// A target build supplies its own adi_bms_platform.h.
+
+// The same as Arduino.h's
+typedef bool boolean;
+
+#define TRUE 1u
+#define FALSE 0u
+#define E_OK 0u
+#define E_NOT_OK 1u
+#define STD_ON 1u
+#define STD_OFF 0u
+#define NULL_PTR nullptr
+
+class SimADBMS6948Chain;
+struct Adbms6948_SpiXfer;
+
+struct AdiPalStats
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    // Simulated time the frames took on the wire
+    uint64_t bus_time_us;
+    uint32_t runtime_errors;
+    uint16_t last_runtime_error;
+    uint32_t development_errors;
+};
+
+// Host setup, not used by the driver
+void adiPalAttach(uint8_t chain_id, SimADBMS6948Chain* chain);
+void adiPalSetSpiClock(uint32_t hz);
+// All chains together
+AdiPalStats adiPalGetStats();
+// Bus counters of one chain; the errors are not per chain
+AdiPalStats adiPalGetChainStats(uint8_t chain_id);
+void adiPalResetStats();
+// Makes the next ADI_PAL_ISERROR on the chain report a bus fault
+void adiPalInjectError(uint8_t chain_id);
+// Off sends the frames of a transfer as separate transactions, as a platform
+// without queued transfers would. On by default.
+void adiPalSetQueueing(bool on);
+// Called on the chain's thread after the driver has taken each notified
+// segment, for a test to look at what it made of it. Null to stop.
+typedef void (*AdiPalSegmentHook)(uint8_t chain_id, uint8_t seg_idx, void* arg);
+void adiPalSetSegmentHook(AdiPalSegmentHook hook, void* arg);
+
+// What the macros below call
+void adiPalSpiWrite(const uint8_t* data, uint16_t length, uint8_t chain_id);
+// One frame per buffer row: config bits 15:0 are the frame length, 31:16 the
+// number of frames
+void adiPalSpiWriteReads(const uint8_t* tx, size_t tx_stride, uint8_t* rx, size_t rx_stride,
+                         uint32_t config, uint8_t chain_id);
+// A read all command: length is the data and PEC of as many devices as are
+// read, first device first, copied to the start of rx
+void adiPalSpiWriteReadAll(const uint8_t* command, uint8_t* rx, uint16_t length, uint8_t chain_id);
+// Runs the transfer's frames back to back on the chain's own thread, each with
+// its own chip select, only the first starting a transaction. pfnSegDone hears
+// of each notified segment once its last byte is in, on the thread's clock,
+// while the rest of its frame is still on the wire. Wait blocks until bBusy
+// clears and moves the caller's clock to the end of the transfer.
+void adiPalSpiSubmit(Adbms6948_SpiXfer* xfer, uint8_t chain_id);
+void adiPalSpiWait(Adbms6948_SpiXfer* xfer, uint8_t chain_id);
+void adiPalTimerDelay(uint32_t us, uint8_t chain_id);
+// The host's own clock, not the simulated bus time
+uint64_t adiPalCpuTimeNs();
+boolean adiPalIsError(uint8_t chain_id);
+void adiPalReportRuntimeError(uint16_t error_id, uint8_t status);
+void adiPalReportDevelopmentError(uint16_t module_id, uint8_t instance_id, uint8_t api_id, uint8_t error);
+void adiPalEnterCritical();
+void adiPalExitCritical();
+void adiPalLockChain(uint8_t chain_id);
+void adiPalUnlockChain(uint8_t chain_id);
+
+#define ADI_PAL_SPIWRITE(buf, len, chain) adiPalSpiWrite((buf), (len), (chain))
+#define ADI_PAL_SPIWRITEREADS(tx, rx, cfg, chain) \
+    adiPalSpiWriteReads(&(tx)[0][0], sizeof((tx)[0]), &(rx)[0][0], sizeof((rx)[0]), (cfg), (chain))
+#define ADI_PAL_SPIWRITEREADALL(tx, rx, len, chain) adiPalSpiWriteReadAll((tx), (rx), (len), (chain))
+#define ADI_PAL_SPISUBMIT(xfer, chain) adiPalSpiSubmit((xfer), (chain))
+#define ADI_PAL_SPIWAIT(xfer, chain) adiPalSpiWait((xfer), (chain))
+// Buffers the driver hands the transfers, aligned as an SPI DMA takes them
+#define ADI_PAL_DMA_ALIGNED alignas(4)
+#define ADI_PAL_TIMERDELAY(us, chain) adiPalTimerDelay((us), (chain))
+#define ADI_PAL_CPU_TIME_NS() adiPalCpuTimeNs()
+#define ADI_PAL_ISERROR(chain) adiPalIsError(chain)
+#define ADI_PAL_REPORT_RUNTIME_ERROR(id, status) adiPalReportRuntimeError((id), (status))
+#define ADI_PAL_REPORT_DEVELOPMENT_ERROR(module, instance, api, error) \
+    adiPalReportDevelopmentError((module), (instance), (api), (error))
+#define ADI_PAL_CRITICAL_SECTION_START adiPalEnterCritical()
+#define ADI_PAL_CRITICAL_SECTION_STOP adiPalExitCritical()
+#define ADI_PAL_CHAIN_LOCK(chain) adiPalLockChain(chain)
+#define ADI_PAL_CHAIN_UNLOCK(chain) adiPalUnlockChain(chain)
+#define ADI_PAL_MEMSET(dst, value, len) memset((dst), (value), (len))
+#define ADI_PAL_MEMCPY(dst, src, len) memcpy((dst), (src), (len))
+
+#endif // ADI_BMS_PLATFORM_H
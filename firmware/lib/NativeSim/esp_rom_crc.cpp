@@ -0,0 +1,13 @@
+#include "esp_rom_crc.h"
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
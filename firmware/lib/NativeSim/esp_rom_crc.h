@@ -0,0 +1,9 @@
+#ifndef NATIVE_SIM_ESP_ROM_CRC_H
+#define NATIVE_SIM_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+// CRC-32 as computed by the ESP32 ROM (reflected, polynomial 0xEDB88320)
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len);
+
+#endif // NATIVE_SIM_ESP_ROM_CRC_H
@@ -0,0 +1,583 @@
+#include "sim_adbms6948.h"
+#include <math.h>
+
+typedef SimADBMS6948 Dev;
+
+// Command codes, as in Adbms6948_ExecCmd.h
+static const uint16_t CMD_SRST = 0x027;
+static const uint16_t CMD_RSTCC = 0x02E;
+static const uint16_t CMD_SNAP = 0x02D;
+static const uint16_t CMD_UNSNAP = 0x02F;
+static const uint16_t CMD_CLRCELL = 0x711;
+static const uint16_t CMD_CLRAUX = 0x712;
+static const uint16_t CMD_CLRFC = 0x714;
+static const uint16_t CMD_CLRSPIN = 0x716;
+
+// Commands without a result here that the part still takes and counts: mute,
+// flag and current clears, COMM, coulomb counting and always-on settings
+static const uint16_t OTHER_COMMANDS[] = {
+    0x028, 0x029, 0x715, 0x717, 0x790, 0x792, 0x794, 0x723, 0x056,
+    0x038, 0x039, 0x040, 0x041, 0x043, 0x058, 0x05A, 0x05C, 0x05E,
+};
+
+struct GroupCommand
+{
+    uint16_t command;
+    Dev::Group group;
+};
+
+static const GroupCommand READS[] = {
+    {0x002, Dev::CFGA}, {0x026, Dev::CFGB}, {0x082, Dev::CFGC}, {0x0A6, Dev::CFGD}, {0x074, Dev::CFGE},
+    {0x076, Dev::CFGF}, {0x078, Dev::CFGG}, {0x07A, Dev::CFGH}, {0x07C, Dev::CFGI},
+    {0x022, Dev::PWMA}, {0x023, Dev::PWMB}, {0x722, Dev::COMM},
+    {0x004, Dev::CVA}, {0x006, Dev::CVB}, {0x008, Dev::CVC}, {0x00A, Dev::CVD}, {0x009, Dev::CVE}, {0x00B, Dev::CVF},
+    {0x044, Dev::ACA}, {0x046, Dev::ACB}, {0x048, Dev::ACC}, {0x04A, Dev::ACD}, {0x049, Dev::ACE}, {0x04B, Dev::ACF},
+    {0x003, Dev::SVA}, {0x005, Dev::SVB}, {0x007, Dev::SVC}, {0x00D, Dev::SVD}, {0x00E, Dev::SVE}, {0x00F, Dev::SVF},
+    {0x012, Dev::FCA}, {0x013, Dev::FCB}, {0x014, Dev::FCC}, {0x015, Dev::FCD}, {0x016, Dev::FCE}, {0x017, Dev::FCF},
+    {0x019, Dev::AUXA}, {0x01A, Dev::AUXB}, {0x01B, Dev::AUXC}, {0x01F, Dev::AUXD},
+    {0x01C, Dev::RAXA}, {0x01D, Dev::RAXB}, {0x01E, Dev::RAXC}, {0x025, Dev::RAXD},
+    {0x030, Dev::STATA}, {0x031, Dev::STATB}, {0x032, Dev::STATC}, {0x033, Dev::STATD}, {0x034, Dev::STATE},
+    {0x0B0, Dev::STATF}, {0x0B1, Dev::STATG},
+    {0x02C, Dev::SID}, {0x084, Dev::CURRENT}, {0x0C4, Dev::CURRENT_AVERAGE}, {0x086, Dev::CONVERSION_COUNT},
+};
+
+static const GroupCommand WRITES[] = {
+    {0x001, Dev::CFGA}, {0x024, Dev::CFGB}, {0x081, Dev::CFGC}, {0x0A4, Dev::CFGD}, {0x073, Dev::CFGE},
+    {0x075, Dev::CFGF}, {0x077, Dev::CFGG}, {0x079, Dev::CFGH}, {0x07B, Dev::CFGI},
+    {0x020, Dev::PWMA}, {0x021, Dev::PWMB}, {0x721, Dev::COMM},
+};
+
+// Conversion commands: the fixed bits, and the option bits around them
+struct AdcCommand
+{
+    uint16_t base;
+    uint16_t options;
+};
+
+static const AdcCommand ADCV = {0x260, 0x197};
+static const AdcCommand ADCIV = {0x240, 0x197};
+static const AdcCommand ADSV = {0x168, 0x093};
+static const AdcCommand ADAX = {0x410, 0x1CF};
+static const AdcCommand ADAX2 = {0x400, 0x00F};
+static const AdcCommand ADI1 = {0x200, 0x183};
+static const AdcCommand ADI2 = {0x108, 0x083};
+
+static const uint16_t OPT_RSTF = 0x004;
+static const uint16_t OPT_CONT = 0x080;
+static const uint16_t OPT_RD = 0x100;
+
+// Aux channel selections beyond single GPIOs
+static const uint8_t AUX_CH_VREF2 = 0x40;
+static const uint8_t AUX_CH_ITMP = 0x43;
+static const uint8_t AUX_CH_GPIO1_TO_7_11 = 0x0E;
+static const uint8_t AUX_CH_GPIO8_TO_10 = 0x0F;
+
+static const float VREF2_VOLTS = 3.0;
+static const uint8_t FC_MASK = 0x07;
+
+static bool matches(uint16_t command, const AdcCommand& adc)
+{
+    return (command & ~adc.options) == adc.base;
+}
+
+static const GroupCommand* find(const GroupCommand* table, size_t count, uint16_t command)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (table[i].command == command) return &table[i];
+    }
+    return nullptr;
+}
+
+// Groups of a read-all reply in order, with the bytes each contributes
+typedef std::vector<std::pair<Dev::Group, uint8_t>> ReadAllLayout;
+
+static void addCells(ReadAllLayout& layout, Dev::Group first)
+{
+    for (int i = 0; i < 5; i++) layout.push_back({(Dev::Group)(first + i), Dev::GROUP_BYTES});
+    layout.push_back({(Dev::Group)(first + 5), 2});
+}
+
+static void addGpios(ReadAllLayout& layout, Dev::Group first)
+{
+    for (int i = 0; i < 3; i++) layout.push_back({(Dev::Group)(first + i), Dev::GROUP_BYTES});
+    layout.push_back({(Dev::Group)(first + 3), 4});
+}
+
+static bool readAllLayout(uint16_t command, ReadAllLayout& layout)
+{
+    switch (command) {
+        case 0x00C: addCells(layout, Dev::CVA); break;                              // RDCVALL
+        case 0x04C: addCells(layout, Dev::ACA); break;                              // RDACALL
+        case 0x010: addCells(layout, Dev::SVA); break;                              // RDSVALL
+        case 0x018: addCells(layout, Dev::FCA); break;                              // RDFCALL
+        case 0x011: addCells(layout, Dev::CVA); addCells(layout, Dev::SVA); break;  // RDCSVALL
+        case 0x051: addCells(layout, Dev::ACA); addCells(layout, Dev::SVA); break;  // RDACSALL
+        case 0x090:                                                                 // RDCIV
+            addCells(layout, Dev::CVA);
+            layout.push_back({Dev::CURRENT, Dev::GROUP_BYTES});
+            break;
+        case 0x0D0:                                                                 // RDACIV
+            addCells(layout, Dev::ACA);
+            layout.push_back({Dev::CURRENT_AVERAGE, Dev::GROUP_BYTES});
+            break;
+        case 0x094:                                                                 // RDCSIVALL
+            addCells(layout, Dev::CVA);
+            addCells(layout, Dev::SVA);
+            layout.push_back({Dev::CURRENT, Dev::GROUP_BYTES});
+            break;
+        case 0x0D4:                                                                 // RDACSIVALL
+            addCells(layout, Dev::ACA);
+            addCells(layout, Dev::SVA);
+            layout.push_back({Dev::CURRENT_AVERAGE, Dev::GROUP_BYTES});
+            break;
+        case 0x035:                                                                 // RDASALL
+            addGpios(layout, Dev::AUXA);
+            addGpios(layout, Dev::RAXA);
+            for (int i = 0; i < 5; i++) layout.push_back({(Dev::Group)(Dev::STATA + i), Dev::GROUP_BYTES});
+            layout.push_back({Dev::STATF, 4});
+            layout.push_back({Dev::STATG, 4});
+            break;
+        default: return false;
+    }
+    return true;
+}
+
+// The ADC each poll command waits on, NUM_ADCS for any
+static bool pollTarget(uint16_t command, uint8_t& adc)
+{
+    switch (command) {
+        case 0x718: adc = 4; return true;  // PLADC
+        case 0x71C: adc = 0; return true;  // PLCADC
+        case 0x71D: adc = 1; return true;  // PLSADC
+        case 0x71E: adc = 2; return true;  // PLAUX1
+        case 0x71F: adc = 3; return true;  // PLAUX2
+        case 0x71A:                        // PLI1ADC and PLI2ADC, no current
+        case 0x71B: adc = 5; return true;  // ADCs modelled, never busy
+        default: return false;
+    }
+}
+
+static void pack(uint8_t (*groups)[Dev::GROUP_BYTES], Dev::Group first, const int16_t* codes, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t* bytes = groups[first + i / 3] + (i % 3) * 2;
+        bytes[0] = (uint16_t)codes[i] & 0xFF;
+        bytes[1] = (uint16_t)codes[i] >> 8;
+    }
+}
+
+// SimADBMS6948
+
+SimADBMS6948::SimADBMS6948()
+{
+    for (uint8_t i = 0; i < NUM_CELLS; i++) cell_volts[i] = 3.7;
+    for (uint8_t i = 0; i < NUM_GPIOS; i++) gpio_volts[i] = 1.5;
+    static const uint8_t DEFAULT_ID[GROUP_BYTES] = {0x48, 0x69, 0x00, 0x00, 0x00, 0x01};
+    memcpy(serial_id, DEFAULT_ID, GROUP_BYTES);
+    reset();
+}
+
+void SimADBMS6948::setCellVoltage(uint8_t cell, float volts)
+{
+    if (cell < NUM_CELLS) cell_volts[cell] = volts;
+}
+
+void SimADBMS6948::setGpioVoltage(uint8_t gpio, float volts)
+{
+    if (gpio < NUM_GPIOS) gpio_volts[gpio] = volts;
+}
+
+void SimADBMS6948::setSerialId(const uint8_t* id)
+{
+    memcpy(serial_id, id, GROUP_BYTES);
+    memcpy(groups[SID], id, GROUP_BYTES);
+}
+
+void SimADBMS6948::setRevision(uint8_t revision)
+{
+    this->revision = revision & 0x0F;
+    groups[STATE][5] = (groups[STATE][5] & 0x0F) | (this->revision << 4);
+}
+
+int16_t SimADBMS6948::toCode(float volts)
+{
+    float code = roundf((volts - ZERO_CODE_VOLTS) / VOLTS_PER_CODE);
+    if (code > 32767) code = 32767;
+    // The most negative code is the cleared marker
+    if (code < -32767) code = -32767;
+    return (int16_t)code;
+}
+
+float SimADBMS6948::toVolts(int16_t code)
+{
+    return code * VOLTS_PER_CODE + ZERO_CODE_VOLTS;
+}
+
+// Power-on state, also what sleep and SRST return to
+void SimADBMS6948::reset()
+{
+    memset(groups, 0, sizeof(groups));
+    memcpy(groups[SID], serial_id, GROUP_BYTES);
+    groups[STATE][5] = revision << 4;
+    command_counter = 0;
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        cells[i] = averages[i] = s_cells[i] = filtered[i] = (int16_t)CLEARED;
+        average_sums[i] = 0;
+    }
+    for (uint8_t i = 0; i < NUM_GPIOS; i++) gpios[i] = redundant_gpios[i] = (int16_t)CLEARED;
+    average_count = 0;
+    filter_primed = false;
+    snapped = false;
+    for (uint8_t i = 0; i < NUM_ADCS; i++) adcs[i] = Conversion();
+    aux_mask = raux_mask = 0;
+    aux_status = false;
+    clear(CVA, FCF - CVA + 1);
+    clear(AUXA, RAXD - AUXA + 1);
+}
+
+void SimADBMS6948::clear(Group first, uint8_t count)
+{
+    for (uint8_t group = first; group < first + count; group++) {
+        for (uint8_t i = 0; i < GROUP_BYTES; i += 2) {
+            groups[group][i] = CLEARED & 0xFF;
+            groups[group][i + 1] = CLEARED >> 8;
+        }
+    }
+}
+
+void SimADBMS6948::countCommand()
+{
+    command_counter = command_counter >= 63 ? 1 : command_counter + 1;
+}
+
+void SimADBMS6948::update(uint64_t now)
+{
+    for (uint8_t adc = 0; adc < NUM_ADCS; adc++) {
+        Conversion& conversion = adcs[adc];
+        while (conversion.running && now >= conversion.done_at) {
+            complete((Adc)adc);
+            if (conversion.continuous) conversion.done_at += conversion.period_us;
+            else conversion.running = false;
+        }
+    }
+}
+
+bool SimADBMS6948::isBusy(Adc adc, uint64_t at)
+{
+    return adcs[adc].running && at < adcs[adc].ready_at;
+}
+
+void SimADBMS6948::start(Adc adc, uint32_t period_us, bool continuous, uint64_t now)
+{
+    Conversion& conversion = adcs[adc];
+    conversion.running = true;
+    conversion.continuous = continuous;
+    conversion.period_us = period_us;
+    conversion.done_at = conversion.ready_at = now + period_us;
+}
+
+void SimADBMS6948::complete(Adc adc)
+{
+    switch (adc) {
+        case CADC: {
+            uint8_t corner = groups[CFGA][5] & FC_MASK;
+            average_count++;
+            for (uint8_t i = 0; i < NUM_CELLS; i++) {
+                cells[i] = toCode(cell_volts[i]);
+                average_sums[i] += cells[i];
+                averages[i] = average_sums[i] / average_count;
+                // A first order IIR, the higher the setting the slower
+                if (corner == 0 || !filter_primed) filter_state[i] = cells[i];
+                else filter_state[i] += (cells[i] - filter_state[i]) / (1 << corner);
+                filtered[i] = (int16_t)roundf(filter_state[i]);
+                if (redundant_cadc) s_cells[i] = cells[i];
+            }
+            filter_primed = true;
+            cadc_conversions++;
+            break;
+        }
+        case SADC:
+            for (uint8_t i = 0; i < NUM_CELLS; i++) s_cells[i] = toCode(cell_volts[i]);
+            break;
+        case AUX:
+            for (uint8_t i = 0; i < NUM_GPIOS; i++) {
+                if (aux_mask & (1 << i)) gpios[i] = toCode(gpio_volts[i]);
+            }
+            if (aux_status) {
+                // ITMP reads 7.5 mV per kelvin
+                int16_t vref2 = toCode(VREF2_VOLTS);
+                int16_t itmp = toCode((die_celsius + 273) * 0.0075);
+                groups[STATA][0] = (uint16_t)vref2 & 0xFF;
+                groups[STATA][1] = (uint16_t)vref2 >> 8;
+                groups[STATA][2] = (uint16_t)itmp & 0xFF;
+                groups[STATA][3] = (uint16_t)itmp >> 8;
+            }
+            break;
+        case RAUX:
+            for (uint8_t i = 0; i < NUM_GPIOS; i++) {
+                if (raux_mask & (1 << i)) redundant_gpios[i] = toCode(gpio_volts[i]);
+            }
+            break;
+        default:
+            break;
+    }
+    publish();
+}
+
+void SimADBMS6948::publish()
+{
+    if (snapped) return;
+    pack(groups, CVA, cells, NUM_CELLS);
+    pack(groups, ACA, averages, NUM_CELLS);
+    pack(groups, SVA, s_cells, NUM_CELLS);
+    pack(groups, FCA, filtered, NUM_CELLS);
+    pack(groups, AUXA, gpios, NUM_GPIOS);
+    pack(groups, RAXA, redundant_gpios, NUM_GPIOS);
+}
+
+void SimADBMS6948::write(Group group, const uint8_t* data)
+{
+    memcpy(groups[group], data, GROUP_BYTES);
+}
+
+void SimADBMS6948::execute(uint16_t command, uint64_t now)
+{
+    switch (command) {
+        case CMD_RSTCC:
+            command_counter = 0;
+            return;
+        case CMD_SNAP:
+            snapped = true;
+            break;
+        case CMD_UNSNAP:
+            snapped = false;
+            publish();
+            break;
+        case CMD_CLRCELL:
+            for (uint8_t i = 0; i < NUM_CELLS; i++) {
+                cells[i] = averages[i] = (int16_t)CLEARED;
+                average_sums[i] = 0;
+            }
+            average_count = 0;
+            if (!snapped) clear(CVA, ACF - CVA + 1);
+            break;
+        case CMD_CLRFC:
+            for (uint8_t i = 0; i < NUM_CELLS; i++) filtered[i] = (int16_t)CLEARED;
+            filter_primed = false;
+            if (!snapped) clear(FCA, FCF - FCA + 1);
+            break;
+        case CMD_CLRSPIN:
+            for (uint8_t i = 0; i < NUM_CELLS; i++) s_cells[i] = (int16_t)CLEARED;
+            if (!snapped) clear(SVA, SVF - SVA + 1);
+            break;
+        case CMD_CLRAUX:
+            for (uint8_t i = 0; i < NUM_GPIOS; i++) gpios[i] = redundant_gpios[i] = (int16_t)CLEARED;
+            if (!snapped) clear(AUXA, RAXD - AUXA + 1);
+            break;
+        default:
+            if (matches(command, ADCV) || matches(command, ADCIV)) {
+                redundant_cadc = command & OPT_RD;
+                if (command & OPT_RSTF) filter_primed = false;
+                start(CADC, CADC_CONVERSION_US, command & OPT_CONT, now);
+            } else if (matches(command, ADSV)) {
+                start(SADC, SADC_CONVERSION_US, command & OPT_CONT, now);
+            } else if (matches(command, ADAX)) {
+                uint8_t channel = command & 0x4F;
+                aux_status = channel == 0 || channel == AUX_CH_VREF2 || channel == AUX_CH_ITMP;
+                if (channel == 0) aux_mask = (1 << NUM_GPIOS) - 1;
+                else if (channel <= NUM_GPIOS) aux_mask = 1 << (channel - 1);
+                else if (channel == AUX_CH_GPIO1_TO_7_11) aux_mask = 0x47F;
+                else if (channel == AUX_CH_GPIO8_TO_10) aux_mask = 0x380;
+                else aux_mask = 0;
+                uint8_t channels = __builtin_popcount(aux_mask) + (aux_status ? 2 : 0);
+                start(AUX, AUX_CONVERSION_US_PER_CHANNEL * (channels ? channels : 1), false, now);
+            } else if (matches(command, ADAX2)) {
+                uint8_t channel = command & 0x0F;
+                if (channel == 0) raux_mask = (1 << NUM_GPIOS) - 1;
+                else if (channel <= NUM_GPIOS) raux_mask = 1 << (channel - 1);
+                else raux_mask = 0;
+                uint8_t channels = __builtin_popcount(raux_mask);
+                start(RAUX, AUX_CONVERSION_US_PER_CHANNEL * (channels ? channels : 1), false, now);
+            }
+            // ADI1 and ADI2 are taken without a current model
+            break;
+    }
+    countCommand();
+}
+
+// SimADBMS6948Chain
+
+SimADBMS6948Chain::SimADBMS6948Chain(uint8_t num_devices)
+    : devices(num_devices), corrupt(num_devices, 0)
+{
+    for (uint8_t i = 0; i < num_devices; i++) {
+        uint8_t id[SimADBMS6948::GROUP_BYTES] = {0x48, 0x69, 0x00, 0x00, 0x00, (uint8_t)(i + 1)};
+        devices[i].setSerialId(id);
+    }
+}
+
+void SimADBMS6948Chain::corruptReads(uint8_t device, uint32_t count)
+{
+    if (device < corrupt.size()) corrupt[device] = count;
+}
+
+void SimADBMS6948Chain::transfer(const uint8_t* tx, uint8_t* rx, size_t length, uint32_t byte_ns)
+{
+    uint64_t now = Sim::now();
+    memset(rx, 0xFF, length);
+    stats.frames++;
+
+    if (!asleep && now - last_frame_at >= SLEEP_TIMEOUT_US) {
+        asleep = true;
+        for (auto& device : devices) device.reset();
+    }
+    last_frame_at = now;
+    if (asleep) {
+        asleep = false;
+        ready_at = now + WAKE_US;
+        stats.ignored++;
+        return;
+    }
+    if (now < ready_at) {
+        stats.ignored++;
+        return;
+    }
+    // Dummy bytes only keep the chain awake
+    if (length < 4) return;
+
+    uint16_t command = (tx[0] << 8) | tx[1];
+    if (pec15(tx, 2) != ((tx[2] << 8) | tx[3])) {
+        stats.command_pec_errors++;
+        return;
+    }
+    for (auto& device : devices) device.update(now);
+
+    bool known;
+    uint8_t adc;
+    if (command == CMD_SRST) {
+        asleep = true;
+        for (auto& device : devices) device.reset();
+        known = true;
+    } else if (pollTarget(command, adc)) {
+        known = poll(command, rx, length, byte_ns);
+    } else if (find(WRITES, sizeof(WRITES) / sizeof(WRITES[0]), command)) {
+        known = write(command, tx, length);
+    } else if (read(command, rx, length)) {
+        known = true;
+    } else {
+        known = false;
+        for (uint16_t other : OTHER_COMMANDS) known |= command == other;
+        known |= matches(command, ADCV) || matches(command, ADCIV) || matches(command, ADSV) ||
+                 matches(command, ADAX) || matches(command, ADAX2) || matches(command, ADI1) ||
+                 matches(command, ADI2) || command == CMD_RSTCC || command == CMD_SNAP ||
+                 command == CMD_UNSNAP || command == CMD_CLRCELL || command == CMD_CLRAUX ||
+                 command == CMD_CLRFC || command == CMD_CLRSPIN;
+        if (known) {
+            for (auto& device : devices) device.execute(command, now);
+        }
+    }
+    if (known) stats.commands++;
+    else stats.ignored++;
+}
+
+bool SimADBMS6948Chain::read(uint16_t command, uint8_t* rx, size_t length)
+{
+    ReadAllLayout layout;
+    const GroupCommand* entry = find(READS, sizeof(READS) / sizeof(READS[0]), command);
+    if (entry) layout.push_back({entry->group, SimADBMS6948::GROUP_BYTES});
+    else if (!readAllLayout(command, layout)) return false;
+
+    uint8_t data[256];
+    size_t size = 0;
+    for (uint8_t k = 0; k < devices.size(); k++) {
+        size = 0;
+        for (auto& part : layout) {
+            memcpy(data + size, devices[k].getGroup(part.first), part.second);
+            size += part.second;
+        }
+        uint8_t counter = devices[k].getCommandCounter();
+        uint16_t pec = pec10(data, size, counter);
+        data[size] = (counter << 2) | (pec >> 8);
+        data[size + 1] = pec & 0xFF;
+        if (corrupt[k] > 0) {
+            data[0] ^= 0x01;
+            corrupt[k]--;
+        }
+        // The first device's reply comes out first
+        size_t offset = 4 + k * (size + 2);
+        for (size_t i = 0; i < size + 2 && offset + i < length; i++) rx[offset + i] = data[i];
+    }
+    return true;
+}
+
+bool SimADBMS6948Chain::poll(uint16_t command, uint8_t* rx, size_t length, uint32_t byte_ns)
+{
+    uint8_t adc;
+    pollTarget(command, adc);
+    uint64_t now = Sim::now();
+    for (auto& device : devices) device.execute(command, now);
+
+    for (size_t i = 4; i < length; i++) {
+        uint64_t at = now + (uint64_t)(i + 1) * byte_ns / 1000;
+        bool busy = false;
+        for (auto& device : devices) {
+            if (adc == SimADBMS6948::NUM_ADCS) {
+                for (uint8_t a = 0; a < SimADBMS6948::NUM_ADCS; a++) busy |= device.isBusy((SimADBMS6948::Adc)a, at);
+            } else if (adc < SimADBMS6948::NUM_ADCS) {
+                busy |= device.isBusy((SimADBMS6948::Adc)adc, at);
+            }
+        }
+        rx[i] = busy ? 0x00 : 0xFF;
+    }
+    return true;
+}
+
+bool SimADBMS6948Chain::write(uint16_t command, const uint8_t* tx, size_t length)
+{
+    const GroupCommand* entry = find(WRITES, sizeof(WRITES) / sizeof(WRITES[0]), command);
+    size_t count = devices.size();
+    for (size_t k = 0; k < count; k++) {
+        // The first group shifts through to the last device
+        SimADBMS6948& device = devices[count - 1 - k];
+        const uint8_t* chunk = tx + 4 + k * 8;
+        bool valid = 4 + (k + 1) * 8 <= length &&
+                     pec10(chunk, SimADBMS6948::GROUP_BYTES, 0) == (((chunk[6] & 0x03) << 8) | chunk[7]);
+        if (valid) device.write(entry->group, chunk);
+        else device.data_pec_errors++;
+    }
+    for (auto& device : devices) device.countCommand();
+    return true;
+}
+
+uint16_t SimADBMS6948Chain::pec15(const uint8_t* data, size_t length)
+{
+    // x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1, seeded with 16
+    uint16_t pec = 16;
+    for (size_t i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            bool in = ((data[i] >> bit) & 1) ^ ((pec >> 14) & 1);
+            pec = (pec << 1) & 0x7FFF;
+            if (in) pec ^= 0x4599;
+        }
+    }
+    // Sent with a 0 appended
+    return pec << 1;
+}
+
+uint16_t SimADBMS6948Chain::pec10(const uint8_t* data, size_t length, uint8_t command_counter)
+{
+    // x^10 + x^7 + x^3 + x^2 + x + 1, seeded with 16, over the data and then
+    // the six counter bits, which are 0 in writes
+    uint16_t pec = 16;
+    auto shift = [&pec](bool bit) {
+        bool in = bit ^ ((pec >> 9) & 1);
+        pec = (pec << 1) & 0x3FF;
+        if (in) pec ^= 0x08F;
+    };
+    for (size_t i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) shift((data[i] >> bit) & 1);
+    }
+    for (int bit = 5; bit >= 0; bit--) shift((command_counter >> bit) & 1);
+    return pec;
+}
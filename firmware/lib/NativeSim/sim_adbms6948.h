@@ -0,0 +1,184 @@
+#ifndef SIM_ADBMS6948_H
+#define SIM_ADBMS6948_H
+
+#include "Arduino.h"
+#include <vector>
+
+// Register-level model of an ADBMS6948 battery monitor, for running the
+// Adbms6948 driver on the host through its platform layer
+// (adi_bms_platform.h).
+//
+// The registers are 6-byte groups: configuration A-I, PWM, COMM, the cell
+// results (C, averaged, S and filtered, 16 cells), GPIO and redundant GPIO
+// results, status A-G and the serial ID. Results read 0x8000 until a
+// conversion completes and again after they are cleared. Conversions take
+// simulated time, CONVERSION constants below, and sample the inputs when they
+// complete; continuous mode starts the next one at once. SNAP holds the result
+// registers until UNSNAP.
+//
+// The command counter counts every accepted command that isn't a read,
+// polls included, and wraps from 63 to 1. RSTCC and SRST clear it.
+class SimADBMS6948
+{
+public:
+    static const uint8_t NUM_CELLS = 16;
+    static const uint8_t NUM_GPIOS = 11;
+    static const uint8_t GROUP_BYTES = 6;
+    static const uint16_t CLEARED = 0x8000;
+    // Result codes are 150 uV per LSB from 1.5 V
+    static constexpr float VOLTS_PER_CODE = 0.00015;
+    static constexpr float ZERO_CODE_VOLTS = 1.5;
+
+    static const uint32_t CADC_CONVERSION_US = 1000;
+    static const uint32_t SADC_CONVERSION_US = 8000;
+    static const uint32_t AUX_CONVERSION_US_PER_CHANNEL = 400;
+
+    enum Group : uint8_t {
+        CFGA, CFGB, CFGC, CFGD, CFGE, CFGF, CFGG, CFGH, CFGI,
+        PWMA, PWMB, COMM,
+        CVA, CVB, CVC, CVD, CVE, CVF,
+        ACA, ACB, ACC, ACD, ACE, ACF,
+        SVA, SVB, SVC, SVD, SVE, SVF,
+        FCA, FCB, FCC, FCD, FCE, FCF,
+        AUXA, AUXB, AUXC, AUXD,
+        RAXA, RAXB, RAXC, RAXD,
+        STATA, STATB, STATC, STATD, STATE, STATF, STATG,
+        SID, CURRENT, CURRENT_AVERAGE, CONVERSION_COUNT,
+        NUM_GROUPS
+    };
+
+    SimADBMS6948();
+
+    // Inputs, taken when a conversion completes
+    void setCellVoltage(uint8_t cell, float volts);
+    void setGpioVoltage(uint8_t gpio, float volts);
+    void setDieTemperature(float celsius) { die_celsius = celsius; }
+    void setSerialId(const uint8_t* id);
+    void setRevision(uint8_t revision);
+
+    const uint8_t* getGroup(Group group) const { return groups[group]; }
+    uint8_t getCommandCounter() const { return command_counter; }
+    uint32_t getCADCConversions() const { return cadc_conversions; }
+    uint32_t getDataPecErrors() const { return data_pec_errors; }
+
+    static int16_t toCode(float volts);
+    static float toVolts(int16_t code);
+
+private:
+    friend class SimADBMS6948Chain;
+
+    enum Adc : uint8_t { CADC, SADC, AUX, RAUX, NUM_ADCS };
+
+    struct Conversion
+    {
+        bool running = false;
+        bool continuous = false;
+        uint32_t period_us = 0;
+        uint64_t done_at = 0;
+        // End of the first conversion, what polls wait for
+        uint64_t ready_at = 0;
+    };
+
+    void reset();
+    void countCommand();
+    void update(uint64_t now);
+    bool isBusy(Adc adc, uint64_t at);
+    void start(Adc adc, uint32_t period_us, bool continuous, uint64_t now);
+    void complete(Adc adc);
+    void execute(uint16_t command, uint64_t now);
+    void write(Group group, const uint8_t* data);
+    void publish();
+    void clear(Group first, uint8_t count);
+
+    uint8_t groups[NUM_GROUPS][GROUP_BYTES];
+    uint8_t command_counter = 0;
+
+    float cell_volts[NUM_CELLS];
+    float gpio_volts[NUM_GPIOS];
+    float die_celsius = 25;
+    uint8_t serial_id[GROUP_BYTES];
+    uint8_t revision = 1;
+
+    // Latest results; the registers follow them unless snapped
+    int16_t cells[NUM_CELLS];
+    int16_t averages[NUM_CELLS];
+    int16_t s_cells[NUM_CELLS];
+    int16_t filtered[NUM_CELLS];
+    int16_t gpios[NUM_GPIOS];
+    int16_t redundant_gpios[NUM_GPIOS];
+    int32_t average_sums[NUM_CELLS];
+    uint16_t average_count = 0;
+    float filter_state[NUM_CELLS];
+    bool filter_primed = false;
+    bool snapped = false;
+
+    Conversion adcs[NUM_ADCS];
+    bool redundant_cadc = false;
+    // Channel masks of the running aux conversions, bit 0 = GPIO1
+    uint16_t aux_mask = 0;
+    uint16_t raux_mask = 0;
+    bool aux_status = false;
+
+    uint32_t cadc_conversions = 0;
+    uint32_t data_pec_errors = 0;
+};
+
+// A daisy chain of ADBMS6948s behind one isoSPI port. Each transfer is one
+// chip-select frame: a command and its PEC15, then for writes one group and
+// PEC10 per device, the last device's first, and for reads one group back per
+// device, the first device's first, with a PEC10 that folds in the device's
+// command counter. A bad command PEC makes the chain ignore the frame; a bad
+// data PEC makes that device drop its write. Polls read 0x00 for each byte
+// clocked while the ADC is still converting. Unknown commands and frames
+// while asleep are ignored and read back 0xFF.
+//
+// The chain sleeps after SLEEP_TIMEOUT_US without a frame, losing its
+// registers, and starts asleep. A frame wakes it, and it ignores that frame
+// and any other in the next WAKE_US. SRST puts it to sleep at once.
+class SimADBMS6948Chain
+{
+public:
+    static const uint32_t WAKE_US = 500;
+    static const uint32_t SLEEP_TIMEOUT_US = 1800000;
+
+    struct Stats
+    {
+        uint32_t frames = 0;
+        uint32_t commands = 0;
+        uint32_t command_pec_errors = 0;
+        uint32_t ignored = 0;
+    };
+
+    explicit SimADBMS6948Chain(uint8_t num_devices = 1);
+
+    uint8_t getDeviceCount() const { return devices.size(); }
+    bool isAsleep() const { return asleep; }
+    SimADBMS6948& device(uint8_t index) { return devices[index]; }
+
+    // One frame; byte_ns is the time each byte takes on the wire, from now
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t length, uint32_t byte_ns);
+
+    // Flips a data bit in a device's next read replies, as noise on the line
+    void corruptReads(uint8_t device, uint32_t count);
+
+    const Stats& getStats() const { return stats; }
+    void resetStats() { stats = Stats(); }
+
+    // The two PECs computed bit by bit, as the part does
+    static uint16_t pec15(const uint8_t* data, size_t length);
+    static uint16_t pec10(const uint8_t* data, size_t length, uint8_t command_counter);
+
+private:
+    bool read(uint16_t command, uint8_t* rx, size_t length);
+    bool poll(uint16_t command, uint8_t* rx, size_t length, uint32_t byte_ns);
+    bool write(uint16_t command, const uint8_t* tx, size_t length);
+
+    std::vector<SimADBMS6948> devices;
+    std::vector<uint32_t> corrupt;
+    bool asleep = true;
+    uint64_t last_frame_at = 0;
+    uint64_t ready_at = 0;
+    Stats stats;
+};
+
+#endif // SIM_ADBMS6948_H
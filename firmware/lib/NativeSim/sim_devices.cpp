@@ -0,0 +1,363 @@
+#include "sim_devices.h"
+
+// Analog model of a cell, matched to the firmware's default calibration points
+static const float BUCK_VOLTS_AT_234 = 4.5971;
+static const float BUCK_VOLTS_PER_CODE = (4.5971 - 1.5041) / (2625 - 234);
+static const float LDO_VOLTS_AT_42 = 4.5176;
+static const float LDO_VOLTS_PER_CODE = (4.5176 - 0.3334) / (3760 - 42);
+static const float LDO_DROPOUT = 0.05;
+static const float BUCK_TAU_US = 3000;
+static const float LDO_TAU_US = 500;
+static const float SHUNT_OHMS = 0.11128;
+static const float SHUNT_GAIN = 50;
+
+// GPIO expander pins, as wired on the board
+static const uint8_t GPIO_BUCK_ENABLE = 2;
+static const uint8_t GPIO_LDO_ENABLE = 3;
+static const uint8_t GPIO_OUTPUT_RELAY = 5;
+
+// SimTCA9548
+
+void SimTCA9548::attach(uint8_t channel, uint8_t address, SimI2CDevice* device)
+{
+    if (channel < NUM_CHANNELS) channels[channel].push_back({address, device});
+}
+
+void SimTCA9548::detachAll()
+{
+    for (auto& channel : channels) channel.clear();
+}
+
+bool SimTCA9548::receive(const uint8_t* data, size_t length)
+{
+    if (length > 0) {
+        mask = data[length - 1];
+        writes++;
+    }
+    return true;
+}
+
+bool SimTCA9548::transmit(uint8_t* data, size_t length)
+{
+    memset(data, mask, length);
+    return true;
+}
+
+void SimTCA9548::route(uint8_t address, std::vector<SimI2CDevice*>& found)
+{
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+        if (!(mask & (1 << channel))) continue;
+        for (auto& entry : channels[channel]) {
+            if (entry.first == address) found.push_back(entry.second);
+        }
+    }
+}
+
+// SimMCP4725
+
+bool SimMCP4725::receive(const uint8_t* data, size_t length)
+{
+    if (length >= 3 && (data[0] & 0xC0) == 0x40) {
+        // Write DAC register, 0x60 also writes the EEPROM
+        uint16_t value = (data[1] << 4) | (data[2] >> 4);
+        if (data[0] & 0x20) eeprom_code = value;
+        set(value);
+    } else {
+        // Fast mode, two bytes per update
+        for (size_t i = 0; i + 1 < length; i += 2) {
+            if (data[i] & 0xC0) break;
+            set(((data[i] & 0x0F) << 8) | data[i + 1]);
+        }
+    }
+    return true;
+}
+
+bool SimMCP4725::transmit(uint8_t* data, size_t length)
+{
+    uint8_t registers[5] = {
+        0xC0, // ready, not powered down
+        (uint8_t)(code >> 4),
+        (uint8_t)((code & 0x0F) << 4),
+        (uint8_t)((eeprom_code >> 8) & 0x0F),
+        (uint8_t)(eeprom_code & 0xFF)
+    };
+    for (size_t i = 0; i < length; i++) data[i] = registers[i % 5];
+    return true;
+}
+
+void SimMCP4725::set(uint16_t value)
+{
+    writes++;
+    if (value == code) return;
+    code = value;
+    if (change_hook) change_hook(change_context);
+}
+
+// SimMCP4728
+
+bool SimMCP4728::receive(const uint8_t* data, size_t length)
+{
+    if (length == 0) return true;
+    if ((data[0] & 0xF8) == 0x40) {
+        // Multi-write, three bytes per channel
+        for (size_t i = 0; i + 2 < length && (data[i] & 0xF8) == 0x40; i += 3) {
+            codes[(data[i] >> 1) & 0x03] = ((data[i + 1] & 0x0F) << 8) | data[i + 2];
+            writes++;
+        }
+    } else if ((data[0] & 0xC0) == 0) {
+        // Fast write, two bytes per channel from A on
+        for (size_t i = 0; i + 1 < length && i / 2 < NUM_CHANNELS; i += 2) {
+            codes[i / 2] = ((data[i] & 0x0F) << 8) | data[i + 1];
+        }
+        writes++;
+    }
+    return true;
+}
+
+bool SimMCP4728::transmit(uint8_t* data, size_t length)
+{
+    // Per channel the DAC register and the EEPROM, three bytes each
+    for (size_t i = 0; i < length; i++) {
+        int channel = (i / 6) % NUM_CHANNELS;
+        switch (i % 3) {
+            case 0: data[i] = 0x80 | (channel << 4); break; // ready
+            case 1: data[i] = (codes[channel] >> 8) & 0x0F; break;
+            default: data[i] = codes[channel] & 0xFF; break;
+        }
+    }
+    return true;
+}
+
+// SimADS1115
+
+bool SimADS1115::receive(const uint8_t* data, size_t length)
+{
+    if (length == 0) return true;
+    update();
+    pointer = data[0] & 0x03;
+    if (length < 3) return true;
+
+    uint16_t value = (data[1] << 8) | data[2];
+    switch (pointer) {
+        case 1:
+            config = value & 0x7FFF;
+            if ((value & 0x8000) && !converting) {
+                // Single-ended inputs only, MUX 100 to 111
+                uint8_t mux = (config >> 12) & 0x07;
+                sampled_volts = (mux >= 4 && input_function) ? input_function(input_context, mux - 4) : 0;
+                converting = true;
+                ready_at = Sim::now() + conversionTime();
+            }
+            break;
+        case 2: low_threshold = value; break;
+        case 3: high_threshold = value; break;
+        default: break;
+    }
+    return true;
+}
+
+bool SimADS1115::transmit(uint8_t* data, size_t length)
+{
+    update();
+    uint16_t value;
+    switch (pointer) {
+        case 0: value = conversion; break;
+        case 1: value = config | (converting ? 0 : 0x8000); break;
+        case 2: value = low_threshold; break;
+        default: value = high_threshold; break;
+    }
+    for (size_t i = 0; i < length; i++) data[i] = (i % 2 == 0) ? value >> 8 : value & 0xFF;
+    return true;
+}
+
+void SimADS1115::update()
+{
+    // Until a conversion completes the register still holds the previous one
+    if (!converting || Sim::now() < ready_at) return;
+    converting = false;
+    conversions++;
+
+    float code = roundf(sampled_volts / fullScale() * 32768);
+    if (code > 32767) code = 32767;
+    if (code < -32768) code = -32768;
+    conversion = (int16_t)code;
+}
+
+uint64_t SimADS1115::conversionTime() const
+{
+    static const uint16_t RATES[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return 1000000 / RATES[(config >> 5) & 0x07];
+}
+
+float SimADS1115::fullScale() const
+{
+    static const float RANGES[8] = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256};
+    return RANGES[(config >> 9) & 0x07];
+}
+
+// SimTCA6408
+
+bool SimTCA6408::receive(const uint8_t* data, size_t length)
+{
+    if (length == 0) return true;
+    pointer = data[0] & 0x03;
+    // The input register is read-only
+    if (length > 1 && pointer != 0) {
+        registers[pointer] = data[length - 1];
+        if (change_hook) change_hook(change_context);
+    }
+    return true;
+}
+
+bool SimTCA6408::transmit(uint8_t* data, size_t length)
+{
+    uint8_t value = registers[pointer];
+    if (pointer == 0) value = getOutputs();
+    memset(data, value, length);
+    return true;
+}
+
+// SimCell
+
+SimCell::SimCell()
+{
+    adc.setInputs(readInput, this);
+    buck_dac.setChangeHook(changed, this);
+    ldo_dac.setChangeHook(changed, this);
+    gpio.setChangeHook(changed, this);
+}
+
+void SimCell::attach(SimTCA9548& mux, uint8_t channel)
+{
+    mux.attach(channel, LDO_ADDRESS, &ldo_dac);
+    mux.attach(channel, BUCK_ADDRESS, &buck_dac);
+    mux.attach(channel, ADC_ADDRESS, &adc);
+    mux.attach(channel, GPIO_ADDRESS, &gpio);
+}
+
+float SimCell::getBuckVoltage()
+{
+    return settle(buck_from, buckTarget(buck_code, was_enabled), buck_changed_at, BUCK_TAU_US);
+}
+
+float SimCell::getLDOVoltage()
+{
+    float buck = getBuckVoltage();
+    float ldo = settle(ldo_from, ldoTarget(ldo_code, was_enabled, buck), ldo_changed_at, LDO_TAU_US);
+    return min(ldo, max(buck - LDO_DROPOUT, 0.0f));
+}
+
+float SimCell::getOutputVoltage()
+{
+    return relayClosed() ? getLDOVoltage() : 0;
+}
+
+float SimCell::getOutputCurrent()
+{
+    if (load_ohms <= 0) return 0;
+    return getOutputVoltage() / load_ohms;
+}
+
+float SimCell::readInput(void* context, uint8_t input)
+{
+    SimCell* cell = static_cast<SimCell*>(context);
+    switch (input) {
+        case 0: return cell->getBuckVoltage();
+        case 1: return cell->getLDOVoltage();
+        case 2: return cell->getOutputCurrent() * SHUNT_OHMS * SHUNT_GAIN;
+        default: return cell->getOutputVoltage();
+    }
+}
+
+void SimCell::changed(void* context)
+{
+    static_cast<SimCell*>(context)->track();
+}
+
+float SimCell::settle(float from, float to, uint64_t since, float tau_us)
+{
+    float elapsed = Sim::now() - since;
+    return to + (from - to) * expf(-elapsed / tau_us);
+}
+
+float SimCell::buckTarget(uint16_t code, bool enabled)
+{
+    if (!enabled) return 0;
+    return constrain(BUCK_VOLTS_AT_234 - ((int)code - 234) * BUCK_VOLTS_PER_CODE, 0.8f, 5.0f);
+}
+
+float SimCell::ldoTarget(uint16_t code, bool enabled, float buck_voltage)
+{
+    if (!enabled) return 0;
+    float target = constrain(LDO_VOLTS_AT_42 - ((int)code - 42) * LDO_VOLTS_PER_CODE, 0.0f, 5.0f);
+    return min(target, max(buck_voltage - LDO_DROPOUT, 0.0f));
+}
+
+bool SimCell::enabled()
+{
+    uint8_t outputs = gpio.getOutputs();
+    return (outputs & (1 << GPIO_BUCK_ENABLE)) && (outputs & (1 << GPIO_LDO_ENABLE));
+}
+
+bool SimCell::relayClosed()
+{
+    return gpio.getOutputs() & (1 << GPIO_OUTPUT_RELAY);
+}
+
+void SimCell::track()
+{
+    // Restart the transients from wherever the outputs are right now
+    bool now_enabled = enabled();
+    bool buck_changed = buck_dac.getCode() != buck_code || now_enabled != was_enabled;
+    bool ldo_changed = buck_changed || ldo_dac.getCode() != ldo_code;
+    uint64_t now = Sim::now();
+
+    if (ldo_changed) {
+        ldo_from = getLDOVoltage();
+        ldo_changed_at = now;
+    }
+    if (buck_changed) {
+        buck_from = getBuckVoltage();
+        buck_changed_at = now;
+    }
+    buck_code = buck_dac.getCode();
+    ldo_code = ldo_dac.getCode();
+    was_enabled = now_enabled;
+}
+
+// SimThermistor
+
+SimThermistor::SimThermistor()
+{
+    adc.setInputs(readInput, this);
+}
+
+float SimThermistor::getOutputVoltage(int channel) const
+{
+    return dac.getCode(channel) * SUPPLY_VOLTS / 4096;
+}
+
+float SimThermistor::readInput(void* context, uint8_t input)
+{
+    return static_cast<SimThermistor*>(context)->getOutputVoltage(input);
+}
+
+// SimBoard
+
+void SimBoard::attach(TwoWire& bus1, TwoWire& bus2)
+{
+    const uint8_t MUX_ADDRESS = 0x70;
+    bus1.detachAll();
+    bus2.detachAll();
+    bus1.attach(MUX_ADDRESS, &muxes[0]);
+    bus1.attach(&muxes[0]);
+    bus2.attach(MUX_ADDRESS, &muxes[1]);
+    bus2.attach(&muxes[1]);
+    bus2.attach(thermistor.getDacAddress(), &thermistor.dac);
+    bus2.attach(thermistor.getAdcAddress(), &thermistor.adc);
+    muxes[0].detachAll();
+    muxes[1].detachAll();
+    for (int i = 0; i < NUM_CELLS; i++) {
+        cells[i].attach(muxes[i / 8], i % 8);
+    }
+}
@@ -0,0 +1,223 @@
+#ifndef SIM_DEVICES_H
+#define SIM_DEVICES_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+// Register-level models of the parts on a cell-sim board
+
+// Lets the analog model hear about writes as they happen
+typedef void (*SimChangeHook)(void* context);
+
+// TCA9548 1-to-8 I2C mux: the control register is a channel bitmask
+class SimTCA9548 : public SimI2CDevice, public SimI2CRouter
+{
+public:
+    static const int NUM_CHANNELS = 8;
+
+    void attach(uint8_t channel, uint8_t address, SimI2CDevice* device);
+    void detachAll();
+    uint8_t getMask() const { return mask; }
+    uint32_t getWriteCount() const { return writes; }
+
+    bool receive(const uint8_t* data, size_t length) override;
+    bool transmit(uint8_t* data, size_t length) override;
+    void route(uint8_t address, std::vector<SimI2CDevice*>& found) override;
+
+private:
+    uint8_t mask = 0;
+    uint32_t writes = 0;
+    std::vector<std::pair<uint8_t, SimI2CDevice*>> channels[NUM_CHANNELS];
+};
+
+// MCP4725 12-bit DAC: fast-mode writes and the write DAC (and EEPROM) command
+class SimMCP4725 : public SimI2CDevice
+{
+public:
+    uint16_t getCode() const { return code; }
+    uint32_t getWriteCount() const { return writes; }
+    void setChangeHook(SimChangeHook hook, void* context) { change_hook = hook; change_context = context; }
+
+    bool receive(const uint8_t* data, size_t length) override;
+    bool transmit(uint8_t* data, size_t length) override;
+
+private:
+    void set(uint16_t value);
+
+    uint16_t code = 0;
+    uint16_t eeprom_code = 0;
+    uint32_t writes = 0;
+    SimChangeHook change_hook = nullptr;
+    void* change_context = nullptr;
+};
+
+// MCP4728 quad 12-bit DAC: fast writes of all four channels and multi-writes
+// of single channels, with the outputs following the input registers (LDAC
+// tied low)
+class SimMCP4728 : public SimI2CDevice
+{
+public:
+    static const int NUM_CHANNELS = 4;
+
+    uint16_t getCode(int channel) const { return codes[channel]; }
+    uint32_t getWriteCount() const { return writes; }
+
+    bool receive(const uint8_t* data, size_t length) override;
+    bool transmit(uint8_t* data, size_t length) override;
+
+private:
+    uint16_t codes[NUM_CHANNELS] = {0};
+    uint32_t writes = 0;
+};
+
+// ADS1115 16-bit ADC: pointer, config and conversion registers with
+// single-shot conversions that take the data-rate period of simulated time
+class SimADS1115 : public SimI2CDevice
+{
+public:
+    // Returns the voltage on an input at the current simulated time
+    typedef float (*InputFunction)(void* context, uint8_t input);
+
+    void setInputs(InputFunction function, void* context) { input_function = function; input_context = context; }
+    uint32_t getConversionCount() const { return conversions; }
+
+    bool receive(const uint8_t* data, size_t length) override;
+    bool transmit(uint8_t* data, size_t length) override;
+
+private:
+    void update();
+    uint64_t conversionTime() const;
+    float fullScale() const;
+
+    uint8_t pointer = 0;
+    uint16_t config = 0x8583;
+    int16_t conversion = 0;
+    uint16_t low_threshold = 0x8000;
+    uint16_t high_threshold = 0x7FFF;
+
+    bool converting = false;
+    uint64_t ready_at = 0;
+    float sampled_volts = 0;
+    uint32_t conversions = 0;
+
+    InputFunction input_function = nullptr;
+    void* input_context = nullptr;
+};
+
+// TCA6408 8-bit GPIO expander: input, output, polarity and config registers
+class SimTCA6408 : public SimI2CDevice
+{
+public:
+    uint8_t getOutputs() const { return registers[1] & ~registers[3]; }
+    void setChangeHook(SimChangeHook hook, void* context) { change_hook = hook; change_context = context; }
+
+    bool receive(const uint8_t* data, size_t length) override;
+    bool transmit(uint8_t* data, size_t length) override;
+
+private:
+    uint8_t pointer = 0;
+    uint8_t registers[4] = {0x00, 0xFF, 0x00, 0xFF};
+    SimChangeHook change_hook = nullptr;
+    void* change_context = nullptr;
+};
+
+// One cell channel: its four devices and an analog model of the buck, LDO,
+// output relay and current shunt. The supplies settle exponentially after a
+// DAC change, so calibration sees realistic transients.
+class SimCell
+{
+public:
+    static const uint8_t LDO_ADDRESS = 0x60;
+    static const uint8_t BUCK_ADDRESS = 0x61;
+    static const uint8_t ADC_ADDRESS = 0x48;
+    static const uint8_t GPIO_ADDRESS = 0x20;
+
+    SimCell();
+    void attach(SimTCA9548& mux, uint8_t channel);
+
+    // Resistive load on the output, 0 for none
+    void setLoad(float ohms) { load_ohms = ohms; }
+
+    float getBuckVoltage();
+    float getLDOVoltage();
+    float getOutputVoltage();
+    float getOutputCurrent();
+
+    SimMCP4725 buck_dac;
+    SimMCP4725 ldo_dac;
+    SimADS1115 adc;
+    SimTCA6408 gpio;
+
+private:
+    static float readInput(void* context, uint8_t input);
+    static void changed(void* context);
+    static float settle(float from, float to, uint64_t since, float tau_us);
+    static float buckTarget(uint16_t code, bool enabled);
+    static float ldoTarget(uint16_t code, bool enabled, float buck_voltage);
+
+    bool enabled();
+    bool relayClosed();
+    void track();
+
+    float load_ohms = 0;
+
+    // DAC codes and enable state the outputs are settling towards, and the
+    // voltages they were moving from
+    uint16_t buck_code = 0;
+    uint16_t ldo_code = 0;
+    bool was_enabled = false;
+    float buck_from = 0;
+    float ldo_from = 0;
+    uint64_t buck_changed_at = 0;
+    uint64_t ldo_changed_at = 0;
+};
+
+// The isolated thermistor front end: the ADC reads the DAC's outputs back.
+// The board as built has it at the addresses of a cell's LDO DAC and ADC; the
+// simulated one has it moved, where the native build of the firmware looks.
+class SimThermistor
+{
+public:
+    static const uint8_t BUILT_DAC_ADDRESS = 0x60;
+    static const uint8_t BUILT_ADC_ADDRESS = 0x48;
+    static const uint8_t DAC_ADDRESS = 0x64;
+    static const uint8_t ADC_ADDRESS = 0x49;
+    // The DAC's supply, which is also its reference
+    static constexpr float SUPPLY_VOLTS = 3.3;
+
+    SimThermistor();
+    float getOutputVoltage(int channel) const;
+    // Another strapping, from the next SimBoard::attach() on
+    void setAddresses(uint8_t dac, uint8_t adc) { dac_address = dac; adc_address = adc; }
+    uint8_t getDacAddress() const { return dac_address; }
+    uint8_t getAdcAddress() const { return adc_address; }
+
+    SimMCP4728 dac;
+    SimADS1115 adc;
+
+private:
+    static float readInput(void* context, uint8_t input);
+
+    uint8_t dac_address = DAC_ADDRESS;
+    uint8_t adc_address = ADC_ADDRESS;
+};
+
+// A whole board: a mux with eight cells on each of Wire and Wire1, and the
+// thermistor front end on Wire1 next to its mux. Attaching again rewires it.
+class SimBoard
+{
+public:
+    static const int NUM_CELLS = 16;
+
+    void attach(TwoWire& bus1, TwoWire& bus2);
+    SimCell& cell(int index) { return cells[index]; }
+    SimTCA9548& mux(int bus) { return muxes[bus]; }
+
+    SimThermistor thermistor;
+
+private:
+    SimTCA9548 muxes[2];
+    SimCell cells[NUM_CELLS];
+};
+
+#endif // SIM_DEVICES_H
@@ -0,0 +1,104 @@
+#include "acquisition.h"
+
+// Constructor
+Acquisition::Acquisition(Cell* cells, uint8_t num_cells) :
+    cells(cells), num_cells(num_cells > MAX_CELLS ? MAX_CELLS : num_cells) {
+}
+
+void Acquisition::poll()
+{
+    // The ALERT/RDY pins are not routed to the micro, so conversions are
+    // collected once the nominal conversion time for the data rate has passed
+    if (conversion_time_us == 0 && num_cells > 0) {
+        conversion_time_us = cells[0].getConversionTimeMicros();
+    }
+
+    for (uint8_t i = 0; i < num_cells; i++) {
+        Channel& channel = channels[i];
+        if (!channel.converting) {
+            start(i);
+            continue;
+        }
+
+        uint32_t now = micros();
+        if (now - channel.started_at < conversion_time_us) continue;
+
+        float value;
+        if (cells[i].readConversion(channel.input, value)) {
+            uint32_t version = sample_version.load(std::memory_order_relaxed);
+            sample_version.store(version + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Sample& sample = samples[i][channel.input];
+            sample.value = value;
+            sample.timestamp = channel.started_at + conversion_time_us / 2;
+            sample.valid = true;
+            if (channel.input == Cell::ADC_OUTPUT_CURRENT) integrate(i, sample);
+
+            sample_version.store(version + 2, std::memory_order_release);
+            sample_count++;
+            channel.input = (channel.input + 1) % Cell::NUM_ADC_INPUTS;
+        }
+
+        // Keep the ADC busy; a conversion clobbered by a blocking read is retried
+        start(i);
+    }
+}
+
+Sample Acquisition::getSample(uint8_t cell, uint8_t input) const
+{
+    if (cell >= num_cells || input >= Cell::NUM_ADC_INPUTS) return Sample();
+
+    Sample sample;
+    uint32_t before, after;
+    do {
+        before = sample_version.load(std::memory_order_acquire);
+        sample = samples[cell][input];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sample_version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return sample;
+}
+
+Totals Acquisition::getTotals(uint8_t cell) const
+{
+    if (cell >= num_cells) return Totals();
+
+    Totals result;
+    uint32_t before, after;
+    do {
+        before = sample_version.load(std::memory_order_acquire);
+        result = totals[cell];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sample_version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return result;
+}
+
+// Called with the sequence lock held
+void Acquisition::integrate(uint8_t cell, const Sample& current)
+{
+    Channel& channel = channels[cell];
+    const Sample& voltage = samples[cell][Cell::ADC_OUTPUT_VOLTAGE];
+    int32_t current_ua = (int32_t)lroundf(current.value * 1e6f);
+    int32_t power_uw = voltage.valid ? (int32_t)lroundf(voltage.value * current.value * 1e6f) : 0;
+
+    if (channel.integrating) {
+        int64_t dt = (uint32_t)(current.timestamp - channel.timestamp);
+        Totals& total = totals[cell];
+        total.charge += ((int64_t)channel.current_ua + current_ua) * dt / 2;
+        total.energy += ((int64_t)channel.power_uw + power_uw) * dt / 2;
+        total.time_us += dt;
+    }
+    channel.integrating = true;
+    channel.current_ua = current_ua;
+    channel.power_uw = power_uw;
+    channel.timestamp = current.timestamp;
+}
+
+void Acquisition::start(uint8_t cell)
+{
+    Channel& channel = channels[cell];
+    channel.converting = cells[cell].startConversion(channel.input);
+    channel.started_at = micros();
+}
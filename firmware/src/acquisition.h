@@ -0,0 +1,80 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "cell.h"
+
+// Latest reading of one ADC input: volts, or amps for the output current
+struct Sample
+{
+    float value = 0;
+    uint32_t timestamp = 0; // micros() at the middle of the conversion
+    bool valid = false;
+};
+
+// Running integrals of a cell's output since boot, positive while it
+// supplies a load
+struct Totals
+{
+    int64_t charge = 0;  // uA*us
+    int64_t energy = 0;  // uW*us
+    int64_t time_us = 0; // time the integrals cover
+};
+
+// Background acquisition for the cells on one I2C bus. Every cell's ADS1115
+// cycles round-robin through its four inputs using non-blocking single-shot
+// conversions, so all ADCs on the bus convert in parallel and readers get the
+// latest sample from the cache instead of waiting on a conversion.
+//
+// Each new current sample is integrated into the cell's charge and, with the
+// latest output voltage, its energy, using the trapezoidal rule between the
+// sample timestamps.
+//
+// poll() must only run on the task that owns the bus; getSample() and
+// getTotals() may be called from any task and never see a half-written value.
+class Acquisition
+{
+public:
+    static const uint8_t MAX_CELLS = 8;
+
+    // Constructor
+    Acquisition(Cell* cells, uint8_t num_cells);
+
+    // Public methods
+    void poll();
+    Sample getSample(uint8_t cell, uint8_t input) const;
+    Totals getTotals(uint8_t cell) const;
+    uint32_t getSampleCount() const { return sample_count; }
+
+private:
+    struct Channel
+    {
+        uint8_t input = 0;
+        bool converting = false;
+        uint32_t started_at = 0;
+
+        // Previous current sample, for the integrals
+        bool integrating = false;
+        int32_t current_ua = 0;
+        int32_t power_uw = 0;
+        uint32_t timestamp = 0;
+    };
+
+    void start(uint8_t cell);
+    void integrate(uint8_t cell, const Sample& current);
+
+    Cell* cells;
+    const uint8_t num_cells;
+    uint32_t conversion_time_us = 0;
+
+    Channel channels[MAX_CELLS];
+    Sample samples[MAX_CELLS][Cell::NUM_ADC_INPUTS];
+    Totals totals[MAX_CELLS];
+    uint32_t sample_count = 0;
+
+    // Sequence lock around samples and totals, odd while poll() is writing
+    std::atomic<uint32_t> sample_version{0};
+};
+
+#endif // ACQUISITION_H
@@ -0,0 +1,210 @@
+#include "battery_model.h"
+#include "board.h"
+
+// False if the parameters can't describe a battery
+bool BatteryModel::configure(const Params& params, uint32_t step_us)
+{
+    if (params.capacity_ah <= 0 || params.r0_ohms < 0 || params.num_rc_pairs > MAX_RC_PAIRS) return false;
+    if (params.num_ocv_points < 2 || params.num_ocv_points > MAX_OCV_POINTS) return false;
+    for (uint8_t i = 0; i < params.num_rc_pairs; i++) {
+        if (params.r_ohms[i] <= 0 || params.c_farads[i] <= 0) return false;
+    }
+
+    capacity_uaus = (int64_t)(params.capacity_ah * 3600.0 * 1e12);
+    charge_per_lsb = capacity_uaus >> 16;
+    if (charge_per_lsb < 1) charge_per_lsb = 1;
+    r0_uohm = (uint32_t)(params.r0_ohms * 1e6f + 0.5f);
+    num_rc_pairs = params.num_rc_pairs;
+    for (uint8_t i = 0; i < num_rc_pairs; i++) {
+        r_uohm[i] = (uint32_t)(params.r_ohms[i] * 1e6f + 0.5f);
+        // Fraction of the RC voltage left after one step
+        float tau_us = params.r_ohms[i] * params.c_farads[i] * 1e6f;
+        decay_q16[i] = (uint32_t)(expf(-(float)step_us / tau_us) * 65536.0f + 0.5f);
+    }
+    num_ocv_points = params.num_ocv_points;
+    for (uint8_t i = 0; i < num_ocv_points; i++) {
+        ocv_table_uv[i] = (int32_t)(params.ocv[i] * 1e6f + 0.5f);
+    }
+    this->step_us = step_us;
+    reset(1.0);
+    return true;
+}
+
+// Starts over at the given state of charge (0 to 1) with the RC pairs relaxed
+void BatteryModel::reset(float soc)
+{
+    if (soc < 0) soc = 0;
+    if (soc > 1) soc = 1;
+    charge_uaus = (int64_t)(soc * capacity_uaus);
+    for (uint8_t i = 0; i < MAX_RC_PAIRS; i++) rc_uv[i] = 0;
+    soc_q16 = (uint32_t)(charge_uaus / charge_per_lsb);
+    if (soc_q16 > 65536) soc_q16 = 65536;
+    ocv_uv = lookupOCV(soc_q16);
+    terminal_uv = ocv_uv;
+    current_ua = 0;
+}
+
+// Advances the model by one step with the current measured over it and
+// returns the terminal voltage in uV
+int32_t BatteryModel::step(int32_t current_ua)
+{
+    this->current_ua = current_ua;
+
+    charge_uaus -= (int64_t)current_ua * step_us;
+    if (charge_uaus < 0) charge_uaus = 0;
+    if (charge_uaus > capacity_uaus) charge_uaus = capacity_uaus;
+    int64_t soc = charge_uaus / charge_per_lsb;
+    soc_q16 = soc > 65536 ? 65536 : (uint32_t)soc;
+    ocv_uv = lookupOCV(soc_q16);
+
+    int64_t terminal = ocv_uv - (int64_t)current_ua * r0_uohm / 1000000;
+    for (uint8_t i = 0; i < num_rc_pairs; i++) {
+        // v += (I * R - v) * (1 - decay)
+        int64_t settled = (int64_t)current_ua * r_uohm[i] / 1000000;
+        rc_uv[i] = (int32_t)(((int64_t)rc_uv[i] * decay_q16[i] + settled * (65536 - decay_q16[i])) >> 16);
+        terminal -= rc_uv[i];
+    }
+    terminal_uv = terminal < 0 ? 0 : (int32_t)terminal;
+    return terminal_uv;
+}
+
+int32_t BatteryModel::lookupOCV(uint32_t soc) const
+{
+    // Position in the table in Q16, between point index and index + 1
+    uint32_t position = soc * (num_ocv_points - 1);
+    uint32_t index = position >> 16;
+    if (index >= (uint32_t)num_ocv_points - 1) return ocv_table_uv[num_ocv_points - 1];
+    int32_t fraction = position & 0xFFFF;
+    int32_t low = ocv_table_uv[index];
+    int32_t high = ocv_table_uv[index + 1];
+    return low + (int32_t)(((int64_t)(high - low) * fraction) >> 16);
+}
+
+bool BatteryModels::configure(uint8_t cell, const BatteryModel::Params& params)
+{
+    if (cell >= 16 || (getRunningMask() & (1U << cell))) return false;
+    // A tick that saw the cell before it stopped may still be stepping it
+    waitForTick();
+    if (!models[cell].configure(params, STEP_US)) return false;
+    publish(cell);
+    return true;
+}
+
+// Every cell in the mask starts from soc (0 to 1). False if one of them has no
+// parameters or is running already.
+bool BatteryModels::start(uint16_t cell_mask, float soc)
+{
+    if (!cell_mask || (getRunningMask() & cell_mask)) return false;
+    for (uint8_t i = 0; i < 16; i++) {
+        if ((cell_mask & (1U << i)) && !models[i].isConfigured()) return false;
+    }
+    waitForTick();
+    for (uint8_t i = 0; i < 16; i++) {
+        if (!(cell_mask & (1U << i))) continue;
+        models[i].reset(soc);
+        publish(i);
+    }
+    // The timer may not have seen the models stop, make sure it starts afresh
+    if (!getRunningMask()) restart.store(true);
+    running.fetch_or(cell_mask, std::memory_order_release);
+    return true;
+}
+
+// Stopped cells keep their last voltage. A tick that saw them still running
+// may be about to step them and set it, so wait it out.
+void BatteryModels::stop(uint16_t cell_mask)
+{
+    running.fetch_and(~cell_mask);
+    waitForTick();
+}
+
+// Sequentially consistent with the store at the start of tick(): either this
+// sees the tick running, or the tick sees the cells stopped
+void BatteryModels::waitForTick() const
+{
+    while (ticking.load()) {
+    }
+}
+
+BatteryModel::State BatteryModels::getState(uint8_t cell) const
+{
+    BatteryModel::State state;
+    uint32_t version;
+    do {
+        version = state_versions[cell].load(std::memory_order_acquire);
+        state = states[cell];
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((version & 1) || version != state_versions[cell].load(std::memory_order_relaxed));
+    return state;
+}
+
+// Copies the model's state where getState() reads it, from whichever task
+// last changed the model
+void BatteryModels::publish(uint8_t cell)
+{
+    uint32_t version = state_versions[cell].load(std::memory_order_relaxed);
+    state_versions[cell].store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    states[cell] = models[cell].getState();
+    state_versions[cell].store(version + 2, std::memory_order_release);
+}
+
+uint32_t BatteryModels::getMeanStepTime() const
+{
+    uint32_t count = steps.load();
+    return count ? total_step_us.load() / count : 0;
+}
+
+void BatteryModels::resetStats()
+{
+    steps.store(0);
+    total_step_us.store(0);
+    max_step_us.store(0);
+    late.store(0);
+}
+
+void BatteryModels::tick(uint32_t now)
+{
+    ticking.store(true);
+    if (restart.exchange(false) || !running.load()) stepping = false;
+    if (!running.load()) {
+        ticking.store(false, std::memory_order_release);
+        return;
+    }
+    if (!stepping) {
+        next_step = now;
+        stepping = true;
+    }
+
+    uint8_t made = 0;
+    while ((int32_t)(now - next_step) >= 0 && made < MAX_CATCH_UP) {
+        step();
+        next_step += STEP_US;
+        made++;
+    }
+    // Too far behind to make up, skip ahead instead
+    if ((int32_t)(now - next_step) >= 0) {
+        late.fetch_add((now - next_step) / STEP_US + 1);
+        next_step = now + STEP_US;
+    }
+    ticking.store(false, std::memory_order_release);
+}
+
+void BatteryModels::step()
+{
+    uint32_t started_at = micros();
+    uint16_t mask = running.load();
+    for (uint8_t i = 0; i < 16; i++) {
+        if (!(mask & (1U << i))) continue;
+        Sample current = workerFor(i).getSample(i % 8, Cell::ADC_OUTPUT_CURRENT);
+        int32_t current_ua = current.valid ? (int32_t)lroundf(current.value * 1e6f) : 0;
+        int32_t terminal_uv = models[i].step(current_ua);
+        setVoltageTarget(i, terminal_uv / 1e6f);
+        publish(i);
+    }
+
+    uint32_t took = micros() - started_at;
+    steps.fetch_add(1);
+    total_step_us.fetch_add(took);
+    if (took > max_step_us.load()) max_step_us.store(took);
+}
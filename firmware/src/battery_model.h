@@ -0,0 +1,136 @@
+#ifndef BATTERY_MODEL_H
+#define BATTERY_MODEL_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Equivalent circuit of one battery: an open circuit voltage that follows the
+// state of charge, a series resistance R0 and up to two RC pairs.
+//
+//   terminal = OCV(SOC) - I * R0 - V_rc1 - V_rc2
+//
+// I is the measured output current, positive while the cell supplies a load.
+// Each step integrates it into the state of charge and moves the RC voltages
+// towards I * R with the decay factor of their time constant. The step only
+// uses integer math: charge in uA*us, voltages in uV and the decay factors and
+// SOC in Q16, with everything involving exp() worked out in configure().
+class BatteryModel
+{
+public:
+    static const uint8_t MAX_RC_PAIRS = 2;
+    static const uint8_t MAX_OCV_POINTS = 21;
+
+    struct Params
+    {
+        float capacity_ah;
+        float r0_ohms;
+        uint8_t num_rc_pairs;
+        float r_ohms[MAX_RC_PAIRS];
+        float c_farads[MAX_RC_PAIRS];
+        // OCV at evenly spaced SOC from 0 to 100%
+        uint8_t num_ocv_points;
+        float ocv[MAX_OCV_POINTS];
+    };
+
+    // What MODELGET reports, in SI units
+    struct State
+    {
+        float soc;
+        float terminal_v;
+        float ocv_v;
+        float current_a;
+    };
+
+    // Public methods
+    bool configure(const Params& params, uint32_t step_us);
+    bool isConfigured() const { return capacity_uaus > 0; }
+    void reset(float soc);
+    int32_t step(int32_t current_ua);
+
+    float getSOC() const { return soc_q16 / 65536.0f; }
+    float getTerminalVoltage() const { return terminal_uv / 1e6f; }
+    float getOCV() const { return ocv_uv / 1e6f; }
+    float getCurrent() const { return current_ua / 1e6f; }
+    State getState() const { return {getSOC(), getTerminalVoltage(), getOCV(), getCurrent()}; }
+
+private:
+    int32_t lookupOCV(uint32_t soc) const;
+
+    // Parameters in fixed point
+    int64_t capacity_uaus = 0;
+    int64_t charge_per_lsb = 1; // capacity / 2^16, so SOC = charge / charge_per_lsb
+    uint32_t r0_uohm = 0;
+    uint8_t num_rc_pairs = 0;
+    uint32_t r_uohm[MAX_RC_PAIRS] = {0};
+    uint32_t decay_q16[MAX_RC_PAIRS] = {0};
+    uint8_t num_ocv_points = 0;
+    int32_t ocv_table_uv[MAX_OCV_POINTS] = {0};
+    uint32_t step_us = 0;
+
+    // State
+    int64_t charge_uaus = 0;
+    int32_t rc_uv[MAX_RC_PAIRS] = {0};
+    uint32_t soc_q16 = 0;
+    int32_t ocv_uv = 0;
+    int32_t terminal_uv = 0;
+    int32_t current_ua = 0;
+};
+
+// Runs a battery model on each cell that has one started, at STEP_US from the
+// simulation timer. Every step reads the cell's latest current from the
+// acquisition cache and sets the model's terminal voltage as the cell's
+// target. The time each step takes over all cells is kept so the cost of the
+// models can be checked against the step period.
+//
+// stop(), configure() and start() wait out a tick in flight, as
+// TemperatureRamp::stop() does, so once they return no step touches the
+// cell's model or sets its target.
+class BatteryModels
+{
+public:
+    static const uint32_t STEP_US = 10000;
+    // Steps made up at once after the timer fell behind; the rest are late
+    static const uint8_t MAX_CATCH_UP = 4;
+
+    // From the command task, only while the cells are stopped
+    bool configure(uint8_t cell, const BatteryModel::Params& params);
+    bool start(uint16_t cell_mask, float soc);
+    void stop(uint16_t cell_mask);
+    uint16_t getRunningMask() const { return running.load(std::memory_order_acquire); }
+    BatteryModel::State getState(uint8_t cell) const;
+
+    uint32_t getStepCount() const { return steps.load(); }
+    uint32_t getMeanStepTime() const;
+    uint32_t getMaxStepTime() const { return max_step_us.load(); }
+    uint32_t getLateCount() const { return late.load(); }
+    void resetStats();
+
+    // Runs on the timer
+    void tick(uint32_t now);
+
+private:
+    void step();
+    void publish(uint8_t cell);
+    void waitForTick() const;
+
+    BatteryModel models[16];
+    std::atomic<uint16_t> running{0};
+    std::atomic<bool> ticking{false};
+
+    // The state of each model is published under a seqlock, like
+    // Thermistor's models: its version is odd while publish() writes it, and
+    // readers retry until they copied it between two equal even versions.
+    BatteryModel::State states[16] = {};
+    std::atomic<uint32_t> state_versions[16] = {};
+
+    uint32_t next_step = 0;
+    bool stepping = false;
+    std::atomic<bool> restart{false};
+
+    std::atomic<uint32_t> steps{0};
+    std::atomic<uint32_t> total_step_us{0};
+    std::atomic<uint32_t> max_step_us{0};
+    std::atomic<uint32_t> late{0};
+};
+
+#endif // BATTERY_MODEL_H
@@ -0,0 +1,96 @@
+#include "binary_protocol.h"
+
+namespace BinaryProtocol
+{
+
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc)
+{
+    // CRC-16/CCITT-FALSE, polynomial 0x1021
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t encode(uint8_t* out, uint8_t seq, uint8_t cmd, const uint8_t* payload, uint8_t length)
+{
+    out[0] = SOF;
+    out[1] = length;
+    out[2] = seq;
+    out[3] = cmd;
+    if (length > 0) memcpy(&out[HEADER_SIZE], payload, length);
+
+    uint16_t crc = crc16(&out[1], HEADER_SIZE - 1 + length);
+    out[HEADER_SIZE + length] = crc & 0xFF;
+    out[HEADER_SIZE + length + 1] = crc >> 8;
+    return HEADER_SIZE + length + CRC_SIZE;
+}
+
+uint16_t voltsToFixed(float volts)
+{
+    if (volts <= 0) return 0;
+    if (volts >= 6.5535f) return 0xFFFF;
+    return (uint16_t)(volts * 10000.0f + 0.5f);
+}
+
+float fixedToVolts(uint16_t value)
+{
+    return value / 10000.0f;
+}
+
+int32_t ampsToFixed(float amps)
+{
+    return (int32_t)lroundf(amps * 1000000.0f);
+}
+
+Decoder::Result Decoder::feed(uint8_t byte)
+{
+    unsigned long now = millis();
+    if (received > 0 && now - last_byte_at > FRAME_TIMEOUT_MS) {
+        received = 0;
+    }
+    last_byte_at = now;
+
+    if (received == 0 && byte != SOF) {
+        // Not part of a frame, collect it as text
+        if (byte == '\r') return NONE;
+        if (byte == '\n') {
+            bool complete = line_length > 0;
+            line_buffer[line_length < MAX_LINE ? line_length : MAX_LINE] = '\0';
+            line_length = 0;
+            return complete ? LINE : NONE;
+        }
+        if (line_length < MAX_LINE) line_buffer[line_length] = (char)byte;
+        line_length++;
+        return NONE;
+    }
+
+    if (received == 0) line_length = 0;
+    buffer[received++] = byte;
+    if (received < HEADER_SIZE) return NONE;
+
+    size_t total = HEADER_SIZE + buffer[1] + CRC_SIZE;
+    if (received < total) return NONE;
+    received = 0;
+
+    current.length = buffer[1];
+    current.seq = buffer[2];
+    current.cmd = buffer[3];
+    memcpy(current.payload, &buffer[HEADER_SIZE], current.length);
+
+    uint16_t expected = crc16(&buffer[1], HEADER_SIZE - 1 + current.length);
+    uint16_t actual = buffer[total - 2] | (buffer[total - 1] << 8);
+    return expected == actual ? FRAME : BAD_CRC;
+}
+
+size_t PayloadWriter::write(uint8_t c)
+{
+    if (used >= capacity) return 0;
+    buffer[used++] = c;
+    return 1;
+}
+
+}
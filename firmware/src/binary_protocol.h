@@ -0,0 +1,119 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+
+// Binary host protocol, entered from ASCII mode with the BINARY command.
+//
+// Frame layout (multi-byte fields are little-endian):
+//   SOF (0xA5) | length | seq | cmd | payload[length] | CRC16
+// The CRC is CRC-16/CCITT-FALSE over length, seq, cmd and the payload.
+// Replies echo seq, set bit 7 of cmd and start the payload with a status byte.
+// Voltages are uint16 in units of 100 uV, currents are int32 in microamps.
+namespace BinaryProtocol
+{
+    const uint8_t VERSION = 1;
+    const uint8_t SOF = 0xA5;
+    const uint8_t MAX_PAYLOAD = 255;
+    const uint8_t HEADER_SIZE = 4;
+    const uint8_t CRC_SIZE = 2;
+    const size_t MAX_FRAME_SIZE = HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE;
+    const uint8_t REPLY_FLAG = 0x80;
+
+    // Commands
+    const uint8_t CMD_PING = 0x01;
+    const uint8_t CMD_SET_V = 0x02;       // cell (1-16), voltage
+    const uint8_t CMD_GET_V = 0x03;       // cell (1-16) -> voltage
+    const uint8_t CMD_SET_ALL_V = 0x04;   // voltage
+    const uint8_t CMD_GET_ALL_V = 0x05;   // -> 16 voltages
+    const uint8_t CMD_GET_ALL_I = 0x06;   // -> 16 currents
+    const uint8_t CMD_SET_VEC = 0x07;     // cell mask (uint16), one voltage per cell in the mask
+    const uint8_t CMD_GET_VEC = 0x08;     // cell mask (uint16), fields -> readings, see below
+    const uint8_t CMD_STAGE_VEC = 0x09;   // like CMD_SET_VEC, but waits for CMD_COMMIT
+    const uint8_t CMD_COMMIT = 0x0A;      // -> cell mask (uint16), skew, latency (uint32 us)
+    const uint8_t CMD_GET_ACC = 0x0B;     // cell mask (uint16) -> per cell charge (int32 uAh), energy (int32 uWh), time (uint32 ms)
+    const uint8_t CMD_RESET_ACC = 0x0C;   // cell mask (uint16)
+    const uint8_t CMD_STREAM_FRAME = 0x40; // unsolicited, see telemetry_stream.h
+    const uint8_t CMD_ASCII = 0x7E;       // ASCII command line -> ASCII reply text
+    const uint8_t CMD_EXIT = 0x7F;        // back to ASCII mode
+
+    // Reply status
+    const uint8_t STATUS_OK = 0x00;
+    const uint8_t STATUS_BAD_CRC = 0x01;
+    const uint8_t STATUS_UNKNOWN_COMMAND = 0x02;
+    const uint8_t STATUS_BAD_ARGUMENT = 0x03;
+
+    // CMD_GET_VEC fields. The reply holds, for each cell in the mask from the
+    // lowest, the selected readings in this order.
+    const uint8_t FIELD_VOLTAGE = 0x01;   // uint16 voltage
+    const uint8_t FIELD_CURRENT = 0x02;   // int32 current
+    const uint8_t FIELD_BUCK = 0x04;      // uint16 voltage
+    const uint8_t FIELD_LDO = 0x08;       // uint16 voltage
+
+    // seq, timestamp, drops (uint32), then 16 voltages, 16 currents, 16 buck, 16 LDO
+    const uint8_t STREAM_FRAME_PAYLOAD = 12 + 16 * 2 + 16 * 4 + 16 * 2 + 16 * 2;
+
+    struct Frame
+    {
+        uint8_t seq;
+        uint8_t cmd;
+        uint8_t length;
+        uint8_t payload[MAX_PAYLOAD];
+    };
+
+    uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+    size_t encode(uint8_t* out, uint8_t seq, uint8_t cmd, const uint8_t* payload, uint8_t length);
+
+    inline uint16_t getU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    inline void putU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+    inline void putU32(uint8_t* p, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+    }
+    inline void putI32(uint8_t* p, int32_t v) { putU32(p, (uint32_t)v); }
+
+    uint16_t voltsToFixed(float volts);
+    float fixedToVolts(uint16_t value);
+    int32_t ampsToFixed(float amps);
+
+    // Incremental frame decoder. Bytes outside of a frame are collected as a
+    // text line so a host that lost track of the mode can send "ASCII\n".
+    class Decoder
+    {
+    public:
+        enum Result { NONE, FRAME, BAD_CRC, LINE };
+
+        Result feed(uint8_t byte);
+        const Frame& frame() const { return current; }
+        const char* line() const { return line_buffer; }
+
+    private:
+        // A frame that stalls for this long is dropped so the decoder resyncs
+        static const unsigned long FRAME_TIMEOUT_MS = 100;
+        static const size_t MAX_LINE = 16;
+
+        uint8_t buffer[MAX_FRAME_SIZE];
+        size_t received = 0;
+        unsigned long last_byte_at = 0;
+        Frame current;
+
+        char line_buffer[MAX_LINE + 1] = {0};
+        size_t line_length = 0;
+    };
+
+    // Print target that collects text into a reply payload
+    class PayloadWriter : public Print
+    {
+    public:
+        PayloadWriter(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+        size_t write(uint8_t c) override;
+        size_t length() const { return used; }
+
+    private:
+        uint8_t* buffer;
+        size_t capacity;
+        size_t used = 0;
+    };
+}
+
+#endif // BINARY_PROTOCOL_H
@@ -0,0 +1,367 @@
+#include "board.h"
+
+// One mux owner per I2C bus, shared by the cells on that bus
+I2CMux mux1(Wire);
+I2CMux mux2(Wire1);
+
+// Create cells
+Cell cell1(0, mux1);
+Cell cell2(1, mux1);
+Cell cell3(2, mux1);
+Cell cell4(3, mux1);
+Cell cell5(4, mux1);
+Cell cell6(5, mux1);
+Cell cell7(6, mux1);
+Cell cell8(7, mux1);
+Cell cell9(0, mux2);
+Cell cell10(1, mux2);
+Cell cell11(2, mux2);
+Cell cell12(3, mux2);
+Cell cell13(4, mux2);
+Cell cell14(5, mux2);
+Cell cell15(6, mux2);
+Cell cell16(7, mux2);
+
+// Cell array
+Cell cells[] = {cell1, cell2, cell3, cell4, cell5, cell6, cell7, cell8, cell9, cell10, cell11, cell12, cell13, cell14, cell15, cell16};
+
+// One worker per I2C bus; its task is the only one that touches the bus
+BusWorker bus1(mux1, &cells[0], 8);
+BusWorker bus2(mux2, &cells[8], 8);
+
+BusWorker& workerFor(int index)
+{
+    return index < 8 ? bus1 : bus2;
+}
+
+// Buses are numbered 1 and 2 like their workers
+static BusWorker* workerForBus(uint8_t bus)
+{
+    return bus == 1 ? &bus1 : bus == 2 ? &bus2 : nullptr;
+}
+
+// Clock each bus runs at, as last set from setup() or setBusClock()
+uint32_t busClocks[2] = {BUS_CLOCK_HZ[0], BUS_CLOCK_HZ[1]};
+
+// Changes a bus's clock from its own task, between transactions
+bool setBusClock(uint8_t bus, uint32_t clock_hz)
+{
+    BusWorker* worker = workerForBus(bus);
+    if (!worker || clock_hz < MIN_BUS_CLOCK_HZ || clock_hz > MAX_BUS_CLOCK_HZ) return false;
+
+    struct ClockChange
+    {
+        TwoWire* wire;
+        uint32_t clock_hz;
+        bool ok;
+    } change = {&worker->getMux().getWire(), clock_hz, false};
+    worker->call(0, [](Cell&, void* context) {
+        ClockChange* change = static_cast<ClockChange*>(context);
+        change->ok = change->wire->setClock(change->clock_hz);
+    }, &change);
+    if (change.ok) busClocks[bus - 1] = clock_hz;
+    return change.ok;
+}
+
+uint32_t getBusClock(uint8_t bus)
+{
+    return workerForBus(bus) ? busClocks[bus - 1] : 0;
+}
+
+void setVoltageTarget(int index, float voltage)
+{
+    workerFor(index).setTarget(index % 8, voltage);
+}
+
+// Sets the targets of the cells in the mask (bit i = cell i + 1) to
+// voltages[i], each bus takes all of its new targets in one pass
+void setVoltageTargets(uint16_t cell_mask, const float* voltages)
+{
+    bus1.setTargets(cell_mask & 0xFF, &voltages[0]);
+    bus2.setTargets(cell_mask >> 8, &voltages[8]);
+}
+
+// Voltage profiles and battery models, both run from the simulation timer
+WaveformPlayer waveformPlayer;
+BatteryModels batteryModels;
+
+Thermistor thermistor(mux2);
+TemperatureRamp temperatureRamp;
+
+// Targets waiting for a commit, and the cells (bit i = cell i + 1) that have one
+float stagedTargets[16];
+uint16_t stagedMask = 0;
+CommitResult lastCommit = {0, 0, 0, {0}};
+
+// Stages voltages[i] for the cells in the mask, replacing anything staged for
+// them before; nothing moves until commitStagedTargets()
+void stageVoltageTargets(uint16_t cell_mask, const float* voltages)
+{
+    for (int i = 0; i < 16; i++) {
+        if (cell_mask & (1U << i)) stagedTargets[i] = voltages[i];
+    }
+    stagedMask |= cell_mask;
+}
+
+uint16_t getStagedMask()
+{
+    return stagedMask;
+}
+
+void clearStagedTargets()
+{
+    stagedMask = 0;
+}
+
+// Moves every staged cell to its staged target at the same time. Both buses
+// first raise the bucks that need it and wait, then write their LDOs back to
+// back from one release time. Fails if nothing is staged or a bus is
+// calibrating; the staged targets are kept in that case.
+bool commitStagedTargets(CommitResult& result)
+{
+    uint32_t requested_at = micros();
+    uint16_t mask = stagedMask;
+    if (!mask || bus1.isCalibrating() || bus2.isCalibrating()) return false;
+
+    BusWorker* buses[] = {&bus1, &bus2};
+    for (int b = 0; b < 2; b++) {
+        while (!buses[b]->beginCommit((mask >> (8 * b)) & 0xFF, &stagedTargets[8 * b])) delay(1);
+    }
+    for (int b = 0; b < 2; b++) {
+        if ((mask >> (8 * b)) & 0xFF) {
+            while (!buses[b]->isCommitArmed()) delay(1);
+        }
+    }
+    uint32_t release_at = micros() + COMMIT_RELEASE_LEAD_US;
+    for (int b = 0; b < 2; b++) buses[b]->releaseCommit(release_at);
+    while (!bus1.isCommitDone() || !bus2.isCommitDone()) delay(1);
+    stagedMask = 0;
+
+    // Skew and latency from the write times both buses recorded
+    uint32_t first = 0;
+    uint32_t last = 0;
+    bool any = false;
+    for (int i = 0; i < 16; i++) {
+        if (!(mask & (1U << i))) continue;
+        uint32_t at = workerFor(i).getCommitTime(i % 8);
+        if (!any || (int32_t)(at - first) < 0) first = at;
+        if (!any || (int32_t)(at - last) > 0) last = at;
+        any = true;
+    }
+    result.cell_mask = mask;
+    result.skew_us = last - first;
+    result.latency_us = first - requested_at;
+    for (int i = 0; i < 16; i++) {
+        result.offsets_us[i] = mask & (1U << i) ? workerFor(i).getCommitTime(i % 8) - first : 0;
+    }
+    lastCommit = result;
+    return true;
+}
+
+const CommitResult& getLastCommit()
+{
+    return lastCommit;
+}
+
+// Runs a job on the cell's bus task and waits for it
+void runOnCell(int index, BusWorker::JobFunction function, void* context)
+{
+    workerFor(index).call(index % 8, function, context);
+}
+
+// Every cell's TCA6408 answers here, behind its mux channel. Nothing else on
+// either bus does: the thermistor front end has a cell's ADC and LDO DAC
+// addresses on this board, so those would count its answers too.
+static const uint8_t CELL_GPIO_ADDRESS = 0x20;
+static const uint8_t TCA6408_REG_CONFIG = 0x03;
+
+struct BenchmarkRun
+{
+    I2CMux* mux;
+    uint8_t num_cells;
+    uint16_t rounds;
+    BusBenchmark* result;
+};
+
+// Counts a transaction by its outcome, as returned by endTransmission()
+static void countTransaction(BusBenchmark& result, uint8_t status)
+{
+    result.transactions++;
+    // 2 and 3 are an address or data byte not acknowledged
+    if (status == 2 || status == 3) result.nacks++;
+    else if (status != 0) result.errors++;
+}
+
+// Times the traffic the bus task makes when sampling: each round selects
+// every cell's mux channel and reads its GPIO expander's config register,
+// three transactions per cell. Nothing is written that the cells depend on,
+// the mux is re-selected by its owner afterwards.
+BusBenchmark benchmarkBus(uint8_t bus, uint16_t rounds)
+{
+    BusBenchmark result = {getBusClock(bus), 0, 0, 0, 0};
+    BusWorker* worker = workerForBus(bus);
+    if (!worker) return result;
+
+    BenchmarkRun run = {&worker->getMux(), worker->getNumCells(), rounds, &result};
+    worker->call(0, [](Cell&, void* context) {
+        BenchmarkRun* run = static_cast<BenchmarkRun*>(context);
+        BusBenchmark& result = *run->result;
+        TwoWire& wire = run->mux->getWire();
+
+        uint32_t started_at = micros();
+        for (uint16_t round = 0; round < run->rounds; round++) {
+            for (uint8_t channel = 0; channel < run->num_cells; channel++) {
+                wire.beginTransmission(run->mux->getAddress());
+                wire.write((uint8_t)(1 << channel));
+                countTransaction(result, wire.endTransmission());
+
+                wire.beginTransmission(CELL_GPIO_ADDRESS);
+                wire.write(TCA6408_REG_CONFIG);
+                countTransaction(result, wire.endTransmission());
+
+                // A read that comes back short was not acknowledged
+                result.transactions++;
+                if (wire.requestFrom(CELL_GPIO_ADDRESS, (size_t)1) != 1) result.nacks++;
+                while (wire.available()) wire.read();
+            }
+        }
+        result.elapsed_us = micros() - started_at;
+        run->mux->invalidate();
+    }, &run);
+    return result;
+}
+
+// How long until GETALLV would answer with voltages all sampled after the
+// request, i.e. the time a host waits to see a change on every cell. 0 if
+// that takes longer than the timeout.
+uint32_t measureFreshReadLatency(uint32_t timeout_us)
+{
+    uint32_t requested_at = micros();
+    for (;;) {
+        bool fresh = true;
+        for (int i = 0; i < 16 && fresh; i++) {
+            Sample sample = workerFor(i).getSample(i % 8, Cell::ADC_OUTPUT_VOLTAGE);
+            fresh = sample.valid && (int32_t)(sample.timestamp - requested_at) >= 0;
+        }
+        uint32_t elapsed = micros() - requested_at;
+        if (fresh) return elapsed;
+        if (elapsed > timeout_us) return 0;
+        delay(1);
+    }
+}
+
+// Calibrates the cells in the mask (bit i = cell i + 1), both buses in parallel
+void calibrateCells(uint16_t cell_mask)
+{
+    bus1.startCalibration(cell_mask & 0xFF);
+    bus2.startCalibration(cell_mask >> 8);
+    while (bus1.isCalibrating() || bus2.isCalibrating()) delay(1);
+}
+
+// Calibration tables that survive a reboot
+CalibrationStore calibrationStore;
+
+// Stores the tables of the cells in the mask; a table that fails validation
+// is not saved, so that cell calibrates again at the next boot
+void saveCalibration(uint16_t cell_mask)
+{
+    for (int i = 0; i < 16; i++) {
+        if (!(cell_mask & (1U << i))) continue;
+        CalibrationTable table;
+        CalibrationStore::readTable(cells[i], table);
+        if (CalibrationStore::isValid(table)) calibrationStore.save(i, table);
+    }
+}
+
+struct BlockingRead
+{
+    uint8_t input;
+    float value;
+};
+
+// Latest cached reading for a cell, falling back to a blocking read until the
+// acquisition engine has produced its first sample for that input
+float getCachedReading(int index, uint8_t input)
+{
+    Sample sample = workerFor(index).getSample(index % 8, input);
+    if (sample.valid) return sample.value;
+
+    BlockingRead read = {input, 0};
+    runOnCell(index, [](Cell& cell, void* context) {
+        BlockingRead* read = static_cast<BlockingRead*>(context);
+        switch (read->input) {
+            case Cell::ADC_BUCK_VOLTAGE: read->value = cell.getBuckVoltage(); break;
+            case Cell::ADC_LDO_VOLTAGE: read->value = cell.getLDOVoltage(); break;
+            case Cell::ADC_OUTPUT_CURRENT: read->value = cell.getCurrent(); break;
+            default: read->value = cell.getVoltage(); break;
+        }
+    }, &read);
+    return read.value;
+}
+
+// The acquisition totals run from boot; a reset just moves the baseline, so
+// the bus tasks never wait on it
+Totals accumulatorBase[16];
+
+Accumulated getAccumulated(int index)
+{
+    Totals totals = workerFor(index).getTotals(index % 8);
+    const Totals& base = accumulatorBase[index];
+    Accumulated result;
+    // 1 mAh is 3.6e12 uA*us, 1 mWh 3.6e12 uW*us
+    result.charge_mah = (totals.charge - base.charge) / 3.6e12f;
+    result.energy_mwh = (totals.energy - base.energy) / 3.6e12f;
+    result.seconds = (totals.time_us - base.time_us) / 1e6f;
+    return result;
+}
+
+void resetAccumulators(uint16_t cell_mask)
+{
+    for (int i = 0; i < 16; i++) {
+        if (cell_mask & (1U << i)) accumulatorBase[i] = workerFor(i).getTotals(i % 8);
+    }
+}
+
+// Initializes every cell and loads its stored calibration. Returns the cells
+// (bit i = cell i + 1) that have no usable table and still need calibrating.
+uint16_t initCells()
+{
+    calibrationStore.begin();
+    uint16_t uncalibrated = 0;
+    for (int i = 0; i < 16; i++) {
+        cells[i].init();
+        cells[i].enable();
+        cells[i].turnOnOutputRelay();
+
+        CalibrationTable table;
+        if (calibrationStore.load(i, table)) {
+            CalibrationStore::applyTable(cells[i], table);
+        } else {
+            uncalibrated |= 1U << i;
+        }
+    }
+    return uncalibrated;
+}
+
+// False if the thermistor front end isn't fitted, or is at the cells' addresses
+bool initThermistor()
+{
+    if (!thermistor.init()) return false;
+    bus2.attachThermistor(&thermistor);
+    return true;
+}
+
+// The front end's four outputs as read back by its ADC, from bus 2's task
+bool readThermistorVoltages(float* volts)
+{
+    struct Readback
+    {
+        float* volts;
+        bool ok;
+    } readback = {volts, false};
+    bus2.call(0, [](Cell&, void* context) {
+        Readback* readback = static_cast<Readback*>(context);
+        readback->ok = thermistor.readVoltages(readback->volts);
+    }, &readback);
+    return readback.ok;
+}
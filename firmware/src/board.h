@@ -0,0 +1,94 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "cell.h"
+#include "i2c_mux.h"
+#include "bus_worker.h"
+#include "calibration.h"
+#include "calibration_store.h"
+#include "waveform.h"
+#include "battery_model.h"
+#include "thermistor.h"
+
+// The cells, their buses and the helpers the rest of the firmware reaches them
+// through. Cells 1-8 are on Wire, 9-16 on Wire1, as is the thermistor front end.
+
+// DMM MUX
+const int DMM_MUX_PINS[] = {1, 2, 3, 4};
+const int DMM_MUX_ENABLE = 5;
+
+// How far ahead of time a commit is released, so both bus tasks are waiting
+// for it when the time comes. More than one tick of the bus tasks.
+const uint32_t COMMIT_RELEASE_LEAD_US = 2000;
+
+// I2C clocks. Every part on the buses (TCA9548A, TCA6408A, MCP4725, ADS1115)
+// is rated for 400kHz fast mode, so that is what they start at. Faster clocks
+// are past the mux and expander ratings and only worth it if I2CBENCH shows
+// the harness cabling takes them without errors.
+const uint32_t BUS_CLOCK_HZ[2] = {400000, 400000};
+const uint32_t MIN_BUS_CLOCK_HZ = 100000;
+const uint32_t MAX_BUS_CLOCK_HZ = 1000000;
+
+// Outcome of benchmarking a bus at one clock, times in microseconds
+struct BusBenchmark
+{
+    uint32_t clock_hz;
+    uint32_t transactions;
+    uint32_t nacks;
+    uint32_t errors;
+    uint32_t elapsed_us;
+};
+
+// Outcome of a commit, times in microseconds
+struct CommitResult
+{
+    uint16_t cell_mask;
+    uint32_t skew_us;         // first LDO write to the last
+    uint32_t latency_us;      // commit requested to the first LDO write
+    uint32_t offsets_us[16];  // each cell's LDO write after the first
+};
+
+// Charge and energy a cell delivered since its accumulators were reset
+struct Accumulated
+{
+    float charge_mah;
+    float energy_mwh;
+    float seconds;
+};
+
+extern I2CMux mux1;
+extern I2CMux mux2;
+extern Cell cells[];
+extern BusWorker bus1;
+extern BusWorker bus2;
+extern CalibrationStore calibrationStore;
+extern WaveformPlayer waveformPlayer;
+extern BatteryModels batteryModels;
+extern Thermistor thermistor;
+extern TemperatureRamp temperatureRamp;
+
+uint16_t initCells();
+bool initThermistor();
+bool readThermistorVoltages(float* volts);
+BusWorker& workerFor(int index);
+bool setBusClock(uint8_t bus, uint32_t clock_hz);
+uint32_t getBusClock(uint8_t bus);
+BusBenchmark benchmarkBus(uint8_t bus, uint16_t rounds);
+uint32_t measureFreshReadLatency(uint32_t timeout_us);
+void setVoltageTarget(int index, float voltage);
+void setVoltageTargets(uint16_t cell_mask, const float* voltages);
+void stageVoltageTargets(uint16_t cell_mask, const float* voltages);
+uint16_t getStagedMask();
+void clearStagedTargets();
+bool commitStagedTargets(CommitResult& result);
+const CommitResult& getLastCommit();
+void runOnCell(int index, BusWorker::JobFunction function, void* context = nullptr);
+void calibrateCells(uint16_t cell_mask);
+void saveCalibration(uint16_t cell_mask);
+float getCachedReading(int index, uint8_t input);
+Accumulated getAccumulated(int index);
+void resetAccumulators(uint16_t cell_mask);
+
+#endif // BOARD_H
@@ -0,0 +1,204 @@
+#include "bus_worker.h"
+
+// Constructor
+BusWorker::BusWorker(I2CMux& mux, Cell* cells, uint8_t num_cells) :
+    mux(mux), cells(cells), num_cells(num_cells > MAX_CELLS ? MAX_CELLS : num_cells),
+    acquisition(cells, this->num_cells), calibrator(cells, this->num_cells) {
+    calibration_job.done.store(true);
+    for (uint8_t i = 0; i < MAX_CELLS; i++) {
+        targets[i].store(0);
+        commit_voltages[i] = 0;
+        commit_times[i] = 0;
+    }
+}
+
+void BusWorker::service()
+{
+    // Jobs first so commands waiting in call() see low latency
+    Job* job;
+    while (jobs.pop(job)) {
+        job->function(cells[job->cell], job->context);
+        job->done.store(true, std::memory_order_release);
+    }
+
+    // An armed commit holds the bus so the release finds it free
+    if (serviceCommit()) return;
+
+    applyTargets();
+    if (thermistor) thermistor->service();
+    acquisition.poll();
+}
+
+bool BusWorker::call(uint8_t cell, JobFunction function, void* context)
+{
+    if (cell >= num_cells) return false;
+
+    Job job;
+    job.cell = cell;
+    job.function = function;
+    job.context = context;
+    job.done.store(false);
+
+    // The job lives on this stack frame, so wait for it to run no matter how long
+    while (!jobs.push(&job)) delay(1);
+    while (!job.done.load(std::memory_order_acquire)) delay(1);
+    return true;
+}
+
+bool BusWorker::startCalibration(uint8_t cell_mask)
+{
+    if (isCalibrating()) return false;
+
+    calibration_mask = cell_mask;
+    calibration_job.cell = 0;
+    calibration_job.function = runCalibration;
+    calibration_job.context = this;
+    calibration_job.done.store(false);
+    while (!jobs.push(&calibration_job)) delay(1);
+    return true;
+}
+
+bool BusWorker::isCalibrating() const
+{
+    return !calibration_job.done.load(std::memory_order_acquire);
+}
+
+void BusWorker::runCalibration(Cell&, void* context)
+{
+    BusWorker* worker = static_cast<BusWorker*>(context);
+    worker->calibrator.run(worker->calibration_mask);
+
+    // The sweep leaves the DACs at the last test point
+    for (uint8_t i = 0; i < worker->num_cells; i++) {
+        if (worker->calibration_mask & (1U << i)) worker->markDirty(i);
+    }
+}
+
+// voltages[i] is the target of cell i. Fails while an earlier commit has not
+// finished. An empty mask leaves the bus alone, there is nothing to arm.
+bool BusWorker::beginCommit(uint8_t cell_mask, const float* voltages)
+{
+    if (!isCommitDone()) return false;
+    if (!cell_mask) return true;
+
+    commit_mask = cell_mask;
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (cell_mask & (1U << i)) commit_voltages[i] = voltages[i];
+    }
+    commit_state.store(COMMIT_PENDING, std::memory_order_release);
+    return true;
+}
+
+bool BusWorker::isCommitArmed() const
+{
+    return commit_state.load(std::memory_order_acquire) == COMMIT_ARMED;
+}
+
+void BusWorker::releaseCommit(uint32_t at_us)
+{
+    if (commit_state.load(std::memory_order_acquire) != COMMIT_ARMED) return;
+    commit_release_at = at_us;
+    commit_state.store(COMMIT_RELEASED, std::memory_order_release);
+}
+
+bool BusWorker::isCommitDone() const
+{
+    return commit_state.load(std::memory_order_acquire) == COMMIT_IDLE;
+}
+
+uint32_t BusWorker::getCommitTime(uint8_t cell) const
+{
+    if (cell >= num_cells) return 0;
+    return commit_times[cell];
+}
+
+// Returns true when the rest of the pass has to wait
+bool BusWorker::serviceCommit()
+{
+    switch (commit_state.load(std::memory_order_acquire)) {
+        case COMMIT_PENDING:
+            for (uint8_t i = 0; i < num_cells; i++) {
+                if (commit_mask & (1U << i)) cells[i].prepareVoltage(commit_voltages[i]);
+            }
+            commit_state.store(COMMIT_ARMED, std::memory_order_release);
+            return true;
+
+        case COMMIT_ARMED:
+            return true;
+
+        case COMMIT_RELEASED:
+            // Busy wait, the caller released with enough lead for every bus to get here
+            while ((int32_t)(commit_release_at - micros()) > 0) delayMicroseconds(1);
+            for (uint8_t i = 0; i < num_cells; i++) {
+                if (!(commit_mask & (1U << i))) continue;
+                cells[i].applyVoltage(commit_voltages[i]);
+                commit_times[i] = micros();
+            }
+            // Nothing else this pass, the other bus may still be writing
+            commit_state.store(COMMIT_APPLIED, std::memory_order_release);
+            return true;
+
+        case COMMIT_APPLIED:
+            for (uint8_t i = 0; i < num_cells; i++) {
+                if (!(commit_mask & (1U << i))) continue;
+                cells[i].finishVoltage(commit_voltages[i]);
+                targets[i].store(commit_voltages[i]);
+            }
+            // The committed values are on the DACs already
+            dirty_targets.fetch_and(~(uint32_t)commit_mask, std::memory_order_acq_rel);
+            commit_state.store(COMMIT_IDLE, std::memory_order_release);
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+void BusWorker::setTarget(uint8_t cell, float voltage)
+{
+    if (cell >= num_cells) return;
+    if (targets[cell].exchange(voltage) != voltage) {
+        dirty_targets.fetch_or(1UL << cell, std::memory_order_release);
+    }
+}
+
+// voltages[i] is the target of cell i. The dirty bits are published together,
+// so the bus task applies every new target in the same pass.
+void BusWorker::setTargets(uint8_t cell_mask, const float* voltages)
+{
+    uint32_t changed = 0;
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (!(cell_mask & (1U << i))) continue;
+        if (targets[i].exchange(voltages[i]) != voltages[i]) changed |= 1UL << i;
+    }
+    if (changed) dirty_targets.fetch_or(changed, std::memory_order_release);
+}
+
+float BusWorker::getTarget(uint8_t cell) const
+{
+    if (cell >= num_cells) return 0;
+    return targets[cell].load();
+}
+
+// True while the target has not been written to the cell yet
+bool BusWorker::isTargetPending(uint8_t cell) const
+{
+    if (cell >= num_cells) return false;
+    return dirty_targets.load(std::memory_order_acquire) & (1UL << cell);
+}
+
+void BusWorker::markDirty(uint8_t cell)
+{
+    if (cell >= num_cells) return;
+    dirty_targets.fetch_or(1UL << cell, std::memory_order_release);
+}
+
+void BusWorker::applyTargets()
+{
+    uint32_t pending = dirty_targets.exchange(0, std::memory_order_acquire);
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (pending & (1UL << i)) {
+            cells[i].setVoltage(targets[i].load());
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef BUS_WORKER_H
+#define BUS_WORKER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "cell.h"
+#include "i2c_mux.h"
+#include "acquisition.h"
+#include "calibration.h"
+#include "thermistor.h"
+#include "spsc_queue.h"
+
+// Owns one I2C bus and the cells on it. Only the task running service() ever
+// touches the bus; other tasks talk to it through lock-free state:
+//   - voltage targets are atomics plus a dirty bitmap, applied on the next pass
+//   - readings come from the acquisition cache
+//   - anything else that needs the bus is posted as a job with call()
+//   - calibration runs as a job too; startCalibration() returns immediately so
+//     both buses can calibrate at the same time
+//   - a commit moves several cells at a time given in micros(), so both buses
+//     can change their outputs together (see beginCommit())
+//   - an attached thermistor front end gets its outputs written each pass
+// call() and startCalibration() may only be used from a single task at a time.
+class BusWorker
+{
+public:
+    static const uint8_t MAX_CELLS = Acquisition::MAX_CELLS;
+
+    typedef void (*JobFunction)(Cell& cell, void* context);
+
+    // Constructor
+    BusWorker(I2CMux& mux, Cell* cells, uint8_t num_cells);
+
+    // Before the bus task starts
+    void attachThermistor(Thermistor* thermistor) { this->thermistor = thermistor; }
+
+    // Runs on the bus task
+    void service();
+
+    // Safe from other tasks
+    bool call(uint8_t cell, JobFunction function, void* context = nullptr);
+    void setTarget(uint8_t cell, float voltage);
+    void setTargets(uint8_t cell_mask, const float* voltages);
+    float getTarget(uint8_t cell) const;
+    bool isTargetPending(uint8_t cell) const;
+    void markDirty(uint8_t cell);
+    Sample getSample(uint8_t cell, uint8_t input) const { return acquisition.getSample(cell, input); }
+    Totals getTotals(uint8_t cell) const { return acquisition.getTotals(cell); }
+    bool startCalibration(uint8_t cell_mask);
+    bool isCalibrating() const;
+
+    // Commits. beginCommit() raises the bucks of the cells in the mask on the
+    // next pass and then holds the bus until releaseCommit(); at the release
+    // time the LDOs are written back to back, which is what moves the outputs.
+    bool beginCommit(uint8_t cell_mask, const float* voltages);
+    bool isCommitArmed() const;
+    void releaseCommit(uint32_t at_us);
+    bool isCommitDone() const;
+    uint32_t getCommitTime(uint8_t cell) const;
+    const Calibrator& getCalibrator() const { return calibrator; }
+
+    I2CMux& getMux() { return mux; }
+    uint8_t getNumCells() const { return num_cells; }
+
+private:
+    struct Job
+    {
+        uint8_t cell;
+        JobFunction function;
+        void* context;
+        std::atomic<bool> done;
+    };
+
+    enum CommitState : uint8_t { COMMIT_IDLE, COMMIT_PENDING, COMMIT_ARMED, COMMIT_RELEASED, COMMIT_APPLIED };
+
+    bool serviceCommit();
+    void applyTargets();
+    static void runCalibration(Cell& cell, void* context);
+
+    I2CMux& mux;
+    Cell* cells;
+    const uint8_t num_cells;
+    Acquisition acquisition;
+    Calibrator calibrator;
+
+    std::atomic<float> targets[MAX_CELLS];
+    // Bit i set when targets[i] still has to be pushed to cell i
+    std::atomic<uint32_t> dirty_targets{0};
+
+    SpscQueue<Job*, 8> jobs;
+    Thermistor* thermistor = nullptr;
+
+    // Outlives startCalibration(), unlike the jobs posted by call()
+    Job calibration_job;
+    uint8_t calibration_mask = 0;
+
+    // Written by the caller only while the state is idle, or when releasing
+    std::atomic<uint8_t> commit_state{COMMIT_IDLE};
+    uint8_t commit_mask = 0;
+    float commit_voltages[MAX_CELLS];
+    uint32_t commit_release_at = 0;
+    // micros() when each cell's LDO write finished
+    uint32_t commit_times[MAX_CELLS];
+};
+
+#endif // BUS_WORKER_H
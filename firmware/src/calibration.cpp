@@ -0,0 +1,142 @@
+#include "calibration.h"
+
+// Constructor
+Calibrator::Calibrator(Cell* cells, uint8_t num_cells) :
+    cells(cells), num_cells(num_cells > MAX_CELLS ? MAX_CELLS : num_cells) {
+    memset(settle_us, 0, sizeof(settle_us));
+    memset(timeouts, 0, sizeof(timeouts));
+}
+
+void Calibrator::run(uint8_t cell_mask)
+{
+    cell_mask &= (1U << num_cells) - 1;
+    if (cell_mask == 0) return;
+    uint32_t started_at = micros();
+
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (!(cell_mask & (1U << i))) continue;
+        timeouts[i] = 0;
+        cells[i].enable();
+        cells[i].turnOnOutputRelay();
+    }
+
+    // Settling is judged on successive samples, so sample as fast as the ADC allows
+    uint16_t data_rates[MAX_CELLS];
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (!(cell_mask & (1U << i))) continue;
+        data_rates[i] = cells[i].getADCDataRate();
+        cells[i].setADCDataRate(CALIBRATION_DATA_RATE);
+    }
+
+    // Calibrate the buck, then the LDO with the buck at its maximum output
+    sweep(cell_mask, true);
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (cell_mask & (1U << i)) cells[i].writeBuckDAC(Cell::calibrationCode(true, 0));
+    }
+    sweep(cell_mask, false);
+
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (cell_mask & (1U << i)) cells[i].setADCDataRate(data_rates[i]);
+    }
+    elapsed_us = micros() - started_at;
+}
+
+uint32_t Calibrator::getSettleTime(uint8_t cell, bool buck, int point) const
+{
+    if (cell >= num_cells || point < 0 || point >= Cell::NUM_POINTS) return 0;
+    return settle_us[cell][buck ? 0 : 1][point];
+}
+
+uint32_t Calibrator::getMeanSettleTime(uint8_t cell) const
+{
+    if (cell >= num_cells) return 0;
+    uint64_t total = 0;
+    for (int i = 0; i < Cell::NUM_POINTS; i++) {
+        total += settle_us[cell][0][i] + settle_us[cell][1][i];
+    }
+    return total / (2 * Cell::NUM_POINTS);
+}
+
+uint32_t Calibrator::getMaxSettleTime(uint8_t cell) const
+{
+    if (cell >= num_cells) return 0;
+    uint32_t longest = 0;
+    for (int i = 0; i < Cell::NUM_POINTS; i++) {
+        longest = max(longest, max(settle_us[cell][0][i], settle_us[cell][1][i]));
+    }
+    return longest;
+}
+
+uint32_t Calibrator::getTimeoutCount(uint8_t cell) const
+{
+    if (cell >= num_cells) return 0;
+    return timeouts[cell];
+}
+
+void Calibrator::sweep(uint8_t cell_mask, bool buck)
+{
+    for (int point = 0; point < Cell::NUM_POINTS; point++) {
+        uint16_t code = Cell::calibrationCode(buck, point);
+        for (uint8_t i = 0; i < num_cells; i++) {
+            if (!(cell_mask & (1U << i))) continue;
+            if (buck) {
+                cells[i].writeBuckDAC(code);
+            } else {
+                cells[i].writeLDODAC(code);
+            }
+        }
+        settle(cell_mask, buck, point);
+    }
+}
+
+void Calibrator::settle(uint8_t cell_mask, bool buck, int point)
+{
+    // The LDO is calibrated against the output it drives
+    uint8_t input = buck ? Cell::ADC_BUCK_VOLTAGE : Cell::ADC_OUTPUT_VOLTAGE;
+    uint16_t code = Cell::calibrationCode(buck, point);
+    uint32_t conversion_time_us = 0;
+    for (uint8_t i = 0; i < num_cells; i++) {
+        if (cell_mask & (1U << i)) conversion_time_us = max(conversion_time_us, cells[i].getConversionTimeMicros());
+    }
+
+    float last[MAX_CELLS];
+    bool have_last[MAX_CELLS] = {false};
+    uint8_t agreeing[MAX_CELLS] = {0};
+    uint8_t pending = cell_mask;
+    uint32_t started_at = micros();
+
+    while (pending) {
+        // One conversion on every unsettled cell, all running in parallel
+        uint32_t converting_since = micros();
+        for (uint8_t i = 0; i < num_cells; i++) {
+            if (pending & (1U << i)) cells[i].startConversion(input);
+        }
+        // Reading early would return the previous result and fake a settled point
+        while (micros() - converting_since < conversion_time_us) delay(1);
+
+        uint32_t now = micros();
+        bool timed_out = now - started_at >= SETTLE_TIMEOUT_US;
+        for (uint8_t i = 0; i < num_cells; i++) {
+            if (!(pending & (1U << i))) continue;
+
+            float value;
+            if (cells[i].readConversion(input, value)) {
+                if (have_last[i] && fabsf(value - last[i]) <= SETTLE_TOLERANCE) {
+                    agreeing[i]++;
+                } else {
+                    agreeing[i] = 0;
+                }
+                last[i] = value;
+                have_last[i] = true;
+            }
+
+            if (agreeing[i] + 1 >= SETTLE_SAMPLES || timed_out) {
+                // A cell that never answered keeps its previous calibration point
+                if (have_last[i]) cells[i].setCalibrationPoint(buck, point, last[i], code);
+                if (timed_out) timeouts[i]++;
+                settle_us[i][buck ? 0 : 1][point] = now - started_at;
+                pending &= ~(1U << i);
+            }
+        }
+    }
+}
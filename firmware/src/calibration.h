@@ -0,0 +1,51 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include "cell.h"
+
+// Calibrates the cells on one I2C bus together. Every DAC step is written to
+// all selected cells first and they then settle side by side, so a bus costs
+// about as much as its slowest cell instead of the sum of all of them.
+//
+// A point is accepted as soon as SETTLE_SAMPLES successive ADC readings agree
+// within SETTLE_TOLERANCE, rather than after a fixed delay. The time each
+// point took is kept so the host can see how the board behaves.
+//
+// run() must only be called on the task that owns the bus.
+class Calibrator
+{
+public:
+    static const uint8_t MAX_CELLS = 8;
+
+    // Constructor
+    Calibrator(Cell* cells, uint8_t num_cells);
+
+    // Public methods
+    void run(uint8_t cell_mask);
+    uint32_t getSettleTime(uint8_t cell, bool buck, int point) const;
+    uint32_t getMeanSettleTime(uint8_t cell) const;
+    uint32_t getMaxSettleTime(uint8_t cell) const;
+    uint32_t getTimeoutCount(uint8_t cell) const;
+    uint32_t getElapsedTime() const { return elapsed_us; }
+
+private:
+    void sweep(uint8_t cell_mask, bool buck);
+    void settle(uint8_t cell_mask, bool buck, int point);
+
+    // Settling criteria, at the fast data rate used while calibrating
+    const float SETTLE_TOLERANCE = 0.002;       // volts between successive samples
+    const uint8_t SETTLE_SAMPLES = 3;
+    const uint32_t SETTLE_TIMEOUT_US = 250000;  // accept the last sample after this
+    const uint16_t CALIBRATION_DATA_RATE = RATE_ADS1115_860SPS;
+
+    Cell* cells;
+    const uint8_t num_cells;
+
+    // Microseconds from the DAC write until each point was accepted
+    uint32_t settle_us[MAX_CELLS][2][Cell::NUM_POINTS];
+    uint32_t timeouts[MAX_CELLS];
+    uint32_t elapsed_us = 0;
+};
+
+#endif // CALIBRATION_H
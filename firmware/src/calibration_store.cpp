@@ -0,0 +1,135 @@
+#include "calibration_store.h"
+#include <esp_rom_crc.h>
+
+bool CalibrationStore::begin()
+{
+    opened = preferences.begin("cellcal", false);
+    return opened;
+}
+
+bool CalibrationStore::load(uint8_t index, CalibrationTable& table)
+{
+    if (!opened) return false;
+
+    char key[8];
+    makeKey(index, key);
+    Record record;
+    if (preferences.getBytesLength(key) != sizeof(record)) return false;
+    if (preferences.getBytes(key, &record, sizeof(record)) != sizeof(record)) return false;
+
+    if (record.magic != MAGIC || record.version != VERSION) return false;
+    if (record.index != index || record.serial != ESP.getEfuseMac()) return false;
+    if (record.crc != recordCrc(record)) return false;
+    if (!isValid(record.table)) return false;
+
+    table = record.table;
+    return true;
+}
+
+bool CalibrationStore::save(uint8_t index, const CalibrationTable& table)
+{
+    if (!opened) return false;
+
+    // Zero the padding too so the CRC only depends on the contents
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.magic = MAGIC;
+    record.version = VERSION;
+    record.index = index;
+    record.serial = ESP.getEfuseMac();
+    record.table = table;
+    record.crc = recordCrc(record);
+
+    char key[8];
+    makeKey(index, key);
+    return preferences.putBytes(key, &record, sizeof(record)) == sizeof(record);
+}
+
+void CalibrationStore::clear()
+{
+    if (opened) preferences.clear();
+}
+
+void CalibrationStore::readTable(Cell& cell, CalibrationTable& table)
+{
+    for (int i = 0; i < Cell::NUM_POINTS; i++) {
+        cell.getCalibrationPoint(true, i, table.buck_voltage[i], table.buck_code[i]);
+        cell.getCalibrationPoint(false, i, table.ldo_voltage[i], table.ldo_code[i]);
+    }
+}
+
+void CalibrationStore::applyTable(Cell& cell, const CalibrationTable& table)
+{
+    for (int i = 0; i < Cell::NUM_POINTS; i++) {
+        cell.setCalibrationPoint(true, i, table.buck_voltage[i], table.buck_code[i]);
+        cell.setCalibrationPoint(false, i, table.ldo_voltage[i], table.ldo_code[i]);
+    }
+}
+
+bool CalibrationStore::isValid(const CalibrationTable& table)
+{
+    // Codes must rise and voltages fall (within noise), the way calibration sweeps them
+    const float NOISE = 0.005;
+    const float MIN_SPAN = 1.0; // an absent or dead cell reads flat
+
+    for (int pass = 0; pass < 2; pass++) {
+        const float* voltage = pass == 0 ? table.buck_voltage : table.ldo_voltage;
+        const uint16_t* code = pass == 0 ? table.buck_code : table.ldo_code;
+        for (int i = 0; i < Cell::NUM_POINTS; i++) {
+            if (!isfinite(voltage[i]) || voltage[i] < 0 || voltage[i] > 6.0) return false;
+            if (code[i] > 4095) return false;
+            if (i == 0) continue;
+            if (code[i] <= code[i - 1]) return false;
+            if (voltage[i] > voltage[i - 1] + NOISE) return false;
+        }
+        if (voltage[0] - voltage[Cell::NUM_POINTS - 1] < MIN_SPAN) return false;
+    }
+    return true;
+}
+
+void CalibrationStore::printTable(Print& out, const CalibrationTable& table)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        const float* voltage = pass == 0 ? table.buck_voltage : table.ldo_voltage;
+        const uint16_t* code = pass == 0 ? table.buck_code : table.ldo_code;
+        if (pass > 0) out.print(";");
+        for (int i = 0; i < Cell::NUM_POINTS; i++) {
+            if (i > 0) out.print(",");
+            out.print(voltage[i], 4);
+            out.print("/");
+            out.print(code[i]);
+        }
+    }
+}
+
+bool CalibrationStore::parseTable(const String& text, CalibrationTable& table)
+{
+    const char* p = text.c_str();
+    for (int pass = 0; pass < 2; pass++) {
+        float* voltage = pass == 0 ? table.buck_voltage : table.ldo_voltage;
+        uint16_t* code = pass == 0 ? table.buck_code : table.ldo_code;
+        if (pass > 0 && *p++ != ';') return false;
+        for (int i = 0; i < Cell::NUM_POINTS; i++) {
+            if (i > 0 && *p++ != ',') return false;
+            char* end;
+            voltage[i] = strtof(p, &end);
+            if (end == p || *end != '/') return false;
+            p = end + 1;
+            long value = strtol(p, &end, 10);
+            if (end == p || value < 0 || value > 4095) return false;
+            code[i] = value;
+            p = end;
+        }
+    }
+    return *p == '\0';
+}
+
+void CalibrationStore::makeKey(uint8_t index, char* key)
+{
+    snprintf(key, 8, "cell%u", (unsigned)index);
+}
+
+uint32_t CalibrationStore::recordCrc(const Record& record)
+{
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&record), offsetof(Record, crc));
+}
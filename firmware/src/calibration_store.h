@@ -0,0 +1,62 @@
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "cell.h"
+
+// One cell's calibration, {measured voltage, DAC code} per point
+struct CalibrationTable
+{
+    float buck_voltage[Cell::NUM_POINTS];
+    uint16_t buck_code[Cell::NUM_POINTS];
+    float ldo_voltage[Cell::NUM_POINTS];
+    uint16_t ldo_code[Cell::NUM_POINTS];
+};
+
+// Keeps calibration tables in NVS, one blob per cell. A blob is only loaded
+// back if its format version, the board serial (eFuse MAC) and its CRC all
+// match and the table itself looks sane, so a stale or foreign table makes
+// that one cell recalibrate instead of driving the wrong voltages.
+//
+// Tables travel to and from the host as text:
+//   <v>/<code>,... (buck points) ; <v>/<code>,... (LDO points)
+class CalibrationStore
+{
+public:
+    static const uint16_t VERSION = 1;
+
+    // Public methods
+    bool begin();
+    bool load(uint8_t index, CalibrationTable& table);
+    bool save(uint8_t index, const CalibrationTable& table);
+    void clear();
+
+    // Table helpers
+    static void readTable(Cell& cell, CalibrationTable& table);
+    static void applyTable(Cell& cell, const CalibrationTable& table);
+    static bool isValid(const CalibrationTable& table);
+    static void printTable(Print& out, const CalibrationTable& table);
+    static bool parseTable(const String& text, CalibrationTable& table);
+
+private:
+    struct Record
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t index;
+        uint64_t serial;
+        CalibrationTable table;
+        uint32_t crc; // CRC-32 of everything above
+    };
+
+    static const uint32_t MAGIC = 0x4C414343; // "CCAL"
+
+    static void makeKey(uint8_t index, char* key);
+    static uint32_t recordCrc(const Record& record);
+
+    Preferences preferences;
+    bool opened = false;
+};
+
+#endif // CALIBRATION_STORE_H
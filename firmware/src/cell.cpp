@@ -1,8 +1,8 @@
-#include "Cell.h"
+#include "cell.h"
 
 // Constructor
-Cell::Cell(uint8_t mux_channel, TwoWire& wire_interface) :
-    mux_channel(mux_channel), wire(wire_interface) {
+Cell::Cell(uint8_t mux_channel, I2CMux& mux) :
+    mux_channel(mux_channel), mux(mux), wire(mux.getWire()) {
     // ...
 }
 
@@ -15,6 +15,7 @@ void Cell::init()
     // Initialize DACs
     ldo_dac.begin(LDO_ADDRESS, &wire);
     buck_dac.begin(BUCK_ADDRESS, &wire);
+    invalidateDACCache();
 
     // Initialize ADC
     adc.begin(ADC_ADDRESS, &wire);
@@ -50,29 +51,33 @@ void Cell::enable()
 
 float Cell::getVoltage()
 {
-    setMuxChannel();
-    int16_t adc_value = adc.readADC_SingleEnded(adc_output_voltage);
-    float volts = adc.computeVolts(adc_value);
-    return volts;
+    return readADCVolts(ADC_OUTPUT_VOLTAGE);
 }
 
 void Cell::setVoltage(float voltage)
 {
-    // Set the mux channel
-    setMuxChannel();
+    // Set the output voltage
+    setBuckVoltage(buckVoltageFor(voltage));
+    setLDOVoltage(ldoVoltageFor(voltage));
+}
 
-    float buck_voltage = voltage * 1.05;
-    float ldo_voltage = voltage;
+void Cell::prepareVoltage(float voltage)
+{
+    // Raise the buck ahead of time so the LDO has its headroom when it moves
+    float buck_voltage = buckVoltageFor(voltage);
+    if (buck_voltage > buck_voltage_set) setBuckVoltage(buck_voltage);
+}
 
-    // Buck voltage limits
-    if (buck_voltage < MIN_BUCK_VOLTAGE) buck_voltage = MIN_BUCK_VOLTAGE;
-    if (buck_voltage > MAX_BUCK_VOLTAGE) buck_voltage = MAX_BUCK_VOLTAGE;
-    if (ldo_voltage < MIN_LDO_VOLTAGE) ldo_voltage = MIN_LDO_VOLTAGE;
-    if (ldo_voltage > MAX_LDO_VOLTAGE) ldo_voltage = MAX_LDO_VOLTAGE;
+void Cell::applyVoltage(float voltage)
+{
+    // The LDO sets the output, so this is the one write that moves it
+    setLDOVoltage(ldoVoltageFor(voltage));
+}
 
-    // Set the output voltage
-    setBuckVoltage(buck_voltage);
-    setLDOVoltage(ldo_voltage);
+void Cell::finishVoltage(float voltage)
+{
+    // Lower the buck only once the output no longer needs the headroom
+    setBuckVoltage(buckVoltageFor(voltage));
 }
 
 void Cell::turnOnOutputRelay()
@@ -113,37 +118,62 @@ float Cell::getCurrent()
 
 float Cell::getLDOVoltage()
 {
-    setMuxChannel();
-    int16_t adc_value = adc.readADC_SingleEnded(adc_ldo_voltage);
-    float volts = adc.computeVolts(adc_value);
-    return volts;
+    return readADCVolts(ADC_LDO_VOLTAGE);
 }
 
 float Cell::getBuckVoltage()
 {
-    setMuxChannel();
-    int16_t adc_value = adc.readADC_SingleEnded(adc_buck_voltage);
-    float volts = adc.computeVolts(adc_value);
-    return volts;
+    return readADCVolts(ADC_BUCK_VOLTAGE);
 }
 
 void Cell::setBuckVoltage(float voltage)
 {
-    setMuxChannel();
     uint16_t setpoint = calculateSetpoint(voltage, true);
-
-
-    buck_dac.setVoltage(setpoint, false);
+    writeBuckDAC(setpoint);
+    buck_voltage_set = voltage;
 }
 
 void Cell::setLDOVoltage(float voltage)
 {
-    setMuxChannel();
     uint16_t setpoint = calculateSetpoint(voltage, false);
-    ldo_dac.setVoltage(setpoint, false);
+    writeLDODAC(setpoint);
+}
+
+void Cell::invalidateDACCache()
+{
+    // Forces the next setpoint to be written even if the code is unchanged
+    buck_dac_code = DAC_CODE_UNKNOWN;
+    ldo_dac_code = DAC_CODE_UNKNOWN;
 }
 // Implementation of helper methods
 
+void Cell::writeBuckDAC(uint16_t code)
+{
+    // A raw code has no known voltage until setBuckVoltage() records one
+    buck_voltage_set = 0;
+    if (code == buck_dac_code) return;
+    setMuxChannel();
+    // Only remember the code once the DAC has actually accepted it
+    buck_dac_code = writeDACFast(BUCK_ADDRESS, code) ? code : DAC_CODE_UNKNOWN;
+}
+
+void Cell::writeLDODAC(uint16_t code)
+{
+    if (code == ldo_dac_code) return;
+    setMuxChannel();
+    ldo_dac_code = writeDACFast(LDO_ADDRESS, code) ? code : DAC_CODE_UNKNOWN;
+}
+
+bool Cell::writeDACFast(uint8_t address, uint16_t code)
+{
+    // MCP4725 fast mode write: two bytes instead of the library's three, and
+    // the library would also put the bus back to 100kHz after every write
+    wire.beginTransmission(address);
+    wire.write((uint8_t)((code >> 8) & 0x0F));
+    wire.write((uint8_t)(code & 0xFF));
+    return wire.endTransmission() == 0;
+}
+
 void Cell::setGPIOState()
 {
     setMuxChannel();
@@ -154,83 +184,166 @@ void Cell::setGPIOState()
     wire.endTransmission();
 }
 
+float Cell::buckVoltageFor(float voltage)
+{
+    // The buck runs 5% above the output to leave the LDO its dropout
+    float buck_voltage = voltage * 1.05;
+    if (buck_voltage < MIN_BUCK_VOLTAGE) buck_voltage = MIN_BUCK_VOLTAGE;
+    if (buck_voltage > MAX_BUCK_VOLTAGE) buck_voltage = MAX_BUCK_VOLTAGE;
+    return buck_voltage;
+}
+
+float Cell::ldoVoltageFor(float voltage)
+{
+    if (voltage < MIN_LDO_VOLTAGE) return MIN_LDO_VOLTAGE;
+    if (voltage > MAX_LDO_VOLTAGE) return MAX_LDO_VOLTAGE;
+    return voltage;
+}
+
 float Cell::readShuntCurrent()
 {
+    return voltsToCurrent(readADCVolts(ADC_OUTPUT_CURRENT));
+}
+
+float Cell::voltsToCurrent(float volts)
+{
+    return volts / SHUNT_RESISTOR_OHMS / SHUNT_GAIN;
+}
+
+float Cell::readADCVolts(uint8_t input)
+{
+    setMuxChannel();
+    // A blocking read reconfigures the ADC, so any non-blocking conversion is lost
+    pending_conversion = NO_CONVERSION;
+    int16_t adc_value = adc.readADC_SingleEnded(input);
+    return adc.computeVolts(adc_value);
+}
+
+bool Cell::startConversion(uint8_t input)
+{
+    if (input >= NUM_ADC_INPUTS) return false;
     setMuxChannel();
-    int16_t adc_value = adc.readADC_SingleEnded(adc_output_current);
+
+    // Single-shot conversion with the comparator (and ALERT/RDY) disabled; the
+    // caller collects the result once getConversionTimeMicros() has elapsed
+    uint16_t config = ADS1X15_REG_CONFIG_CQUE_NONE |
+                      ADS1X15_REG_CONFIG_CLAT_NONLAT |
+                      ADS1X15_REG_CONFIG_CPOL_ACTVLOW |
+                      ADS1X15_REG_CONFIG_CMODE_TRAD |
+                      ADS1X15_REG_CONFIG_MODE_SINGLE |
+                      ADS1X15_REG_CONFIG_OS_SINGLE;
+    config |= adc.getGain();
+    config |= adc.getDataRate();
+    config |= MUX_BY_CHANNEL[input];
+
+    wire.beginTransmission(ADC_ADDRESS);
+    wire.write(ADS1X15_REG_POINTER_CONFIG);
+    wire.write((uint8_t)(config >> 8));
+    wire.write((uint8_t)(config & 0xFF));
+    if (wire.endTransmission() != 0) {
+        pending_conversion = NO_CONVERSION;
+        return false;
+    }
+    pending_conversion = input;
+    return true;
+}
+
+bool Cell::readConversion(uint8_t input, float& value)
+{
+    // Someone else used the ADC since the conversion was started
+    if (pending_conversion != input) return false;
+    pending_conversion = NO_CONVERSION;
+    setMuxChannel();
+
+    wire.beginTransmission(ADC_ADDRESS);
+    wire.write(ADS1X15_REG_POINTER_CONVERT);
+    if (wire.endTransmission() != 0) return false;
+    if (wire.requestFrom(ADC_ADDRESS, (size_t)2) != 2) return false;
+    uint8_t msb = wire.read();
+    uint8_t lsb = wire.read();
+    int16_t adc_value = (int16_t)((msb << 8) | lsb);
+
     float volts = adc.computeVolts(adc_value);
+    value = (input == ADC_OUTPUT_CURRENT) ? voltsToCurrent(volts) : volts;
+    return true;
+}
 
-    return volts / SHUNT_RESISTOR_OHMS / SHUNT_GAIN;
+uint32_t Cell::getConversionTimeMicros()
+{
+    // Nominal conversion period for the configured data rate
+    uint32_t sps;
+    switch (adc.getDataRate()) {
+        case RATE_ADS1115_8SPS: sps = 8; break;
+        case RATE_ADS1115_16SPS: sps = 16; break;
+        case RATE_ADS1115_32SPS: sps = 32; break;
+        case RATE_ADS1115_64SPS: sps = 64; break;
+        case RATE_ADS1115_250SPS: sps = 250; break;
+        case RATE_ADS1115_475SPS: sps = 475; break;
+        case RATE_ADS1115_860SPS: sps = 860; break;
+        default: sps = 128; break;
+    }
+    // The internal oscillator is only good to 10%, plus wake-up from power-down
+    return 1000000UL / sps * 11 / 10 + 50;
+}
+
+bool Cell::usesAddress(uint8_t address)
+{
+    return address == LDO_ADDRESS || address == BUCK_ADDRESS || address == ADC_ADDRESS || address == GPIO_ADDRESS;
 }
 
 void Cell::setMuxChannel()
 {
-    wire.beginTransmission(MUX_ADDRESS);
-    wire.write(1 << mux_channel);
-    wire.endTransmission();
+    // The mux skips the write if this channel is already selected
+    mux.select(mux_channel);
 }
 
-void Cell::calibrate()
+uint16_t Cell::calibrationCode(bool buck, int point)
 {
-    // Calibrate the buck between 234 and 2625
-    float delta = 2625 - 234;
-    int step = round(delta / NUM_POINTS);
-    for (int i = 0; i < NUM_POINTS; i++) {
-        enable();
-        turnOnOutputRelay();
-        float setpoint = 234 + i * step;
-        buck_dac.setVoltage(setpoint, false);
-        delay(100);
-        float voltage = getBuckVoltage();
-        BUCK_SETPOINTS[i] = {voltage, setpoint};
-    }
+    // Same spacing the calibration tables have always used
+    float first = buck ? BUCK_CAL_FIRST_CODE : LDO_CAL_FIRST_CODE;
+    float last = buck ? BUCK_CAL_LAST_CODE : LDO_CAL_LAST_CODE;
+    int step = round((last - first) / NUM_POINTS);
+    return first + point * step;
+}
+
+void Cell::setCalibrationPoint(bool buck, int point, float voltage, uint16_t code)
+{
+    if (point < 0 || point >= NUM_POINTS) return;
+    std::pair<float, float>* calibration_points = buck ? BUCK_SETPOINTS : LDO_SETPOINTS;
+    calibration_points[point] = {voltage, code};
+    setpoint_tables_stale = true;
+}
+
+void Cell::getCalibrationPoint(bool buck, int point, float& voltage, uint16_t& code)
+{
+    if (point < 0 || point >= NUM_POINTS) return;
+    const std::pair<float, float>* calibration_points = buck ? BUCK_SETPOINTS : LDO_SETPOINTS;
+    voltage = calibration_points[point].first;
+    code = calibration_points[point].second;
+}
 
-    // Set buck output to max
-    buck_dac.setVoltage(234, false);
-    delay(50);
-    // Calibrate the ldo between 42 and 3760    
-    delta = 3760 - 42;
-    step = round(delta / NUM_POINTS);
-    for (int i = 0; i < NUM_POINTS; i++) {
-        enable();
-        turnOnOutputRelay();
-        float setpoint = 42 + i * step;
-        ldo_dac.setVoltage(setpoint, false);
-        delay(100);
-        float voltage = getVoltage();
-        LDO_SETPOINTS[i] = {voltage, setpoint};
+const SetpointTable& Cell::getSetpointTable(bool buck)
+{
+    if (setpoint_tables_stale) {
+        buck_table.compile(BUCK_SETPOINTS, NUM_POINTS);
+        ldo_table.compile(LDO_SETPOINTS, NUM_POINTS);
+        setpoint_tables_stale = false;
     }
+    return buck ? buck_table : ldo_table;
+}
+
+uint16_t Cell::getADCDataRate()
+{
+    return adc.getDataRate();
+}
+
+void Cell::setADCDataRate(uint16_t rate)
+{
+    adc.setDataRate(rate);
 }
 
 uint16_t Cell::calculateSetpoint(float voltage, bool useBuckCalibration)
 {
-    // Use the appropriate calibration array; each element is {measured voltage, DAC setpoint}
-    const std::pair<float, float>* calibration_points = useBuckCalibration ? BUCK_SETPOINTS : LDO_SETPOINTS;
-    const int numPoints = NUM_POINTS;
-    // For descending data: clamp if voltage is above the maximum or below the minimum.
-    if (voltage >= calibration_points[0].first) {
-        return calibration_points[0].second;
-    }
-    if (voltage <= calibration_points[numPoints - 1].first) {
-        return calibration_points[numPoints - 1].second;
-    }
-    // Find the first index where the measured voltage becomes less than or equal to the target.
-    int index = 1;
-    while (index < numPoints && calibration_points[index].first > voltage) {
-        index++;
-    }
-    int above_index = index - 1;
-    int below_index = index;
-    if (above_index == below_index) {
-        return calibration_points[above_index].second;
-    }
-    // Linear interpolation:
-    // DAC setpoint = s1 + (voltage - v1) * (s2 - s1) / (v2 - v1)
-    float v1 = calibration_points[above_index].first;
-    float v2 = calibration_points[below_index].first;
-    float s1 = calibration_points[above_index].second;
-    float s2 = calibration_points[below_index].second;
-    float m = (s2 - s1) / (v2 - v1);
-    float b = s1 - m * v1;
-    return static_cast<uint16_t>(m * voltage + b);
+    // The compiled table replaces the scan over the calibration points
+    return getSetpointTable(useBuckCalibration).lookup(voltage);
 }
\ No newline at end of file
@@ -6,12 +6,23 @@
 #include <SPI.h>
 #include <Adafruit_MCP4725.h> // DAC
 #include <Adafruit_ADS1X15.h> // ADC
+#include "i2c_mux.h"
+#include "setpoint_table.h"
 
 class Cell
 {
 public:
+    // ADS1115 inputs
+    enum AdcInput : uint8_t {
+        ADC_BUCK_VOLTAGE = 0,
+        ADC_LDO_VOLTAGE = 1,
+        ADC_OUTPUT_CURRENT = 2,
+        ADC_OUTPUT_VOLTAGE = 3,
+        NUM_ADC_INPUTS = 4
+    };
+
     // Constructor
-    Cell(uint8_t mux_channel, TwoWire& wire_interface);
+    Cell(uint8_t mux_channel, I2CMux& mux);
 
     // Public methods
     void init();
@@ -20,6 +31,10 @@ public:
     float getVoltage();
     float getCurrent();
     void setVoltage(float voltage);
+    // setVoltage() in three steps, for changing many cells at the same instant
+    void prepareVoltage(float voltage);
+    void applyVoltage(float voltage);
+    void finishVoltage(float voltage);
     void turnOnOutputRelay();
     void turnOffOutputRelay();
     void turnOnLoadSwitch();
@@ -28,17 +43,29 @@ public:
     void setLDOVoltage(float voltage);
     float getBuckVoltage();
     void setBuckVoltage(float voltage);
-    void calibrate();
+    void invalidateDACCache();
+
+    // Raw access used by the calibrator
+    static const int NUM_POINTS = 32;
+    static uint16_t calibrationCode(bool buck, int point);
+    void writeBuckDAC(uint16_t code);
+    void writeLDODAC(uint16_t code);
+    void setCalibrationPoint(bool buck, int point, float voltage, uint16_t code);
+    void getCalibrationPoint(bool buck, int point, float& voltage, uint16_t& code);
+    const SetpointTable& getSetpointTable(bool buck);
+    uint16_t getADCDataRate();
+    void setADCDataRate(uint16_t rate);
+
+    // Non-blocking ADC access, used by the acquisition engine
+    bool startConversion(uint8_t input);
+    bool readConversion(uint8_t input, float& value);
+    uint32_t getConversionTimeMicros();
+    // True if a cell's own devices answer at the address behind its mux channel
+    static bool usesAddress(uint8_t address);
     uint8_t GPIO_STATE = 0b00000000;
 
 private:
     // Pins
-    // ADC
-    const int adc_buck_voltage = 0;
-    const int adc_ldo_voltage = 1;
-    const int adc_output_current = 2;
-    const int adc_output_voltage = 3;
-
     // GPIO Expander
     const int gpio_buck_enable = 2;
     const int gpio_ldo_enable = 3;
@@ -46,15 +73,15 @@ private:
     const int gpio_output_relay_control = 5;
 
     // Hardcoded I2C addresses
-    const uint8_t LDO_ADDRESS = 0x60;
-    const uint8_t BUCK_ADDRESS = 0x61;
-    const uint8_t ADC_ADDRESS = 0x48;
-    const uint8_t GPIO_ADDRESS = 0x20;
-    const uint8_t MUX_ADDRESS = 0x70;
-    const uint8_t TCA6408_ADDR = 0x20;
+    static const uint8_t LDO_ADDRESS = 0x60;
+    static const uint8_t BUCK_ADDRESS = 0x61;
+    static const uint8_t ADC_ADDRESS = 0x48;
+    static const uint8_t GPIO_ADDRESS = 0x20;
+    static const uint8_t TCA6408_ADDR = 0x20;
 
     // Mux channel
     const uint8_t mux_channel;
+    I2CMux& mux;
     TwoWire& wire;
 
     // Device instances
@@ -62,13 +89,31 @@ private:
     Adafruit_MCP4725 buck_dac;
     Adafruit_ADS1115 adc;
 
+    // Last DAC codes committed to the buck and LDO, DAC_CODE_UNKNOWN until written
+    static const uint16_t DAC_CODE_UNKNOWN = 0xFFFF;
+    uint16_t buck_dac_code = DAC_CODE_UNKNOWN;
+    uint16_t ldo_dac_code = DAC_CODE_UNKNOWN;
+
+    // Input of the conversion started by startConversion, NO_CONVERSION if none
+    // is pending or a blocking read has since reconfigured the ADC
+    static const uint8_t NO_CONVERSION = 0xFF;
+    uint8_t pending_conversion = NO_CONVERSION;
+
+    // Buck voltage last set, 0 after a raw DAC write
+    float buck_voltage_set = 0;
+
     // Private methods
     uint16_t calculateSetpoint(float voltage, bool useBuckCalibration = true);
+    float buckVoltageFor(float voltage);
+    float ldoVoltageFor(float voltage);
 
     // Helper methods for I2C communication
     void setMuxChannel();
     void setGPIOState();
+    bool writeDACFast(uint8_t address, uint16_t code);
     float readShuntCurrent();
+    float readADCVolts(uint8_t input);
+    float voltsToCurrent(float volts);
 
     // Shunt resistor
     const float SHUNT_RESISTOR_OHMS = 0.11128; // With 50V/V gain: 0.523V / 50 / 0.094A = 0.11128 ohms
@@ -80,8 +125,13 @@ private:
     const float MIN_LDO_VOLTAGE = 0.35;
     const float MAX_LDO_VOLTAGE = 4.5;
 
+    // DAC code ranges swept by calibration
+    static const uint16_t BUCK_CAL_FIRST_CODE = 234;
+    static const uint16_t BUCK_CAL_LAST_CODE = 2625;
+    static const uint16_t LDO_CAL_FIRST_CODE = 42;
+    static const uint16_t LDO_CAL_LAST_CODE = 3760;
+
     // Calibration points
-    static const int NUM_POINTS = 32;
     // Each pair is defined as {measured voltage, DAC setpoint}
     std::pair<float, float> BUCK_SETPOINTS[NUM_POINTS] = {
         {4.5971, 234}, {1.5041, 2625}
@@ -89,6 +139,11 @@ private:
     std::pair<float, float> LDO_SETPOINTS[NUM_POINTS] = {
         {4.5176, 42}, {0.3334, 3760}
     };
+
+    // Setpoint lookup compiled from the points above, rebuilt after they change
+    SetpointTable buck_table;
+    SetpointTable ldo_table;
+    bool setpoint_tables_stale = true;
 };
 
 #endif // CELL_H
@@ -0,0 +1,1304 @@
+#include "commands.h"
+#include <arpa/inet.h>
+
+// Host protocol state, switched to binary framing by the BINARY command
+bool binaryMode = false;
+BinaryProtocol::Decoder binaryDecoder;
+
+TelemetryStream telemetryStream;
+TelemetryStream udpTelemetryStream;
+NetworkServer networkServer;
+
+// False while handling a line that came in over the network
+static bool commandFromUSB = true;
+
+// Parses a cell mask (bit i = cell i + 1), decimal or 0x-prefixed hex
+bool parseCellMask(const String& text, uint16_t& mask)
+{
+    char* end;
+    long value = strtol(text.c_str(), &end, 0);
+    if (end == text.c_str() || *end != '\0' || value <= 0 || value > 0xFFFF) return false;
+    mask = value;
+    return true;
+}
+
+// Parses one comma separated voltage per cell in the mask into voltages[cell],
+// false unless the counts match
+bool parseVoltageVector(const String& list, uint16_t mask, float* voltages)
+{
+    unsigned int from = 0;
+    for (int i = 0; i < 16; i++) {
+        if (!(mask & (1U << i))) continue;
+        if (from > list.length()) return false;
+        int comma = list.indexOf(',', from);
+        unsigned int to = comma == -1 ? list.length() : comma;
+        if (to == from) return false;
+        voltages[i] = list.substring(from, to).toFloat();
+        from = to + 1;
+    }
+    return from > list.length();
+}
+
+// Parses up to max_values comma separated numbers, -1 if there are more
+int parseFloatList(const String& list, float* values, int max_values)
+{
+    int count = 0;
+    unsigned int from = 0;
+    while (from <= list.length()) {
+        if (count == max_values) return -1;
+        int comma = list.indexOf(',', from);
+        unsigned int to = comma == -1 ? list.length() : comma;
+        values[count++] = list.substring(from, to).toFloat();
+        from = to + 1;
+    }
+    return count;
+}
+
+// Parses up to max_points comma separated <ms>:<volts> pairs, returns how many
+// or -1 if any is malformed
+int parseWavePoints(const String& list, uint32_t* times_us, float* voltages, int max_points)
+{
+    int count = 0;
+    unsigned int from = 0;
+    while (from <= list.length()) {
+        int comma = list.indexOf(',', from);
+        unsigned int to = comma == -1 ? list.length() : comma;
+        String point = list.substring(from, to);
+        int colon = point.indexOf(':');
+        if (colon <= 0 || colon == (int)point.length() - 1 || count == max_points) return -1;
+        float ms = point.substring(0, colon).toFloat();
+        if (ms < 0) return -1;
+        times_us[count] = (uint32_t)(ms * 1000 + 0.5f);
+        voltages[count] = point.substring(colon + 1).toFloat();
+        count++;
+        from = to + 1;
+    }
+    return count;
+}
+
+void handleCommand(String cmd, Print& out) {
+    cmd.trim();
+    if (cmd.length() == 0) return;
+
+    int firstSpace = cmd.indexOf(' ');
+    String command = cmd;
+    String args = "";
+    if (firstSpace != -1) {
+        command = cmd.substring(0, firstSpace);
+        args = cmd.substring(firstSpace + 1);
+    }
+    command.toUpperCase();
+
+    if (command == "SETV") {
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:SETV requires two arguments");
+            return;
+        }
+        String cellStr = args.substring(0, spaceIndex);
+        String voltageStr = args.substring(spaceIndex + 1);
+        int cellNumber = cellStr.toInt();
+        float voltageValue = voltageStr.toFloat();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        setVoltageTarget(cellNumber - 1, voltageValue);
+        out.print("OK:voltage_set:");
+        out.println(voltageValue);
+    } else if (command == "GETV") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        float volt = getCachedReading(cellNumber - 1, Cell::ADC_OUTPUT_VOLTAGE);
+        out.print("OK:voltage:");
+        out.println(volt, 5);
+    } else if (command == "ENABLE_OUTPUT") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        runOnCell(cellNumber - 1, [](Cell& cell, void*) { cell.turnOnOutputRelay(); });
+        out.print("OK:output_enabled:");
+        out.println(cellNumber);
+    } else if (command == "ENABLE_DMM") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        int channel = cellNumber - 1;
+        for (int i = 0; i < 4; i++) {
+            int bitVal = (channel >> i) & 0x01;
+            digitalWrite(DMM_MUX_PINS[i], bitVal ? HIGH : LOW);
+        }
+        digitalWrite(DMM_MUX_ENABLE, LOW);
+        out.print("OK:dmm_enabled:");
+        out.println(cellNumber);
+    } else if (command == "DISABLE_DMM") {
+        digitalWrite(DMM_MUX_ENABLE, HIGH);
+        out.println("OK:dmm_disabled");
+    } else if (command == "GETALLV") {
+        out.print("OK:voltages:");
+        for (int i = 0; i < 16; i++) {
+            if (i > 0) out.print(",");
+            out.print(getCachedReading(i, Cell::ADC_OUTPUT_VOLTAGE), 2);
+        }
+        out.println();
+    } else if (command == "GETALLI") {
+        out.print("OK:currents:");
+        for (int i = 0; i < 16; i++) {
+            if (i > 0) out.print(",");
+            out.print(getCachedReading(i, Cell::ADC_OUTPUT_CURRENT), 2);
+        }
+        out.println();
+    } else if (command == "SETALLV") {
+        if (args.length() == 0) {
+            out.println("Error:SETALLV requires one argument");
+            return;
+        }
+        float voltage = args.toFloat();
+        for (int i = 0; i < 16; i++) {
+            setVoltageTarget(i, voltage);
+        }
+        out.print("OK:all_voltages_set:");
+        out.println(voltage);
+    } else if (command == "SETVEC") {
+        // SETVEC <mask> <v>,<v>,... with a voltage for each cell in the mask,
+        // lowest cell first. All of them take effect in the same bus pass.
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:SETVEC requires two arguments");
+            return;
+        }
+        uint16_t mask;
+        if (!parseCellMask(args.substring(0, spaceIndex), mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        float voltages[16] = {0};
+        if (!parseVoltageVector(args.substring(spaceIndex + 1), mask, voltages)) {
+            out.println("Error:SETVEC needs one voltage per cell in the mask");
+            return;
+        }
+        setVoltageTargets(mask, voltages);
+        out.print("OK:vector_set:");
+        out.println(__builtin_popcount(mask));
+    } else if (command == "GETVEC") {
+        // GETVEC <mask> [fields] where fields picks from V (output voltage),
+        // I (current), B (buck) and L (LDO), V if left out. Replies with the
+        // fields in the order asked for, for each cell in the mask.
+        int spaceIndex = args.indexOf(' ');
+        String fields = spaceIndex == -1 ? String("V") : args.substring(spaceIndex + 1);
+        uint16_t mask;
+        if (!parseCellMask(spaceIndex == -1 ? args : args.substring(0, spaceIndex), mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        fields.toUpperCase();
+        uint8_t inputs[4];
+        unsigned int num_fields = fields.length();
+        if (num_fields == 0 || num_fields > 4) {
+            out.println("Error:GETVEC takes one to four fields");
+            return;
+        }
+        for (unsigned int f = 0; f < num_fields; f++) {
+            switch (fields[f]) {
+                case 'V': inputs[f] = Cell::ADC_OUTPUT_VOLTAGE; break;
+                case 'I': inputs[f] = Cell::ADC_OUTPUT_CURRENT; break;
+                case 'B': inputs[f] = Cell::ADC_BUCK_VOLTAGE; break;
+                case 'L': inputs[f] = Cell::ADC_LDO_VOLTAGE; break;
+                default:
+                    out.println("Error:fields must be from V, I, B and L");
+                    return;
+            }
+        }
+        out.print("OK:vector:");
+        bool first = true;
+        for (int i = 0; i < 16; i++) {
+            if (!(mask & (1U << i))) continue;
+            for (unsigned int f = 0; f < num_fields; f++) {
+                if (!first) out.print(",");
+                first = false;
+                out.print(getCachedReading(i, inputs[f]), inputs[f] == Cell::ADC_OUTPUT_CURRENT ? 5 : 4);
+            }
+        }
+        out.println();
+    } else if (command == "STAGEV") {
+        // Like SETV, but the target waits for COMMIT
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:STAGEV requires two arguments");
+            return;
+        }
+        int cellNumber = args.substring(0, spaceIndex).toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        float voltages[16] = {0};
+        voltages[cellNumber - 1] = args.substring(spaceIndex + 1).toFloat();
+        stageVoltageTargets(1U << (cellNumber - 1), voltages);
+        out.print("OK:staged:");
+        out.println(__builtin_popcount(getStagedMask()));
+    } else if (command == "STAGEVEC") {
+        // Like SETVEC, but the targets wait for COMMIT
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:STAGEVEC requires two arguments");
+            return;
+        }
+        uint16_t mask;
+        if (!parseCellMask(args.substring(0, spaceIndex), mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        float voltages[16] = {0};
+        if (!parseVoltageVector(args.substring(spaceIndex + 1), mask, voltages)) {
+            out.println("Error:STAGEVEC needs one voltage per cell in the mask");
+            return;
+        }
+        stageVoltageTargets(mask, voltages);
+        out.print("OK:staged:");
+        out.println(__builtin_popcount(getStagedMask()));
+    } else if (command == "UNSTAGE") {
+        clearStagedTargets();
+        out.println("OK:unstaged");
+    } else if (command == "COMMIT") {
+        // Moves every staged cell at once, replies with the cells moved, the
+        // skew between the first and last and the latency to the first, in us
+        if (!getStagedMask()) {
+            out.println("Error:nothing staged");
+            return;
+        }
+        CommitResult result;
+        if (!commitStagedTargets(result)) {
+            out.println("Error:cannot commit while calibrating");
+            return;
+        }
+        out.print("OK:committed:");
+        out.print(__builtin_popcount(result.cell_mask));
+        out.print(",");
+        out.print(result.skew_us);
+        out.print(",");
+        out.println(result.latency_us);
+    } else if (command == "GETCOMMIT") {
+        // Skew of the last commit, then when each cell moved after the first,
+        // -1 for cells that were not part of it
+        const CommitResult& result = getLastCommit();
+        out.print("OK:commit:");
+        out.print(result.skew_us);
+        for (int i = 0; i < 16; i++) {
+            out.print(",");
+            if (result.cell_mask & (1U << i)) out.print(result.offsets_us[i]);
+            else out.print(-1);
+        }
+        out.println();
+    } else if (command == "WAVEPOINTS") {
+        // WAVEPOINTS <cell> <ms>:<v>,<ms>:<v>,... appends points to the cell's
+        // waveform, times from the start of the waveform. Long waveforms take
+        // several lines.
+        const int MAX_LINE_POINTS = 64;
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:WAVEPOINTS requires two arguments");
+            return;
+        }
+        int cellNumber = args.substring(0, spaceIndex).toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        uint32_t times[MAX_LINE_POINTS];
+        float voltages[MAX_LINE_POINTS];
+        int count = parseWavePoints(args.substring(spaceIndex + 1), times, voltages, MAX_LINE_POINTS);
+        if (count < 0) {
+            out.println("Error:points must be up to 64 <ms>:<volts> pairs");
+            return;
+        }
+        if (!waveformPlayer.addPoints(cellNumber - 1, times, voltages, count)) {
+            out.println("Error:points out of order, waveform full or playing");
+            return;
+        }
+        out.print("OK:wave_points:");
+        out.println(waveformPlayer.getPointCount(cellNumber - 1));
+    } else if (command == "WAVESAMPLES") {
+        // WAVESAMPLES <cell> <interval_ms> <v>,<v>,... appends samples taken
+        // interval_ms apart
+        const int MAX_LINE_SAMPLES = 64;
+        int firstSpace = args.indexOf(' ');
+        int secondSpace = firstSpace == -1 ? -1 : args.indexOf(' ', firstSpace + 1);
+        if (secondSpace == -1) {
+            out.println("Error:WAVESAMPLES requires three arguments");
+            return;
+        }
+        int cellNumber = args.substring(0, firstSpace).toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        float interval_ms = args.substring(firstSpace + 1, secondSpace).toFloat();
+        float voltages[MAX_LINE_SAMPLES];
+        int count = parseFloatList(args.substring(secondSpace + 1), voltages, MAX_LINE_SAMPLES);
+        if (count < 0 || interval_ms <= 0) {
+            out.println("Error:samples must be up to 64 voltages at a positive interval");
+            return;
+        }
+        if (!waveformPlayer.addSamples(cellNumber - 1, (uint32_t)(interval_ms * 1000 + 0.5f), voltages, count)) {
+            out.println("Error:waveform full or playing");
+            return;
+        }
+        out.print("OK:wave_points:");
+        out.println(waveformPlayer.getPointCount(cellNumber - 1));
+    } else if (command == "WAVECLEAR") {
+        uint16_t mask = 0xFFFF;
+        if (args.length() > 0 && !parseCellMask(args, mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        waveformPlayer.clear(mask);
+        out.println("OK:wave_cleared");
+    } else if (command == "WAVEPLAY") {
+        // WAVEPLAY <mask> [LOOP] [delay_ms] starts the cells in the mask
+        // together, 10 ms from now unless given. A play with nothing else
+        // playing starts the late and underrun counts over.
+        args.toUpperCase();
+        int spaceIndex = args.indexOf(' ');
+        String options = spaceIndex == -1 ? String("") : args.substring(spaceIndex + 1);
+        uint16_t mask;
+        if (!parseCellMask(spaceIndex == -1 ? args : args.substring(0, spaceIndex), mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        bool loop = options.startsWith("LOOP");
+        if (loop) options = options.substring(4);
+        options.trim();
+        float delay_ms = options.length() > 0 ? options.toFloat() : 10;
+        if (delay_ms < 0) {
+            out.println("Error:delay must not be negative");
+            return;
+        }
+        if (mask & batteryModels.getRunningMask()) {
+            out.println("Error:cell is running a battery model");
+            return;
+        }
+        bool fresh = waveformPlayer.getPlayingMask() == 0;
+        if (!waveformPlayer.start(mask, loop, (uint32_t)(delay_ms * 1000 + 0.5f))) {
+            out.println("Error:cell without a waveform or already playing");
+            return;
+        }
+        if (fresh) waveformPlayer.resetCounts();
+        out.print("OK:wave_playing:");
+        out.println(__builtin_popcount(mask));
+    } else if (command == "WAVESTOP") {
+        uint16_t mask = 0xFFFF;
+        if (args.length() > 0 && !parseCellMask(args, mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        waveformPlayer.stop(mask);
+        out.println("OK:wave_stopped");
+    } else if (command == "WAVESTATUS") {
+        // Cells still playing (as a mask), late ticks and underruns
+        out.print("OK:wave:0x");
+        out.print(waveformPlayer.getPlayingMask(), HEX);
+        out.print(",");
+        out.print(waveformPlayer.getLateCount());
+        out.print(",");
+        out.println(waveformPlayer.getUnderrunCount());
+    } else if (command == "MODELSET") {
+        // MODELSET <cell> <capacity_Ah>,<R0>[,<R1>,<C1>[,<R2>,<C2>]] <ocv>,<ocv>,...
+        // with resistances in ohms, capacitances in farads and 2 to 21 OCV
+        // points at evenly spaced SOC from 0 to 100%
+        int firstSpace = args.indexOf(' ');
+        int secondSpace = firstSpace == -1 ? -1 : args.indexOf(' ', firstSpace + 1);
+        if (secondSpace == -1) {
+            out.println("Error:MODELSET requires three arguments");
+            return;
+        }
+        int cellNumber = args.substring(0, firstSpace).toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        float circuit[2 + 2 * BatteryModel::MAX_RC_PAIRS];
+        int num_circuit = parseFloatList(args.substring(firstSpace + 1, secondSpace), circuit, 2 + 2 * BatteryModel::MAX_RC_PAIRS);
+        BatteryModel::Params params;
+        int num_ocv = parseFloatList(args.substring(secondSpace + 1), params.ocv, BatteryModel::MAX_OCV_POINTS);
+        if (num_circuit < 2 || num_circuit % 2 != 0 || num_ocv < 2) {
+            out.println("Error:MODELSET needs capacity, R0, up to two R,C pairs and 2 to 21 OCV points");
+            return;
+        }
+        params.capacity_ah = circuit[0];
+        params.r0_ohms = circuit[1];
+        params.num_rc_pairs = (num_circuit - 2) / 2;
+        for (int i = 0; i < params.num_rc_pairs; i++) {
+            params.r_ohms[i] = circuit[2 + 2 * i];
+            params.c_farads[i] = circuit[3 + 2 * i];
+        }
+        params.num_ocv_points = num_ocv;
+        if (!batteryModels.configure(cellNumber - 1, params)) {
+            out.println("Error:invalid model parameters or model running");
+            return;
+        }
+        out.print("OK:model_set:");
+        out.println(cellNumber);
+    } else if (command == "MODELSTART") {
+        // MODELSTART <mask> [soc_percent], from a full battery unless given.
+        // A start with no model running starts the step statistics over.
+        int spaceIndex = args.indexOf(' ');
+        uint16_t mask;
+        if (!parseCellMask(spaceIndex == -1 ? args : args.substring(0, spaceIndex), mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        float soc = spaceIndex == -1 ? 100 : args.substring(spaceIndex + 1).toFloat();
+        if (soc < 0 || soc > 100) {
+            out.println("Error:state of charge must be between 0 and 100");
+            return;
+        }
+        if (mask & waveformPlayer.getPlayingMask()) {
+            out.println("Error:cell is playing a waveform");
+            return;
+        }
+        bool fresh = batteryModels.getRunningMask() == 0;
+        if (!batteryModels.start(mask, soc / 100)) {
+            out.println("Error:cell without a model or already running");
+            return;
+        }
+        if (fresh) batteryModels.resetStats();
+        out.print("OK:model_running:");
+        out.println(__builtin_popcount(mask));
+    } else if (command == "MODELSTOP") {
+        uint16_t mask = 0xFFFF;
+        if (args.length() > 0 && !parseCellMask(args, mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        batteryModels.stop(mask);
+        out.println("OK:model_stopped");
+    } else if (command == "MODELGET") {
+        // SOC in %, terminal voltage, OCV and current of a cell's model
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        BatteryModel::State state = batteryModels.getState(cellNumber - 1);
+        out.print("OK:model:");
+        out.print(state.soc * 100, 3);
+        out.print(",");
+        out.print(state.terminal_v, 4);
+        out.print(",");
+        out.print(state.ocv_v, 4);
+        out.print(",");
+        out.println(state.current_a, 5);
+    } else if (command == "MODELSTATS") {
+        // Steps taken, mean and max time of a step over all cells in us, late steps
+        out.print("OK:model_stats:");
+        out.print(batteryModels.getStepCount());
+        out.print(",");
+        out.print(batteryModels.getMeanStepTime());
+        out.print(",");
+        out.print(batteryModels.getMaxStepTime());
+        out.print(",");
+        out.println(batteryModels.getLateCount());
+    } else if (command == "SETTEMP") {
+        // SETTEMP <channel> <celsius> for thermistor channels 1-4
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:SETTEMP requires two arguments");
+            return;
+        }
+        int channel = args.substring(0, spaceIndex).toInt();
+        if (channel < 1 || channel > Thermistor::NUM_CHANNELS) {
+            out.println("Error:thermistor channel must be between 1 and 4");
+            return;
+        }
+        float celsius = args.substring(spaceIndex + 1).toFloat();
+        temperatureRamp.stop(1U << (channel - 1));
+        thermistor.setTemperature(channel - 1, celsius);
+        out.print("OK:temp_set:");
+        out.println(celsius, 2);
+    } else if (command == "SETTEMPVEC") {
+        // SETTEMPVEC <mask> <celsius>,... with a temperature for each thermistor
+        // channel in the mask, lowest first. All of them go out in one write.
+        int spaceIndex = args.indexOf(' ');
+        uint16_t mask;
+        if (spaceIndex == -1 || !parseCellMask(args.substring(0, spaceIndex), mask) || mask > 0xF) {
+            out.println("Error:SETTEMPVEC needs a channel mask between 0x1 and 0xF and temperatures");
+            return;
+        }
+        float temperatures[16] = {0};
+        if (!parseVoltageVector(args.substring(spaceIndex + 1), mask, temperatures)) {
+            out.println("Error:SETTEMPVEC needs one temperature per channel in the mask");
+            return;
+        }
+        temperatureRamp.stop(mask);
+        for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) {
+            if (mask & (1U << i)) thermistor.setTemperature(i, temperatures[i]);
+        }
+        out.print("OK:temp_vector_set:");
+        out.println(__builtin_popcount(mask));
+    } else if (command == "GETTEMP") {
+        // Mask of ramping channels, then for each channel the temperature set,
+        // the voltage read back and the temperature that voltage stands for
+        float volts[Thermistor::NUM_CHANNELS];
+        if (thermistor.sharesCellAddress()) {
+            out.println("Error:thermistor front end shares addresses with cells 9-16 on this board");
+            return;
+        }
+        if (!readThermistorVoltages(volts)) {
+            out.println("Error:thermistor front end not found");
+            return;
+        }
+        out.print("OK:temp:0x");
+        out.print(temperatureRamp.getActiveMask(), HEX);
+        for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) {
+            out.print(",");
+            out.print(thermistor.getTemperature(i), 2);
+            out.print(",");
+            out.print(volts[i], 4);
+            out.print(",");
+            out.print(thermistor.getModel(i).temperatureFromVoltage(volts[i]), 2);
+        }
+        out.println();
+    } else if (command == "TEMPMODEL") {
+        // TEMPMODEL <channel> BETA <R25>,<beta>,<pullup>,<vref>
+        // TEMPMODEL <channel> SH <a>,<b>,<c>,<pullup>,<vref>
+        // with the BMS's pullup in ohms and the reference it pulls up to
+        int firstSpace = args.indexOf(' ');
+        int secondSpace = firstSpace == -1 ? -1 : args.indexOf(' ', firstSpace + 1);
+        if (secondSpace == -1) {
+            out.println("Error:TEMPMODEL requires three arguments");
+            return;
+        }
+        int channel = args.substring(0, firstSpace).toInt();
+        if (channel < 1 || channel > Thermistor::NUM_CHANNELS) {
+            out.println("Error:thermistor channel must be between 1 and 4");
+            return;
+        }
+        String type = args.substring(firstSpace + 1, secondSpace);
+        type.toUpperCase();
+        float values[5];
+        int count = parseFloatList(args.substring(secondSpace + 1), values, 5);
+        NtcModel model;
+        if (type == "BETA" && count == 4) {
+            model = NtcModel::fromBeta(values[0], values[1], values[2], values[3]);
+        } else if (type == "SH" && count == 5) {
+            model = NtcModel::fromSteinhartHart(values[0], values[1], values[2], values[3], values[4]);
+        } else {
+            out.println("Error:TEMPMODEL needs BETA with R25,beta,pullup,vref or SH with a,b,c,pullup,vref");
+            return;
+        }
+        if ((temperatureRamp.getActiveMask() & (1U << (channel - 1))) || !thermistor.setModel(channel - 1, model)) {
+            out.println("Error:invalid model parameters or channel ramping");
+            return;
+        }
+        out.print("OK:temp_model:");
+        out.println(channel);
+    } else if (command == "TEMPRAMP") {
+        // TEMPRAMP <mask> <celsius>,... <seconds> ramps each channel in the mask
+        // from its present temperature to the one given; TEMPRAMP STOP [mask]
+        args.trim();
+        String upper = args;
+        upper.toUpperCase();
+        if (upper.startsWith("STOP")) {
+            uint16_t mask = 0xF;
+            String maskText = args.substring(4);
+            maskText.trim();
+            if (maskText.length() > 0 && !parseCellMask(maskText, mask)) {
+                out.println("Error:channel mask must be between 0x1 and 0xF");
+                return;
+            }
+            temperatureRamp.stop(mask);
+            out.println("OK:temp_ramp_stopped");
+            return;
+        }
+        int firstSpace = args.indexOf(' ');
+        int secondSpace = firstSpace == -1 ? -1 : args.indexOf(' ', firstSpace + 1);
+        uint16_t mask;
+        if (secondSpace == -1 || !parseCellMask(args.substring(0, firstSpace), mask) || mask > 0xF) {
+            out.println("Error:TEMPRAMP needs a channel mask between 0x1 and 0xF, temperatures and seconds");
+            return;
+        }
+        float to[16] = {0};
+        if (!parseVoltageVector(args.substring(firstSpace + 1, secondSpace), mask, to)) {
+            out.println("Error:TEMPRAMP needs one temperature per channel in the mask");
+            return;
+        }
+        float seconds = args.substring(secondSpace + 1).toFloat();
+        if (seconds <= 0 || seconds > 86400) {
+            out.println("Error:ramp time must be between 0 and 86400 seconds");
+            return;
+        }
+        float from[Thermistor::NUM_CHANNELS];
+        for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) from[i] = thermistor.getTemperature(i);
+        temperatureRamp.stop(mask);
+        temperatureRamp.start(mask, from, to, (uint32_t)(seconds * 1000));
+        out.print("OK:temp_ramp:");
+        out.println(__builtin_popcount(mask));
+    } else if (command == "GETACC") {
+        // GETACC [mask] replies with charge in mAh, energy in mWh and the
+        // seconds they cover for each cell in the mask, all cells if left out
+        uint16_t mask = 0xFFFF;
+        if (args.length() > 0 && !parseCellMask(args, mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        out.print("OK:acc:");
+        bool first = true;
+        for (int i = 0; i < 16; i++) {
+            if (!(mask & (1U << i))) continue;
+            Accumulated acc = getAccumulated(i);
+            if (!first) out.print(",");
+            first = false;
+            out.print(acc.charge_mah, 4);
+            out.print(",");
+            out.print(acc.energy_mwh, 4);
+            out.print(",");
+            out.print(acc.seconds, 3);
+        }
+        out.println();
+    } else if (command == "RESETACC") {
+        uint16_t mask = 0xFFFF;
+        if (args.length() > 0 && !parseCellMask(args, mask)) {
+            out.println("Error:cell mask must be between 0x1 and 0xFFFF");
+            return;
+        }
+        resetAccumulators(mask);
+        out.println("OK:acc_reset");
+    } else if (command == "ENABLE_OUTPUT_ALL") {
+        for (int i = 0; i < 16; i++) {
+            runOnCell(i, [](Cell& cell, void*) { cell.turnOnOutputRelay(); });
+        }
+        out.println("OK:all_outputs_enabled");
+    } else if (command == "DISABLE_OUTPUT_ALL") {
+        for (int i = 0; i < 16; i++) {
+            runOnCell(i, [](Cell& cell, void*) { cell.turnOffOutputRelay(); });
+        }
+        out.println("OK:all_outputs_disabled");
+    } else if (command == "ENABLE_OUTPUT") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        runOnCell(cellNumber - 1, [](Cell& cell, void*) { cell.turnOnOutputRelay(); });
+        out.println("OK:output_enabled");
+    } else if (command == "DISABLE_OUTPUT") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        runOnCell(cellNumber - 1, [](Cell& cell, void*) { cell.turnOffOutputRelay(); });
+        out.println("OK:output_disabled");
+    } else if (command == "ENABLE_LOAD_SWITCH") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        runOnCell(cellNumber - 1, [](Cell& cell, void*) { cell.turnOnLoadSwitch(); });
+        out.println("OK:load_switch_enabled");
+    } else if (command == "DISABLE_LOAD_SWITCH") {
+        int cellNumber = args.toInt();
+        if (cellNumber < 1 || cellNumber > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        runOnCell(cellNumber - 1, [](Cell& cell, void*) { cell.turnOffLoadSwitch(); });
+        out.println("OK:load_switch_disabled");
+    } else if (command == "ENABLE_LOAD_SWITCH_ALL") {
+        for (int i = 0; i < 16; i++) {
+            runOnCell(i, [](Cell& cell, void*) { cell.turnOnLoadSwitch(); });
+        }
+        out.println("OK:all_load_switches_enabled");
+    } else if (command == "DISABLE_LOAD_SWITCH_ALL") {
+        for (int i = 0; i < 16; i++) {
+            runOnCell(i, [](Cell& cell, void*) { cell.turnOffLoadSwitch(); });
+        }
+        out.println("OK:all_load_switches_disabled");
+    } else if (command == "GETMUXSTATS") {
+        // writes,avoided for the Wire bus followed by the Wire1 bus
+        out.print("OK:mux_stats:");
+        out.print(mux1.getWriteCount());
+        out.print(",");
+        out.print(mux1.getAvoidedCount());
+        out.print(",");
+        out.print(mux2.getWriteCount());
+        out.print(",");
+        out.println(mux2.getAvoidedCount());
+    } else if (command == "RESETMUXSTATS") {
+        mux1.resetCounters();
+        mux2.resetCounters();
+        out.println("OK:mux_stats_reset");
+    } else if (command == "I2CCLOCK") {
+        // I2CCLOCK [<bus>] <hz>, both buses without a bus number; replies
+        // with the clock of bus 1 and bus 2
+        if (args.length() > 0) {
+            int spaceIndex = args.indexOf(' ');
+            int bus = spaceIndex == -1 ? 0 : args.substring(0, spaceIndex).toInt();
+            long clock = args.substring(spaceIndex + 1).toInt();
+            if (spaceIndex != -1 && bus != 1 && bus != 2) {
+                out.println("Error:bus must be 1 or 2");
+                return;
+            }
+            if (clock < (long)MIN_BUS_CLOCK_HZ || clock > (long)MAX_BUS_CLOCK_HZ) {
+                out.println("Error:clock must be between 100000 and 1000000 Hz");
+                return;
+            }
+            for (uint8_t b = 1; b <= 2; b++) {
+                if ((bus == 0 || bus == b) && !setBusClock(b, clock)) {
+                    out.println("Error:bus rejected the clock");
+                    return;
+                }
+            }
+        }
+        out.print("OK:i2c_clock:");
+        out.print(getBusClock(1));
+        out.print(",");
+        out.println(getBusClock(2));
+    } else if (command == "I2CBENCH") {
+        // I2CBENCH [rounds] runs both buses at each standard clock. One
+        // BENCH:<hz>,<transactions/s>,<nacks>,<errors> for bus 1 then bus 2,
+        // <GETALLV latency in us> line per clock, 0 latency if it timed out.
+        // The clocks are set back afterwards.
+        int rounds = args.length() > 0 ? args.toInt() : 50;
+        if (rounds < 1 || rounds > 1000) {
+            out.println("Error:rounds must be between 1 and 1000");
+            return;
+        }
+        static const uint32_t CLOCKS[] = {100000, 400000, 1000000};
+        uint32_t previous[2] = {getBusClock(1), getBusClock(2)};
+        for (uint32_t clock : CLOCKS) {
+            out.print("BENCH:");
+            out.print(clock);
+            for (uint8_t bus = 1; bus <= 2; bus++) {
+                setBusClock(bus, clock);
+                BusBenchmark result = benchmarkBus(bus, rounds);
+                uint32_t rate = result.elapsed_us ? (uint64_t)result.transactions * 1000000 / result.elapsed_us : 0;
+                out.print(",");
+                out.print(rate);
+                out.print(",");
+                out.print(result.nacks);
+                out.print(",");
+                out.print(result.errors);
+            }
+            // The cache is being refilled at this clock after the benchmark
+            out.print(",");
+            out.println(measureFreshReadLatency(1000000));
+        }
+        for (uint8_t bus = 1; bus <= 2; bus++) setBusClock(bus, previous[bus - 1]);
+        out.print("OK:i2c_bench:");
+        out.println(sizeof(CLOCKS) / sizeof(CLOCKS[0]));
+    } else if (command == "PING") {
+        out.println("OK:PONG");
+    } else if ((command == "STREAM" || command == "BINARY") && !commandFromUSB) {
+        out.print("Error:");
+        out.print(command);
+        out.println(" is only available over USB, use UDPSTREAM");
+    } else if (command == "STREAM") {
+        args.toUpperCase();
+        int rate = args.toInt();
+        if (args == "STOP" || (args.length() > 0 && rate == 0)) {
+            telemetryStream.stop();
+            out.print("OK:stream_stopped:");
+            out.println(telemetryStream.getDropCount());
+            return;
+        }
+        if (!telemetryStream.start(rate)) {
+            out.println("Error:stream rate must be between 1 and 500 Hz");
+            return;
+        }
+        out.print("OK:stream:");
+        out.println(rate);
+    } else if (command == "UDPSTREAM") {
+        // UDPSTREAM <ip> <port> <rate> sends binary stream frames as datagrams
+        args.trim();
+        String upper = args;
+        upper.toUpperCase();
+        if (upper == "STOP") {
+            udpTelemetryStream.stop();
+            networkServer.clearTelemetryTarget();
+            out.print("OK:udp_stream_stopped:");
+            out.println(udpTelemetryStream.getDropCount());
+            return;
+        }
+        int first = args.indexOf(' ');
+        int second = args.indexOf(' ', first + 1);
+        if (first == -1 || second == -1) {
+            out.println("Error:UDPSTREAM requires ip, port and rate");
+            return;
+        }
+        long udp_port = args.substring(first + 1, second).toInt();
+        int rate = args.substring(second + 1).toInt();
+        if (udp_port < 1 || udp_port > 65535 || !networkServer.setTelemetryTarget(args.substring(0, first).c_str(), udp_port)) {
+            out.println("Error:invalid UDP destination");
+            return;
+        }
+        if (!udpTelemetryStream.start(rate)) {
+            networkServer.clearTelemetryTarget();
+            out.println("Error:stream rate must be between 1 and 500 Hz");
+            return;
+        }
+        out.print("OK:udp_stream:");
+        out.println(rate);
+    } else if (command == "NETINFO") {
+        // NETINFO replies with the address, the command port and the clients
+        uint32_t address = ntohl(networkServer.getAddress());
+        char text[16];
+        snprintf(text, sizeof(text), "%lu.%lu.%lu.%lu", (unsigned long)(address >> 24),
+                 (unsigned long)(address >> 16) & 0xFF, (unsigned long)(address >> 8) & 0xFF, (unsigned long)address & 0xFF);
+        out.print("OK:net:");
+        out.print(text);
+        out.print(",");
+        out.print(networkServer.getPort());
+        out.print(",");
+        out.println(networkServer.getClientCount());
+    } else if (command == "BINARY") {
+        // Everything after this reply is framed, see binary_protocol.h
+        out.print("OK:binary:");
+        out.println((int)BinaryProtocol::VERSION);
+        binaryMode = true;
+    } else if (command == "CALIBRATE") {
+        int cell_num = args.toInt();
+        if (cell_num < 1 || cell_num > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        calibrateCells(1U << (cell_num - 1));
+        saveCalibration(1U << (cell_num - 1));
+
+        // Reply with the mean and worst settle time in ms
+        const Calibrator& calibrator = workerFor(cell_num - 1).getCalibrator();
+        out.print("OK:calibrated:");
+        out.print(calibrator.getMeanSettleTime((cell_num - 1) % 8) / 1000.0, 2);
+        out.print(",");
+        out.println(calibrator.getMaxSettleTime((cell_num - 1) % 8) / 1000.0, 2);
+    } else if (command == "CALIBRATE_ALL") {
+        uint32_t started_at = millis();
+        calibrateCells(0xFFFF);
+        saveCalibration(0xFFFF);
+
+        // Reply with the total time, the worst settle time and the points that timed out
+        uint32_t longest = 0;
+        uint32_t timeouts = 0;
+        for (int i = 0; i < 16; i++) {
+            const Calibrator& calibrator = workerFor(i).getCalibrator();
+            longest = max(longest, calibrator.getMaxSettleTime(i % 8));
+            timeouts += calibrator.getTimeoutCount(i % 8);
+        }
+        out.print("OK:all_calibrated:");
+        out.print(millis() - started_at);
+        out.print(",");
+        out.print(longest / 1000.0, 2);
+        out.print(",");
+        out.println(timeouts);
+    } else if (command == "GETCAL") {
+        // One CAL:<cell>:<table> line per cell, or just the one asked for
+        int first = 1;
+        int last = 16;
+        if (args.length() > 0) {
+            first = last = args.toInt();
+            if (first < 1 || first > 16) {
+                out.println("Error:cell number must be between 1 and 16");
+                return;
+            }
+        }
+        // The bus task rewrites the tables when it calibrates, so copy them out there
+        static CalibrationTable table;
+        for (int i = first; i <= last; i++) {
+            runOnCell(i - 1, [](Cell& cell, void* context) {
+                CalibrationStore::readTable(cell, *static_cast<CalibrationTable*>(context));
+            }, &table);
+            out.print("CAL:");
+            out.print(i);
+            out.print(":");
+            CalibrationStore::printTable(out, table);
+            out.println();
+        }
+        out.print("OK:cal:");
+        out.println(last - first + 1);
+    } else if (command == "SETCAL") {
+        int spaceIndex = args.indexOf(' ');
+        if (spaceIndex == -1) {
+            out.println("Error:SETCAL requires two arguments");
+            return;
+        }
+        int cell_num = args.substring(0, spaceIndex).toInt();
+        if (cell_num < 1 || cell_num > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        static CalibrationTable table;
+        if (!CalibrationStore::parseTable(args.substring(spaceIndex + 1), table)) {
+            out.println("Error:malformed calibration table");
+            return;
+        }
+        if (!CalibrationStore::isValid(table)) {
+            out.println("Error:calibration table failed validation");
+            return;
+        }
+        // The bus task reads the table on every setpoint, so swap it in there
+        runOnCell(cell_num - 1, [](Cell& cell, void* context) {
+            CalibrationStore::applyTable(cell, *static_cast<CalibrationTable*>(context));
+        }, &table);
+        workerFor(cell_num - 1).markDirty((cell_num - 1) % 8);
+        if (!calibrationStore.save(cell_num - 1, table)) {
+            out.println("Error:could not store calibration");
+            return;
+        }
+        out.print("OK:cal_set:");
+        out.println(cell_num);
+    } else if (command == "GETLUT") {
+        int cell_num = args.toInt();
+        if (cell_num < 1 || cell_num > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        // The tables are compiled lazily on the bus task, so copy them out there
+        static SetpointTable tables[2];
+        runOnCell(cell_num - 1, [](Cell& cell, void* context) {
+            SetpointTable* tables = static_cast<SetpointTable*>(context);
+            tables[0] = cell.getSetpointTable(true);
+            tables[1] = cell.getSetpointTable(false);
+        }, tables);
+
+        // min,max:edges for the buck, then the same for the LDO
+        out.print("OK:lut:");
+        for (int t = 0; t < 2; t++) {
+            if (t > 0) out.print(";");
+            out.print(tables[t].getMinUnits());
+            out.print(",");
+            out.print(tables[t].getMaxUnits());
+            out.print(":");
+            for (int i = 0; i < SetpointTable::NUM_EDGES; i++) {
+                if (i > 0) out.print(",");
+                out.print(tables[t].getEdge(i));
+            }
+        }
+        out.println();
+    } else if (command == "CLEARCAL") {
+        // Every cell calibrates again at the next boot
+        calibrationStore.clear();
+        out.println("OK:cal_cleared");
+    } else if (command == "GETSETTLE") {
+        int cell_num = args.toInt();
+        if (cell_num < 1 || cell_num > 16) {
+            out.println("Error:cell number must be between 1 and 16");
+            return;
+        }
+        // Settle time in ms of every point from the last calibration, buck then LDO
+        const Calibrator& calibrator = workerFor(cell_num - 1).getCalibrator();
+        out.print("OK:settle:");
+        for (int i = 0; i < 2 * Cell::NUM_POINTS; i++) {
+            if (i > 0) out.print(",");
+            bool buck = i < Cell::NUM_POINTS;
+            out.print(calibrator.getSettleTime((cell_num - 1) % 8, buck, i % Cell::NUM_POINTS) / 1000.0, 2);
+        }
+        out.println();
+    } else {
+        out.println("Error:unknown command");
+    }
+}
+
+void sendBinaryFrame(uint8_t seq, uint8_t cmd, const uint8_t* payload, size_t length)
+{
+    static uint8_t frame[BinaryProtocol::MAX_FRAME_SIZE];
+    size_t size = BinaryProtocol::encode(frame, seq, cmd, payload, length);
+    USBSerial.write(frame, size);
+}
+
+void handleBinaryFrame(const BinaryProtocol::Frame& request)
+{
+    using namespace BinaryProtocol;
+    static uint8_t reply[MAX_PAYLOAD];
+    size_t length = 1; // reply[0] is the status
+    uint8_t status = STATUS_OK;
+
+    switch (request.cmd) {
+        case CMD_PING:
+            break;
+        case CMD_SET_V:
+            if (request.length != 3 || request.payload[0] < 1 || request.payload[0] > 16) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            setVoltageTarget(request.payload[0] - 1, fixedToVolts(getU16(&request.payload[1])));
+            break;
+        case CMD_GET_V:
+            if (request.length != 1 || request.payload[0] < 1 || request.payload[0] > 16) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            putU16(&reply[length], voltsToFixed(getCachedReading(request.payload[0] - 1, Cell::ADC_OUTPUT_VOLTAGE)));
+            length += 2;
+            break;
+        case CMD_SET_ALL_V:
+            if (request.length != 2) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            for (int i = 0; i < 16; i++) {
+                setVoltageTarget(i, fixedToVolts(getU16(request.payload)));
+            }
+            break;
+        case CMD_GET_ALL_V:
+            for (int i = 0; i < 16; i++) {
+                putU16(&reply[length], voltsToFixed(getCachedReading(i, Cell::ADC_OUTPUT_VOLTAGE)));
+                length += 2;
+            }
+            break;
+        case CMD_GET_ALL_I:
+            for (int i = 0; i < 16; i++) {
+                putI32(&reply[length], ampsToFixed(getCachedReading(i, Cell::ADC_OUTPUT_CURRENT)));
+                length += 4;
+            }
+            break;
+        case CMD_SET_VEC: {
+            uint16_t mask = request.length >= 2 ? getU16(request.payload) : 0;
+            if (mask == 0 || request.length != 2 + 2 * __builtin_popcount(mask)) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            float voltages[16] = {0};
+            const uint8_t* value = &request.payload[2];
+            for (int i = 0; i < 16; i++) {
+                if (!(mask & (1U << i))) continue;
+                voltages[i] = fixedToVolts(getU16(value));
+                value += 2;
+            }
+            setVoltageTargets(mask, voltages);
+            break;
+        }
+        case CMD_STAGE_VEC: {
+            uint16_t mask = request.length >= 2 ? getU16(request.payload) : 0;
+            if (mask == 0 || request.length != 2 + 2 * __builtin_popcount(mask)) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            float voltages[16] = {0};
+            const uint8_t* value = &request.payload[2];
+            for (int i = 0; i < 16; i++) {
+                if (!(mask & (1U << i))) continue;
+                voltages[i] = fixedToVolts(getU16(value));
+                value += 2;
+            }
+            stageVoltageTargets(mask, voltages);
+            break;
+        }
+        case CMD_COMMIT: {
+            CommitResult result;
+            if (request.length != 0 || !commitStagedTargets(result)) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            putU16(&reply[length], result.cell_mask);
+            putU32(&reply[length + 2], result.skew_us);
+            putU32(&reply[length + 6], result.latency_us);
+            length += 10;
+            break;
+        }
+        case CMD_GET_ACC: {
+            uint16_t mask = request.length == 2 ? getU16(request.payload) : 0;
+            if (mask == 0) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            for (int i = 0; i < 16; i++) {
+                if (!(mask & (1U << i))) continue;
+                Accumulated acc = getAccumulated(i);
+                putI32(&reply[length], (int32_t)lroundf(acc.charge_mah * 1000));
+                putI32(&reply[length + 4], (int32_t)lroundf(acc.energy_mwh * 1000));
+                putU32(&reply[length + 8], (uint32_t)lroundf(acc.seconds * 1000));
+                length += 12;
+            }
+            break;
+        }
+        case CMD_RESET_ACC: {
+            uint16_t mask = request.length == 2 ? getU16(request.payload) : 0;
+            if (mask == 0) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            resetAccumulators(mask);
+            break;
+        }
+        case CMD_GET_VEC: {
+            uint16_t mask = request.length == 3 ? getU16(request.payload) : 0;
+            uint8_t fields = request.length == 3 ? request.payload[2] : 0;
+            if (mask == 0 || fields == 0 || (fields & ~(FIELD_VOLTAGE | FIELD_CURRENT | FIELD_BUCK | FIELD_LDO))) {
+                status = STATUS_BAD_ARGUMENT;
+                break;
+            }
+            for (int i = 0; i < 16; i++) {
+                if (!(mask & (1U << i))) continue;
+                if (fields & FIELD_VOLTAGE) {
+                    putU16(&reply[length], voltsToFixed(getCachedReading(i, Cell::ADC_OUTPUT_VOLTAGE)));
+                    length += 2;
+                }
+                if (fields & FIELD_CURRENT) {
+                    putI32(&reply[length], ampsToFixed(getCachedReading(i, Cell::ADC_OUTPUT_CURRENT)));
+                    length += 4;
+                }
+                if (fields & FIELD_BUCK) {
+                    putU16(&reply[length], voltsToFixed(getCachedReading(i, Cell::ADC_BUCK_VOLTAGE)));
+                    length += 2;
+                }
+                if (fields & FIELD_LDO) {
+                    putU16(&reply[length], voltsToFixed(getCachedReading(i, Cell::ADC_LDO_VOLTAGE)));
+                    length += 2;
+                }
+            }
+            break;
+        }
+        case CMD_ASCII: {
+            // Tunnels any ASCII command, the reply carries its text output
+            char line[MAX_PAYLOAD + 1];
+            memcpy(line, request.payload, request.length);
+            line[request.length] = '\0';
+            PayloadWriter writer(&reply[length], MAX_PAYLOAD - length);
+            handleCommand(String(line), writer);
+            length += writer.length();
+            break;
+        }
+        case CMD_EXIT:
+            binaryMode = false;
+            break;
+        default:
+            status = STATUS_UNKNOWN_COMMAND;
+            break;
+    }
+
+    reply[0] = status;
+    sendBinaryFrame(request.seq, request.cmd | REPLY_FLAG, reply, length);
+}
+
+void processBinaryInput()
+{
+    using namespace BinaryProtocol;
+    // Bounded so a burst of input can't starve the rest of the loop
+    int budget = 512;
+    while (binaryMode && USBSerial.available() && budget-- > 0) {
+        switch (binaryDecoder.feed(USBSerial.read())) {
+            case Decoder::FRAME:
+                handleBinaryFrame(binaryDecoder.frame());
+                break;
+            case Decoder::BAD_CRC: {
+                uint8_t status = STATUS_BAD_CRC;
+                const Frame& frame = binaryDecoder.frame();
+                sendBinaryFrame(frame.seq, frame.cmd | REPLY_FLAG, &status, 1);
+                break;
+            }
+            case Decoder::LINE:
+                // Lets a host that lost track of the mode get back to ASCII
+                if (strcmp(binaryDecoder.line(), "ASCII") == 0) {
+                    binaryMode = false;
+                    USBSerial.println("OK:ascii");
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Prefixes every line of a reply with the tag of the request it answers
+class TaggedPrint : public Print
+{
+public:
+    TaggedPrint(Print& out, const String& tag) : out(out), tag(tag) {}
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+        // Whole runs of text at a time, the tag goes in front of each line
+        size_t start = 0;
+        for (size_t i = 0; i < size; i++) {
+            if (buffer[i] != '\n') continue;
+            writeRun(&buffer[start], i + 1 - start);
+            start = i + 1;
+        }
+        writeRun(&buffer[start], size - start);
+        return size;
+    }
+
+private:
+    void writeRun(const uint8_t* run, size_t length)
+    {
+        if (length == 0) return;
+        if (line_start) {
+            out.print(tag);
+            out.print(' ');
+        }
+        out.write(run, length);
+        line_start = run[length - 1] == '\n';
+    }
+
+    Print& out;
+    const String& tag;
+    bool line_start = true;
+};
+
+void processASCIILine(String line, Print& out, bool usb)
+{
+    // "#<tag> <command>" gets every reply line back prefixed with "#<tag> ",
+    // so a host can have several commands in flight and still match replies
+    commandFromUSB = usb;
+    line.trim();
+    if (!line.startsWith("#")) {
+        handleCommand(line, out);
+    } else {
+        int space = line.indexOf(' ');
+        if (space != -1) {
+            String tag = line.substring(0, space);
+            TaggedPrint tagged(out, tag);
+            handleCommand(line.substring(space + 1), tagged);
+        }
+    }
+    commandFromUSB = true;
+}
+
+void processUARTCommands() {
+    if (binaryMode) {
+        processBinaryInput();
+        return;
+    }
+    // Pipelined commands queue up, so work through several per pass
+    int budget = 16;
+    while (!binaryMode && USBSerial.available() && budget-- > 0) {
+        processASCIILine(USBSerial.readStringUntil('\n'), USBSerial, true);
+    }
+}
+
+void sendTelemetry()
+{
+    // One snapshot serves both streams when they fall due together
+    uint32_t now = micros();
+    bool serial_due = telemetryStream.due(now);
+    bool udp_due = udpTelemetryStream.due(now);
+    if (!serial_due && !udp_due) return;
+
+    TelemetryFrame frame;
+    frame.timestamp = micros();
+    for (int i = 0; i < 16; i++) {
+        frame.voltage[i] = getCachedReading(i, Cell::ADC_OUTPUT_VOLTAGE);
+        frame.current[i] = getCachedReading(i, Cell::ADC_OUTPUT_CURRENT);
+        frame.buck[i] = getCachedReading(i, Cell::ADC_BUCK_VOLTAGE);
+        frame.ldo[i] = getCachedReading(i, Cell::ADC_LDO_VOLTAGE);
+    }
+    if (serial_due) telemetryStream.send(USBSerial, frame, binaryMode);
+    if (udp_due) {
+        DatagramPrint datagram(networkServer);
+        udpTelemetryStream.send(datagram, frame, true);
+    }
+}
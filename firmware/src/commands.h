@@ -0,0 +1,27 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+#include "board.h"
+#include "binary_protocol.h"
+#include "telemetry_stream.h"
+#include "network_server.h"
+
+// Host command processing: the ASCII commands, the binary framed protocol and
+// telemetry streaming over USBSerial, and the ASCII commands and telemetry
+// over the network. Runs on the command task.
+
+// Host protocol state, switched to binary framing by the BINARY command
+extern bool binaryMode;
+extern BinaryProtocol::Decoder binaryDecoder;
+extern TelemetryStream telemetryStream;
+extern TelemetryStream udpTelemetryStream;
+extern NetworkServer networkServer;
+
+void handleCommand(String cmd, Print& out);
+void processASCIILine(String line, Print& out, bool usb);
+void handleBinaryFrame(const BinaryProtocol::Frame& request);
+void processUARTCommands();
+void sendTelemetry();
+
+#endif // COMMANDS_H
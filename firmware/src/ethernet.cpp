@@ -0,0 +1,74 @@
+#include "ethernet.h"
+#include "commands.h"
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+#include <esp_eth.h>
+#include <esp_event.h>
+#include <esp_mac.h>
+#include <esp_netif.h>
+
+static const int SPI_CLOCK_HZ = 20 * 1000 * 1000;
+
+static void onNetworkEvent(void* arg, esp_event_base_t base, int32_t id, void* data)
+{
+    if (base == IP_EVENT && id == IP_EVENT_ETH_GOT_IP) {
+        const ip_event_got_ip_t* event = static_cast<const ip_event_got_ip_t*>(data);
+        networkServer.setAddress(event->ip_info.ip.addr);
+    } else if (base == ETH_EVENT && id == ETHERNET_EVENT_DISCONNECTED) {
+        networkServer.setAddress(0);
+    }
+}
+
+bool initEthernet(const EthernetPins& pins)
+{
+    // The W5500 driver takes its interrupt through the GPIO ISR service
+    esp_err_t isr = gpio_install_isr_service(0);
+    if (isr != ESP_OK && isr != ESP_ERR_INVALID_STATE) return false;
+
+    spi_bus_config_t bus = {};
+    bus.sclk_io_num = pins.sck;
+    bus.mosi_io_num = pins.mosi;
+    bus.miso_io_num = pins.miso;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) return false;
+
+    // W5500 frames start with a 16 bit address and an 8 bit control phase
+    spi_device_interface_config_t device = {};
+    device.command_bits = 16;
+    device.address_bits = 8;
+    device.mode = 0;
+    device.clock_speed_hz = SPI_CLOCK_HZ;
+    device.spics_io_num = pins.cs;
+    device.queue_size = 20;
+    spi_device_handle_t spi = nullptr;
+    if (spi_bus_add_device(SPI2_HOST, &device, &spi) != ESP_OK) return false;
+
+    eth_w5500_config_t w5500 = ETH_W5500_DEFAULT_CONFIG(spi);
+    w5500.int_gpio_num = pins.interrupt;
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+    phy_config.reset_gpio_num = pins.reset;
+    esp_eth_mac_t* mac = esp_eth_mac_new_w5500(&w5500, &mac_config);
+    esp_eth_phy_t* phy = esp_eth_phy_new_w5500(&phy_config);
+    if (!mac || !phy) return false;
+
+    esp_eth_config_t config = ETH_DEFAULT_CONFIG(mac, phy);
+    esp_eth_handle_t handle = nullptr;
+    if (esp_eth_driver_install(&config, &handle) != ESP_OK) return false;
+
+    // The W5500 has no address of its own, use the one reserved in eFuse
+    uint8_t mac_address[6];
+    esp_read_mac(mac_address, ESP_MAC_ETH);
+    esp_eth_ioctl(handle, ETH_CMD_S_MAC_ADDR, mac_address);
+
+    esp_netif_init();
+    esp_event_loop_create_default();
+    esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
+    esp_netif_t* netif = esp_netif_new(&netif_config);
+    esp_netif_attach(netif, esp_eth_new_netif_glue(handle));
+    esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, onNetworkEvent, nullptr);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, onNetworkEvent, nullptr);
+
+    return esp_eth_start(handle) == ESP_OK;
+}
@@ -0,0 +1,25 @@
+#ifndef ETHERNET_H
+#define ETHERNET_H
+
+#include <Arduino.h>
+
+// W5500 on SPI2, brought up through the ESP-IDF Ethernet driver.
+//
+// The driver reads the W5500 from its own task, woken by the chip's interrupt
+// line, and its SPI bus moves frames by DMA, so the command task only ever
+// touches already buffered socket data. The address comes from DHCP and is
+// handed to networkServer as the link comes and goes.
+struct EthernetPins
+{
+    int sck;
+    int mosi;
+    int miso;
+    int cs;
+    int interrupt;
+    int reset;
+};
+
+// False if the W5500 doesn't answer, networking then stays off
+bool initEthernet(const EthernetPins& pins);
+
+#endif // ETHERNET_H
@@ -0,0 +1,48 @@
+#include "i2c_mux.h"
+
+// Constructor
+I2CMux::I2CMux(TwoWire& wire_interface, uint8_t address) :
+    wire(wire_interface), address(address) {
+}
+
+bool I2CMux::select(uint8_t channel)
+{
+    if (channel > 7) return false;
+    return writeMask(1 << channel);
+}
+
+bool I2CMux::deselectAll()
+{
+    // Disconnects every downstream channel, for devices that sit directly on the bus
+    return writeMask(0x00);
+}
+
+void I2CMux::invalidate()
+{
+    // Forces the next select to hit the bus, e.g. after a bus reset
+    state_known = false;
+}
+
+void I2CMux::resetCounters()
+{
+    write_count = 0;
+    avoided_count = 0;
+}
+
+bool I2CMux::writeMask(uint8_t mask)
+{
+    if (state_known && selected_mask == mask) {
+        avoided_count++;
+        return true;
+    }
+
+    wire.beginTransmission(address);
+    wire.write(mask);
+    uint8_t result = wire.endTransmission();
+    write_count++;
+
+    // If the write failed we no longer know what the mux has selected
+    state_known = (result == 0);
+    selected_mask = mask;
+    return state_known;
+}
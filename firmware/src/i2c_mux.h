@@ -0,0 +1,42 @@
+#ifndef I2C_MUX_H
+#define I2C_MUX_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Owns the TCA9548 mux on one I2C bus. All cells on the bus share it, so it
+// remembers the currently selected channel and only writes the mux when the
+// selection actually changes.
+class I2CMux
+{
+public:
+    // Constructor
+    I2CMux(TwoWire& wire_interface, uint8_t address = 0x70);
+
+    // Public methods
+    bool select(uint8_t channel);
+    bool deselectAll();
+    void invalidate();
+    void resetCounters();
+
+    TwoWire& getWire() { return wire; }
+    uint8_t getAddress() const { return address; }
+    uint32_t getWriteCount() const { return write_count; }
+    uint32_t getAvoidedCount() const { return avoided_count; }
+
+private:
+    bool writeMask(uint8_t mask);
+
+    TwoWire& wire;
+    const uint8_t address;
+
+    // Channel mask last written to the mux, only meaningful while state_known
+    uint8_t selected_mask = 0;
+    bool state_known = false;
+
+    // Statistics
+    uint32_t write_count = 0;
+    uint32_t avoided_count = 0;
+};
+
+#endif // I2C_MUX_H
@@ -0,0 +1,49 @@
+#include "led_strip.h"
+#include <driver/rmt.h>
+
+// 80 MHz APB / 2, 25 ns per tick
+static const uint8_t CLOCK_DIVIDER = 2;
+// WS2812 bit timing in ticks: high then low time of a 0 and of a 1
+static const uint16_t T0H = 16; // 0.40 us
+static const uint16_t T0L = 34; // 0.85 us
+static const uint16_t T1H = 32; // 0.80 us
+static const uint16_t T1L = 18; // 0.45 us
+
+bool LedStrip::begin(int pin, uint8_t num_leds)
+{
+    if (num_leds > MAX_LEDS) return false;
+    this->num_leds = num_leds;
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, (rmt_channel_t)channel);
+    config.clk_div = CLOCK_DIVIDER;
+    if (rmt_config(&config) != ESP_OK) return false;
+    return rmt_driver_install((rmt_channel_t)channel, 0, 0) == ESP_OK;
+}
+
+bool LedStrip::isBusy() const
+{
+    return started && rmt_wait_tx_done((rmt_channel_t)channel, 0) != ESP_OK;
+}
+
+bool LedStrip::show(const LedColor* colors)
+{
+    if (isBusy()) return false;
+
+    // GRB, most significant bit first
+    rmt_item32_t* item = reinterpret_cast<rmt_item32_t*>(items);
+    for (uint8_t i = 0; i < num_leds; i++) {
+        uint32_t grb = ((uint32_t)colors[i].g << 16) | ((uint32_t)colors[i].r << 8) | colors[i].b;
+        for (int bit = BITS_PER_LED - 1; bit >= 0; bit--) {
+            bool one = grb & (1UL << bit);
+            item->level0 = 1;
+            item->duration0 = one ? T1H : T0H;
+            item->level1 = 0;
+            item->duration1 = one ? T1L : T0L;
+            item++;
+        }
+    }
+    // The line idles low between frames, which is the latch
+    started = rmt_write_items((rmt_channel_t)channel, reinterpret_cast<rmt_item32_t*>(items),
+                              num_leds * BITS_PER_LED, false) == ESP_OK;
+    return started;
+}
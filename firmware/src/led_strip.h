@@ -0,0 +1,33 @@
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+#include <Arduino.h>
+#include "status_leds.h"
+
+// The WS2812 status strip, driven by the RMT peripheral.
+//
+// show() encodes the colors into RMT symbols and starts the transfer without
+// waiting for it. The RMT driver refills the peripheral's memory from its
+// interrupt, so no task spends the ~1 ms a 32 LED frame takes on the wire.
+class LedStrip
+{
+public:
+    static const uint8_t MAX_LEDS = StatusLeds::NUM_LEDS;
+
+    // Public methods
+    bool begin(int pin, uint8_t num_leds);
+    bool isBusy() const;
+    // False while the previous frame is still going out
+    bool show(const LedColor* colors);
+
+private:
+    static const uint8_t BITS_PER_LED = 24;
+
+    uint8_t channel = 0;
+    uint8_t num_leds = 0;
+    bool started = false;
+    // rmt_item32_t, owned by the driver until the transfer is done
+    uint32_t items[MAX_LEDS * BITS_PER_LED];
+};
+
+#endif // LED_STRIP_H
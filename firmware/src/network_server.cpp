@@ -0,0 +1,274 @@
+#include "network_server.h"
+#include "commands.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// What the stack took without waiting, 0 if it has no room, -1 on an error
+ssize_t sendSome(int fd, const uint8_t* data, size_t size)
+{
+    for (;;) {
+        ssize_t written = send(fd, data, size, SEND_FLAGS);
+        if (written >= 0) return written;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+// Collects a reply so it leaves in as few segments as possible. What the
+// stack has no room for goes behind the client's pending replies; fails on a
+// socket error or when those would outgrow MAX_PENDING.
+class SocketPrint : public Print
+{
+public:
+    SocketPrint(int fd, uint8_t*& pending, size_t& pending_length, uint32_t& sent_at)
+        : fd(fd), pending(pending), pending_length(pending_length), sent_at(sent_at)
+    {
+    }
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t size) override
+    {
+        for (size_t i = 0; i < size; i++) {
+            if (length == sizeof(buffer)) sendBuffered();
+            buffer[length++] = data[i];
+        }
+        return size;
+    }
+
+    bool sendBuffered()
+    {
+        size_t sent = 0;
+        // Behind replies still waiting, nothing may overtake them
+        while (!failed && pending_length == 0 && sent < length) {
+            ssize_t written = sendSome(fd, buffer + sent, length - sent);
+            if (written < 0) failed = true;
+            else if (written == 0) break;
+            else sent += written;
+        }
+        if (!failed && sent < length) failed = !hold(buffer + sent, length - sent);
+        length = 0;
+        return !failed;
+    }
+
+private:
+    bool hold(const uint8_t* data, size_t size)
+    {
+        if (pending_length + size > NetworkServer::MAX_PENDING) return false;
+        if (!pending) pending = static_cast<uint8_t*>(malloc(NetworkServer::MAX_PENDING));
+        if (!pending) return false;
+        // The timeout runs from the moment the stack ran out of room
+        if (pending_length == 0) sent_at = millis();
+        memcpy(pending + pending_length, data, size);
+        pending_length += size;
+        return true;
+    }
+
+    int fd;
+    uint8_t*& pending;
+    size_t& pending_length;
+    uint32_t& sent_at;
+    uint8_t buffer[1460];
+    size_t length = 0;
+    bool failed = false;
+};
+
+} // namespace
+
+// Port 0 listens on any free port, see getPort()
+bool NetworkServer::begin(uint16_t port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return false;
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(listen_fd, (sockaddr*)&local, sizeof(local)) != 0 ||
+        listen(listen_fd, MAX_CLIENTS) != 0 || !setNonBlocking(listen_fd)) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socklen_t length = sizeof(local);
+    getsockname(listen_fd, (sockaddr*)&local, &length);
+    this->port = ntohs(local.sin_port);
+
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_fd >= 0 && !setNonBlocking(udp_fd)) {
+        ::close(udp_fd);
+        udp_fd = -1;
+    }
+    return true;
+}
+
+void NetworkServer::poll()
+{
+    if (listen_fd < 0) return;
+    accept();
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        // A client takes no more commands until it has read its replies
+        if (clients[i].fd >= 0 && flush(clients[i]) && clients[i].pending_length == 0) receive(clients[i]);
+    }
+}
+
+uint8_t NetworkServer::getClientCount() const
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) count++;
+    }
+    return count;
+}
+
+bool NetworkServer::setTelemetryTarget(const char* ip, uint16_t port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (udp_fd < 0 || port == 0 || inet_pton(AF_INET, ip, &address.sin_addr) != 1) return false;
+    target = address;
+    has_target = true;
+    return true;
+}
+
+bool NetworkServer::sendDatagram(const uint8_t* data, size_t size)
+{
+    if (!has_target || size > MAX_DATAGRAM) return false;
+    return sendto(udp_fd, data, size, SEND_FLAGS, (sockaddr*)&target, sizeof(target)) == (ssize_t)size;
+}
+
+void NetworkServer::accept()
+{
+    for (;;) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) return;
+
+        Client* client = nullptr;
+        for (uint8_t i = 0; i < MAX_CLIENTS && !client; i++) {
+            if (clients[i].fd < 0) client = &clients[i];
+        }
+        if (!client || !setNonBlocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+        // Replies are small and the host waits on each of them
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifndef ESP_PLATFORM
+        // The send buffer lwIP gives a socket on the board (TCP_SND_BUF), so
+        // the host build runs out of room where the board would
+        int send_buffer = 5744;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+#endif
+        client->fd = fd;
+        client->length = 0;
+        client->discarding = false;
+    }
+}
+
+// Sends what the stack has room for of the client's pending replies. False
+// once the client is closed, on a socket error or after SEND_TIMEOUT_MS
+// without the stack taking any.
+bool NetworkServer::flush(Client& client)
+{
+    if (client.pending_length == 0) return true;
+    ssize_t written = sendSome(client.fd, client.pending, client.pending_length);
+    if (written < 0 || (written == 0 && millis() - client.sent_at >= SEND_TIMEOUT_MS)) {
+        close(client);
+        return false;
+    }
+    if (written == 0) return true;
+    client.pending_length -= written;
+    memmove(client.pending, client.pending + written, client.pending_length);
+    client.sent_at = millis();
+    if (client.pending_length == 0) {
+        free(client.pending);
+        client.pending = nullptr;
+    }
+    return true;
+}
+
+void NetworkServer::receive(Client& client)
+{
+    // Pipelined commands queue up, so take a few reads per pass. Bytes are
+    // looked at first and only taken up to the line whose reply had to wait,
+    // the rest stays with the stack until the client has read it.
+    for (int reads = 0; reads < 4 && client.pending_length == 0; reads++) {
+        char chunk[256];
+        ssize_t received = recv(client.fd, chunk, sizeof(chunk), MSG_DONTWAIT | MSG_PEEK);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close(client);
+            return;
+        }
+        if (received < 0) return;
+
+        ssize_t taken = received;
+        for (ssize_t i = 0; i < received; i++) {
+            if (chunk[i] != '\n') {
+                if (client.discarding) continue;
+                if (client.length == MAX_LINE - 1) {
+                    client.discarding = true;
+                    continue;
+                }
+                client.line[client.length++] = chunk[i];
+                continue;
+            }
+
+            SocketPrint out(client.fd, client.pending, client.pending_length, client.sent_at);
+            if (client.discarding) {
+                out.println("Error:command too long");
+            } else {
+                client.line[client.length] = '\0';
+                processASCIILine(String(client.line), out, false);
+            }
+            client.length = 0;
+            client.discarding = false;
+            if (!out.sendBuffered()) {
+                close(client);
+                return;
+            }
+            if (client.pending_length > 0) {
+                taken = i + 1;
+                break;
+            }
+        }
+        recv(client.fd, chunk, taken, MSG_DONTWAIT);
+    }
+}
+
+void NetworkServer::close(Client& client)
+{
+    ::close(client.fd);
+    client.fd = -1;
+    client.length = 0;
+    free(client.pending);
+    client.pending = nullptr;
+    client.pending_length = 0;
+}
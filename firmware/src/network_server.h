@@ -0,0 +1,100 @@
+#ifndef NETWORK_SERVER_H
+#define NETWORK_SERVER_H
+
+#include <Arduino.h>
+#include <netinet/in.h>
+
+// The host command set over TCP and telemetry over UDP.
+//
+// Clients connect to COMMAND_PORT and send the same ASCII lines as over USB,
+// "#<tag>" prefixes included, and get their replies on their own connection.
+// Binary framing stays on USB, TCP already carries the text without the
+// serial round trip cost. Telemetry goes out as one CMD_STREAM_FRAME frame
+// per datagram to the address set with UDPSTREAM.
+//
+// Every socket is non-blocking and poll() only handles what the stack has
+// already buffered, so the command task never waits on the network. What of a
+// reply the stack has no room for waits with its client, which sends nothing
+// more until the client has read it. A client that stops reading is dropped
+// once its waiting reply outgrows MAX_PENDING or sits for SEND_TIMEOUT_MS.
+class NetworkServer
+{
+public:
+    static const uint16_t COMMAND_PORT = 5025;
+    static const uint8_t MAX_CLIENTS = 4;
+    static const size_t MAX_LINE = 1024;
+    static const size_t MAX_DATAGRAM = 1472;
+    // Room for a GETCAL of every cell
+    static const size_t MAX_PENDING = 16384;
+    static const uint32_t SEND_TIMEOUT_MS = 5000;
+
+    // Public methods
+    bool begin(uint16_t port = COMMAND_PORT);
+    bool isListening() const { return listen_fd >= 0; }
+    uint16_t getPort() const { return port; }
+    void poll();
+    uint8_t getClientCount() const;
+
+    // IPv4 address of the interface in network order, 0 while it has none.
+    // Set by the Ethernet driver as the link comes and goes.
+    void setAddress(uint32_t address) { this->address = address; }
+    uint32_t getAddress() const { return address; }
+
+    // Telemetry datagrams, dropped rather than queued when the stack is busy
+    bool setTelemetryTarget(const char* ip, uint16_t port);
+    void clearTelemetryTarget() { has_target = false; }
+    bool hasTelemetryTarget() const { return has_target; }
+    bool sendDatagram(const uint8_t* data, size_t size);
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        char line[MAX_LINE];
+        size_t length = 0;
+        // Rest of a line too long to take, thrown away up to its newline
+        bool discarding = false;
+        // Replies the stack had no room for, allocated when first needed
+        uint8_t* pending = nullptr;
+        size_t pending_length = 0;
+        // When the stack last took some of them
+        uint32_t sent_at = 0;
+    };
+
+    void accept();
+    bool flush(Client& client);
+    void receive(Client& client);
+    void close(Client& client);
+
+    int listen_fd = -1;
+    int udp_fd = -1;
+    uint16_t port = 0;
+    volatile uint32_t address = 0;
+    Client clients[MAX_CLIENTS];
+
+    sockaddr_in target = {};
+    bool has_target = false;
+};
+
+// Hands everything written in one call to the server as one datagram, so
+// TelemetryStream can send frames over UDP as it does over USB
+class DatagramPrint : public Print
+{
+public:
+    explicit DatagramPrint(NetworkServer& server) : server(server) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+        return server.sendDatagram(buffer, size) ? size : 0;
+    }
+    int availableForWrite() override
+    {
+        return server.hasTelemetryTarget() ? NetworkServer::MAX_DATAGRAM : 0;
+    }
+
+private:
+    NetworkServer& server;
+};
+
+#endif // NETWORK_SERVER_H
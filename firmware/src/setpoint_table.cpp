@@ -0,0 +1,59 @@
+#include "setpoint_table.h"
+
+void SetpointTable::compile(const std::pair<float, float>* points, int num_points)
+{
+    // Points are in descending voltage
+    min_units = static_cast<int32_t>(points[num_points - 1].first * 10000.0f + 0.5f);
+    max_units = static_cast<int32_t>(points[0].first * 10000.0f + 0.5f);
+    if (min_units < 0) min_units = 0;
+    if (max_units >= (NUM_EDGES - 1) << STEP_SHIFT) max_units = ((NUM_EDGES - 1) << STEP_SHIFT) - 1;
+    if (max_units < min_units) max_units = min_units;
+
+    for (int i = 0; i < NUM_EDGES; i++) {
+        float voltage = (i << STEP_SHIFT) / 10000.0;
+        float edge = interpolate(points, num_points, voltage) * (1 << FRACTION_BITS);
+        if (edge < INT16_MIN) edge = INT16_MIN;
+        if (edge > INT16_MAX) edge = INT16_MAX;
+        edges[i] = static_cast<int16_t>(lroundf(edge));
+    }
+
+    // A higher voltage never needs a higher code, even if a calibration point was noisy
+    for (int i = NUM_EDGES - 2; i >= 0; i--) {
+        if (edges[i] < edges[i + 1]) edges[i] = edges[i + 1];
+    }
+}
+
+uint16_t SetpointTable::lookup(float voltage) const
+{
+    int32_t units = static_cast<int32_t>(voltage * 10000.0f + 0.5f);
+    if (units < min_units) units = min_units;
+    if (units > max_units) units = max_units;
+
+    int32_t bin = units >> STEP_SHIFT;
+    int32_t fraction = units & ((1 << STEP_SHIFT) - 1);
+    int32_t low = edges[bin];
+    int32_t high = edges[bin + 1];
+    int32_t code = low + (((high - low) * fraction) >> STEP_SHIFT);
+    code = (code + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+    if (code < 0) return 0;
+    if (code > 4095) return 4095;
+    return code;
+}
+
+float SetpointTable::interpolate(const std::pair<float, float>* points, int num_points, float voltage)
+{
+    // Each point is {measured voltage, DAC setpoint}, in descending voltage.
+    // Find the segment holding the voltage, or the end segment it lies beyond.
+    int index = 1;
+    while (index < num_points - 1 && points[index].first > voltage) {
+        index++;
+    }
+    // Linear interpolation:
+    // DAC setpoint = s1 + (voltage - v1) * (s2 - s1) / (v2 - v1)
+    float v1 = points[index - 1].first;
+    float v2 = points[index].first;
+    float s1 = points[index - 1].second;
+    float s2 = points[index].second;
+    if (v1 == v2) return s1;
+    return s1 + (voltage - v1) * (s2 - s1) / (v2 - v1);
+}
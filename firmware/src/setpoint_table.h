@@ -0,0 +1,40 @@
+#ifndef SETPOINT_TABLE_H
+#define SETPOINT_TABLE_H
+
+#include <Arduino.h>
+#include <utility>
+
+// Voltage to DAC code conversion compiled from a calibration table. The
+// calibration curve is sampled on a fixed grid of 25.6 mV bins from 0 V and
+// stored as fixed-point codes, so a lookup is one shift to find the bin and
+// one integer interpolation inside it, instead of a scan over the points.
+// The end segments are extended past the calibrated range and the voltage is
+// clamped to that range instead, so the bins holding the ends stay exact.
+//
+// The grid is the same for every table, so the host can rebuild the exact
+// codes from the edges alone (see lib/calibration.py).
+class SetpointTable
+{
+public:
+    // Voltages are handled in 100 uV units, the resolution of the host protocol
+    static const uint8_t STEP_SHIFT = 8;    // 256 units = 25.6 mV per bin
+    static const uint8_t FRACTION_BITS = 3; // edges hold DAC codes in 1/8 steps
+    static const int NUM_EDGES = 193;       // 0 V to 4.9152 V
+
+    // Public methods
+    void compile(const std::pair<float, float>* points, int num_points);
+    uint16_t lookup(float voltage) const;
+    int16_t getEdge(int index) const { return edges[index]; }
+    int32_t getMinUnits() const { return min_units; }
+    int32_t getMaxUnits() const { return max_units; }
+
+private:
+    static float interpolate(const std::pair<float, float>* points, int num_points, float voltage);
+
+    int16_t edges[NUM_EDGES] = {0};
+    // Calibrated range in 100 uV units
+    int32_t min_units = 0;
+    int32_t max_units = 0;
+};
+
+#endif // SETPOINT_TABLE_H
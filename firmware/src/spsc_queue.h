@@ -0,0 +1,40 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free ring buffer for exactly one producer task and one consumer task.
+// Holds up to N - 1 items; N must be a power of two.
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T& item)
+    {
+        size_t head = head_index.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == tail_index.load(std::memory_order_acquire)) return false;
+        items[head] = item;
+        head_index.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        size_t tail = tail_index.load(std::memory_order_relaxed);
+        if (tail == head_index.load(std::memory_order_acquire)) return false;
+        item = items[tail];
+        tail_index.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    std::atomic<size_t> head_index{0};
+    std::atomic<size_t> tail_index{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,45 @@
+#include "status_leds.h"
+#include "board.h"
+
+uint16_t StatusLeds::update()
+{
+    uint16_t redrawn = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        // Cache only, unlike getCachedReading() this must never post bus jobs
+        Sample voltage_sample = workerFor(i).getSample(i % 8, Cell::ADC_OUTPUT_VOLTAGE);
+        Sample current_sample = workerFor(i).getSample(i % 8, Cell::ADC_OUTPUT_CURRENT);
+        if (!voltage_sample.valid || !current_sample.valid) continue;
+        float voltage = voltage_sample.value;
+        float current = current_sample.value;
+
+        bool moved = fabsf(voltage - drawn_voltage[i]) >= VOLTAGE_THRESHOLD ||
+                     fabsf(current - drawn_current[i]) >= CURRENT_THRESHOLD;
+        if (!moved && !(stale & (1U << i))) continue;
+
+        draw(i, voltage, current);
+        drawn_voltage[i] = voltage;
+        drawn_current[i] = current;
+        redrawn |= 1U << i;
+    }
+    stale &= ~redrawn;
+    return redrawn;
+}
+
+void StatusLeds::draw(uint8_t cell, float voltage, float current)
+{
+    float voltage_pos = constrain((voltage - MIN_VOLTAGE) / (MAX_VOLTAGE - MIN_VOLTAGE), 0, 1);
+    uint8_t current_bright = constrain((current / MAX_CURRENT) * 255, 0, 255);
+
+    // Blue to green over the lower half of the range, green to red above
+    LedColor voltage_color;
+    if (voltage_pos < 0.5) {
+        float pos = voltage_pos * 2;
+        voltage_color = {0, (uint8_t)(255 * pos), (uint8_t)(255 * (1 - pos))};
+    } else {
+        float pos = (voltage_pos - 0.5) * 2;
+        voltage_color = {(uint8_t)(255 * pos), (uint8_t)(255 * (1 - pos)), 0};
+    }
+
+    colors[cell * 2] = {current_bright, 0, 0};
+    colors[cell * 2 + 1] = voltage_color;
+}
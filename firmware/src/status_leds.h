@@ -0,0 +1,49 @@
+#ifndef STATUS_LEDS_H
+#define STATUS_LEDS_H
+
+#include <Arduino.h>
+
+struct LedColor
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+// Colors of the two status LEDs per cell: the first shows the current in
+// red, the second the output voltage on a blue, green, red gradient.
+//
+// Only the cached readings are used, so drawing never touches a bus. A cell
+// is recomputed when its voltage or current moved past a threshold since it
+// was last drawn, about one step of its colors, so a steady board costs
+// nothing and doesn't need pushing to the strip.
+class StatusLeds
+{
+public:
+    static const uint8_t NUM_CELLS = 16;
+    static const uint8_t NUM_LEDS = 2 * NUM_CELLS;
+
+    // Ranges the colors span
+    static constexpr float MIN_VOLTAGE = 0.5;
+    static constexpr float MAX_VOLTAGE = 4.5;
+    static constexpr float MAX_CURRENT = 0.5;
+    // 4V and 0.5A over 255 color steps
+    static constexpr float VOLTAGE_THRESHOLD = 0.015;
+    static constexpr float CURRENT_THRESHOLD = 0.002;
+
+    // Returns the mask of cells redrawn (bit i = cell i + 1)
+    uint16_t update();
+    void invalidate() { stale = 0xFFFF; }
+    const LedColor* getColors() const { return colors; }
+
+private:
+    void draw(uint8_t cell, float voltage, float current);
+
+    LedColor colors[NUM_LEDS] = {};
+    float drawn_voltage[NUM_CELLS] = {0};
+    float drawn_current[NUM_CELLS] = {0};
+    // Cells to redraw no matter how little their readings moved
+    uint16_t stale = 0xFFFF;
+};
+
+#endif // STATUS_LEDS_H
@@ -0,0 +1,88 @@
+#include "telemetry_stream.h"
+#include "binary_protocol.h"
+
+bool TelemetryStream::start(uint16_t rate_hz)
+{
+    if (rate_hz < MIN_RATE_HZ || rate_hz > MAX_RATE_HZ) return false;
+    period_us = 1000000UL / rate_hz;
+    next_due = micros();
+    seq = 0;
+    drops = 0;
+    return true;
+}
+
+void TelemetryStream::stop()
+{
+    period_us = 0;
+}
+
+bool TelemetryStream::due(uint32_t now)
+{
+    if (!isActive()) return false;
+    if ((int32_t)(now - next_due) < 0) return false;
+
+    // Ticks the loop was too busy to service are counted as drops
+    uint32_t missed = (now - next_due) / period_us;
+    if (missed > 0) {
+        drops += missed;
+        seq += missed;
+        next_due += missed * period_us;
+    }
+    next_due += period_us;
+    return true;
+}
+
+void TelemetryStream::send(Print& out, const TelemetryFrame& frame, bool binary)
+{
+    static char text[768];
+    static uint8_t packet[BinaryProtocol::MAX_FRAME_SIZE];
+
+    const uint8_t* data;
+    size_t size;
+    if (binary) {
+        size = formatBinary(packet, frame);
+        data = packet;
+    } else {
+        size = formatText(text, sizeof(text), frame);
+        data = (const uint8_t*)text;
+    }
+
+    // Never block the loop on a slow host
+    if ((size_t)out.availableForWrite() < size || out.write(data, size) != size) {
+        drops++;
+    }
+    seq++;
+}
+
+size_t TelemetryStream::formatText(char* buffer, size_t capacity, const TelemetryFrame& frame)
+{
+    size_t used = snprintf(buffer, capacity, "STREAM:%lu,%lu,%lu",
+                           (unsigned long)seq, (unsigned long)frame.timestamp, (unsigned long)drops);
+
+    const float* fields[] = {frame.voltage, frame.current, frame.buck, frame.ldo};
+    const int decimals[] = {4, 5, 3, 3};
+    for (int f = 0; f < 4; f++) {
+        for (int i = 0; i < 16 && used < capacity; i++) {
+            used += snprintf(buffer + used, capacity - used, ",%.*f", decimals[f], fields[f][i]);
+        }
+    }
+    if (used < capacity) used += snprintf(buffer + used, capacity - used, "\r\n");
+    return used < capacity ? used : capacity - 1;
+}
+
+size_t TelemetryStream::formatBinary(uint8_t* buffer, const TelemetryFrame& frame)
+{
+    using namespace BinaryProtocol;
+    uint8_t payload[STREAM_FRAME_PAYLOAD];
+    uint8_t* p = payload;
+
+    putU32(p, seq); p += 4;
+    putU32(p, frame.timestamp); p += 4;
+    putU32(p, drops); p += 4;
+    for (int i = 0; i < 16; i++, p += 2) putU16(p, voltsToFixed(frame.voltage[i]));
+    for (int i = 0; i < 16; i++, p += 4) putI32(p, ampsToFixed(frame.current[i]));
+    for (int i = 0; i < 16; i++, p += 2) putU16(p, voltsToFixed(frame.buck[i]));
+    for (int i = 0; i < 16; i++, p += 2) putU16(p, voltsToFixed(frame.ldo[i]));
+
+    return encode(buffer, seq & 0xFF, CMD_STREAM_FRAME, payload, STREAM_FRAME_PAYLOAD);
+}
@@ -0,0 +1,52 @@
+#ifndef TELEMETRY_STREAM_H
+#define TELEMETRY_STREAM_H
+
+#include <Arduino.h>
+
+// Snapshot of every channel pushed in one stream frame
+struct TelemetryFrame
+{
+    uint32_t timestamp; // micros()
+    float voltage[16];
+    float current[16];
+    float buck[16];
+    float ldo[16];
+};
+
+// Pushes telemetry frames to the host at a fixed rate until stopped.
+//
+// ASCII mode line:
+//   STREAM:<seq>,<timestamp_us>,<drops>,<16 voltages>,<16 currents>,<16 buck>,<16 ldo>
+// Binary mode: an unsolicited BinaryProtocol::CMD_STREAM_FRAME frame, also the
+// payload of each datagram when streaming over UDP.
+//
+// Every tick consumes a sequence number. A tick is dropped instead of blocking
+// when the output (USB transmit buffer or UDP socket) can't take the whole
+// frame, or when the loop fell more than a period behind, so gaps in seq always
+// match the drop counter.
+class TelemetryStream
+{
+public:
+    static const uint16_t MIN_RATE_HZ = 1;
+    static const uint16_t MAX_RATE_HZ = 500;
+
+    // Public methods
+    bool start(uint16_t rate_hz);
+    void stop();
+    bool isActive() const { return period_us != 0; }
+    bool due(uint32_t now);
+    void send(Print& out, const TelemetryFrame& frame, bool binary);
+
+    uint32_t getDropCount() const { return drops; }
+
+private:
+    size_t formatText(char* buffer, size_t capacity, const TelemetryFrame& frame);
+    size_t formatBinary(uint8_t* buffer, const TelemetryFrame& frame);
+
+    uint32_t period_us = 0;
+    uint32_t next_due = 0;
+    uint32_t seq = 0;
+    uint32_t drops = 0;
+};
+
+#endif // TELEMETRY_STREAM_H
@@ -0,0 +1,224 @@
+#include "thermistor.h"
+#include "board.h"
+
+static const float KELVIN = 273.15;
+static const float T25_KELVIN = 25 + KELVIN;
+
+NtcModel NtcModel::fromBeta(float r25_ohms, float beta, float pullup_ohms, float reference_volts)
+{
+    NtcModel model = {};
+    model.type = BETA;
+    model.r25_ohms = r25_ohms;
+    model.beta = beta;
+    model.pullup_ohms = pullup_ohms;
+    model.reference_volts = reference_volts;
+    return model;
+}
+
+NtcModel NtcModel::fromSteinhartHart(float a, float b, float c, float pullup_ohms, float reference_volts)
+{
+    NtcModel model = {};
+    model.type = STEINHART_HART;
+    model.a = a;
+    model.b = b;
+    model.c = c;
+    model.pullup_ohms = pullup_ohms;
+    model.reference_volts = reference_volts;
+    return model;
+}
+
+bool NtcModel::isValid() const
+{
+    if (pullup_ohms <= 0 || reference_volts <= 0) return false;
+    if (type == BETA) return r25_ohms > 0 && beta > 0;
+    return b > 0 && c >= 0;
+}
+
+float NtcModel::resistanceAt(float celsius) const
+{
+    double inverse_t = 1.0 / (celsius + KELVIN);
+    if (type == BETA) return r25_ohms * exp(beta * (inverse_t - 1.0 / T25_KELVIN));
+    if (c == 0) return exp((inverse_t - a) / b);
+
+    // Solve the cubic in ln(R)
+    double x = (a - inverse_t) / c;
+    double y = sqrt(pow(b / (3.0 * c), 3) + x * x / 4.0);
+    return exp(cbrt(y - x / 2.0) - cbrt(y + x / 2.0));
+}
+
+float NtcModel::temperatureAt(float ohms) const
+{
+    double ln_r = log(ohms);
+    double inverse_t = type == BETA ? 1.0 / T25_KELVIN + log(ohms / r25_ohms) / beta
+                                    : a + b * ln_r + c * ln_r * ln_r * ln_r;
+    return 1.0 / inverse_t - KELVIN;
+}
+
+float NtcModel::voltageAt(float celsius) const
+{
+    float ohms = resistanceAt(celsius);
+    return reference_volts * ohms / (ohms + pullup_ohms);
+}
+
+// NAN outside of what the divider can produce
+float NtcModel::temperatureFromVoltage(float volts) const
+{
+    if (volts <= 0 || volts >= reference_volts) return NAN;
+    return temperatureAt(pullup_ohms * volts / (reference_volts - volts));
+}
+
+// Constructor
+Thermistor::Thermistor(I2CMux& mux, uint8_t dac_address, uint8_t adc_address)
+    : wire(mux.getWire()), dac_address(dac_address), adc_address(adc_address)
+{
+    // 10k B3435 NTCs against a 10k pullup to 3.3V until told otherwise
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        models[i] = NtcModel::fromBeta(10000, 3435, 10000, 3.3);
+        model_versions[i].store(0);
+        temperatures[i].store(25);
+        codes[i].store(0);
+    }
+}
+
+// False if the front end doesn't answer, or is at a cell's address; it then
+// stays idle
+bool Thermistor::init()
+{
+    present = false;
+    if (sharesCellAddress()) return false;
+    wire.beginTransmission(dac_address);
+    present = wire.endTransmission() == 0 && adc.begin(adc_address, &wire);
+    if (!present) return false;
+
+    adc.setDataRate(RATE_ADS1115_860SPS);
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) setTemperature(i, getTemperature(i));
+    service();
+    return true;
+}
+
+bool Thermistor::sharesCellAddress() const
+{
+    return Cell::usesAddress(dac_address) || Cell::usesAddress(adc_address);
+}
+
+void Thermistor::service()
+{
+    if (!present || !dirty.exchange(false)) return;
+    // Try again next pass if the write didn't make it
+    if (!writeOutputs()) dirty.store(true);
+}
+
+// Reads the four outputs back, in volts
+bool Thermistor::readVoltages(float* volts)
+{
+    if (!present) return false;
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        volts[i] = adc.computeVolts(adc.readADC_SingleEnded(i));
+    }
+    return true;
+}
+
+bool Thermistor::setModel(uint8_t channel, const NtcModel& model)
+{
+    if (channel >= NUM_CHANNELS || !model.isValid()) return false;
+    uint32_t version = model_versions[channel].load(std::memory_order_relaxed);
+    model_versions[channel].store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    models[channel] = model;
+    model_versions[channel].store(version + 2, std::memory_order_release);
+    setTemperature(channel, getTemperature(channel));
+    return true;
+}
+
+NtcModel Thermistor::getModel(uint8_t channel) const
+{
+    NtcModel model;
+    uint32_t version;
+    do {
+        version = model_versions[channel].load(std::memory_order_acquire);
+        model = models[channel];
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((version & 1) || version != model_versions[channel].load(std::memory_order_relaxed));
+    return model;
+}
+
+void Thermistor::setTemperature(uint8_t channel, float celsius)
+{
+    if (channel >= NUM_CHANNELS) return;
+    float code = roundf(getModel(channel).voltageAt(celsius) / DAC_REFERENCE_VOLTS * 4096);
+    temperatures[channel].store(celsius);
+    codes[channel].store((uint16_t)constrain(code, 0.0f, 4095.0f));
+    dirty.store(true, std::memory_order_release);
+}
+
+bool Thermistor::writeOutputs()
+{
+    // Fast write: two bytes per channel, A to D, in one transaction
+    wire.beginTransmission(dac_address);
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        uint16_t code = codes[i].load();
+        wire.write((uint8_t)((code >> 8) & 0x0F));
+        wire.write((uint8_t)(code & 0xFF));
+    }
+    return wire.endTransmission() == 0;
+}
+
+// from[i] and to[i] are for channel i. False if a channel in the mask is
+// ramping already.
+bool TemperatureRamp::start(uint8_t channel_mask, const float* from, const float* to, uint32_t duration_ms)
+{
+    channel_mask &= (1U << Thermistor::NUM_CHANNELS) - 1;
+    if (!channel_mask || (getActiveMask() & channel_mask)) return false;
+
+    for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) {
+        if (!(channel_mask & (1U << i))) continue;
+        channels[i].from = from[i];
+        channels[i].to = to[i];
+        channels[i].duration_ms = duration_ms;
+    }
+    starting.fetch_or(channel_mask, std::memory_order_release);
+    return true;
+}
+
+// Stopped channels stay where the ramp had got to. A tick that saw them still
+// active may be about to set them, so wait it out; it runs on the timer, above
+// the command task, and takes microseconds.
+void TemperatureRamp::stop(uint8_t channel_mask)
+{
+    starting.fetch_and(~channel_mask);
+    active.fetch_and(~channel_mask);
+    while (ticking.load()) {
+    }
+    // That tick may also have moved them from starting to active
+    active.fetch_and(~channel_mask);
+}
+
+void TemperatureRamp::tick(uint32_t now)
+{
+    // Sequentially consistent with stop(): either it sees this tick running,
+    // or this tick sees the channels it stopped
+    ticking.store(true);
+    clock_us += ticked ? now - last_tick : 0;
+    last_tick = now;
+    ticked = true;
+
+    uint8_t started = starting.exchange(0);
+    for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) {
+        if (started & (1U << i)) channels[i].start_us = clock_us;
+    }
+    uint8_t ramping = started ? active.fetch_or(started) | started : active.load();
+
+    for (uint8_t i = 0; i < Thermistor::NUM_CHANNELS; i++) {
+        if (!(ramping & (1U << i))) continue;
+        const Channel& ch = channels[i];
+        uint64_t duration_us = (uint64_t)ch.duration_ms * 1000;
+        uint64_t elapsed = clock_us - ch.start_us;
+        if (elapsed >= duration_us) {
+            thermistor.setTemperature(i, ch.to);
+            active.fetch_and(~(1U << i), std::memory_order_acq_rel);
+            continue;
+        }
+        thermistor.setTemperature(i, ch.from + (ch.to - ch.from) * (float)elapsed / (float)duration_us);
+    }
+    ticking.store(false, std::memory_order_release);
+}
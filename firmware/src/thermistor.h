@@ -0,0 +1,141 @@
+#ifndef THERMISTOR_H
+#define THERMISTOR_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <atomic>
+#include <Adafruit_ADS1X15.h> // ADC
+#include "i2c_mux.h"
+
+// An NTC as the BMS sees it: the thermistor from its sense input to ground,
+// with the BMS's pullup from the sense input to its reference. Either a beta
+// model from R25, or Steinhart-Hart coefficients
+//   1/T = a + b ln(R) + c ln(R)^3   (T in kelvin)
+struct NtcModel
+{
+    enum Type : uint8_t { BETA, STEINHART_HART };
+
+    Type type;
+    float r25_ohms;
+    float beta;
+    float a, b, c;
+    float pullup_ohms;
+    float reference_volts;
+
+    static NtcModel fromBeta(float r25_ohms, float beta, float pullup_ohms, float reference_volts);
+    static NtcModel fromSteinhartHart(float a, float b, float c, float pullup_ohms, float reference_volts);
+    bool isValid() const;
+
+    float resistanceAt(float celsius) const;
+    float temperatureAt(float ohms) const;
+    // Voltage on the sense input at a temperature, and back
+    float voltageAt(float celsius) const;
+    float temperatureFromVoltage(float volts) const;
+};
+
+// Where the front end answers. As built, its MCP4728 and ADS1115 are at 0x60
+// and 0x48, the addresses of the LDO DAC and ADC of every cell behind the mux
+// on the same bus. Sitting in front of the mux, it hears all of their traffic:
+// an LDO write is also a valid MCP4728 fast write to channel A, and both ADCs
+// drive SDA on every cell ADC read. A board with the
+// front end moved, an MCP4728A4 and the ADS1115's ADDR pin to VDD, builds with
+// -DTHERMISTOR_DAC_ADDRESS=0x64 -DTHERMISTOR_ADC_ADDRESS=0x49.
+#ifndef THERMISTOR_DAC_ADDRESS
+#define THERMISTOR_DAC_ADDRESS 0x60
+#endif
+#ifndef THERMISTOR_ADC_ADDRESS
+#define THERMISTOR_ADC_ADDRESS 0x48
+#endif
+
+// The isolated four channel thermistor simulator on Wire1: an MCP4728 whose
+// buffered outputs stand in for the thermistors, and an ADS1115 reading them
+// back.
+//
+// Temperatures are turned into DAC codes by the channel's NtcModel when they
+// are set, from any task. service() runs on bus 2's task and writes all four
+// outputs with one MCP4728 fast write whenever a code changed. At an address a
+// cell also uses the front end is never enabled: the firmware can neither keep
+// its outputs nor the cells' readings on that bus intact.
+class Thermistor
+{
+public:
+    static const uint8_t NUM_CHANNELS = 4;
+    static const uint8_t DAC_ADDRESS = THERMISTOR_DAC_ADDRESS;
+    static const uint8_t ADC_ADDRESS = THERMISTOR_ADC_ADDRESS;
+    // The DAC runs from the isolated 3.3V rail and uses it as reference
+    static constexpr float DAC_REFERENCE_VOLTS = 3.3;
+
+    // Constructor
+    Thermistor(I2CMux& mux, uint8_t dac_address = DAC_ADDRESS, uint8_t adc_address = ADC_ADDRESS);
+
+    // Public methods, on the bus task
+    bool init();
+    bool isPresent() const { return present; }
+    bool sharesCellAddress() const;
+    void service();
+    bool readVoltages(float* volts);
+
+    // Safe from other tasks. Models change from the command task only.
+    bool setModel(uint8_t channel, const NtcModel& model);
+    NtcModel getModel(uint8_t channel) const;
+    void setTemperature(uint8_t channel, float celsius);
+    float getTemperature(uint8_t channel) const { return temperatures[channel].load(); }
+    uint16_t getCode(uint8_t channel) const { return codes[channel].load(); }
+
+private:
+    bool writeOutputs();
+
+    TwoWire& wire;
+    const uint8_t dac_address;
+    const uint8_t adc_address;
+    Adafruit_ADS1115 adc;
+    bool present = false;
+
+    // Each model is published under a seqlock: its version is odd while
+    // setModel() writes it, and readers retry until they copied it between two
+    // equal even versions. The ramp reads models from the timer.
+    NtcModel models[NUM_CHANNELS];
+    std::atomic<uint32_t> model_versions[NUM_CHANNELS];
+    std::atomic<float> temperatures[NUM_CHANNELS];
+    std::atomic<uint16_t> codes[NUM_CHANNELS];
+    // Set when a code still has to be written
+    std::atomic<bool> dirty{false};
+};
+
+// Moves thermistor channels linearly from one temperature to another, from
+// the simulation timer, so thermal derating tests run without the host.
+class TemperatureRamp
+{
+public:
+    // From the command task
+    bool start(uint8_t channel_mask, const float* from, const float* to, uint32_t duration_ms);
+    // Returns once a tick in flight is through, so nothing the ramp sets
+    // lands after a temperature set next
+    void stop(uint8_t channel_mask);
+    uint8_t getActiveMask() const { return active.load(std::memory_order_acquire) | starting.load(std::memory_order_acquire); }
+
+    // Runs on the timer
+    void tick(uint32_t now);
+
+private:
+    struct Channel
+    {
+        float from;
+        float to;
+        uint32_t duration_ms;
+        uint64_t start_us;
+    };
+
+    Channel channels[Thermistor::NUM_CHANNELS];
+    // Time since the first tick, ramps may outlast a micros() wrap
+    uint64_t clock_us = 0;
+    uint32_t last_tick = 0;
+    bool ticked = false;
+    // Like WaveformPlayer, the next tick gives started channels their start time
+    std::atomic<uint8_t> starting{0};
+    std::atomic<uint8_t> active{0};
+    // Set while tick() runs
+    std::atomic<bool> ticking{false};
+};
+
+#endif // THERMISTOR_H
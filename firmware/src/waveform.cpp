@@ -0,0 +1,178 @@
+#include "waveform.h"
+#include "board.h"
+
+void WaveformPlayer::clear(uint16_t channel_mask)
+{
+    channel_mask &= ~getPlayingMask();
+    // A tick that saw a channel before it finished may still be reading it
+    waitForTick();
+    for (uint8_t i = 0; i < 16; i++) {
+        if (!(channel_mask & (1U << i))) continue;
+        channels[i].num_points = 0;
+        channels[i].duration_us = 0;
+    }
+}
+
+// Appends points, which must come later than the ones already there and in
+// order of time. Nothing is added unless all of them fit; false when they
+// don't, or when the channel is playing.
+bool WaveformPlayer::addPoints(uint8_t channel, const uint32_t* times_us, const float* voltages, uint16_t count)
+{
+    if (channel >= 16 || (getPlayingMask() & (1U << channel))) return false;
+    // A tick that saw the channel before it finished may still be reading it
+    waitForTick();
+    Channel& ch = channels[channel];
+    if (ch.num_points + count > MAX_POINTS) return false;
+    for (uint16_t i = 0; i < count; i++) {
+        bool first = ch.num_points == 0 && i == 0;
+        uint32_t previous = i > 0 ? times_us[i - 1] : (ch.num_points > 0 ? ch.points[ch.num_points - 1].time_us : 0);
+        if (!first && times_us[i] <= previous) return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        ch.points[ch.num_points].time_us = times_us[i];
+        ch.points[ch.num_points].voltage = voltages[i];
+        ch.num_points++;
+        if (times_us[i] > ch.duration_us) ch.duration_us = times_us[i];
+    }
+    return true;
+}
+
+// Appends samples interval_us apart, after whatever the channel already
+// holds. The last one holds for an interval, so a loop of samples repeats
+// every count * interval_us.
+bool WaveformPlayer::addSamples(uint8_t channel, uint32_t interval_us, const float* voltages, uint16_t count)
+{
+    if (channel >= 16 || interval_us == 0 || count == 0 || count > MAX_POINTS) return false;
+    if (getPlayingMask() & (1U << channel)) return false;
+    waitForTick();
+    Channel& ch = channels[channel];
+
+    uint32_t times_us[MAX_POINTS];
+    uint32_t time_us = ch.num_points > 0 ? ch.points[ch.num_points - 1].time_us + interval_us : 0;
+    for (uint16_t i = 0; i < count; i++) {
+        times_us[i] = time_us;
+        time_us += interval_us;
+    }
+    if (!addPoints(channel, times_us, voltages, count)) return false;
+    ch.duration_us = time_us;
+    return true;
+}
+
+uint16_t WaveformPlayer::getPointCount(uint8_t channel) const
+{
+    return channel < 16 ? channels[channel].num_points : 0;
+}
+
+uint32_t WaveformPlayer::getDuration(uint8_t channel) const
+{
+    return channel < 16 ? channels[channel].duration_us : 0;
+}
+
+// False if a channel in the mask has no points or is already playing
+bool WaveformPlayer::start(uint16_t channel_mask, bool loop, uint32_t delay_us)
+{
+    if (!channel_mask || (getPlayingMask() & channel_mask)) return false;
+    for (uint8_t i = 0; i < 16; i++) {
+        if ((channel_mask & (1U << i)) && channels[i].num_points == 0) return false;
+    }
+
+    for (uint8_t i = 0; i < 16; i++) {
+        if (!(channel_mask & (1U << i))) continue;
+        channels[i].loop = loop && channels[i].duration_us > 0;
+        channels[i].start_delay_us = delay_us;
+        channels[i].last_voltage = NAN;
+    }
+    starting.fetch_or(channel_mask, std::memory_order_release);
+    return true;
+}
+
+// Stopped channels keep the last value they were given. A tick that saw them
+// still playing may be about to set one, so wait it out, as
+// TemperatureRamp::stop() does.
+void WaveformPlayer::stop(uint16_t channel_mask)
+{
+    starting.fetch_and(~channel_mask);
+    playing.fetch_and(~channel_mask);
+    waitForTick();
+    // That tick may also have moved them from starting to playing
+    playing.fetch_and(~channel_mask);
+}
+
+// Sequentially consistent with the store at the start of tick(): either this
+// sees the tick running, or the tick sees what was changed before the call
+void WaveformPlayer::waitForTick() const
+{
+    while (ticking.load()) {
+    }
+}
+
+void WaveformPlayer::resetCounts()
+{
+    late.store(0);
+    underruns.store(0);
+}
+
+void WaveformPlayer::tick(uint32_t now)
+{
+    ticking.store(true);
+    uint32_t elapsed = ticked ? now - last_tick : 0;
+    last_tick = now;
+    ticked = true;
+    clock_us += elapsed;
+
+    uint16_t active = playing.load();
+    if (active && elapsed > TICK_US + TICK_US / 2) {
+        late.fetch_add((elapsed - TICK_US / 2) / TICK_US);
+    }
+
+    // Everything started together gets the same start time
+    uint16_t started = starting.exchange(0);
+    for (uint8_t i = 0; i < 16; i++) {
+        if (started & (1U << i)) channels[i].start_us = clock_us + channels[i].start_delay_us;
+    }
+    if (started) active = playing.fetch_or(started) | started;
+
+    for (uint8_t i = 0; i < 16; i++) {
+        if (!(active & (1U << i))) continue;
+        Channel& ch = channels[i];
+        if (clock_us < ch.start_us) continue;
+
+        uint64_t position = clock_us - ch.start_us;
+        if (position >= ch.duration_us) {
+            if (ch.loop) {
+                position %= ch.duration_us;
+            } else {
+                position = ch.duration_us;
+                playing.fetch_and(~(1U << i), std::memory_order_acq_rel);
+            }
+        }
+
+        float voltage = valueAt(ch, (uint32_t)position);
+        if (voltage == ch.last_voltage) continue;
+        if (workerFor(i).isTargetPending(i % 8)) underruns.fetch_add(1);
+        setVoltageTarget(i, voltage);
+        ch.last_voltage = voltage;
+    }
+    ticking.store(false, std::memory_order_release);
+}
+
+float WaveformPlayer::valueAt(const Channel& channel, uint32_t position_us) const
+{
+    const Point* points = channel.points;
+    uint16_t count = channel.num_points;
+    if (position_us <= points[0].time_us) return points[0].voltage;
+    if (position_us >= points[count - 1].time_us) return points[count - 1].voltage;
+
+    // Last point at or before the position
+    uint16_t low = 0;
+    uint16_t high = count - 1;
+    while (high - low > 1) {
+        uint16_t mid = (low + high) / 2;
+        if (points[mid].time_us <= position_us) low = mid;
+        else high = mid;
+    }
+    const Point& a = points[low];
+    const Point& b = points[high];
+    return a.voltage + (b.voltage - a.voltage) * (float)(position_us - a.time_us) / (float)(b.time_us - a.time_us);
+}
@@ -0,0 +1,88 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Plays uploaded voltage profiles on the cells without the host in the loop.
+//
+// Each channel holds up to MAX_POINTS (time, voltage) points and the output
+// moves linearly from one to the next. Sample arrays are stored the same way,
+// one point per sample. tick() runs from a hardware timer every TICK_US and
+// hands the value for that instant to the cell's bus worker, which writes it
+// with Cell::setVoltage() on its next pass.
+//
+// Two counters show when playback fell short of its timing:
+//   - late: timer ticks that came more than half a period after they were due
+//     counted once per period missed
+//   - underruns: new values handed to a bus worker that had not yet written
+//     the previous one, so that value never reached the cell
+//
+// Points may only be changed on channels that are not playing. stop() and the
+// upload calls wait out a tick in flight, so once they return no tick reads the
+// channel's points or sets its target.
+class WaveformPlayer
+{
+public:
+    static const uint16_t MAX_POINTS = 256;
+    static const uint32_t TICK_US = 1000;
+
+    // Upload, from the command task
+    void clear(uint16_t channel_mask);
+    bool addPoints(uint8_t channel, const uint32_t* times_us, const float* voltages, uint16_t count);
+    bool addSamples(uint8_t channel, uint32_t interval_us, const float* voltages, uint16_t count);
+    uint16_t getPointCount(uint8_t channel) const;
+    uint32_t getDuration(uint8_t channel) const;
+
+    // Playback. Every channel in the mask of one start() begins at the same
+    // tick, delay_us after the next one.
+    bool start(uint16_t channel_mask, bool loop, uint32_t delay_us);
+    void stop(uint16_t channel_mask);
+    uint16_t getPlayingMask() const { return playing.load(std::memory_order_acquire) | starting.load(std::memory_order_acquire); }
+    uint32_t getLateCount() const { return late.load(); }
+    uint32_t getUnderrunCount() const { return underruns.load(); }
+    void resetCounts();
+
+    // Runs on the timer
+    void tick(uint32_t now);
+
+private:
+    struct Point
+    {
+        uint32_t time_us;
+        float voltage;
+    };
+
+    struct Channel
+    {
+        Point points[MAX_POINTS];
+        uint16_t num_points;
+        // Loops wrap here; the last point holds until then
+        uint32_t duration_us;
+        uint64_t start_us;
+        uint32_t start_delay_us;
+        bool loop;
+        float last_voltage;
+    };
+
+    float valueAt(const Channel& channel, uint32_t position_us) const;
+    void waitForTick() const;
+
+    Channel channels[16];
+    // start() marks channels as starting, the next tick gives them all the
+    // same start time and moves them to playing
+    std::atomic<uint16_t> starting{0};
+    std::atomic<uint16_t> playing{0};
+    // Set while tick() runs
+    std::atomic<bool> ticking{false};
+
+    // Time since the first tick, immune to micros() wrapping
+    uint64_t clock_us = 0;
+    uint32_t last_tick = 0;
+    bool ticked = false;
+
+    std::atomic<uint32_t> late{0};
+    std::atomic<uint32_t> underruns{0};
+};
+
+#endif // WAVEFORM_H
@@ -0,0 +1,675 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include <sim_adbms6948.h>
+#include <adi_bms_platform.h>
+#include "Adbms6948.h"
+#include "Adbms6948_Common.h"
+#include "Adbms6948_ExecCmd.h"
+#include "Adbms6948_Pec.h"
+
+// The vendor ADBMS6948 driver on the host, through adi_bms_platform against
+// the emulated chain. Each test starts from a fresh Adbms6948_Init.
+
+static const uint8_t CHAIN = 0;
+
+static SimADBMS6948Chain chain(1);
+static SimADBMS6948& device = chain.device(0);
+
+static void sendRaw(uint16_t command)
+{
+    uint8_t frame[4] = {(uint8_t)(command >> 8), (uint8_t)command};
+    uint16_t pec = SimADBMS6948Chain::pec15(frame, 2);
+    frame[2] = pec >> 8;
+    frame[3] = pec & 0xFF;
+    ADI_PAL_SPIWRITE(frame, sizeof(frame), CHAIN);
+}
+
+static Adbms6948_ReturnType triggerCells(uint8_t chain_id = CHAIN)
+{
+    Adbms6948_TrigCADCInputs inputs = {};
+    inputs.Adbms6948_eOWSel = ADBMS6948_CELL_OW_NONE;
+    return Adbms6948_TrigCADC(&inputs, chain_id);
+}
+
+// A failed poll reads as busy
+static bool isBusy(Adbms6948_ADCSelType adc, uint8_t chain_id = CHAIN)
+{
+    boolean busy = FALSE;
+    return Adbms6948_PollADCStatus(adc, &busy, chain_id) != E_OK || busy;
+}
+
+// Up to ADBMS6948_NO_OF_DAISY_CHAIN emulated chains of the same length, in
+// place of the single device chain while a test runs
+static SimADBMS6948Chain* long_chains[ADBMS6948_NO_OF_DAISY_CHAIN];
+static Adbms6948_DaisyChainCfgType long_chain_cfgs[ADBMS6948_NO_OF_DAISY_CHAIN];
+static uint8_t long_chain_cells[ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+static Adbms6948_CfgType long_chain_set;
+
+static double longChainVolts(uint8_t chain_id, uint8_t device_index, uint8_t cell)
+{
+    return 2.5 + 0.005 * chain_id + 0.02 * device_index + 0.05 * cell;
+}
+
+static Adbms6948_ReturnType initLongChains(uint8_t chains, uint8_t devices)
+{
+    Adbms6948_DeInit();
+    memset(long_chain_cells, SimADBMS6948::NUM_CELLS, sizeof(long_chain_cells));
+    for (uint8_t c = 0; c < chains; c++) {
+        long_chains[c] = new SimADBMS6948Chain(devices);
+        for (uint8_t d = 0; d < devices; d++) {
+            for (uint8_t i = 0; i < SimADBMS6948::NUM_CELLS; i++) {
+                long_chains[c]->device(d).setCellVoltage(i, longChainVolts(c, d, i));
+            }
+        }
+        adiPalAttach(c, long_chains[c]);
+        long_chain_cfgs[c] = Adbms6948ConfigSet_0_PB.Adbms6948_pDaisyChainCfg[0];
+        long_chain_cfgs[c].Adbms6948_nNoOfDevices = devices;
+        long_chain_cfgs[c].Adbms6948_pNoOfCellsPerDevice = long_chain_cells;
+    }
+    long_chain_set = Adbms6948ConfigSet_0_PB;
+    long_chain_set.Adbms6948_nNoOfChains = chains;
+    long_chain_set.Adbms6948_pDaisyChainCfg = long_chain_cfgs;
+    Adbms6948_ReturnType result = Adbms6948_Init(&long_chain_set);
+    adiPalResetStats();
+    return result;
+}
+
+static void releaseLongChains()
+{
+    if (Adbms6948_eState == ADBMS6948_ST_INIT) Adbms6948_DeInit();
+    for (uint8_t c = 0; c < ADBMS6948_NO_OF_DAISY_CHAIN; c++) {
+        delete long_chains[c];
+        long_chains[c] = nullptr;
+        adiPalAttach(c, nullptr);
+    }
+    adiPalAttach(CHAIN, &chain);
+}
+
+// The cells of the chain's devices, as ReadCellVolt lays them out: every
+// cell of each device in turn
+static double readCode(const int16_t* codes, uint8_t device_index, uint8_t cell)
+{
+    return SimADBMS6948::toVolts(codes[device_index * 16 + cell]);
+}
+
+struct CycleResult
+{
+    uint32_t failures;
+    uint64_t sim_us;
+};
+
+// Trigger, poll and read all cells of one chain, on the calling thread with
+// its own simulated clock starting at start_us
+static void runCycles(uint8_t chain_id, uint32_t runs, uint64_t start_us, CycleResult* result)
+{
+    static int16_t codes[ADBMS6948_NO_OF_DAISY_CHAIN][SimADBMS6948::NUM_CELLS * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    Sim::advance(start_us - Sim::now());
+    result->failures = 0;
+    for (uint32_t n = 0; n < runs; n++) {
+        if (triggerCells(chain_id) != E_OK) result->failures++;
+        while (isBusy(ADBMS6948_ADC_CADC, chain_id)) {
+        }
+        if (Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes[chain_id],
+                                   ADBMS6948_SEND_NONE, chain_id) != E_OK) {
+            result->failures++;
+        }
+    }
+    result->sim_us = Sim::now() - start_us;
+}
+
+void setUp(void)
+{
+    if (Adbms6948_eState == ADBMS6948_ST_INIT) Adbms6948_DeInit();
+    for (uint8_t i = 0; i < SimADBMS6948::NUM_CELLS; i++) device.setCellVoltage(i, 3.0 + 0.05 * i);
+    adiPalSetSpiClock(1000000);
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_Init(&Adbms6948ConfigSet_0_PB));
+    Adbms6948_ClearErrorCounts(CHAIN);
+    chain.resetStats();
+    adiPalResetStats();
+}
+
+void tearDown(void)
+{
+    // A failed assertion returns before the test releases its chains
+    releaseLongChains();
+    adiPalSetQueueing(true);
+}
+
+void test_pec_matches_driver(void)
+{
+    uint8_t data[66];
+    srand(6948);
+    for (uint8_t length = 1; length <= 64; length++) {
+        for (uint8_t i = 0; i < length; i++) data[i] = rand();
+        uint8_t counter = rand() & 0x3F;
+        data[length] = counter << 2;
+        TEST_ASSERT_EQUAL_HEX16(SimADBMS6948Chain::pec15(data, length), Adbms6948_Pec15Calculate(data, length));
+        TEST_ASSERT_EQUAL_HEX16(SimADBMS6948Chain::pec10(data, length, 0), Adbms6948_Pec10Calculate(data, FALSE, length));
+        TEST_ASSERT_EQUAL_HEX16(SimADBMS6948Chain::pec10(data, length, counter), Adbms6948_Pec10Calculate(data, TRUE, length));
+    }
+}
+
+static const char* const ENGINE_NAMES[] = {"table", "slice-by-4", "clmul"};
+
+void test_pec_engines_match_table(void)
+{
+    // Init timed every engine that passed its self-check and picked the fastest
+    Adbms6948_PecEngineType picked = Adbms6948_PecGetEngine();
+    TEST_ASSERT_TRUE(Adbms6948_PecIsEngineAvailable(picked));
+    for (int engine = 0; engine < ADBMS6948_PEC_ENGINE_INVALID; engine++) {
+        uint32_t ns = Adbms6948_PecGetEngineTime((Adbms6948_PecEngineType)engine);
+        if (!Adbms6948_PecIsEngineAvailable((Adbms6948_PecEngineType)engine)) {
+            TEST_ASSERT_EQUAL(0, ns);
+            continue;
+        }
+        TEST_ASSERT_TRUE(ns > 0);
+        TEST_ASSERT_TRUE(Adbms6948_PecGetEngineTime(picked) <= ns);
+    }
+    TEST_ASSERT_TRUE(Adbms6948_PecIsEngineAvailable(ADBMS6948_PEC_ENGINE_SLICE4));
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_PecSelectEngine(ADBMS6948_PEC_ENGINE_INVALID));
+
+    uint8_t data[131];
+    srand(22);
+    for (int engine = 0; engine < ADBMS6948_PEC_ENGINE_INVALID; engine++) {
+        if (Adbms6948_PecSelectEngine((Adbms6948_PecEngineType)engine) != E_OK) continue;
+        for (uint8_t length = 0; length <= 130; length++) {
+            for (uint8_t i = 0; i <= length; i++) data[i] = rand();
+            uint8_t counter = data[length] >> 2;
+            TEST_ASSERT_EQUAL_HEX16(SimADBMS6948Chain::pec15(data, length), Adbms6948_Pec15Calculate(data, length));
+            TEST_ASSERT_EQUAL_HEX16(SimADBMS6948Chain::pec10(data, length, counter), Adbms6948_Pec10Calculate(data, TRUE, length));
+        }
+    }
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_PecSelectEngine(picked));
+}
+
+void test_init_configures_device(void)
+{
+    TEST_ASSERT_FALSE(chain.isAsleep());
+    // REFON, and the counters agree after the reset and the writes
+    TEST_ASSERT_TRUE(device.getGroup(SimADBMS6948::CFGA)[0] & 0x80);
+    TEST_ASSERT_EQUAL_UINT8(Adbms6948_aoChainStateInfo[CHAIN].nCmdCnt[0], device.getCommandCounter());
+    TEST_ASSERT_EQUAL_UINT32(0, device.getDataPecErrors());
+}
+
+void test_poll_waits_for_conversion(void)
+{
+    TEST_ASSERT_EQUAL(E_OK, triggerCells());
+    TEST_ASSERT_TRUE(isBusy(ADBMS6948_ADC_CADC));
+    delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+    TEST_ASSERT_FALSE(isBusy(ADBMS6948_ADC_CADC));
+    TEST_ASSERT_EQUAL_UINT32(1, device.getCADCConversions());
+}
+
+void test_read_cell_voltages(void)
+{
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    TEST_ASSERT_EQUAL(E_OK, triggerCells());
+    delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes,
+                                                   ADBMS6948_SEND_NONE, CHAIN));
+    for (uint8_t i = 0; i < SimADBMS6948::NUM_CELLS; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.0002, 3.0 + 0.05 * i, SimADBMS6948::toVolts(codes[i]));
+    }
+
+    // The read clears the results behind it
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C4C5C6, codes,
+                                                   ADBMS6948_SEND_NONE, CHAIN));
+    TEST_ASSERT_EQUAL_INT16(-32768, codes[0]);
+}
+
+void test_read_cell_voltages_snapped(void)
+{
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    TEST_ASSERT_EQUAL(E_OK, triggerCells());
+    delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes,
+                                                   ADBMS6948_SEND_BOTH, CHAIN));
+    TEST_ASSERT_FLOAT_WITHIN(0.0002, 3.75, SimADBMS6948::toVolts(codes[15]));
+}
+
+void test_read_gpio_voltages(void)
+{
+    int16_t codes[SimADBMS6948::NUM_GPIOS];
+    device.setGpioVoltage(0, 1.25);
+    device.setGpioVoltage(10, 2.5);
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_TrigAuxADC(FALSE, FALSE, ADBMS6948_AUX_CH_ALL, CHAIN));
+    TEST_ASSERT_TRUE(isBusy(ADBMS6948_ADC_AUX));
+    delay(10);
+    TEST_ASSERT_FALSE(isBusy(ADBMS6948_ADC_AUX));
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadGPIOInputVolt(ADBMS6948_GPIO_MEAS_DATA, ADBMS6948_GPIO_GRP_ALL, codes, CHAIN));
+    TEST_ASSERT_FLOAT_WITHIN(0.0002, 1.25, SimADBMS6948::toVolts(codes[0]));
+    TEST_ASSERT_FLOAT_WITHIN(0.0002, 2.5, SimADBMS6948::toVolts(codes[10]));
+}
+
+void test_corrupt_read_counts_pec_error(void)
+{
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    Adbms6948_ErrorCounts errors;
+    chain.corruptReads(0, 1);
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C1C2C3, codes,
+                                                       ADBMS6948_SEND_NONE, CHAIN));
+    Adbms6948_ReadErrorCounts(&errors, CHAIN);
+    TEST_ASSERT_EQUAL_UINT32(1, errors.Adbms6948_nPECErrs);
+
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C1C2C3, codes,
+                                                   ADBMS6948_SEND_NONE, CHAIN));
+}
+
+void test_unexpected_command_counts_cc_error(void)
+{
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    Adbms6948_ErrorCounts errors;
+    // A command the driver didn't send moves the device's counter on
+    sendRaw(0x02D);
+    sendRaw(0x02F);
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C1C2C3, codes,
+                                                       ADBMS6948_SEND_NONE, CHAIN));
+    Adbms6948_ReadErrorCounts(&errors, CHAIN);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, errors.Adbms6948_nCmdCntErrs);
+
+    // and the driver takes the new count
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C1C2C3, codes,
+                                                   ADBMS6948_SEND_NONE, CHAIN));
+}
+
+void test_bad_command_pec_ignored(void)
+{
+    uint8_t before = device.getCommandCounter();
+    uint8_t frame[4] = {0x00, 0x2D, 0x00, 0x00};
+    ADI_PAL_SPIWRITE(frame, sizeof(frame), CHAIN);
+    TEST_ASSERT_EQUAL_UINT32(1, chain.getStats().command_pec_errors);
+    TEST_ASSERT_EQUAL_UINT8(before, device.getCommandCounter());
+
+    // Unknown commands are dropped without counting
+    sendRaw(0x7FF);
+    TEST_ASSERT_EQUAL_UINT32(1, chain.getStats().ignored);
+    TEST_ASSERT_EQUAL_UINT8(before, device.getCommandCounter());
+}
+
+void test_daisy_chain_order(void)
+{
+    SimADBMS6948Chain three(3);
+    uint8_t tx[4 + 3 * 8];
+    uint8_t rx[sizeof(tx)];
+    uint8_t wake = 0xFF;
+    three.transfer(&wake, rx, 1, 8000);
+    delayMicroseconds(SimADBMS6948Chain::WAKE_US);
+
+    // WRPWMA, the first group goes to the last device
+    tx[0] = 0x00;
+    tx[1] = 0x20;
+    uint16_t pec = SimADBMS6948Chain::pec15(tx, 2);
+    tx[2] = pec >> 8;
+    tx[3] = pec & 0xFF;
+    for (uint8_t k = 0; k < 3; k++) {
+        uint8_t* group = tx + 4 + 8 * k;
+        memset(group, 0x10 * (k + 1), SimADBMS6948::GROUP_BYTES);
+        pec = SimADBMS6948Chain::pec10(group, SimADBMS6948::GROUP_BYTES, 0);
+        group[6] = pec >> 8;
+        group[7] = pec & 0xFF;
+    }
+    three.transfer(tx, rx, sizeof(tx), 8000);
+    TEST_ASSERT_EQUAL_HEX8(0x30, three.device(0).getGroup(SimADBMS6948::PWMA)[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x10, three.device(2).getGroup(SimADBMS6948::PWMA)[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, three.device(1).getCommandCounter());
+
+    // RDPWMA, the first device's reply comes first
+    tx[1] = 0x22;
+    pec = SimADBMS6948Chain::pec15(tx, 2);
+    tx[2] = pec >> 8;
+    tx[3] = pec & 0xFF;
+    memset(tx + 4, 0xFF, sizeof(tx) - 4);
+    three.transfer(tx, rx, sizeof(tx), 8000);
+    for (uint8_t k = 0; k < 3; k++) {
+        uint8_t* group = rx + 4 + 8 * k;
+        TEST_ASSERT_EQUAL_HEX8(0x30 - 0x10 * k, group[0]);
+        TEST_ASSERT_EQUAL_UINT8(1, group[6] >> 2);
+        pec = SimADBMS6948Chain::pec10(group, SimADBMS6948::GROUP_BYTES, 1);
+        TEST_ASSERT_EQUAL_HEX16(pec, ((group[6] & 0x03) << 8) | group[7]);
+    }
+}
+
+void test_chain_sleeps_when_idle(void)
+{
+    delayMicroseconds(SimADBMS6948Chain::SLEEP_TIMEOUT_US);
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    // The first frames only wake the chain, and the registers are gone
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_C1C2C3, codes,
+                                                       ADBMS6948_SEND_NONE, CHAIN));
+    TEST_ASSERT_GREATER_OR_EQUAL(1, chain.getStats().ignored);
+    TEST_ASSERT_FALSE(device.getGroup(SimADBMS6948::CFGA)[0] & 0x80);
+}
+
+void test_long_chains_read_all_cells(void)
+{
+    const uint8_t chains = ADBMS6948_NO_OF_DAISY_CHAIN;
+    const uint8_t devices = ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN;
+    static int16_t codes[SimADBMS6948::NUM_CELLS * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    TEST_ASSERT_EQUAL(E_OK, initLongChains(chains, devices));
+    for (uint8_t c = 0; c < chains; c++) {
+        TEST_ASSERT_EQUAL(E_OK, triggerCells(c));
+        delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+        TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes,
+                                                       ADBMS6948_SEND_BOTH, c));
+        for (uint8_t d = 0; d < devices; d++) {
+            for (uint8_t i = 0; i < SimADBMS6948::NUM_CELLS; i++) {
+                TEST_ASSERT_FLOAT_WITHIN(0.0002, longChainVolts(c, d, i), readCode(codes, d, i));
+            }
+        }
+        // Every frame went back to the chain's arena
+        TEST_ASSERT_EQUAL_UINT8(0, Adbms6948_aoChainStateInfo[c].nArenaTop);
+    }
+    // Only the configured chains take calls
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_DeInit());
+    long_chain_set.Adbms6948_nNoOfChains = 2;
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_Init(&long_chain_set));
+    TEST_ASSERT_EQUAL(E_NOT_OK, triggerCells(2));
+    Adbms6948_DeInit();
+    long_chain_set.Adbms6948_nNoOfChains = ADBMS6948_NO_OF_DAISY_CHAIN + 1;
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_Init(&long_chain_set));
+    releaseLongChains();
+}
+
+void test_queued_read_all_matches_separate(void)
+{
+    // SNAP, the read, UNSNAP, the clear and the command count check go out as
+    // one transfer, or as separate transactions on a platform without
+    // one. Same frames and the same cells, less time on the bus.
+    const uint8_t devices = ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN < 8 ? ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN : 8;
+    static int16_t codes[2][SimADBMS6948::NUM_CELLS * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    AdiPalStats stats[2];
+    TEST_ASSERT_EQUAL(E_OK, initLongChains(1, devices));
+    for (uint8_t queued = 0; queued < 2; queued++) {
+        // The read clears the registers behind it
+        TEST_ASSERT_EQUAL(E_OK, triggerCells(0));
+        delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+        adiPalSetQueueing(queued);
+        adiPalResetStats();
+        TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL,
+                                                       codes[queued], ADBMS6948_SEND_BOTH, 0));
+        stats[queued] = adiPalGetChainStats(0);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(codes[0], codes[1], sizeof(int16_t) * SimADBMS6948::NUM_CELLS * devices);
+    TEST_ASSERT_EQUAL_UINT32(5, stats[1].transactions);
+    TEST_ASSERT_EQUAL_UINT32(stats[0].bytes, stats[1].bytes);
+    TEST_ASSERT_TRUE(stats[1].bus_time_us < stats[0].bus_time_us);
+
+    // A device whose data is corrupt fails the read; the others still decode
+    Adbms6948_ErrorCounts errors[ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    Adbms6948_ClearErrorCounts(0);
+    TEST_ASSERT_EQUAL(E_OK, triggerCells(0));
+    delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+    long_chains[0]->corruptReads(devices / 2, 1);
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL,
+                                                       codes[1], ADBMS6948_SEND_BOTH, 0));
+    Adbms6948_ReadErrorCounts(errors, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, errors[devices / 2].Adbms6948_nPECErrs);
+    TEST_ASSERT_FLOAT_WITHIN(0.0002, longChainVolts(0, devices - 1, 15), readCode(codes[1], devices - 1, 15));
+    TEST_ASSERT_EQUAL_UINT8(0, Adbms6948_aoChainStateInfo[0].nArenaTop);
+    releaseLongChains();
+}
+
+struct SegLog
+{
+    uint8_t count;
+    uint8_t index[ADBMS6948_MAX_SPI_SEGS];
+    const uint8_t* rx[ADBMS6948_MAX_SPI_SEGS];
+    std::thread::id thread;
+};
+
+static void logSeg(void* arg, const Adbms6948_SpiSegType* seg, uint8_t index)
+{
+    SegLog* log = (SegLog*)arg;
+    log->index[log->count] = index;
+    log->rx[log->count] = seg->pRxBuf;
+    log->count++;
+    log->thread = std::this_thread::get_id();
+}
+
+void test_transfer_notifies_segments_in_place(void)
+{
+    // A register read with a segment per device: each device's reply lands in
+    // its own buffer, and the PAL says so from its own thread as it comes in
+    const uint8_t devices = ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN < 4 ? ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN : 4;
+    uint8_t rx[4][ADBMS6948_REG_DATA_LEN_WITH_PEC];
+    SegLog log = {};
+    TEST_ASSERT_EQUAL(E_OK, initLongChains(1, devices));
+    Adbms6948_Cmd_BeginXfer(0);
+    Adbms6948_Cmd_AddCmd(ADBMS6948_CMD_RDCFGA, FALSE, FALSE, 0);
+    for (uint8_t d = 0; d < devices; d++) {
+        uint8_t flags = ADBMS6948_SPI_SEG_NOTIFY | (d + 1 == devices ? ADBMS6948_SPI_SEG_CS_RELEASE : 0);
+        TEST_ASSERT_EQUAL_UINT8(d + 1, Adbms6948_Cmd_AddSeg(NULL_PTR, rx[d], sizeof(rx[d]), flags, 0));
+    }
+    Adbms6948_Cmd_SubmitXfer(logSeg, &log, 0);
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_Cmd_WaitXfer(0));
+    TEST_ASSERT_FALSE(Adbms6948_aoChainStateInfo[0].oXfer.bBusy);
+    TEST_ASSERT_EQUAL_UINT8(devices, log.count);
+    TEST_ASSERT_TRUE(log.thread != std::this_thread::get_id());
+    for (uint8_t d = 0; d < devices; d++) {
+        TEST_ASSERT_EQUAL_UINT8(d + 1, log.index[d]);
+        TEST_ASSERT_TRUE(log.rx[d] == rx[d]);
+        TEST_ASSERT_TRUE(Adbms6948_Cmn_ValidatePEC(rx[d], sizeof(rx[d]), d, 0));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, adiPalGetChainStats(0).transactions);
+
+    // A transfer with more segments than fit is not sent at all
+    adiPalResetStats();
+    Adbms6948_Cmd_BeginXfer(0);
+    for (uint8_t i = 0; i <= ADBMS6948_MAX_SPI_SEGS; i++) Adbms6948_Cmd_AddSeg(NULL_PTR, NULL_PTR, 1, 0, 0);
+    Adbms6948_Cmd_SubmitXfer(NULL_PTR, NULL_PTR, 0);
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_Cmd_WaitXfer(0));
+    TEST_ASSERT_EQUAL_UINT32(0, adiPalGetChainStats(0).transactions);
+    releaseLongChains();
+}
+
+struct DecodeLog
+{
+    const int16_t* codes;
+    uint8_t devices;
+    // Commands are notified too
+    uint8_t count;
+    uint8_t decoded[ADBMS6948_MAX_SPI_SEGS];
+    uint64_t at_us[ADBMS6948_MAX_SPI_SEGS];
+};
+
+static const int16_t NOT_DECODED = 0x7FFF;
+
+// After the driver took a segment: how many devices it has decoded so far,
+// and when on the chain's clock
+static void logDecode(uint8_t chain_id, uint8_t seg_idx, void* arg)
+{
+    DecodeLog* log = (DecodeLog*)arg;
+    uint8_t decoded = 0;
+    while (decoded < log->devices && log->codes[decoded * SimADBMS6948::NUM_CELLS] != NOT_DECODED) decoded++;
+    log->decoded[log->count] = decoded;
+    log->at_us[log->count] = Sim::now();
+    log->count++;
+}
+
+void test_read_all_decodes_devices_mid_frame(void)
+{
+    // Each device of a read of all cells is decoded as soon as its data is
+    // in, while the devices after it are still on the wire
+    const uint8_t devices = ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN < 8 ? ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN : 8;
+    static int16_t codes[SimADBMS6948::NUM_CELLS * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    DecodeLog log = {codes, devices};
+    TEST_ASSERT_EQUAL(E_OK, initLongChains(1, devices));
+    TEST_ASSERT_EQUAL(E_OK, triggerCells(0));
+    delayMicroseconds(SimADBMS6948::CADC_CONVERSION_US);
+    for (int16_t& code : codes) code = NOT_DECODED;
+    adiPalSetSegmentHook(logDecode, &log);
+    Adbms6948_ReturnType result = Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL,
+                                                         codes, ADBMS6948_SEND_BOTH, 0);
+    adiPalSetSegmentHook(nullptr, nullptr);
+    TEST_ASSERT_EQUAL(E_OK, result);
+
+    // One more device per notification of the read, each at a later time on
+    // the wire than the one before; the frame ends with the last device's data
+    uint64_t decoded_at[ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    uint8_t decoded = 0;
+    for (uint8_t i = 0; i < log.count; i++) {
+        TEST_ASSERT_TRUE(log.decoded[i] == decoded || log.decoded[i] == decoded + 1);
+        if (log.decoded[i] > decoded) decoded_at[decoded++] = log.at_us[i];
+    }
+    TEST_ASSERT_EQUAL_UINT8(devices, decoded);
+    for (uint8_t d = 0; d + 1 < devices; d++) TEST_ASSERT_TRUE(decoded_at[d] < decoded_at[d + 1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0002, longChainVolts(0, devices - 1, 15), readCode(codes, devices - 1, 15));
+    releaseLongChains();
+}
+
+void test_benchmark_cell_read(void)
+{
+    // Simulated bus time of the driver's cell reads at 1 MHz, and host CPU
+    // time per call, PAL and emulator included
+    const uint32_t RUNS = 200;
+    int16_t codes[SimADBMS6948::NUM_CELLS];
+    auto started_at = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < RUNS; n++) {
+        TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes,
+                                                       ADBMS6948_SEND_BOTH, CHAIN));
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started_at).count();
+    const AdiPalStats& stats = adiPalGetStats();
+    printf("BENCH ReadCellVolt all, snapped: %.1f frames, %.1f bytes, %.1f us bus time, %.0f ns on the host\n",
+           (double)stats.transactions / RUNS, (double)stats.bytes / RUNS, (double)stats.bus_time_us / RUNS, ns / RUNS);
+
+    adiPalResetStats();
+    uint64_t started_sim = Sim::now();
+    for (uint32_t n = 0; n < RUNS; n++) {
+        TEST_ASSERT_EQUAL(E_OK, triggerCells());
+        while (isBusy(ADBMS6948_ADC_CADC)) {
+        }
+        TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL, codes,
+                                                       ADBMS6948_SEND_NONE, CHAIN));
+    }
+    printf("BENCH CADC trigger, poll and read: %.1f frames, %.1f us bus time, %.1f us per cycle\n",
+           (double)adiPalGetStats().transactions / RUNS, (double)adiPalGetStats().bus_time_us / RUNS,
+           (double)(Sim::now() - started_sim) / RUNS);
+}
+
+void test_benchmark_long_chains(void)
+{
+    // A trigger, poll and read of all cells on chains of 1, 8 and 32 devices,
+    // each chain on its own thread as on its own bus. The cycle is the
+    // slowest chain's simulated time; the host time is wall time with the
+    // chains in parallel.
+    static const uint8_t DEVICES[] = {1, 8, 32};
+    const uint32_t RUNS = 20;
+    for (uint8_t devices : DEVICES) {
+        if (devices > ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN) continue;
+        for (uint8_t chains = 1; chains <= ADBMS6948_NO_OF_DAISY_CHAIN; chains++) {
+            TEST_ASSERT_EQUAL(E_OK, initLongChains(chains, devices));
+            CycleResult results[ADBMS6948_NO_OF_DAISY_CHAIN];
+            std::thread threads[ADBMS6948_NO_OF_DAISY_CHAIN];
+            uint64_t start_us = Sim::now();
+            auto started_at = std::chrono::steady_clock::now();
+            for (uint8_t c = 0; c < chains; c++) threads[c] = std::thread(runCycles, c, RUNS, start_us, &results[c]);
+            uint64_t cycle_us = 0;
+            for (uint8_t c = 0; c < chains; c++) {
+                threads[c].join();
+                TEST_ASSERT_EQUAL_UINT32(0, results[c].failures);
+                if (results[c].sim_us > cycle_us) cycle_us = results[c].sim_us;
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started_at).count();
+            Sim::advance(cycle_us);
+            AdiPalStats stats = adiPalGetChainStats(0);
+            printf("BENCH %2u devices x %u chains: %.1f frames, %.0f bytes, %.0f us bus time per chain, "
+                   "%.0f us per cycle, %.0f us on the host\n",
+                   devices, chains, (double)stats.transactions / RUNS, (double)stats.bytes / RUNS,
+                   (double)stats.bus_time_us / RUNS, (double)cycle_us / RUNS, us / RUNS);
+            releaseLongChains();
+        }
+    }
+}
+
+void test_benchmark_queued_read_all(void)
+{
+    // A snapped read of all cells as one queued transfer against separate
+    // transactions, on a chain of 1, 8 and 32 devices. The bus time saved is
+    // the PAL's model of the chip select gaps between frames.
+    static const uint8_t DEVICES[] = {1, 8, 32};
+    static int16_t codes[SimADBMS6948::NUM_CELLS * ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN];
+    const uint32_t RUNS = 100;
+    for (uint8_t devices : DEVICES) {
+        if (devices > ADBMS6948_MAX_NO_OF_DEVICES_IN_DAISY_CHAIN) continue;
+        TEST_ASSERT_EQUAL(E_OK, initLongChains(1, devices));
+        double bus_us[2];
+        double host_ns[2];
+        for (uint8_t queued = 0; queued < 2; queued++) {
+            adiPalSetQueueing(queued);
+            adiPalResetStats();
+            auto started_at = std::chrono::steady_clock::now();
+            for (uint32_t n = 0; n < RUNS; n++) {
+                TEST_ASSERT_EQUAL(E_OK, Adbms6948_ReadCellVolt(ADBMS6948_CELL_MEAS_DATA, ADBMS6948_CELL_GRP_SEL_ALL,
+                                                               codes, ADBMS6948_SEND_BOTH, 0));
+            }
+            host_ns[queued] =
+                std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started_at).count() / RUNS;
+            bus_us[queued] = (double)adiPalGetChainStats(0).bus_time_us / RUNS;
+        }
+        printf("BENCH queued read all, %2u devices: %.0f us bus time, %.0f us separate, %.0f us saved per cycle (modeled), "
+               "%.0f ns on the host, %.0f ns separate\n",
+               devices, bus_us[1], bus_us[0], bus_us[0] - bus_us[1], host_ns[1], host_ns[0]);
+        releaseLongChains();
+    }
+}
+
+void test_benchmark_pec_engines(void)
+{
+    // Host throughput of each engine on a register group and on a read all
+    // of the aux and status groups
+    static const uint8_t LENGTHS[] = {6, 82};
+    uint8_t data[82];
+    for (uint8_t i = 0; i < sizeof(data); i++) data[i] = i * 37 + 11;
+    Adbms6948_PecEngineType picked = Adbms6948_PecGetEngine();
+
+    for (int engine = 0; engine < ADBMS6948_PEC_ENGINE_INVALID; engine++) {
+        if (Adbms6948_PecSelectEngine((Adbms6948_PecEngineType)engine) != E_OK) continue;
+        for (uint8_t length : LENGTHS) {
+            const uint32_t RUNS = 2000000 / length;
+            uint32_t sum = 0;
+            auto started_at = std::chrono::steady_clock::now();
+            for (uint32_t n = 0; n < RUNS; n++) {
+                data[0] = n;
+                sum += Adbms6948_Pec10Calculate(data, FALSE, length);
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+            printf("BENCH PEC10 %s, %u bytes: %.1f MB/s%s\n", ENGINE_NAMES[engine], length,
+                   RUNS * length / s / 1e6, engine == picked ? " (picked)" : "");
+            TEST_ASSERT_GREATER_THAN(0, sum);
+        }
+        printf("BENCH PEC %s timed by Init: %u ns\n", ENGINE_NAMES[engine],
+               (unsigned)Adbms6948_PecGetEngineTime((Adbms6948_PecEngineType)engine));
+    }
+    TEST_ASSERT_EQUAL(E_OK, Adbms6948_PecSelectEngine(picked));
+}
+
+int main(int argc, char** argv)
+{
+    adiPalAttach(CHAIN, &chain);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_pec_matches_driver);
+    RUN_TEST(test_pec_engines_match_table);
+    RUN_TEST(test_init_configures_device);
+    RUN_TEST(test_poll_waits_for_conversion);
+    RUN_TEST(test_read_cell_voltages);
+    RUN_TEST(test_read_cell_voltages_snapped);
+    RUN_TEST(test_read_gpio_voltages);
+    RUN_TEST(test_corrupt_read_counts_pec_error);
+    RUN_TEST(test_unexpected_command_counts_cc_error);
+    RUN_TEST(test_bad_command_pec_ignored);
+    RUN_TEST(test_daisy_chain_order);
+    RUN_TEST(test_chain_sleeps_when_idle);
+    RUN_TEST(test_long_chains_read_all_cells);
+    RUN_TEST(test_queued_read_all_matches_separate);
+    RUN_TEST(test_transfer_notifies_segments_in_place);
+    RUN_TEST(test_read_all_decodes_devices_mid_frame);
+    RUN_TEST(test_benchmark_cell_read);
+    RUN_TEST(test_benchmark_long_chains);
+    RUN_TEST(test_benchmark_queued_read_all);
+    RUN_TEST(test_benchmark_pec_engines);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <adi_bms_platform.h>
+#include "Adbms6948.h"
+#include "Adbms6948_Types.h"
+
+// The Adbms6948 driver through the ESP32-S3 platform layer in
+// lib/Adbms6948Esp32, on the board with no chain wired up: the SPI hosts, the
+// chain's task and the segment callbacks, and the driver failing cleanly on
+// the reads nobody answers. pio test -e ESP32
+
+static const uint8_t CHAIN = 0;
+// Pins the board leaves free
+static const AdiPalSpiPins CHAIN_PINS = {39, 40, 41, 42};
+static const AdiPalSpiPins ETHERNET_PINS = {12, 11, 13, 10};
+static const uint32_t CLOCK_HZ = 1000 * 1000;
+
+static uint8_t notified[4];
+static uint8_t notified_count;
+
+static void segDone(Adbms6948_SpiXfer* xfer, uint8_t seg)
+{
+    if (notified_count < sizeof(notified)) notified[notified_count] = seg;
+    notified_count++;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_host_owned_by_ethernet_refused(void)
+{
+    // What initEthernet() does to SPI2 before the chains come up
+    spi_bus_config_t bus = {};
+    bus.sclk_io_num = ETHERNET_PINS.sck;
+    bus.mosi_io_num = ETHERNET_PINS.mosi;
+    bus.miso_io_num = ETHERNET_PINS.miso;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    TEST_ASSERT_EQUAL(ESP_OK, spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO));
+    TEST_ASSERT_FALSE(adiPalBeginChain(CHAIN, SPI2_HOST, CHAIN_PINS, CLOCK_HZ));
+}
+
+void test_chain_comes_up_once(void)
+{
+    TEST_ASSERT_TRUE(adiPalBeginChain(CHAIN, SPI3_HOST, CHAIN_PINS, CLOCK_HZ));
+    TEST_ASSERT_FALSE(adiPalBeginChain(CHAIN, SPI3_HOST, CHAIN_PINS, CLOCK_HZ));
+    TEST_ASSERT_FALSE(adiPalBeginChain(ADBMS6948_NO_OF_DAISY_CHAIN, SPI3_HOST, CHAIN_PINS, CLOCK_HZ));
+}
+
+void test_transfer_notifies_segments_in_order(void)
+{
+    // Two frames of a command and a read each, only the reads notified
+    ADI_PAL_DMA_ALIGNED static uint8_t command[4] = {0x00, 0x01, 0x3D, 0x6E};
+    ADI_PAL_DMA_ALIGNED static uint8_t rx[8 + 4];
+    const Adbms6948_SpiSegType segs[] = {
+        {command, rx, 4, 0},
+        {NULL_PTR, &rx[4], 7, ADBMS6948_SPI_SEG_NOTIFY | ADBMS6948_SPI_SEG_CS_RELEASE},
+        {command, NULL_PTR, 4, 0},
+        {NULL_PTR, NULL_PTR, 1, ADBMS6948_SPI_SEG_NOTIFY | ADBMS6948_SPI_SEG_CS_RELEASE},
+    };
+    Adbms6948_SpiXfer xfer = {};
+    xfer.pSegs = segs;
+    xfer.nSegs = sizeof(segs) / sizeof(segs[0]);
+    xfer.pfnSegDone = segDone;
+    xfer.bBusy = TRUE;
+    notified_count = 0;
+    ADI_PAL_SPISUBMIT(&xfer, CHAIN);
+    ADI_PAL_SPIWAIT(&xfer, CHAIN);
+    TEST_ASSERT_FALSE(xfer.bBusy);
+    TEST_ASSERT_FALSE(xfer.bError);
+    TEST_ASSERT_EQUAL(2, notified_count);
+    TEST_ASSERT_EQUAL(1, notified[0]);
+    TEST_ASSERT_EQUAL(3, notified[1]);
+    TEST_ASSERT_FALSE(ADI_PAL_ISERROR(CHAIN));
+}
+
+void test_init_without_devices_fails(void)
+{
+    // Nobody answers, so the reads back of the configuration fail their PEC
+    TEST_ASSERT_EQUAL(E_NOT_OK, Adbms6948_Init(&Adbms6948ConfigSet_0_PB));
+}
+
+void setup()
+{
+    // Time for the host to open the port after the reset
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_host_owned_by_ethernet_refused);
+    RUN_TEST(test_chain_comes_up_once);
+    RUN_TEST(test_transfer_notifies_segments_in_order);
+    RUN_TEST(test_init_without_devices_fails);
+    UNITY_END();
+}
+
+void loop()
+{
+}
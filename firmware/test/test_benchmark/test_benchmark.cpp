@@ -0,0 +1,247 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <Preferences.h>
+#include <unity.h>
+#include <sim_devices.h>
+#include <string>
+#include <chrono>
+#include "board.h"
+#include "commands.h"
+
+// I2C cost of the host commands and of the bus tasks, measured on the
+// simulated board. Each case prints one BENCH line with the transactions,
+// bytes and bus time it took on both buses together; run with -v to see them.
+//   pio test -e native -f test_benchmark -v
+
+static SimBoard board;
+
+// Discards a command's reply
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t c) override { return 1; }
+};
+
+struct BusCost
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t nacks;
+    uint64_t bus_time_us;
+};
+
+// One pass of both bus tasks
+static void runBusTasks()
+{
+    bus1.service();
+    bus2.service();
+}
+
+static void resetStats()
+{
+    Wire.resetStats();
+    Wire1.resetStats();
+}
+
+static BusCost readStats()
+{
+    BusCost cost;
+    cost.transactions = Wire.getStats().transactions + Wire1.getStats().transactions;
+    cost.bytes = Wire.getStats().bytes + Wire1.getStats().bytes;
+    cost.nacks = Wire.getStats().nacks + Wire1.getStats().nacks;
+    cost.bus_time_us = Wire.getStats().bus_time_us + Wire1.getStats().bus_time_us;
+    return cost;
+}
+
+static void report(const char* name, const BusCost& cost, uint32_t runs)
+{
+    printf("BENCH %s: %.1f transactions, %.1f bytes, %.1f us bus time\n", name,
+           (double)cost.transactions / runs, (double)cost.bytes / runs, (double)cost.bus_time_us / runs);
+}
+
+static void command(const char* line)
+{
+    NullPrint out;
+    handleCommand(String(line), out);
+}
+
+void setUp(void)
+{
+    // Let acquisition fill the cache so GETALLV starts warm
+    delay(500);
+}
+
+void tearDown(void)
+{
+}
+
+void test_getallv(void)
+{
+    const uint32_t RUNS = 100;
+    resetStats();
+    for (uint32_t i = 0; i < RUNS; i++) command("GETALLV");
+    BusCost cost = readStats();
+    report("GETALLV", cost, RUNS);
+    // Served from the acquisition cache
+    TEST_ASSERT_EQUAL_UINT32(0, cost.transactions);
+}
+
+void test_getallv_blocking(void)
+{
+    // What GETALLV costs until acquisition has a sample for every cell. The
+    // bus tasks are held off so only the reads themselves are counted.
+    Sim::setYieldHook(nullptr);
+    resetStats();
+    for (int i = 0; i < 16; i++) cells[i].getVoltage();
+    BusCost cost = readStats();
+    Sim::setYieldHook(runBusTasks);
+
+    report("GETALLV blocking", cost, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, cost.nacks);
+    TEST_ASSERT_GREATER_OR_EQUAL(16 * 3, cost.transactions);
+}
+
+void test_setallv(void)
+{
+    const uint32_t RUNS = 50;
+    BusCost total = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < RUNS; i++) {
+        // Alternate so every run moves the DACs
+        command(i % 2 ? "SETALLV 2.0" : "SETALLV 3.0");
+        resetStats();
+        runBusTasks();
+        BusCost cost = readStats();
+        total.transactions += cost.transactions;
+        total.bytes += cost.bytes;
+        total.nacks += cost.nacks;
+        total.bus_time_us += cost.bus_time_us;
+        delay(20);
+    }
+    report("SETALLV + apply tick", total, RUNS);
+    // A buck and an LDO write per cell, plus whatever acquisition did that pass
+    TEST_ASSERT_EQUAL_UINT32(0, total.nacks);
+    TEST_ASSERT_GREATER_OR_EQUAL(32 * RUNS, total.transactions);
+}
+
+void test_setallv_unchanged(void)
+{
+    const uint32_t RUNS = 50;
+    command("SETALLV 2.5");
+    delay(20);
+    resetStats();
+    for (uint32_t i = 0; i < RUNS; i++) {
+        command("SETALLV 2.5");
+        runBusTasks();
+    }
+    BusCost cost = readStats();
+    report("SETALLV unchanged + apply tick", cost, RUNS);
+}
+
+void test_commit_skew(void)
+{
+    const uint32_t RUNS = 20;
+    uint64_t skew = 0;
+    uint64_t latency = 0;
+    for (uint32_t i = 0; i < RUNS; i++) {
+        float voltages[16];
+        for (int c = 0; c < 16; c++) voltages[c] = i % 2 ? 2.0 : 3.0;
+        stageVoltageTargets(0xFFFF, voltages);
+        CommitResult result;
+        TEST_ASSERT_TRUE(commitStagedTargets(result));
+        skew += result.skew_us;
+        latency += result.latency_us;
+        delay(20);
+    }
+    // Both buses run on one timeline here, so the skew includes bus 1's
+    // writes; on the board the buses write in parallel
+    printf("BENCH COMMIT 16 cells: %.1f us skew, %.1f us latency\n", (double)skew / RUNS, (double)latency / RUNS);
+}
+
+void test_battery_model_step(void)
+{
+    // CPU time of the model math alone for all 16 cells, on the host; the
+    // board reports its own figure with MODELSTATS
+    BatteryModel models[16];
+    BatteryModel::Params params = {3.0, 0.05, 2, {0.02, 0.03}, {1000, 20000}, 11,
+                                   {3.0, 3.45, 3.6, 3.66, 3.72, 3.78, 3.85, 3.93, 4.0, 4.08, 4.2}};
+    for (int i = 0; i < 16; i++) TEST_ASSERT_TRUE(models[i].configure(params, BatteryModels::STEP_US));
+
+    const uint32_t STEPS = 100000;
+    int64_t sum = 0;
+    auto started_at = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < STEPS; n++) {
+        for (int i = 0; i < 16; i++) sum += models[i].step(500000 + 1000 * i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started_at).count();
+    printf("BENCH battery model step, 16 cells: %.1f ns on the host\n", ns / STEPS);
+    TEST_ASSERT_GREATER_THAN(0, sum);
+}
+
+void test_idle_tick(void)
+{
+    // Each millisecond of waiting is one pass of both bus tasks, as with
+    // vTaskDelay(1) on the board
+    const uint32_t TICKS = 1000;
+    resetStats();
+    for (uint32_t i = 0; i < TICKS; i++) delay(1);
+    BusCost cost = readStats();
+    report("idle tick", cost, TICKS);
+    // Acquisition keeps sampling even when nothing changes
+    TEST_ASSERT_EQUAL_UINT32(0, cost.nacks);
+    TEST_ASSERT_GREATER_THAN(0, cost.transactions);
+}
+
+void test_bus_clocks(void)
+{
+    // Transactions per second and how soon GETALLV sees fresh voltages, the
+    // same figures I2CBENCH reports on the board
+    const uint32_t CLOCKS[] = {100000, 400000, 1000000};
+    uint32_t previous_rate = 0;
+    for (uint32_t clock : CLOCKS) {
+        setBusClock(1, clock);
+        setBusClock(2, clock);
+        BusBenchmark result = benchmarkBus(1, 20);
+        uint32_t latency_us = measureFreshReadLatency(1000000);
+        uint32_t rate = (uint64_t)result.transactions * 1000000 / result.elapsed_us;
+        printf("BENCH bus at %u Hz: %u transactions/s, GETALLV fresh after %.2f ms\n",
+               (unsigned)clock, (unsigned)rate, latency_us / 1000.0);
+        TEST_ASSERT_EQUAL_UINT32(0, result.nacks + result.errors);
+        TEST_ASSERT_GREATER_THAN(previous_rate, rate);
+        TEST_ASSERT_GREATER_THAN(0, latency_us);
+        previous_rate = rate;
+    }
+    setBusClock(1, BUS_CLOCK_HZ[0]);
+    setBusClock(2, BUS_CLOCK_HZ[1]);
+}
+
+void test_calibrate_all(void)
+{
+    resetStats();
+    uint64_t started_at = Sim::now();
+    calibrateCells(0xFFFF);
+    BusCost cost = readStats();
+    report("CALIBRATE_ALL", cost, 1);
+    printf("BENCH CALIBRATE_ALL: %.1f ms elapsed\n", (Sim::now() - started_at) / 1000.0);
+    TEST_ASSERT_EQUAL_UINT32(0, cost.nacks);
+    TEST_ASSERT_GREATER_THAN(0, cost.transactions);
+}
+
+int main(int argc, char** argv)
+{
+    Preferences::eraseAll();
+    board.attach(Wire, Wire1);
+    Sim::setYieldHook(runBusTasks);
+    initCells();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_getallv);
+    RUN_TEST(test_getallv_blocking);
+    RUN_TEST(test_setallv);
+    RUN_TEST(test_setallv_unchanged);
+    RUN_TEST(test_commit_skew);
+    RUN_TEST(test_battery_model_step);
+    RUN_TEST(test_idle_tick);
+    RUN_TEST(test_bus_clocks);
+    RUN_TEST(test_calibrate_all);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <unity.h>
+#include <sim_devices.h>
+#include "cell.h"
+#include "i2c_mux.h"
+#include "calibration.h"
+
+// Cell driver against the simulated board. No bus task runs here, the tests
+// own Wire and drive a cell directly.
+
+static SimBoard board;
+static I2CMux mux(Wire);
+static Cell bus_cells[] = {
+    Cell(0, mux), Cell(1, mux), Cell(2, mux), Cell(3, mux),
+    Cell(4, mux), Cell(5, mux), Cell(6, mux), Cell(7, mux)
+};
+static Cell& cell = bus_cells[2];
+static SimCell& sim = board.cell(2);
+
+void setUp(void)
+{
+    board.attach(Wire, Wire1);
+    mux.invalidate();
+    cell.init();
+    cell.enable();
+    cell.turnOnOutputRelay();
+    Wire.resetStats();
+}
+
+void tearDown(void)
+{
+}
+
+void test_init_drives_gpio_expander(void)
+{
+    uint8_t outputs = sim.gpio.getOutputs();
+    TEST_ASSERT_TRUE(outputs & (1 << 2)); // buck enable
+    TEST_ASSERT_TRUE(outputs & (1 << 3)); // LDO enable
+    TEST_ASSERT_TRUE(outputs & (1 << 5)); // output relay
+    TEST_ASSERT_FALSE(outputs & (1 << 4)); // load switch
+
+    cell.turnOffOutputRelay();
+    TEST_ASSERT_FALSE(sim.gpio.getOutputs() & (1 << 5));
+}
+
+void test_mux_selects_cell_channel(void)
+{
+    cell.getVoltage();
+    TEST_ASSERT_EQUAL_HEX8(1 << 2, board.mux(0).getMask());
+}
+
+void test_mux_write_skipped_when_channel_unchanged(void)
+{
+    uint32_t before = board.mux(0).getWriteCount();
+    cell.getVoltage();
+    cell.getCurrent();
+    cell.getBuckVoltage();
+    TEST_ASSERT_EQUAL_UINT32(before, board.mux(0).getWriteCount());
+}
+
+void test_set_voltage_reaches_output(void)
+{
+    cell.setVoltage(3.3);
+    delay(50);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.3, sim.getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.3, cell.getVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 3.3 * 1.05, cell.getBuckVoltage());
+}
+
+void test_unchanged_setpoint_skips_dac_writes(void)
+{
+    cell.setVoltage(2.5);
+    uint32_t buck_writes = sim.buck_dac.getWriteCount();
+    uint32_t ldo_writes = sim.ldo_dac.getWriteCount();
+    uint32_t transactions = Wire.getStats().transactions;
+
+    cell.setVoltage(2.5);
+    TEST_ASSERT_EQUAL_UINT32(buck_writes, sim.buck_dac.getWriteCount());
+    TEST_ASSERT_EQUAL_UINT32(ldo_writes, sim.ldo_dac.getWriteCount());
+    TEST_ASSERT_EQUAL_UINT32(transactions, Wire.getStats().transactions);
+
+    cell.invalidateDACCache();
+    cell.setVoltage(2.5);
+    TEST_ASSERT_EQUAL_UINT32(buck_writes + 1, sim.buck_dac.getWriteCount());
+    TEST_ASSERT_EQUAL_UINT32(ldo_writes + 1, sim.ldo_dac.getWriteCount());
+}
+
+void test_voltage_limits_clamp_setpoints(void)
+{
+    cell.setVoltage(9.0);
+    delay(50);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 4.5, sim.getLDOVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 4.55, sim.getBuckVoltage());
+}
+
+void test_current_reads_load(void)
+{
+    cell.setVoltage(2.0);
+    sim.setLoad(20.0);
+    delay(50);
+    TEST_ASSERT_FLOAT_WITHIN(0.002, 0.1, cell.getCurrent());
+    sim.setLoad(0);
+}
+
+void test_non_blocking_conversion_reads_output(void)
+{
+    cell.setVoltage(1.8);
+    delay(50);
+
+    float value = 0;
+    TEST_ASSERT_TRUE(cell.startConversion(Cell::ADC_OUTPUT_VOLTAGE));
+    delayMicroseconds(cell.getConversionTimeMicros());
+    TEST_ASSERT_TRUE(cell.readConversion(Cell::ADC_OUTPUT_VOLTAGE, value));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.8, value);
+}
+
+void test_calibration_matches_board(void)
+{
+    Calibrator calibrator(bus_cells, 8);
+    calibrator.run(1 << 2);
+
+    TEST_ASSERT_EQUAL_UINT32(0, calibrator.getTimeoutCount(2));
+    TEST_ASSERT_GREATER_THAN(0, calibrator.getMeanSettleTime(2));
+    // The buck settles with a 3 ms time constant, so its points take longest
+    TEST_ASSERT_GREATER_THAN(calibrator.getSettleTime(2, false, 10), calibrator.getSettleTime(2, true, 10));
+
+    for (float target = 0.5; target <= 4.4; target += 0.3) {
+        cell.setVoltage(target);
+        delay(50);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, target, sim.getOutputVoltage());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_drives_gpio_expander);
+    RUN_TEST(test_mux_selects_cell_channel);
+    RUN_TEST(test_mux_write_skipped_when_channel_unchanged);
+    RUN_TEST(test_set_voltage_reaches_output);
+    RUN_TEST(test_unchanged_setpoint_skips_dac_writes);
+    RUN_TEST(test_voltage_limits_clamp_setpoints);
+    RUN_TEST(test_current_reads_load);
+    RUN_TEST(test_non_blocking_conversion_reads_output);
+    RUN_TEST(test_calibration_matches_board);
+    return UNITY_END();
+}
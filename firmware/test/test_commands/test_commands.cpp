@@ -0,0 +1,1044 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <Preferences.h>
+#include <unity.h>
+#include <sim_devices.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "commands.h"
+#include "status_leds.h"
+
+// Host commands end to end: the command parser, both bus workers and the
+// cells against the simulated board. The bus tasks run whenever the firmware
+// waits, the way they would be scheduled on the board.
+
+static SimBoard board;
+
+// Collects a command's reply
+class Capture : public Print
+{
+public:
+    size_t write(uint8_t c) override { text += (char)c; return 1; }
+    std::string text;
+};
+
+static void runBusTasks()
+{
+    bus1.service();
+    bus2.service();
+}
+
+// Everything that runs on its own on the board: the simulation timer, then
+// both bus tasks
+static void runTasks()
+{
+    waveformPlayer.tick(micros());
+    batteryModels.tick(micros());
+    temperatureRamp.tick(micros());
+    runBusTasks();
+}
+
+// Waits until ms of simulated time have passed. delay() takes longer than
+// asked here, since the bus passes it runs take bus time of their own.
+static void waitFor(uint32_t ms)
+{
+    uint64_t until = Sim::now() + ms * 1000ULL;
+    while (Sim::now() < until) delay(1);
+}
+
+static std::string command(const char* line)
+{
+    Capture out;
+    handleCommand(String(line), out);
+    return out.text;
+}
+
+static std::vector<float> parseList(const std::string& reply, const char* prefix)
+{
+    std::vector<float> values;
+    size_t prefix_length = strlen(prefix);
+    if (reply.compare(0, prefix_length, prefix) != 0) return values;
+    const char* p = reply.c_str() + prefix_length;
+    while (*p) {
+        values.push_back(atof(p));
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return values;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    binaryMode = false;
+    USBSerial.takeOutput();
+}
+
+void test_ping(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:PONG\r\n", command("PING").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:PONG\r\n", command("  ping  ").c_str());
+}
+
+void test_unknown_command(void)
+{
+    TEST_ASSERT_EQUAL_STRING("Error:unknown command\r\n", command("FOO 1").c_str());
+    TEST_ASSERT_EQUAL_STRING("", command("").c_str());
+}
+
+void test_setv_argument_errors(void)
+{
+    TEST_ASSERT_EQUAL_STRING("Error:SETV requires two arguments\r\n", command("SETV 3").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell number must be between 1 and 16\r\n", command("SETV 17 1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell number must be between 1 and 16\r\n", command("GETV 0").c_str());
+}
+
+void test_setv_then_getv(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:voltage_set:2.50\r\n", command("SETV 3 2.5").c_str());
+    delay(100);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.5, board.cell(2).getOutputVoltage());
+
+    std::string reply = command("GETV 3");
+    TEST_ASSERT_EQUAL_STRING("OK:voltage:", reply.substr(0, 11).c_str());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.5, atof(reply.c_str() + 11));
+}
+
+void test_setallv_then_getallv(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:all_voltages_set:1.80\r\n", command("SETALLV 1.8").c_str());
+    delay(200);
+
+    std::string reply = command("GETALLV");
+    std::vector<float> voltages = parseList(reply, "OK:voltages:");
+    TEST_ASSERT_EQUAL_INT(16, voltages.size());
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.011, 1.8, voltages[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 1.8, board.cell(i).getOutputVoltage());
+    }
+}
+
+void test_setvec_applies_in_one_pass(void)
+{
+    uint16_t codes[16];
+    for (int i = 0; i < 16; i++) codes[i] = board.cell(i).ldo_dac.getCode();
+
+    std::string vector;
+    for (int i = 0; i < 16; i++) {
+        if (i > 0) vector += ",";
+        vector += std::to_string(1.1 + 0.2 * i).substr(0, 4);
+    }
+    std::string line = "SETVEC 0xFFFF " + vector;
+    TEST_ASSERT_EQUAL_STRING("OK:vector_set:16\r\n", command(line.c_str()).c_str());
+
+    // One pass of each bus task picks up every new target
+    runBusTasks();
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_TRUE(board.cell(i).ldo_dac.getCode() != codes[i]);
+    }
+
+    delay(200);
+    std::vector<float> readings = parseList(command("GETVEC 65535 VB"), "OK:vector:");
+    TEST_ASSERT_EQUAL_INT(32, readings.size());
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 1.1 + 0.2 * i, readings[2 * i]);
+        TEST_ASSERT_GREATER_THAN(readings[2 * i], readings[2 * i + 1]);
+    }
+}
+
+void test_setvec_masked_subset(void)
+{
+    command("SETALLV 2.0");
+    delay(100);
+    TEST_ASSERT_EQUAL_STRING("OK:vector_set:2\r\n", command("SETVEC 0x0104 3.1,1.2").c_str());
+    delay(100);
+
+    std::vector<float> readings = parseList(command("GETVEC 0x0106 iv"), "OK:vector:");
+    TEST_ASSERT_EQUAL_INT(6, readings.size());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, readings[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.1, readings[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.2, readings[5]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0, readings[0]);
+}
+
+void test_vector_argument_errors(void)
+{
+    TEST_ASSERT_EQUAL_STRING("Error:SETVEC needs one voltage per cell in the mask\r\n", command("SETVEC 0x3 1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:SETVEC needs one voltage per cell in the mask\r\n", command("SETVEC 0x3 1.0,2.0,3.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:SETVEC needs one voltage per cell in the mask\r\n", command("SETVEC 0x3 1.0,").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell mask must be between 0x1 and 0xFFFF\r\n", command("SETVEC 0 1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell mask must be between 0x1 and 0xFFFF\r\n", command("GETVEC 0x10000").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:fields must be from V, I, B and L\r\n", command("GETVEC 1 VX").c_str());
+}
+
+void test_staged_targets_wait_for_commit(void)
+{
+    command("SETALLV 2.0");
+    delay(100);
+    TEST_ASSERT_EQUAL_STRING("OK:staged:1\r\n", command("STAGEV 16 1.5").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:staged:16\r\n", command("STAGEVEC 0xFFFF 3.0,3.0,3.0,3.0,3.0,3.0,3.0,3.0,"
+                                                            "3.3,3.3,3.3,3.3,3.3,3.3,3.3,3.3").c_str());
+    delay(100);
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, board.cell(i).getOutputVoltage());
+    }
+
+    std::vector<float> result = parseList(command("COMMIT"), "OK:committed:");
+    TEST_ASSERT_EQUAL_INT(3, result.size());
+    TEST_ASSERT_EQUAL_FLOAT(16, result[0]);
+    TEST_ASSERT_GREATER_OR_EQUAL(COMMIT_RELEASE_LEAD_US, result[2]);
+    delay(100);
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, i < 8 ? 3.0 : 3.3, board.cell(i).getOutputVoltage());
+    }
+
+    // The latest offset is the skew
+    std::vector<float> times = parseList(command("GETCOMMIT"), "OK:commit:");
+    TEST_ASSERT_EQUAL_INT(17, times.size());
+    TEST_ASSERT_EQUAL_FLOAT(result[1], times[0]);
+    float latest = 0;
+    for (int i = 1; i <= 16; i++) {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, times[i]);
+        if (times[i] > latest) latest = times[i];
+    }
+    TEST_ASSERT_EQUAL_FLOAT(times[0], latest);
+
+    // Committing leaves the targets where SETV and GETVEC expect them
+    TEST_ASSERT_EQUAL_STRING("Error:nothing staged\r\n", command("COMMIT").c_str());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 3.3, bus2.getTarget(7));
+}
+
+void test_commit_subset_and_unstage(void)
+{
+    command("SETALLV 2.0");
+    delay(100);
+    command("STAGEVEC 0x0101 2.5,1.5");
+    TEST_ASSERT_EQUAL_STRING("OK:committed:2", command("COMMIT").substr(0, 14).c_str());
+    delay(100);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.5, board.cell(0).getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, board.cell(1).getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.5, board.cell(8).getOutputVoltage());
+
+    std::vector<float> times = parseList(command("GETCOMMIT"), "OK:commit:");
+    TEST_ASSERT_EQUAL_INT(17, times.size());
+    TEST_ASSERT_EQUAL_FLOAT(-1, times[2]);
+
+    command("STAGEV 2 4.0");
+    TEST_ASSERT_EQUAL_STRING("OK:unstaged\r\n", command("UNSTAGE").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:nothing staged\r\n", command("COMMIT").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell mask must be between 0x1 and 0xFFFF\r\n", command("STAGEVEC 0 1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:STAGEVEC needs one voltage per cell in the mask\r\n", command("STAGEVEC 3 1.0").c_str());
+}
+
+void test_waveform_synchronized_start(void)
+{
+    command("SETALLV 2.0");
+    delay(100);
+    TEST_ASSERT_EQUAL_STRING("OK:wave_points:3\r\n", command("WAVESAMPLES 1 20 2.4,2.8,3.2").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave_points:3\r\n", command("WAVESAMPLES 9 20 2.4,2.8,3.2").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave_playing:2\r\n", command("WAVEPLAY 0x0101").c_str());
+
+    // Both cells get every value at the same tick
+    for (int i = 0; i < 100; i++) {
+        delay(1);
+        TEST_ASSERT_EQUAL_FLOAT(bus1.getTarget(0), bus2.getTarget(0));
+    }
+    delay(100);
+    TEST_ASSERT_EQUAL_STRING("OK:wave:0x0,", command("WAVESTATUS").substr(0, 12).c_str());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.2, board.cell(0).getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.2, board.cell(8).getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, board.cell(1).getOutputVoltage());
+}
+
+void test_waveform_loops_points(void)
+{
+    command("WAVECLEAR");
+    TEST_ASSERT_EQUAL_STRING("OK:wave_points:2\r\n", command("WAVEPOINTS 2 0:1.0,100:2.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave_points:3\r\n", command("WAVEPOINTS 2 200:1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave_playing:1\r\n", command("WAVEPLAY 2 loop 0").c_str());
+
+    // Ramps up and down between the points, and starts over every 200 ms
+    float lowest = 5;
+    float highest = 0;
+    int rises = 0;
+    float previous = bus1.getTarget(1);
+    for (int i = 0; i < 500; i++) {
+        delay(1);
+        float target = bus1.getTarget(1);
+        if (target < lowest) lowest = target;
+        if (target > highest) highest = target;
+        if (target > previous && previous < 1.1) rises++;
+        previous = target;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 1.0, lowest);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 2.0, highest);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, rises);
+
+    TEST_ASSERT_EQUAL_STRING("Error:points out of order, waveform full or playing\r\n", command("WAVEPOINTS 2 300:1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave:0x2,", command("WAVESTATUS").substr(0, 12).c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave_stopped\r\n", command("WAVESTOP").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:wave:0x0,", command("WAVESTATUS").substr(0, 12).c_str());
+}
+
+void test_waveform_counts_late_ticks(void)
+{
+    command("WAVECLEAR 2");
+    command("WAVEPOINTS 2 0:1.5,1000:2.5");
+    command("WAVEPLAY 2 0");
+
+    // Hold off the timer for 5 periods; the tick after that is 4 late
+    Sim::setYieldHook(nullptr);
+    waveformPlayer.tick(micros());
+    waveformPlayer.tick(micros() + 1000);
+    delayMicroseconds(1000 + 5 * WaveformPlayer::TICK_US);
+    waveformPlayer.tick(micros());
+    Sim::setYieldHook(runTasks);
+
+    std::vector<float> status = parseList(command("WAVESTATUS"), "OK:wave:");
+    TEST_ASSERT_EQUAL_INT(3, status.size());
+    TEST_ASSERT_EQUAL_FLOAT(4, status[1]);
+    command("WAVESTOP 2");
+}
+
+void test_waveform_argument_errors(void)
+{
+    command("WAVECLEAR");
+    TEST_ASSERT_EQUAL_STRING("Error:cell without a waveform or already playing\r\n", command("WAVEPLAY 0x10").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:points out of order, waveform full or playing\r\n", command("WAVEPOINTS 5 10:1.0,5:2.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:points must be up to 64 <ms>:<volts> pairs\r\n", command("WAVEPOINTS 5 10:1.0,2.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:samples must be up to 64 voltages at a positive interval\r\n", command("WAVESAMPLES 5 0 1.0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell number must be between 1 and 16\r\n", command("WAVESAMPLES 17 10 1.0").c_str());
+    TEST_ASSERT_EQUAL_INT(0, waveformPlayer.getPointCount(4));
+}
+
+void test_waveform_stop_against_a_running_timer(void)
+{
+    // The other cells keep the tick busy before it gets to the last one
+    const uint32_t ramp_times[2] = {0, 100000};
+    const float ramp_voltages[2] = {2.0, 3.0};
+    waveformPlayer.clear(0xFFFF);
+    for (uint8_t i = 0; i < 15; i++) TEST_ASSERT_TRUE(waveformPlayer.addPoints(i, ramp_times, ramp_voltages, 2));
+    TEST_ASSERT_TRUE(waveformPlayer.start(0x7FFF, true, 0));
+
+    // The timer on a task of its own, as on the board
+    std::atomic<bool> running{true};
+    std::thread timer([&running] {
+        uint32_t now = 0;
+        while (running.load()) waveformPlayer.tick(now += 1000);
+    });
+
+    const uint32_t times[1] = {0};
+    const float voltages[1] = {4.0};
+    for (int i = 0; i < 20000; i++) {
+        waveformPlayer.clear(0x8000);
+        TEST_ASSERT_TRUE(waveformPlayer.addPoints(15, times, voltages, 1));
+        TEST_ASSERT_TRUE(waveformPlayer.start(0x8000, false, 0));
+        // A target set once WAVESTOP returns is the one that stays
+        waveformPlayer.stop(0x8000);
+        setVoltageTarget(15, 1.5);
+        for (volatile int spin = 0; spin < 1000; spin++) {
+        }
+        TEST_ASSERT_EQUAL_FLOAT(1.5, bus2.getTarget(7));
+    }
+    running.store(false);
+    timer.join();
+    waveformPlayer.stop(0xFFFF);
+    waveformPlayer.clear(0xFFFF);
+}
+
+void test_battery_model_sags_and_recovers(void)
+{
+    // Flat 3.7 V OCV, 0.5 ohm R0 and a 0.5 ohm, 0.2 F pair (100 ms)
+    TEST_ASSERT_EQUAL_STRING("OK:model_set:4\r\n", command("MODELSET 4 1.0,0.5,0.5,0.2 3.7,3.7").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:model_running:1\r\n", command("MODELSTART 0x8").c_str());
+    waitFor(200);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.7, board.cell(3).getOutputVoltage());
+
+    // R0 drops the voltage at once, the RC pair some more as it charges
+    board.cell(3).setLoad(20);
+    waitFor(60);
+    float early = board.cell(3).getOutputVoltage();
+    waitFor(1000);
+    float settled = board.cell(3).getOutputVoltage();
+    TEST_ASSERT_LESS_THAN(3.68, early);
+    TEST_ASSERT_GREATER_THAN(settled + 0.02, early);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 3.7 * 20 / 21, settled);
+
+    std::vector<float> state = parseList(command("MODELGET 4"), "OK:model:");
+    TEST_ASSERT_EQUAL_INT(4, state.size());
+    TEST_ASSERT_FLOAT_WITHIN(0.02, settled, state[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, settled / 20, state[3]);
+
+    board.cell(3).setLoad(0);
+    waitFor(1000);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.7, board.cell(3).getOutputVoltage());
+
+    std::vector<float> stats = parseList(command("MODELSTATS"), "OK:model_stats:");
+    TEST_ASSERT_EQUAL_INT(4, stats.size());
+    TEST_ASSERT_GREATER_THAN(200, stats[0]);
+    TEST_ASSERT_EQUAL_STRING("OK:model_stopped\r\n", command("MODELSTOP").c_str());
+}
+
+void test_battery_model_discharges(void)
+{
+    // 0.5 mAh from 4.2 V full to 3.0 V empty
+    command("MODELSET 5 0.0005,0 3.0,4.2");
+    command("MODELSTART 0x10 100");
+    board.cell(4).setLoad(10);
+    waitFor(1000);
+    board.cell(4).setLoad(0);
+    command("MODELSTOP 0x10");
+
+    // About 0.4 A for a second takes a fifth of the charge
+    std::vector<float> state = parseList(command("MODELGET 5"), "OK:model:");
+    TEST_ASSERT_FLOAT_WITHIN(8, 78, state[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 3.0 + 1.2 * state[0] / 100, state[2]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, state[1], board.cell(4).getOutputVoltage());
+}
+
+void test_battery_model_stop_against_a_running_timer(void)
+{
+    // 3.0 V empty to 4.2 V full and no resistance, so the terminal voltage
+    // always equals the OCV of the SOC
+    BatteryModel::Params params = {1.0, 0, 0, {0}, {0}, 2, {3.0, 4.2}};
+    TEST_ASSERT_TRUE(batteryModels.configure(0, params));
+
+    // The timer on a task of its own, as on the board
+    std::atomic<bool> running{true};
+    std::thread timer([&running] {
+        uint32_t now = 0;
+        while (running.load()) batteryModels.tick(now += BatteryModels::STEP_US);
+    });
+    // Starts alternate between empty and full, so a torn state doesn't add up
+    std::atomic<uint32_t> torn{0};
+    std::thread reader([&running, &torn] {
+        while (running.load()) {
+            BatteryModel::State state = batteryModels.getState(0);
+            if (state.terminal_v != state.ocv_v || fabsf(3.0f + 1.2f * state.soc - state.ocv_v) > 0.001f) torn++;
+        }
+    });
+
+    for (int i = 0; i < 20000; i++) {
+        TEST_ASSERT_TRUE(batteryModels.start(0x1, i % 2));
+        // A target set once MODELSTOP returns is the one that stays
+        batteryModels.stop(0x1);
+        setVoltageTarget(0, 1.5);
+        for (volatile int spin = 0; spin < 1000; spin++) {
+        }
+        TEST_ASSERT_EQUAL_FLOAT(1.5, bus1.getTarget(0));
+    }
+    running.store(false);
+    timer.join();
+    reader.join();
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+}
+
+void test_battery_model_argument_errors(void)
+{
+    TEST_ASSERT_EQUAL_STRING("Error:cell without a model or already running\r\n", command("MODELSTART 0x40").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:MODELSET needs capacity, R0, up to two R,C pairs and 2 to 21 OCV points\r\n",
+                             command("MODELSET 7 1.0 3.7,3.8").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:MODELSET needs capacity, R0, up to two R,C pairs and 2 to 21 OCV points\r\n",
+                             command("MODELSET 7 1.0,0.1,0.5 3.7,3.8").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:invalid model parameters or model running\r\n", command("MODELSET 7 0,0.1 3.7,3.8").c_str());
+
+    // A cell runs either a model or a waveform
+    command("MODELSET 7 1.0,0.1 3.7,3.8");
+    command("WAVECLEAR");
+    command("WAVESAMPLES 7 10 3.0");
+    TEST_ASSERT_EQUAL_STRING("OK:model_running:1\r\n", command("MODELSTART 0x40 50").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell is running a battery model\r\n", command("WAVEPLAY 0x40").c_str());
+    command("MODELSTOP");
+    TEST_ASSERT_EQUAL_STRING("OK:wave_playing:1\r\n", command("WAVEPLAY 0x40 0").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:cell is playing a waveform\r\n", command("MODELSTART 0x40").c_str());
+    command("WAVESTOP");
+}
+
+void test_accumulators_integrate_load_current(void)
+{
+    command("SETALLV 3.0");
+    board.cell(10).setLoad(20);
+    waitFor(200);
+    TEST_ASSERT_EQUAL_STRING("OK:acc_reset\r\n", command("RESETACC 0x0C00").c_str());
+    waitFor(2000);
+    std::vector<float> acc = parseList(command("GETACC 0x0C00"), "OK:acc:");
+    board.cell(10).setLoad(0);
+
+    // 150 mA and 450 mW on cell 11, nothing on cell 12
+    TEST_ASSERT_EQUAL_INT(6, acc.size());
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 2.0, acc[2]);
+    TEST_ASSERT_FLOAT_WITHIN(0.02 * 0.15 * acc[2] / 3.6, 0.15 * acc[2] / 3.6, acc[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.02 * 0.45 * acc[2] / 3.6, 0.45 * acc[2] / 3.6, acc[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, 0, acc[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, 0, acc[4]);
+
+    // A reset only affects the cells in the mask
+    command("RESETACC 0x800");
+    std::vector<float> after = parseList(command("GETACC 0x0C00"), "OK:acc:");
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, acc[0], after[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0, after[5]);
+    TEST_ASSERT_EQUAL_INT(48, parseList(command("GETACC"), "OK:acc:").size());
+}
+
+void test_output_relay_commands(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:output_disabled\r\n", command("DISABLE_OUTPUT 9").c_str());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0, board.cell(8).getOutputVoltage());
+    TEST_ASSERT_EQUAL_STRING("OK:all_outputs_enabled\r\n", command("ENABLE_OUTPUT_ALL").c_str());
+    TEST_ASSERT_GREATER_THAN(0.3, board.cell(8).getOutputVoltage());
+}
+
+void test_getallv_uses_cached_readings(void)
+{
+    delay(200);
+    uint32_t before = Wire.getStats().transactions + Wire1.getStats().transactions;
+    command("GETALLV");
+    uint32_t after = Wire.getStats().transactions + Wire1.getStats().transactions;
+    TEST_ASSERT_EQUAL_UINT32(before, after);
+}
+
+void test_mux_stats(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:mux_stats_reset\r\n", command("RESETMUXSTATS").c_str());
+    delay(100);
+    std::vector<float> stats = parseList(command("GETMUXSTATS"), "OK:mux_stats:");
+    TEST_ASSERT_EQUAL_INT(4, stats.size());
+    TEST_ASSERT_GREATER_THAN(0, stats[0]);
+    TEST_ASSERT_GREATER_THAN(0, stats[2]);
+}
+
+void test_i2c_clock(void)
+{
+    TEST_ASSERT_EQUAL_STRING("OK:i2c_clock:400000,400000\r\n", command("I2CCLOCK 400000").c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:i2c_clock:400000,1000000\r\n", command("I2CCLOCK 2 1000000").c_str());
+    TEST_ASSERT_EQUAL_UINT32(400000, Wire.getClock());
+    TEST_ASSERT_EQUAL_UINT32(1000000, Wire1.getClock());
+    TEST_ASSERT_EQUAL_STRING("Error:bus must be 1 or 2\r\n", command("I2CCLOCK 3 400000").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:clock must be between 100000 and 1000000 Hz\r\n", command("I2CCLOCK 50000").c_str());
+
+    // DAC writes leave the clock alone
+    command("SETV 2 2.2");
+    command("SETV 10 2.2");
+    delay(100);
+    TEST_ASSERT_EQUAL_UINT32(400000, Wire.getClock());
+    TEST_ASSERT_EQUAL_UINT32(1000000, Wire1.getClock());
+    command("I2CCLOCK 400000");
+}
+
+void test_i2c_benchmark(void)
+{
+    Capture out;
+    handleCommand(String("I2CBENCH 5"), out);
+    std::string reply = out.text;
+    TEST_ASSERT_TRUE(reply.find("OK:i2c_bench:3\r\n") != std::string::npos);
+
+    std::vector<std::vector<float>> rows;
+    size_t from = 0;
+    while ((from = reply.find("BENCH:", from)) != std::string::npos) {
+        rows.push_back(parseList(reply.substr(from, reply.find("\r", from) - from), "BENCH:"));
+        from++;
+    }
+    TEST_ASSERT_EQUAL_INT(3, rows.size());
+    for (auto& row : rows) {
+        // clock, then rate, nacks and errors per bus, then latency
+        TEST_ASSERT_EQUAL_INT(8, row.size());
+        TEST_ASSERT_EQUAL_FLOAT(0, row[2]);
+        TEST_ASSERT_EQUAL_FLOAT(0, row[3]);
+        TEST_ASSERT_EQUAL_FLOAT(0, row[5]);
+        TEST_ASSERT_EQUAL_FLOAT(0, row[6]);
+        TEST_ASSERT_GREATER_THAN(0, row[7]);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(100000, rows[0][0]);
+    TEST_ASSERT_EQUAL_FLOAT(1000000, rows[2][0]);
+    TEST_ASSERT_GREATER_THAN(rows[0][1], rows[1][1]);
+    TEST_ASSERT_GREATER_THAN(rows[1][1], rows[2][1]);
+
+    // Set back to what they were
+    TEST_ASSERT_EQUAL_STRING("OK:i2c_clock:400000,400000\r\n", command("I2CCLOCK").c_str());
+    TEST_ASSERT_EQUAL_UINT32(400000, Wire.getClock());
+}
+
+void test_calibration_round_trip(void)
+{
+    std::string reply = command("GETCAL 5");
+    TEST_ASSERT_EQUAL_STRING("CAL:5:", reply.substr(0, 6).c_str());
+    size_t end = reply.find("\r\n");
+    std::string table = reply.substr(6, end - 6);
+    TEST_ASSERT_EQUAL_STRING("OK:cal:1\r\n", reply.substr(end + 2).c_str());
+
+    std::string set = "SETCAL 12 " + table;
+    TEST_ASSERT_EQUAL_STRING("OK:cal_set:12\r\n", command(set.c_str()).c_str());
+    std::string check = command("GETCAL 12");
+    TEST_ASSERT_EQUAL_STRING(table.c_str(), check.substr(7, check.find("\r\n") - 7).c_str());
+
+    TEST_ASSERT_EQUAL_STRING("Error:malformed calibration table\r\n", command("SETCAL 12 1.0/abc").c_str());
+}
+
+void test_calibration_survives_reboot(void)
+{
+    // Every cell was calibrated and stored at startup
+    TEST_ASSERT_EQUAL_HEX16(0, initCells());
+
+    TEST_ASSERT_EQUAL_STRING("OK:cal_cleared\r\n", command("CLEARCAL").c_str());
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, initCells());
+    saveCalibration(0xFFFF);
+    TEST_ASSERT_EQUAL_HEX16(0, initCells());
+}
+
+void test_tagged_commands_pipelined(void)
+{
+    USBSerial.inject("#7 PING\n#8 GETV 99\nPING\n#9 GETCAL 2\n");
+    processUARTCommands();
+
+    std::string output = USBSerial.takeOutput();
+    std::string expected = "#7 OK:PONG\r\n#8 Error:cell number must be between 1 and 16\r\nOK:PONG\r\n#9 CAL:2:";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), output.substr(0, expected.size()).c_str());
+    TEST_ASSERT_TRUE(output.find("\r\n#9 OK:cal:1\r\n") != std::string::npos);
+}
+
+void test_binary_get_all_v(void)
+{
+    using namespace BinaryProtocol;
+    command("SETALLV 3.0");
+    delay(200);
+
+    USBSerial.inject("BINARY\n");
+    processUARTCommands();
+    TEST_ASSERT_TRUE(binaryMode);
+    USBSerial.takeOutput();
+
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t size = encode(frame, 7, CMD_GET_ALL_V, nullptr, 0);
+    USBSerial.inject(frame, size);
+    processUARTCommands();
+
+    Decoder decoder;
+    std::string reply = USBSerial.takeOutput();
+    Decoder::Result result = Decoder::NONE;
+    for (char c : reply) result = decoder.feed((uint8_t)c);
+    TEST_ASSERT_EQUAL_INT(Decoder::FRAME, result);
+    TEST_ASSERT_EQUAL_UINT8(7, decoder.frame().seq);
+    TEST_ASSERT_EQUAL_UINT8(CMD_GET_ALL_V | REPLY_FLAG, decoder.frame().cmd);
+    TEST_ASSERT_EQUAL_UINT8(1 + 32, decoder.frame().length);
+    TEST_ASSERT_EQUAL_UINT8(STATUS_OK, decoder.frame().payload[0]);
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 3.0, fixedToVolts(getU16(&decoder.frame().payload[1 + 2 * i])));
+    }
+}
+
+void test_binary_vectors(void)
+{
+    using namespace BinaryProtocol;
+    binaryMode = true;
+    uint8_t payload[6] = {0x81, 0x00};
+    putU16(&payload[2], voltsToFixed(2.2));
+    putU16(&payload[4], voltsToFixed(3.7));
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t size = encode(frame, 1, CMD_SET_VEC, payload, sizeof(payload));
+    USBSerial.inject(frame, size);
+    processUARTCommands();
+    delay(200);
+
+    uint8_t request[3] = {0x81, 0x00, FIELD_VOLTAGE | FIELD_CURRENT};
+    size = encode(frame, 2, CMD_GET_VEC, request, sizeof(request));
+    USBSerial.inject(frame, size);
+    processUARTCommands();
+
+    Decoder decoder;
+    std::vector<Frame> replies;
+    std::string output = USBSerial.takeOutput();
+    for (char c : output) {
+        if (decoder.feed((uint8_t)c) == Decoder::FRAME) replies.push_back(decoder.frame());
+    }
+    TEST_ASSERT_EQUAL_INT(2, replies.size());
+    TEST_ASSERT_EQUAL_UINT8(STATUS_OK, replies[0].payload[0]);
+    TEST_ASSERT_EQUAL_UINT8(1 + 2 * (2 + 4), replies[1].length);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 2.2, fixedToVolts(getU16(&replies[1].payload[1])));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3.7, fixedToVolts(getU16(&replies[1].payload[7])));
+
+    // A voltage short of the mask
+    size = encode(frame, 3, CMD_SET_VEC, payload, 4);
+    USBSerial.inject(frame, size);
+    processUARTCommands();
+    output = USBSerial.takeOutput();
+    Decoder::Result result = Decoder::NONE;
+    for (char c : output) result = decoder.feed((uint8_t)c);
+    TEST_ASSERT_EQUAL_INT(Decoder::FRAME, result);
+    TEST_ASSERT_EQUAL_UINT8(STATUS_BAD_ARGUMENT, decoder.frame().payload[0]);
+}
+
+void test_binary_bad_crc(void)
+{
+    using namespace BinaryProtocol;
+    binaryMode = true;
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t size = encode(frame, 9, CMD_PING, nullptr, 0);
+    frame[size - 1] ^= 0xFF;
+    USBSerial.inject(frame, size);
+    processUARTCommands();
+
+    Decoder decoder;
+    std::string reply = USBSerial.takeOutput();
+    Decoder::Result result = Decoder::NONE;
+    for (char c : reply) result = decoder.feed((uint8_t)c);
+    TEST_ASSERT_EQUAL_INT(Decoder::FRAME, result);
+    TEST_ASSERT_EQUAL_UINT8(STATUS_BAD_CRC, decoder.frame().payload[0]);
+}
+
+void test_thermistor_refused_at_cell_addresses(void)
+{
+    // Where the board as built has it, the front end hears the cells on bus 2:
+    // an LDO write also lands on its channel A
+    board.thermistor.setAddresses(SimThermistor::BUILT_DAC_ADDRESS, SimThermistor::BUILT_ADC_ADDRESS);
+    board.attach(Wire, Wire1);
+    command("SETV 12 2.5");
+    waitFor(20);
+    TEST_ASSERT_TRUE(board.thermistor.dac.getCode(0) != 0);
+    TEST_ASSERT_EQUAL_UINT16(board.cell(11).ldo_dac.getCode(), board.thermistor.dac.getCode(0));
+
+    // so the firmware leaves it alone there
+    Thermistor as_built(mux2, SimThermistor::BUILT_DAC_ADDRESS, SimThermistor::BUILT_ADC_ADDRESS);
+    uint32_t writes = board.thermistor.dac.getWriteCount();
+    TEST_ASSERT_TRUE(as_built.sharesCellAddress());
+    TEST_ASSERT_FALSE(as_built.init());
+    TEST_ASSERT_FALSE(as_built.isPresent());
+    TEST_ASSERT_FALSE(thermistor.sharesCellAddress());
+
+    board.thermistor.setAddresses(SimThermistor::DAC_ADDRESS, SimThermistor::ADC_ADDRESS);
+    board.attach(Wire, Wire1);
+    command("SETV 12 2.8");
+    waitFor(20);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 2.8, board.cell(11).getOutputVoltage());
+    // Moved, the cells no longer reach it
+    TEST_ASSERT_EQUAL_UINT32(writes, board.thermistor.dac.getWriteCount());
+}
+
+void test_thermistor_temperatures_read_back(void)
+{
+    uint32_t writes = board.thermistor.dac.getWriteCount();
+    TEST_ASSERT_EQUAL_STRING("OK:temp_vector_set:4\r\n", command("SETTEMPVEC 0xF 25,40,0,-10").c_str());
+    waitFor(20);
+
+    // One fast write for all four, 10k B3435 against 10k to 3.3V by default
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, board.thermistor.dac.getWriteCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.002, 1.65, board.thermistor.getOutputVoltage(0));
+    TEST_ASSERT_TRUE(board.thermistor.getOutputVoltage(1) < board.thermistor.getOutputVoltage(0));
+    TEST_ASSERT_TRUE(board.thermistor.getOutputVoltage(3) > board.thermistor.getOutputVoltage(2));
+
+    std::vector<float> temp = parseList(command("GETTEMP"), "OK:temp:");
+    TEST_ASSERT_EQUAL_INT(1 + 3 * 4, temp.size());
+    const float expected[] = {25, 40, 0, -10};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.01, expected[i], temp[1 + 3 * i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.002, board.thermistor.getOutputVoltage(i), temp[2 + 3 * i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.2, expected[i], temp[3 + 3 * i]);
+    }
+
+    // The cells on the same bus still work
+    command("SETV 12 2.8");
+    waitFor(20);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 2.8, board.cell(11).getOutputVoltage());
+    TEST_ASSERT_FLOAT_WITHIN(0.002, 1.65, board.thermistor.getOutputVoltage(0));
+}
+
+void test_thermistor_ramp(void)
+{
+    command("SETTEMP 2 20");
+    TEST_ASSERT_EQUAL_STRING("OK:temp_ramp:1\r\n", command("TEMPRAMP 0x2 40 1").c_str());
+    waitFor(500);
+    TEST_ASSERT_FLOAT_WITHIN(3, 30, thermistor.getTemperature(1));
+    TEST_ASSERT_EQUAL_HEX8(0x2, temperatureRamp.getActiveMask());
+    waitFor(600);
+    TEST_ASSERT_EQUAL_FLOAT(40, thermistor.getTemperature(1));
+    TEST_ASSERT_EQUAL_HEX8(0, temperatureRamp.getActiveMask());
+
+    // Stopping holds the temperature where it got to
+    command("TEMPRAMP 0x2 0 1");
+    waitFor(300);
+    TEST_ASSERT_EQUAL_STRING("OK:temp_ramp_stopped\r\n", command("TEMPRAMP STOP").c_str());
+    float held = thermistor.getTemperature(1);
+    TEST_ASSERT_TRUE(held < 40 && held > 0);
+    waitFor(100);
+    TEST_ASSERT_EQUAL_FLOAT(held, thermistor.getTemperature(1));
+}
+
+void test_thermistor_ramp_against_a_running_timer(void)
+{
+    // The timer on a task of its own, as on the board
+    std::atomic<bool> running{true};
+    std::thread timer([&running] {
+        uint32_t now = 0;
+        while (running.load()) temperatureRamp.tick(now += 1000);
+    });
+    // Models alternate between two whose fields never mix
+    const NtcModel models[2] = {NtcModel::fromBeta(10000, 3435, 10000, 3.3),
+                                NtcModel::fromBeta(100000, 4250, 4700, 5)};
+    std::atomic<uint32_t> torn{0};
+    std::thread reader([&running, &torn] {
+        while (running.load()) {
+            NtcModel model = thermistor.getModel(0);
+            bool first = model.r25_ohms == 10000;
+            if (first != (model.beta == 3435) || first != (model.pullup_ohms == 10000)) torn++;
+        }
+    });
+
+    const float from[4] = {0, 0, 0, 0};
+    const float to[4] = {100, 0, 0, 0};
+    for (int i = 0; i < 200000; i++) {
+        TEST_ASSERT_TRUE(temperatureRamp.start(0x1, from, to, 1000));
+        thermistor.setModel(0, models[i % 2]);
+        // What SETTEMP does: nothing the ramp had under way lands after it
+        temperatureRamp.stop(0x1);
+        thermistor.setTemperature(0, -5);
+        for (volatile int spin = 0; spin < 1000; spin++) {
+        }
+        TEST_ASSERT_EQUAL_FLOAT(-5, thermistor.getTemperature(0));
+    }
+    running.store(false);
+    timer.join();
+    reader.join();
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    thermistor.setModel(0, models[0]);
+    command("SETTEMP 1 25");
+}
+
+void test_thermistor_models(void)
+{
+    // Steinhart-Hart coefficients of a 10k NTC, 10k at 25C
+    TEST_ASSERT_EQUAL_STRING("OK:temp_model:3\r\n",
+                             command("TEMPMODEL 3 SH 0.001125308852,0.0002347125601,0.00000008566352786,10000,3.3").c_str());
+    command("SETTEMP 3 25");
+    waitFor(20);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.65, board.thermistor.getOutputVoltage(2));
+    NtcModel model = thermistor.getModel(2);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 60, model.temperatureAt(model.resistanceAt(60)));
+
+    // A 100k beta NTC on a 4.7k pullup to 5V
+    command("TEMPMODEL 4 BETA 100000,4250,4700,5");
+    command("SETTEMP 4 25");
+    waitFor(20);
+    // Above the DAC's 3.3V, so it saturates
+    TEST_ASSERT_EQUAL_UINT16(4095, board.thermistor.dac.getCode(3));
+    command("SETTEMP 4 100");
+    waitFor(20);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, thermistor.getModel(3).voltageAt(100), board.thermistor.getOutputVoltage(3));
+
+    TEST_ASSERT_EQUAL_STRING("Error:thermistor channel must be between 1 and 4\r\n", command("SETTEMP 5 20").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:invalid model parameters or channel ramping\r\n", command("TEMPMODEL 1 BETA 0,3435,10000,3.3").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:TEMPRAMP needs one temperature per channel in the mask\r\n", command("TEMPRAMP 0x3 40 10").c_str());
+    TEST_ASSERT_EQUAL_STRING("Error:SETTEMPVEC needs a channel mask between 0x1 and 0xF and temperatures\r\n", command("SETTEMPVEC 0x10 20").c_str());
+    command("TEMPMODEL 3 BETA 10000,3435,10000,3.3");
+    command("TEMPMODEL 4 BETA 10000,3435,10000,3.3");
+}
+
+void test_status_leds_redraw_changed_cells(void)
+{
+    StatusLeds leds;
+    command("SETALLV 2.5");
+    waitFor(300);
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, leds.update());
+    TEST_ASSERT_EQUAL_HEX16(0, leds.update());
+
+    // Only the cell that moved past the threshold
+    command("SETV 10 4.0");
+    waitFor(300);
+    TEST_ASSERT_EQUAL_HEX16(1U << 9, leds.update());
+    const LedColor& voltage = leds.getColors()[2 * 9 + 1];
+    TEST_ASSERT_TRUE(voltage.r > voltage.g && voltage.b == 0);
+    TEST_ASSERT_EQUAL_UINT8(0, leds.getColors()[2 * 9].r);
+
+    leds.invalidate();
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, leds.update());
+}
+
+// Reads whatever the server has sent back so far
+static std::string receiveAll(int fd)
+{
+    std::string text;
+    char chunk[256];
+    ssize_t received;
+    while ((received = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0) text.append(chunk, received);
+    return text;
+}
+
+static int connectTo(uint16_t port, int receive_buffer = 0)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (receive_buffer > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd, (sockaddr*)&address, sizeof(address));
+    return fd;
+}
+
+void test_network_commands(void)
+{
+    if (!networkServer.isListening()) TEST_ASSERT_TRUE(networkServer.begin(0));
+    int first = connectTo(networkServer.getPort());
+    int second = connectTo(networkServer.getPort());
+    networkServer.poll();
+    TEST_ASSERT_EQUAL_UINT8(2, networkServer.getClientCount());
+
+    // Each client gets its own replies, tags and all, split lines included
+    const char* requests = "#1 PING\r\nSETV 3 2.5\nGETV 3";
+    send(first, requests, strlen(requests), 0);
+    send(second, "PING\nBINARY\n", 12, 0);
+    networkServer.poll();
+    send(first, "\n", 1, 0);
+    networkServer.poll();
+    std::string replies = receiveAll(first);
+    TEST_ASSERT_EQUAL_STRING("#1 OK:PONG\r\nOK:voltage_set:2.50\r\nOK:voltage:", replies.substr(0, 44).c_str());
+    TEST_ASSERT_EQUAL_STRING("OK:PONG\r\nError:BINARY is only available over USB, use UDPSTREAM\r\n",
+                             receiveAll(second).c_str());
+    TEST_ASSERT_FALSE(binaryMode);
+    TEST_ASSERT_EQUAL_STRING("", USBSerial.takeOutput().c_str());
+
+    close(second);
+    networkServer.poll();
+    TEST_ASSERT_EQUAL_UINT8(1, networkServer.getClientCount());
+    close(first);
+    networkServer.poll();
+    TEST_ASSERT_EQUAL_UINT8(0, networkServer.getClientCount());
+}
+
+void test_network_reply_larger_than_send_buffer(void)
+{
+    // Pipelined GETCALs for every cell, far more than the stack takes at
+    // once from a client with a small receive window. The server holds
+    // what didn't fit until the client reads it, and keeps the client.
+    const int REQUESTS = 8;
+    if (!networkServer.isListening()) TEST_ASSERT_TRUE(networkServer.begin(0));
+    int fd = connectTo(networkServer.getPort(), 4096);
+    networkServer.poll();
+    TEST_ASSERT_EQUAL_UINT8(1, networkServer.getClientCount());
+    std::string requests;
+    for (int i = 0; i < REQUESTS; i++) requests += "GETCAL\n";
+    send(fd, requests.data(), requests.size(), 0);
+
+    std::string replies;
+    int complete = 0;
+    for (int pass = 0; pass < 100000 && complete < REQUESTS; pass++) {
+        networkServer.poll();
+        TEST_ASSERT_EQUAL_UINT8(1, networkServer.getClientCount());
+        replies += receiveAll(fd);
+        complete = 0;
+        for (size_t at = replies.find("OK:cal:16\r\n"); at != std::string::npos;
+             at = replies.find("OK:cal:16\r\n", at + 1)) {
+            complete++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(REQUESTS, complete);
+    int tables = 0;
+    for (size_t at = replies.find("CAL:"); at != std::string::npos; at = replies.find("CAL:", at + 1)) {
+        if (at == 0 || replies[at - 1] == '\n') tables++;
+    }
+    TEST_ASSERT_EQUAL_INT(16 * REQUESTS, tables);
+    close(fd);
+    networkServer.poll();
+    TEST_ASSERT_EQUAL_UINT8(0, networkServer.getClientCount());
+}
+
+void test_udp_telemetry(void)
+{
+    using namespace BinaryProtocol;
+    if (!networkServer.isListening()) TEST_ASSERT_TRUE(networkServer.begin(0));
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr*)&address, sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, (sockaddr*)&address, &length);
+
+    TEST_ASSERT_EQUAL_STRING("Error:invalid UDP destination\r\n", command("UDPSTREAM 127.0.0 5000 100").c_str());
+    std::string start = "UDPSTREAM 127.0.0.1 " + std::to_string(ntohs(address.sin_port)) + " 100";
+    TEST_ASSERT_EQUAL_STRING("OK:udp_stream:100\r\n", command(start.c_str()).c_str());
+    for (int i = 0; i < 3; i++) {
+        sendTelemetry();
+        waitFor(10);
+    }
+    command("UDPSTREAM STOP");
+
+    // One frame per datagram, nothing on USB
+    int frames = 0;
+    uint8_t datagram[NetworkServer::MAX_DATAGRAM];
+    ssize_t received;
+    while ((received = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT)) > 0) {
+        Decoder decoder;
+        Decoder::Result result = Decoder::NONE;
+        for (ssize_t i = 0; i < received; i++) result = decoder.feed(datagram[i]);
+        TEST_ASSERT_EQUAL_INT(Decoder::FRAME, result);
+        TEST_ASSERT_EQUAL_UINT8(CMD_STREAM_FRAME, decoder.frame().cmd);
+        frames++;
+    }
+    close(fd);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, frames);
+    TEST_ASSERT_EQUAL_STRING("", USBSerial.takeOutput().c_str());
+}
+
+int main(int argc, char** argv)
+{
+    // What setup() does on the board, minus the tasks
+    Preferences::eraseAll();
+    board.attach(Wire, Wire1);
+    Sim::setYieldHook(runTasks);
+    uint16_t uncalibrated = initCells();
+    initThermistor();
+    calibrateCells(uncalibrated);
+    saveCalibration(uncalibrated);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ping);
+    RUN_TEST(test_unknown_command);
+    RUN_TEST(test_setv_argument_errors);
+    RUN_TEST(test_setv_then_getv);
+    RUN_TEST(test_setallv_then_getallv);
+    RUN_TEST(test_setvec_applies_in_one_pass);
+    RUN_TEST(test_setvec_masked_subset);
+    RUN_TEST(test_vector_argument_errors);
+    RUN_TEST(test_staged_targets_wait_for_commit);
+    RUN_TEST(test_commit_subset_and_unstage);
+    RUN_TEST(test_waveform_synchronized_start);
+    RUN_TEST(test_waveform_loops_points);
+    RUN_TEST(test_waveform_counts_late_ticks);
+    RUN_TEST(test_waveform_argument_errors);
+    RUN_TEST(test_waveform_stop_against_a_running_timer);
+    RUN_TEST(test_battery_model_sags_and_recovers);
+    RUN_TEST(test_battery_model_discharges);
+    RUN_TEST(test_battery_model_stop_against_a_running_timer);
+    RUN_TEST(test_battery_model_argument_errors);
+    RUN_TEST(test_accumulators_integrate_load_current);
+    RUN_TEST(test_output_relay_commands);
+    RUN_TEST(test_getallv_uses_cached_readings);
+    RUN_TEST(test_mux_stats);
+    RUN_TEST(test_i2c_clock);
+    RUN_TEST(test_i2c_benchmark);
+    RUN_TEST(test_calibration_round_trip);
+    RUN_TEST(test_calibration_survives_reboot);
+    RUN_TEST(test_tagged_commands_pipelined);
+    RUN_TEST(test_binary_get_all_v);
+    RUN_TEST(test_binary_vectors);
+    RUN_TEST(test_binary_bad_crc);
+    RUN_TEST(test_thermistor_refused_at_cell_addresses);
+    RUN_TEST(test_thermistor_temperatures_read_back);
+    RUN_TEST(test_thermistor_ramp);
+    RUN_TEST(test_thermistor_ramp_against_a_running_timer);
+    RUN_TEST(test_thermistor_models);
+    RUN_TEST(test_status_leds_redraw_changed_cells);
+    RUN_TEST(test_network_commands);
+    RUN_TEST(test_network_reply_larger_than_send_buffer);
+    RUN_TEST(test_udp_telemetry);
+    return UNITY_END();
+}
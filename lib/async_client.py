@@ -0,0 +1,321 @@
+import asyncio
+import serial
+
+from . import protocol
+from . import transport
+
+
+def reply_timeout(cmd):
+    """How long to wait for the reply to an ASCII command."""
+    if cmd.startswith("CALIBRATE"):
+        return 30.0  # calibration sweeps every DAC point
+    if cmd.startswith("I2CBENCH"):
+        return 30.0  # both buses at every clock
+    return 1.0
+
+
+class _PendingReply:
+    def __init__(self, future):
+        self.future = future
+        self.lines = []
+
+
+class _TelemetryDatagrams(asyncio.DatagramProtocol):
+    """Queues the stream frame carried by each UDP telemetry datagram."""
+
+    def __init__(self, client):
+        self.client = client
+
+    def datagram_received(self, data, addr):
+        for seq, cmd, payload, crc_ok in protocol.FrameDecoder().feed(data):
+            if crc_ok and cmd == protocol.CMD_STREAM_FRAME:
+                self.client._queue_stream_frame(protocol.parse_stream_payload(payload))
+
+
+class AsyncCellSimClient:
+    """asyncio client that keeps many commands in flight on one serial port.
+
+    A reader task owns the port's input and hands every reply to the request it
+    answers, so callers can pipeline commands instead of waiting a round trip
+    for each. ASCII commands are sent as "#<tag> <command>" and the firmware
+    prefixes each reply line with the tag; binary frames are matched by their
+    sequence number. Telemetry that arrives in between is queued for
+    read_stream_frame() rather than thrown away.
+
+    port is a serial port, or "tcp://host[:port]" for the Ethernet command
+    server, where telemetry arrives over UDP, see start_udp_stream().
+
+        async with AsyncCellSimClient("/dev/ttyACM0") as client:
+            await client.commands([f"SETV {ch} 3.3" for ch in range(1, 17)])
+    """
+
+    def __init__(self, port, baudrate=115200, poll_interval=0.05, max_in_flight=32):
+        """Open the port; call start() (or use async with) before sending."""
+        self.serial = transport.open_transport(port, baudrate, timeout=poll_interval)
+        self.binary = False
+        self._max_in_flight = max_in_flight
+        self._decoder = protocol.FrameDecoder()
+        self._text = bytearray()
+        self._tag = 0
+        self._seq = 0
+        self._ascii_pending = {}
+        self._binary_pending = {}
+        self._reader = None
+        self._closing = False
+        self._udp = None
+
+    async def start(self):
+        """Start the reader task on the running event loop."""
+        self._window = asyncio.Semaphore(self._max_in_flight)
+        self._mode_ready = asyncio.Event()
+        self._mode_ready.set()
+        self._stream_frames = asyncio.Queue(maxsize=1000)
+        self.serial.reset_input_buffer()
+        self._reader = asyncio.get_running_loop().create_task(self._read_loop())
+        return self
+
+    async def __aenter__(self):
+        return await self.start()
+
+    async def __aexit__(self, *exc):
+        await self.close()
+
+    async def command(self, cmd, timeout=None):
+        """Send an ASCII command and return its reply lines.
+
+        Like CellSimClient.send_command(), returns whatever lines arrived if the
+        reply does not complete within the timeout.
+        """
+        await self._mode_ready.wait()
+        return await self._command(cmd, timeout)
+
+    async def commands(self, cmds, timeout=None):
+        """Send several ASCII commands back to back and return their replies in order."""
+        return await asyncio.gather(*[self.command(cmd, timeout) for cmd in cmds])
+
+    async def transact(self, cmd, payload=b"", timeout=1.0):
+        """Send one binary frame and return the reply payload (without the status byte)."""
+        await self._mode_ready.wait()
+        return await self._transact(cmd, payload, timeout)
+
+    async def transact_all(self, requests, timeout=1.0):
+        """Send several (cmd, payload) frames back to back and return their reply payloads in order."""
+        return await asyncio.gather(*[self.transact(cmd, payload, timeout) for cmd, payload in requests])
+
+    async def enter_binary_mode(self):
+        """Switch the firmware to the framed binary protocol."""
+        if self.binary:
+            return
+        self._mode_ready.clear()
+        try:
+            await self._drain()
+            lines = await self._command("BINARY", None)
+            if not lines or not lines[-1].startswith("OK:binary:"):
+                raise protocol.ProtocolError(f"binary handshake failed: {lines}")
+            version = int(lines[-1][len("OK:binary:"):])
+            if version != protocol.VERSION:
+                raise protocol.ProtocolError(f"unsupported protocol version {version}")
+        finally:
+            self._mode_ready.set()
+
+    async def exit_binary_mode(self):
+        """Switch the firmware back to ASCII commands."""
+        if not self.binary:
+            return
+        self._mode_ready.clear()
+        try:
+            await self._drain()
+            await self._transact(protocol.CMD_EXIT, b"", 1.0)
+        finally:
+            self._mode_ready.set()
+
+    @property
+    def network(self):
+        """True when connected over TCP rather than a serial port."""
+        return isinstance(self.serial, transport.TcpTransport)
+
+    async def start_udp_stream(self, rate_hz, port=0):
+        """Have the firmware stream telemetry at rate_hz to a UDP port on this host.
+
+        Only over TCP. Frames are queued for read_stream_frame() like the ones
+        STREAM sends over USB; port 0 picks a free one.
+        """
+        if not self.network:
+            raise protocol.ProtocolError("UDP telemetry needs a TCP connection")
+        await self.stop_udp_stream()
+        loop = asyncio.get_running_loop()
+        self._udp, _ = await loop.create_datagram_endpoint(
+            lambda: _TelemetryDatagrams(self), local_addr=(self.serial.local_address, port))
+        host, udp_port = self._udp.get_extra_info("sockname")[:2]
+        lines = await self.command(f"UDPSTREAM {host} {udp_port} {int(rate_hz)}")
+        if not lines or not lines[-1].startswith("OK:udp_stream:"):
+            self._udp.close()
+            self._udp = None
+            raise protocol.ProtocolError(f"failed to start UDP stream: {lines}")
+
+    async def stop_udp_stream(self):
+        """Stop the UDP telemetry started by start_udp_stream()."""
+        if self._udp is None:
+            return
+        await self.command("UDPSTREAM STOP")
+        self._udp.close()
+        self._udp = None
+
+    async def read_stream_frame(self, timeout=None):
+        """Return the next telemetry frame, or None if none arrived within the timeout."""
+        try:
+            return await asyncio.wait_for(self._stream_frames.get(), timeout)
+        except asyncio.TimeoutError:
+            return None
+
+    def clear_stream_frames(self):
+        """Drop any telemetry frames queued so far."""
+        while not self._stream_frames.empty():
+            self._stream_frames.get_nowait()
+
+    async def close(self):
+        """Leave binary mode, stop the reader and close the port."""
+        if self._reader is not None and not self._reader.done():
+            if self._udp is not None:
+                try:
+                    await self.stop_udp_stream()
+                except protocol.ProtocolError:
+                    pass
+            if self.binary:
+                try:
+                    await self.exit_binary_mode()
+                except protocol.ProtocolError:
+                    pass
+            self._closing = True
+            await self._reader
+        if self.serial.is_open:
+            self.serial.close()
+
+    async def _command(self, cmd, timeout):
+        if self.binary:
+            # ASCII commands are tunneled through a frame in binary mode
+            reply = await self._transact(protocol.CMD_ASCII, cmd.encode(), timeout or reply_timeout(cmd))
+            return [line.strip() for line in reply.decode().splitlines() if line.strip()]
+
+        async with self._window:
+            tag = self._next_tag()
+            pending = _PendingReply(asyncio.get_running_loop().create_future())
+            self._ascii_pending[tag] = pending
+            try:
+                self.serial.write(f"#{tag} {cmd}\n".encode())
+                return await asyncio.wait_for(pending.future, timeout or reply_timeout(cmd))
+            except asyncio.TimeoutError:
+                return pending.lines
+            finally:
+                self._ascii_pending.pop(tag, None)
+
+    async def _transact(self, cmd, payload, timeout):
+        async with self._window:
+            seq = self._next_seq()
+            pending = _PendingReply(asyncio.get_running_loop().create_future())
+            self._binary_pending[seq] = pending
+            try:
+                self.serial.write(protocol.encode(seq, cmd, payload))
+                reply_cmd, reply = await asyncio.wait_for(pending.future, timeout)
+            except asyncio.TimeoutError:
+                raise protocol.ProtocolError(f"timeout waiting for reply to command 0x{cmd:02x}") from None
+            finally:
+                self._binary_pending.pop(seq, None)
+        if reply_cmd != (cmd | protocol.REPLY_FLAG):
+            raise protocol.ProtocolError(f"reply 0x{reply_cmd:02x} does not match command 0x{cmd:02x}")
+        if not reply or reply[0] != protocol.STATUS_OK:
+            status = reply[0] if reply else None
+            raise protocol.ProtocolError(f"command 0x{cmd:02x} failed with status {status}")
+        return reply[1:]
+
+    async def _drain(self):
+        """Wait until every request in flight has its reply or has timed out."""
+        pending = [p.future for p in list(self._ascii_pending.values()) + list(self._binary_pending.values())]
+        if pending:
+            await asyncio.wait(pending)
+
+    def _next_tag(self):
+        while True:
+            self._tag = (self._tag + 1) % 10000
+            if str(self._tag) not in self._ascii_pending:
+                return str(self._tag)
+
+    def _next_seq(self):
+        while True:
+            self._seq = (self._seq + 1) & 0xFF
+            if self._seq not in self._binary_pending:
+                return self._seq
+
+    async def _read_loop(self):
+        loop = asyncio.get_running_loop()
+        try:
+            while not self._closing:
+                data = await loop.run_in_executor(None, self._read_available)
+                if data:
+                    self._feed(data)
+        except (serial.SerialException, OSError) as e:
+            error = protocol.ProtocolError(f"serial port failed: {e}")
+            for pending in list(self._ascii_pending.values()) + list(self._binary_pending.values()):
+                if not pending.future.done():
+                    pending.future.set_exception(error)
+
+    def _read_available(self):
+        # Returns after poll_interval at the latest, so close() is never held up
+        return self.serial.read(self.serial.in_waiting or 1)
+
+    def _feed(self, data):
+        if self.binary:
+            for seq, cmd, payload, crc_ok in self._decoder.feed(data):
+                self._dispatch_frame(seq, cmd, payload, crc_ok)
+            return
+
+        self._text.extend(data)
+        while not self.binary:
+            end = self._text.find(b"\n")
+            if end < 0:
+                return
+            line = self._text[:end].decode(errors="replace").strip()
+            del self._text[:end + 1]
+            self._dispatch_line(line)
+        # The firmware switched to frames right after its BINARY reply
+        rest = bytes(self._text)
+        self._text.clear()
+        self._decoder = protocol.FrameDecoder()
+        self._feed(rest)
+
+    def _dispatch_line(self, line):
+        if not line.startswith("#"):
+            frame = protocol.parse_stream_line(line)
+            if frame is not None:
+                self._queue_stream_frame(frame)
+            return
+        tag, _, text = line[1:].partition(" ")
+        pending = self._ascii_pending.get(tag)
+        if pending is None or pending.future.done():
+            return
+        pending.lines.append(text)
+        if text.startswith("OK:") or text.startswith("Error:"):
+            if text.startswith("OK:binary:"):
+                self.binary = True
+            pending.future.set_result(pending.lines)
+
+    def _dispatch_frame(self, seq, cmd, payload, crc_ok):
+        if not crc_ok:
+            # The seq can't be trusted either, that request will time out
+            return
+        if cmd == protocol.CMD_STREAM_FRAME:
+            self._queue_stream_frame(protocol.parse_stream_payload(payload))
+            return
+        pending = self._binary_pending.get(seq)
+        if pending is None or pending.future.done():
+            return
+        if cmd == (protocol.CMD_EXIT | protocol.REPLY_FLAG):
+            self.binary = False
+            self._text.clear()
+        pending.future.set_result((cmd, payload))
+
+    def _queue_stream_frame(self, frame):
+        # Oldest frames go first if nobody is reading the stream
+        if self._stream_frames.full():
+            self._stream_frames.get_nowait()
+        self._stream_frames.put_nowait(frame)
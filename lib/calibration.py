@@ -0,0 +1,69 @@
+"""Calibration table text format, mirrors firmware/src/calibration_store.h.
+
+A table is two lists of (voltage, dac_code) points, buck first, written as
+"<v>/<code>,...;<v>/<code>,...".
+"""
+
+NUM_POINTS = 32
+
+
+def format_table(buck, ldo):
+    """Format buck and LDO point lists for the SETCAL command."""
+    halves = []
+    for points in (buck, ldo):
+        if len(points) != NUM_POINTS:
+            raise ValueError(f"a calibration table needs {NUM_POINTS} points, got {len(points)}")
+        halves.append(",".join(f"{float(v):.4f}/{int(code)}" for v, code in points))
+    return ";".join(halves)
+
+
+def parse_table(text: str):
+    """Parse a table as printed by GETCAL into (buck, ldo) point lists."""
+    halves = text.strip().split(";")
+    if len(halves) != 2:
+        raise ValueError("malformed calibration table")
+    tables = []
+    for half in halves:
+        points = []
+        for point in half.split(","):
+            voltage, code = point.split("/")
+            points.append((float(voltage), int(code)))
+        if len(points) != NUM_POINTS:
+            raise ValueError(f"a calibration table needs {NUM_POINTS} points, got {len(points)}")
+        tables.append(points)
+    return tables[0], tables[1]
+
+
+class SetpointTable:
+    """Voltage to DAC code table, mirrors firmware/src/setpoint_table.h.
+
+    lookup() does the same integer math as the firmware, so the host can
+    precompute the codes a cell will use for any voltage.
+    """
+
+    STEP_SHIFT = 8
+    FRACTION_BITS = 3
+
+    def __init__(self, min_units, max_units, edges):
+        self.min_units = min_units
+        self.max_units = max_units
+        self.edges = edges
+
+    @classmethod
+    def parse(cls, text: str):
+        """Parse one "<min>,<max>:<edges>" table as printed by GETLUT."""
+        limits, edges = text.split(":")
+        min_units, max_units = (int(v) for v in limits.split(","))
+        return cls(min_units, max_units, [int(e) for e in edges.split(",")])
+
+    def lookup(self, voltage: float) -> int:
+        """Return the DAC code the firmware writes for this voltage."""
+        units = int(voltage * 10000.0 + 0.5)
+        units = min(max(units, self.min_units), self.max_units)
+        index = units >> self.STEP_SHIFT
+        fraction = units & ((1 << self.STEP_SHIFT) - 1)
+        low = self.edges[index]
+        high = self.edges[index + 1]
+        code = low + (((high - low) * fraction) >> self.STEP_SHIFT)
+        code = (code + (1 << (self.FRACTION_BITS - 1))) >> self.FRACTION_BITS
+        return min(max(code, 0), 4095)
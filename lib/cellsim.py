@@ -1,20 +1,416 @@
 from .client import CellSimClient
+from . import protocol
+from . import calibration
+import struct
 import time
 
 
+_FIELD_BITS = {"V": protocol.FIELD_VOLTAGE, "I": protocol.FIELD_CURRENT,
+               "B": protocol.FIELD_BUCK, "L": protocol.FIELD_LDO}
+
+
+def _channel_mask(channels):
+    """Firmware cell mask for channels 1-16."""
+    mask = 0
+    for ch in channels:
+        if ch < 1 or ch > 16:
+            raise ValueError("channels must be between 1 and 16")
+        mask |= 1 << (ch - 1)
+    return mask
+
+
+def _thermistor_mask(channels):
+    """Firmware mask for thermistor channels 1-4."""
+    mask = 0
+    for ch in channels:
+        if ch < 1 or ch > 4:
+            raise ValueError("thermistor channels must be between 1 and 4")
+        mask |= 1 << (ch - 1)
+    return mask
+
+
+def _voltage_targets(voltages, channels):
+    """Cell mask and the voltages in channel order, see CellSim.setVoltages()."""
+    if isinstance(voltages, dict):
+        targets = {int(ch): float(v) for ch, v in voltages.items()}
+    else:
+        voltages = [float(v) for v in voltages]
+        channels = range(1, len(voltages) + 1) if channels is None else [int(ch) for ch in channels]
+        if len(channels) != len(voltages):
+            raise ValueError("need one voltage per channel")
+        targets = dict(zip(channels, voltages))
+    if not targets:
+        raise ValueError("no channels given")
+    return _channel_mask(targets), [targets[ch] for ch in sorted(targets)]
+
+
 class CellSim:
-    def __init__(self, port, baudrate=115200, timeout=5):
-        """Initialize the CellSim with a serial connection using CellSimClient."""
+    def __init__(self, port, baudrate=115200, timeout=5, binary=False):
+        """Initialize the CellSim with a connection using CellSimClient.
+
+        port is a serial port, or "tcp://host[:port]" to connect over Ethernet.
+        With binary=True the binary framed protocol is negotiated, which speeds up
+        the voltage and current calls; all other calls keep working unchanged.
+        Binary framing is USB only and the flag is ignored over TCP.
+        """
         self.client = CellSimClient(port, baudrate, timeout)
+        if binary and not self.client.network:
+            self.client.enter_binary_mode()
 
     def setVoltage(self, channel: int, voltage: float):
-        """Set the voltage target for the given cell channel (1-16)."""
+        """Set the voltage target for the given cell channel (1-16).
+
+        Returns the response lines, or in binary mode True on success and
+        False if the firmware refused the command.
+        """
+        if self.client.binary:
+            payload = struct.pack("<BH", channel, protocol.volts_to_fixed(voltage))
+            try:
+                self.client.transact(protocol.CMD_SET_V, payload)
+            except protocol.ProtocolError:
+                return False
+            return True
         cmd = f"SETV {channel} {voltage}"
         response = self.client.send_command(cmd)
         return response
 
+    def setVoltages(self, voltages, channels=None):
+        """Set the voltage targets of several cells at once with one command.
+
+        voltages is a list or numpy array with one voltage per channel, for
+        channels 1 up or the given channels, or a {channel: voltage} dict. The
+        firmware applies them all together. Returns True on success.
+        """
+        mask, ordered = _voltage_targets(voltages, channels)
+        if self.client.binary:
+            payload = struct.pack(f"<H{len(ordered)}H", mask, *[protocol.volts_to_fixed(v) for v in ordered])
+            try:
+                self.client.transact(protocol.CMD_SET_VEC, payload)
+            except protocol.ProtocolError:
+                return False
+            return True
+        cmd = f"SETVEC 0x{mask:04X} " + ",".join(f"{v:.4f}" for v in ordered)
+        response = self.client.send_command(cmd)
+        return bool(response) and response[-1].startswith("OK:vector_set:")
+
+    def stageVoltages(self, voltages, channels=None):
+        """Stage voltage targets without applying them; commit() moves them all at once.
+
+        Takes the same arguments as setVoltages(). Staging a channel again
+        replaces its staged target. Returns True on success.
+        """
+        mask, ordered = _voltage_targets(voltages, channels)
+        if self.client.binary:
+            payload = struct.pack(f"<H{len(ordered)}H", mask, *[protocol.volts_to_fixed(v) for v in ordered])
+            try:
+                self.client.transact(protocol.CMD_STAGE_VEC, payload)
+            except protocol.ProtocolError:
+                return False
+            return True
+        cmd = f"STAGEVEC 0x{mask:04X} " + ",".join(f"{v:.4f}" for v in ordered)
+        response = self.client.send_command(cmd)
+        return bool(response) and response[-1].startswith("OK:staged:")
+
+    def commit(self):
+        """Apply every staged target at the same time.
+
+        Returns {"channels": n, "skew_us": ..., "latency_us": ...}, where skew
+        is the time between the first and last channel moving and latency the
+        time from the command to the first. Returns None if nothing was staged.
+        """
+        if self.client.binary:
+            try:
+                reply = self.client.transact(protocol.CMD_COMMIT, max_wait=2.0)
+            except protocol.ProtocolError:
+                return None
+            mask, skew, latency = struct.unpack("<HII", reply)
+            return {"channels": bin(mask).count("1"), "skew_us": skew, "latency_us": latency}
+
+        response = self.client.send_command("COMMIT")
+        for line in response:
+            if line.startswith("OK:committed:"):
+                channels, skew, latency = (int(v) for v in line[len("OK:committed:"):].split(","))
+                return {"channels": channels, "skew_us": skew, "latency_us": latency}
+        return None
+
+    def clearStaged(self):
+        """Drop the staged targets without applying them."""
+        return self.client.send_command("UNSTAGE")
+
+    def getCommitTimes(self):
+        """When each channel moved in the last commit, in us after the first.
+
+        Returns (skew_us, {channel: offset_us}) for the channels that were part
+        of it, or None on error.
+        """
+        response = self.client.send_command("GETCOMMIT")
+        for line in response:
+            if line.startswith("OK:commit:"):
+                values = [int(v) for v in line[len("OK:commit:"):].split(",")]
+                offsets = {ch: v for ch, v in enumerate(values[1:], start=1) if v >= 0}
+                return values[0], offsets
+        return None
+
+    def uploadWaveform(self, channel: int, points=None, samples=None, interval=None):
+        """Replace the waveform of a channel (1-16) for playWaveforms().
+
+        Give either points, a list of (time_s, voltage) pairs in order of time
+        that the output ramps between, or samples, a list of voltages taken
+        interval seconds apart. Returns the number of points stored.
+        """
+        if (points is None) == (samples is None):
+            raise ValueError("give either points or samples")
+        if samples is not None and not interval:
+            raise ValueError("samples need an interval")
+        response = self.client.send_command(f"WAVECLEAR 0x{1 << (channel - 1):04X}")
+        if not response or not response[-1].startswith("OK:"):
+            raise Exception(f"Clearing waveform failed: {response}")
+
+        # Short lines, so each fits in a binary frame when tunneled
+        if points is not None:
+            values = [f"{t * 1000:.3f}:{v:.4f}" for t, v in points]
+            prefix = f"WAVEPOINTS {channel} "
+        else:
+            values = [f"{float(v):.4f}" for v in samples]
+            prefix = f"WAVESAMPLES {channel} {interval * 1000:.3f} "
+        cmds = [prefix + ",".join(values[i:i + 12]) for i in range(0, len(values), 12)]
+        count = 0
+        for response in self.client.send_commands(cmds):
+            if not response or not response[-1].startswith("OK:wave_points:"):
+                raise Exception(f"Uploading waveform failed: {response}")
+            count = int(response[-1][len("OK:wave_points:"):])
+        return count
+
+    def playWaveforms(self, channels, loop=False, delay=0.01):
+        """Start the uploaded waveforms of the given channels together, delay seconds from now."""
+        mask = _channel_mask(channels)
+        cmd = f"WAVEPLAY 0x{mask:04X}{' LOOP' if loop else ''} {delay * 1000:.3f}"
+        response = self.client.send_command(cmd)
+        return bool(response) and response[-1].startswith("OK:wave_playing:")
+
+    def stopWaveforms(self, channels=None):
+        """Stop playback, of every channel if none are given; outputs keep their last value."""
+        mask = 0xFFFF if channels is None else _channel_mask(channels)
+        return self.client.send_command(f"WAVESTOP 0x{mask:04X}")
+
+    def getWaveformStatus(self):
+        """Return {"playing": [channels], "late": n, "underruns": n}, or None on error.
+
+        late counts timer ticks that came too late and underruns the values a
+        bus could not write before the next one replaced them, both since the
+        last playWaveforms() that started with nothing playing.
+        """
+        response = self.client.send_command("WAVESTATUS")
+        for line in response:
+            if line.startswith("OK:wave:"):
+                mask, late, underruns = line[len("OK:wave:"):].split(",")
+                mask = int(mask, 16)
+                playing = [ch for ch in range(1, 17) if mask & (1 << (ch - 1))]
+                return {"playing": playing, "late": int(late), "underruns": int(underruns)}
+        return None
+
+    def setBatteryModel(self, channel: int, capacity_ah, r0, ocv, rc_pairs=()):
+        """Configure the battery model of a channel (1-16).
+
+        capacity_ah is the capacity in Ah, r0 the series resistance in ohms and
+        rc_pairs up to two (ohms, farads) pairs. ocv lists 2 to 21 open circuit
+        voltages at evenly spaced states of charge from empty to full.
+        """
+        circuit = [capacity_ah, r0] + [x for pair in rc_pairs for x in pair]
+        cmd = (f"MODELSET {channel} " + ",".join(f"{x:g}" for x in circuit) + " "
+               + ",".join(f"{v:.4f}" for v in ocv))
+        response = self.client.send_command(cmd)
+        if response and response[-1].startswith("OK:model_set:"):
+            return response
+        raise Exception(f"Setting battery model failed: {response}")
+
+    def startBatteryModels(self, channels, soc=1.0):
+        """Run the battery models of the given channels from soc (0 to 1); the firmware closes the loop."""
+        mask = _channel_mask(channels)
+        response = self.client.send_command(f"MODELSTART 0x{mask:04X} {soc * 100:.3f}")
+        return bool(response) and response[-1].startswith("OK:model_running:")
+
+    def stopBatteryModels(self, channels=None):
+        """Stop the battery models, of every channel if none are given; outputs keep their last value."""
+        mask = 0xFFFF if channels is None else _channel_mask(channels)
+        return self.client.send_command(f"MODELSTOP 0x{mask:04X}")
+
+    def getBatteryState(self, channel: int):
+        """Return {"soc", "voltage", "ocv", "current"} of a channel's battery model, or None on error."""
+        response = self.client.send_command(f"MODELGET {channel}")
+        for line in response:
+            if line.startswith("OK:model:"):
+                soc, voltage, ocv, current = (float(v) for v in line[len("OK:model:"):].split(","))
+                return {"soc": soc / 100, "voltage": voltage, "ocv": ocv, "current": current}
+        return None
+
+    def getBatteryModelStats(self):
+        """Return {"steps", "mean_step_us", "max_step_us", "late"} for the model loop, or None on error.
+
+        The step times cover all running channels together and are to be
+        compared with the 10 ms step period.
+        """
+        response = self.client.send_command("MODELSTATS")
+        for line in response:
+            if line.startswith("OK:model_stats:"):
+                steps, mean, worst, late = (int(v) for v in line[len("OK:model_stats:"):].split(","))
+                return {"steps": steps, "mean_step_us": mean, "max_step_us": worst, "late": late}
+        return None
+
+    def getAccumulators(self, channels=None):
+        """Charge and energy each channel delivered since its last reset.
+
+        Returns {"charge_mah": [...], "energy_mwh": [...], "seconds": [...]}
+        with the channels in ascending order, all 16 if channels is None.
+        Returns None on error.
+        """
+        channels = range(1, 17) if channels is None else sorted({int(ch) for ch in channels})
+        mask = _channel_mask(channels)
+        if self.client.binary:
+            try:
+                reply = self.client.transact(protocol.CMD_GET_ACC, struct.pack("<H", mask))
+            except protocol.ProtocolError:
+                return None
+            values = [struct.unpack_from("<iiI", reply, 12 * k) for k in range(len(channels))]
+            return {"charge_mah": [v[0] / 1000 for v in values],
+                    "energy_mwh": [v[1] / 1000 for v in values],
+                    "seconds": [v[2] / 1000 for v in values]}
+
+        response = self.client.send_command(f"GETACC 0x{mask:04X}")
+        for line in response:
+            if line.startswith("OK:acc:"):
+                values = [float(v) for v in line[len("OK:acc:"):].split(",")]
+                return {"charge_mah": values[0::3], "energy_mwh": values[1::3], "seconds": values[2::3]}
+        return None
+
+    def resetAccumulators(self, channels=None):
+        """Start the charge and energy of the given channels, or all of them, over from zero."""
+        mask = 0xFFFF if channels is None else _channel_mask(channels)
+        if self.client.binary:
+            try:
+                self.client.transact(protocol.CMD_RESET_ACC, struct.pack("<H", mask))
+            except protocol.ProtocolError:
+                return False
+            return True
+        response = self.client.send_command(f"RESETACC 0x{mask:04X}")
+        return bool(response) and response[-1].startswith("OK:acc_reset")
+
+    def setTemperatures(self, temperatures):
+        """Set thermistor channels (1-4) to the given {channel: celsius}, all in one write.
+
+        Stops any ramp running on them. Returns True on success.
+        """
+        channels = sorted(int(ch) for ch in temperatures)
+        mask = _thermistor_mask(channels)
+        cmd = f"SETTEMPVEC 0x{mask:X} " + ",".join(f"{temperatures[ch]:.2f}" for ch in channels)
+        response = self.client.send_command(cmd)
+        return bool(response) and response[-1].startswith("OK:temp_vector_set:")
+
+    def getTemperatures(self):
+        """Return the four thermistor channels as read back by the simulator.
+
+        A list of {"set", "volts", "measured", "ramping"} per channel, where
+        measured is the temperature the read back voltage stands for. Returns
+        None on error, e.g. when the thermistor board is not fitted.
+        """
+        response = self.client.send_command("GETTEMP")
+        for line in response:
+            if line.startswith("OK:temp:"):
+                parts = line[len("OK:temp:"):].split(",")
+                ramping = int(parts[0], 16)
+                values = [float(v) for v in parts[1:]]
+                return [{"set": values[3 * i], "volts": values[3 * i + 1], "measured": values[3 * i + 2],
+                         "ramping": bool(ramping >> i & 1)} for i in range(4)]
+        return None
+
+    def setThermistorModel(self, channel: int, pullup_ohms, reference_volts, r25=None, beta=None, coefficients=None):
+        """Set the NTC a thermistor channel (1-4) simulates and the BMS divider it sits in.
+
+        Give either r25 (ohms) and beta, or coefficients, the Steinhart-Hart
+        (a, b, c). The BMS pulls the thermistor up to reference_volts through
+        pullup_ohms.
+        """
+        if coefficients is not None:
+            values = list(coefficients) + [pullup_ohms, reference_volts]
+            cmd = f"TEMPMODEL {channel} SH " + ",".join(f"{v:.10g}" for v in values)
+        elif r25 is not None and beta is not None:
+            values = [r25, beta, pullup_ohms, reference_volts]
+            cmd = f"TEMPMODEL {channel} BETA " + ",".join(f"{v:g}" for v in values)
+        else:
+            raise ValueError("need r25 and beta, or Steinhart-Hart coefficients")
+        response = self.client.send_command(cmd)
+        if response and response[-1].startswith("OK:temp_model:"):
+            return response
+        raise Exception(f"Setting thermistor model failed: {response}")
+
+    def rampTemperatures(self, temperatures, seconds):
+        """Ramp thermistor channels from where they are to the given {channel: celsius} over seconds.
+
+        The firmware runs the ramp on its own. Returns True on success.
+        """
+        channels = sorted(int(ch) for ch in temperatures)
+        mask = _thermistor_mask(channels)
+        cmd = (f"TEMPRAMP 0x{mask:X} " + ",".join(f"{temperatures[ch]:.2f}" for ch in channels)
+               + f" {seconds:.3f}")
+        response = self.client.send_command(cmd)
+        return bool(response) and response[-1].startswith("OK:temp_ramp:")
+
+    def stopTemperatureRamps(self, channels=None):
+        """Stop the ramps of the given thermistor channels, or all of them, where they are."""
+        mask = 0xF if channels is None else _thermistor_mask(channels)
+        return self.client.send_command(f"TEMPRAMP STOP 0x{mask:X}")
+
+    def getReadings(self, channels=None, fields="V"):
+        """Read any of V (output voltage), I (current), B (buck) and L (LDO) for several cells at once.
+
+        Returns {field: [value per channel]} with the channels in ascending
+        order, all 16 if channels is None. Returns None on error.
+        """
+        channels = range(1, 17) if channels is None else sorted({int(ch) for ch in channels})
+        fields = "".join(dict.fromkeys(fields.upper()))
+        if not fields or any(f not in _FIELD_BITS for f in fields):
+            raise ValueError("fields must be from V, I, B and L")
+        mask = _channel_mask(channels)
+
+        if self.client.binary:
+            bits = 0
+            for f in fields:
+                bits |= _FIELD_BITS[f]
+            try:
+                reply = self.client.transact(protocol.CMD_GET_VEC, struct.pack("<HB", mask, bits))
+            except protocol.ProtocolError:
+                return None
+            # The firmware sends each cell's readings in V, I, B, L order
+            order = [f for f in "VIBL" if f in fields]
+            readings = {f: [] for f in fields}
+            offset = 0
+            for _ in channels:
+                for f in order:
+                    if f == "I":
+                        readings[f].append(struct.unpack_from("<i", reply, offset)[0] / 1e6)
+                        offset += 4
+                    else:
+                        readings[f].append(protocol.fixed_to_volts(struct.unpack_from("<H", reply, offset)[0]))
+                        offset += 2
+            return readings
+
+        response = self.client.send_command(f"GETVEC 0x{mask:04X} {fields}")
+        for line in response:
+            if line.startswith("OK:vector:"):
+                values = [float(v) for v in line[len("OK:vector:"):].split(",")]
+                return {f: values[i::len(fields)] for i, f in enumerate(fields)}
+            elif line.startswith("Error:"):
+                break
+        return None
+
     def getVoltage(self, channel: int):
         """Get the voltage reading for the given cell channel (1-16)."""
+        if self.client.binary:
+            try:
+                reply = self.client.transact(protocol.CMD_GET_V, bytes([channel]))
+            except protocol.ProtocolError:
+                return None
+            return protocol.fixed_to_volts(struct.unpack("<H", reply)[0])
         cmd = f"GETV {channel}"
         response = self.client.send_command(cmd)
         for line in response:
@@ -40,6 +436,12 @@ class CellSim:
     
     def setAllVoltages(self, voltage: float):
         """Set all voltage readings for all 16 cells."""
+        if self.client.binary:
+            try:
+                self.client.transact(protocol.CMD_SET_ALL_V, struct.pack("<H", protocol.volts_to_fixed(voltage)))
+            except protocol.ProtocolError:
+                return False
+            return True
         cmd = f"SETALLV {voltage}"
         response = self.client.send_command(cmd)
         for line in response:
@@ -49,6 +451,9 @@ class CellSim:
 
     def getAllVoltages(self):
         """Get all voltage readings for all 16 cells in a compact format."""
+        if self.client.binary:
+            reply = self.client.transact(protocol.CMD_GET_ALL_V)
+            return [protocol.fixed_to_volts(v) for v in struct.unpack("<16H", reply)]
         cmd = "GETALLV"
         response = self.client.send_command(cmd)
         voltages = [None] * 16
@@ -68,6 +473,9 @@ class CellSim:
 
     def getAllCurrents(self):
         """Get all current readings for all 16 cells in a compact format."""
+        if self.client.binary:
+            reply = self.client.transact(protocol.CMD_GET_ALL_I)
+            return [ua / 1e6 for ua in struct.unpack("<16i", reply)]
         cmd = "GETALLI"
         response = self.client.send_command(cmd)
         currents = [None] * 16
@@ -125,6 +533,102 @@ class CellSim:
         cmd = f"DISABLE_LOAD_SWITCH {channel}"
         return self.client.send_command(cmd)
 
+    def stream(self, rate_hz: int = 100):
+        """Stream telemetry for all 16 channels at rate_hz (1-500 Hz).
+
+        Yields protocol.StreamFrame objects as they arrive, with timestamp_us
+        unwrapped to a monotonic 64-bit count. The stream is stopped when the
+        generator is closed, e.g. by leaving a for loop over it. Over TCP the
+        frames come as UDP datagrams, which may be lost; gaps in seq show it.
+        """
+        if self.client.network:
+            self.client.start_udp_stream(rate_hz)
+        else:
+            response = self.client.send_command(f"STREAM {int(rate_hz)}")
+            if not response or not response[-1].startswith("OK:stream:"):
+                raise Exception(f"Failed to start stream: {response}")
+        self.client.clear_stream_frames()
+        last_timestamp = None
+        wraps = 0
+        try:
+            while True:
+                frame = self.client.read_stream_frame()
+                if frame is None:
+                    continue
+                if last_timestamp is not None and frame.timestamp_us < last_timestamp:
+                    wraps += 1
+                last_timestamp = frame.timestamp_us
+                frame.timestamp_us += wraps << 32
+                yield frame
+        finally:
+            if self.client.network:
+                self.client.stop_udp_stream()
+            else:
+                self.client.send_command("STREAM STOP")
+
+    def getMuxStats(self):
+        """Get the I2C mux write statistics as {'wire': (writes, avoided), 'wire1': (writes, avoided)}."""
+        cmd = "GETMUXSTATS"
+        response = self.client.send_command(cmd)
+        for line in response:
+            stripped = line.strip()
+            if stripped.startswith("OK:mux_stats:"):
+                try:
+                    parts = [int(p) for p in stripped[len("OK:mux_stats:"):].split(",")]
+                    return {"wire": (parts[0], parts[1]), "wire1": (parts[2], parts[3])}
+                except Exception:
+                    pass
+                break
+            elif stripped.startswith("Error:"):
+                break
+        return None
+
+    def resetMuxStats(self):
+        """Reset the I2C mux write statistics."""
+        cmd = "RESETMUXSTATS"
+        return self.client.send_command(cmd)
+
+    def getBusClocks(self):
+        """Return the I2C clocks in Hz as (bus 1, bus 2)."""
+        response = self.client.send_command("I2CCLOCK")
+        for line in response:
+            if line.startswith("OK:i2c_clock:"):
+                return tuple(int(v) for v in line[len("OK:i2c_clock:"):].split(","))
+        return None
+
+    def setBusClock(self, clock_hz: int, bus=None):
+        """Set the I2C clock of bus 1 or 2, or of both, from 100 kHz to 1 MHz.
+
+        400 kHz is the fastest every part on the buses is rated for; use
+        benchmarkBuses() to check faster clocks on your harness.
+        """
+        cmd = f"I2CCLOCK {clock_hz}" if bus is None else f"I2CCLOCK {bus} {clock_hz}"
+        response = self.client.send_command(cmd)
+        if response and response[-1].startswith("OK:i2c_clock:"):
+            return tuple(int(v) for v in response[-1][len("OK:i2c_clock:"):].split(","))
+        raise Exception(f"Setting the I2C clock failed: {response}")
+
+    def benchmarkBuses(self, rounds=None):
+        """Run both I2C buses at 100 kHz, 400 kHz and 1 MHz and return one result per clock.
+
+        Each result is {"clock_hz", "buses": [{"transactions_per_s", "nacks", "errors"}, ...],
+        "getallv_latency_us"}, the buses in order. The latency is how long until
+        GETALLV answers with voltages all sampled after the request, 0 if that
+        took over a second. The clocks are set back afterwards.
+        """
+        cmd = "I2CBENCH" if rounds is None else f"I2CBENCH {rounds}"
+        response = self.client.send_command(cmd)
+        if not response or not response[-1].startswith("OK:i2c_bench:"):
+            raise Exception(f"I2C benchmark failed: {response}")
+        results = []
+        for line in response:
+            if line.startswith("BENCH:"):
+                values = [int(v) for v in line[len("BENCH:"):].split(",")]
+                buses = [{"transactions_per_s": values[i], "nacks": values[i + 1], "errors": values[i + 2]}
+                         for i in (1, 4)]
+                results.append({"clock_hz": values[0], "buses": buses, "getallv_latency_us": values[7]})
+        return results
+
     def close(self):
         """Close the underlying serial connection."""
         self.client.close() 
@@ -144,3 +648,75 @@ class CellSim:
         if response and "OK:all_calibrated" in response[0]:
             return response
         raise Exception("Calibration failed")
+
+    def getSettleTimes(self, channel: int):
+        """Return the settle time in ms of each point from the last calibration of a cell.
+
+        Returns a (buck, ldo) tuple of lists, or None on error.
+        """
+        cmd = f"GETSETTLE {channel}"
+        response = self.client.send_command(cmd)
+        for line in response:
+            stripped = line.strip()
+            if stripped.startswith("OK:settle:"):
+                try:
+                    times = [float(t) for t in stripped[len("OK:settle:"):].split(",")]
+                    half = len(times) // 2
+                    return times[:half], times[half:]
+                except Exception:
+                    pass
+                break
+            elif stripped.startswith("Error:"):
+                break
+        return None
+
+    def getCalibration(self, channel: int = None):
+        """Return the calibration tables held by the firmware.
+
+        Returns {channel: (buck, ldo)} where each table is a list of (voltage, dac_code)
+        points, for all 16 cells or just the given channel (1-16).
+        """
+        cmd = "GETCAL" if channel is None else f"GETCAL {channel}"
+        response = self.client.send_ascii_command(cmd)
+        if not response or not response[-1].startswith("OK:cal:"):
+            raise Exception(f"Reading calibration failed: {response}")
+        tables = {}
+        for line in response:
+            if line.startswith("CAL:"):
+                _, cell, table = line.split(":", 2)
+                tables[int(cell)] = calibration.parse_table(table)
+        return tables
+
+    def setCalibration(self, channel: int, buck, ldo):
+        """Upload and store the calibration table of one cell channel (1-16)."""
+        cmd = f"SETCAL {channel} {calibration.format_table(buck, ldo)}"
+        response = self.client.send_ascii_command(cmd)
+        if response and response[-1].startswith("OK:cal_set:"):
+            return response
+        raise Exception(f"Setting calibration failed: {response}")
+
+    def uploadCalibration(self, tables):
+        """Upload tables as returned by getCalibration(), e.g. restored from a file.
+
+        The SETCAL commands go out back to back rather than one reply at a time.
+        """
+        items = sorted(tables.items())
+        cmds = [f"SETCAL {channel} {calibration.format_table(buck, ldo)}" for channel, (buck, ldo) in items]
+        for (channel, _), response in zip(items, self.client.send_ascii_commands(cmds)):
+            if not response or not response[-1].startswith("OK:cal_set:"):
+                raise Exception(f"Setting calibration of channel {channel} failed: {response}")
+
+    def getSetpointTables(self, channel: int):
+        """Return the (buck, ldo) SetpointTable a cell channel (1-16) converts voltages with."""
+        cmd = f"GETLUT {channel}"
+        response = self.client.send_ascii_command(cmd)
+        for line in response:
+            if line.startswith("OK:lut:"):
+                buck, ldo = line[len("OK:lut:"):].split(";")
+                return calibration.SetpointTable.parse(buck), calibration.SetpointTable.parse(ldo)
+        raise Exception(f"Reading setpoint tables failed: {response}")
+
+    def clearCalibration(self):
+        """Erase the stored tables so every cell calibrates again at the next boot."""
+        cmd = "CLEARCAL"
+        return self.client.send_command(cmd)
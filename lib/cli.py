@@ -4,7 +4,7 @@ from cell_sim.client import CellSimClient
 
 def main():
     parser = argparse.ArgumentParser(description="Cell Simulator Client CLI")
-    parser.add_argument("-p", "--port", type=str, required=True, help="Serial port to connect to")
+    parser.add_argument("-p", "--port", type=str, required=True, help="Serial port, or tcp://host[:port] for Ethernet")
     parser.add_argument("-b", "--baudrate", type=int, default=115200, help="Baud rate, default is 115200")
     args = parser.parse_args()
 
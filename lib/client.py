@@ -1,43 +1,119 @@
-import serial
-import time
+import asyncio
+import threading
+
+from .async_client import AsyncCellSimClient
 
 
 class CellSimClient:
+    """Blocking front end to AsyncCellSimClient, which runs on its own event loop thread.
+
+    Every call waits for its reply like before, but send_commands() and
+    transact_all() put a whole batch on the wire before waiting, so the batch
+    costs one round trip instead of one per command.
+    """
+
     def __init__(self, port, baudrate=115200, timeout=0.2):
-        """Initialize serial connection to the CellSim."""
-        self.serial = serial.Serial(port, baudrate, timeout=timeout)
+        """Initialize the connection to the CellSim.
+
+        port is a serial port, or "tcp://host[:port]" for Ethernet.
+        timeout is how long read_stream_frame() waits for a frame;
+        replies to commands have their own timeouts.
+        """
+        self.timeout = timeout
+        self._loop = asyncio.new_event_loop()
+        self._thread = threading.Thread(target=self._loop.run_forever, daemon=True)
+        self._thread.start()
+        try:
+            self._client = AsyncCellSimClient(port, baudrate)
+            self._run(self._client.start())
+        except Exception:
+            self._stop_loop()
+            raise
+
+    @property
+    def serial(self):
+        return self._client.serial
+
+    @property
+    def network(self):
+        return self._client.network
+
+    @property
+    def binary(self):
+        return self._client.binary
+
+    def enter_binary_mode(self):
+        """Switch the firmware to the framed binary protocol."""
+        self._run(self._client.enter_binary_mode())
+
+    def exit_binary_mode(self):
+        """Switch the firmware back to ASCII commands."""
+        self._run(self._client.exit_binary_mode())
+
+    def transact(self, cmd, payload=b"", max_wait=1.0):
+        """Send one binary frame and return the reply payload (without the status byte)."""
+        return self._run(self._client.transact(cmd, payload, max_wait))
+
+    def transact_all(self, requests, max_wait=1.0):
+        """Send several (cmd, payload) frames at once and return their reply payloads in order."""
+        return self._run(self._client.transact_all(requests, max_wait))
 
     def send_command(self, cmd):
         """Send a command and return the response lines."""
-        # Clear any pending input and send command
-        self.serial.reset_input_buffer()
-        self.serial.write(f"{cmd}\n".encode())
-        
-        # Read response with retries
-        start_time = time.time()
-        # Use appropriate timeouts for different commands
-        if cmd.startswith("SETV"):
-            max_wait = 1.0  # 1s for SETV
-        elif cmd in ["GETALLV", "GETALLI"]:
-            max_wait = 1.0  # 1s for commands that read all cells
-        else:
-            max_wait = 1.0  # 1s for other commands
-            
-        lines = []
-        while (time.time() - start_time) < max_wait:
-            if self.serial.in_waiting:
-                line = self.serial.readline().decode().strip()
-                if line:
-                    lines.append(line)
-                    # If we got a valid response (OK: or Error:), we're done
-                    if line.startswith("OK:") or line.startswith("Error:"):
-                        return lines
-            else:
-                time.sleep(0.001)  # 1ms sleep when no data
-        
-        return lines
+        return self._run(self._client.command(cmd))
+
+    def send_commands(self, cmds):
+        """Send several commands at once and return the response lines of each, in order."""
+        return self._run(self._client.commands(cmds))
+
+    def send_ascii_command(self, cmd):
+        """Send a command whose request or reply may not fit in a binary frame."""
+        if not self.binary:
+            return self.send_command(cmd)
+        self.exit_binary_mode()
+        try:
+            return self.send_command(cmd)
+        finally:
+            self.enter_binary_mode()
+
+    def send_ascii_commands(self, cmds):
+        """send_ascii_command() for several commands, sent back to back."""
+        if not self.binary:
+            return self.send_commands(cmds)
+        self.exit_binary_mode()
+        try:
+            return self.send_commands(cmds)
+        finally:
+            self.enter_binary_mode()
+
+    def start_udp_stream(self, rate_hz, port=0):
+        """Have telemetry streamed over UDP to this host, only over TCP."""
+        self._run(self._client.start_udp_stream(rate_hz, port))
+
+    def stop_udp_stream(self):
+        """Stop the UDP telemetry."""
+        self._run(self._client.stop_udp_stream())
+
+    def read_stream_frame(self):
+        """Return the next telemetry frame, or None if none arrived within the timeout."""
+        return self._run(self._client.read_stream_frame(self.timeout))
+
+    def clear_stream_frames(self):
+        """Drop telemetry frames that arrived before the caller was interested."""
+        self._loop.call_soon_threadsafe(self._client.clear_stream_frames)
 
     def close(self):
         """Close the serial connection."""
-        if self.serial.is_open:
-            self.serial.close() 
\ No newline at end of file
+        if self._thread.is_alive():
+            try:
+                self._run(self._client.close())
+            finally:
+                self._stop_loop()
+
+    def _run(self, coro):
+        return asyncio.run_coroutine_threadsafe(coro, self._loop).result()
+
+    def _stop_loop(self):
+        self._loop.call_soon_threadsafe(self._loop.stop)
+        self._thread.join()
+        self._loop.close()
@@ -0,0 +1,134 @@
+"""Binary host protocol, mirrors firmware/src/binary_protocol.h."""
+import struct
+
+VERSION = 1
+SOF = 0xA5
+MAX_PAYLOAD = 255
+REPLY_FLAG = 0x80
+
+CMD_PING = 0x01
+CMD_SET_V = 0x02
+CMD_GET_V = 0x03
+CMD_SET_ALL_V = 0x04
+CMD_GET_ALL_V = 0x05
+CMD_GET_ALL_I = 0x06
+CMD_SET_VEC = 0x07
+CMD_GET_VEC = 0x08
+CMD_STAGE_VEC = 0x09
+CMD_COMMIT = 0x0A
+CMD_GET_ACC = 0x0B
+CMD_RESET_ACC = 0x0C
+CMD_STREAM_FRAME = 0x40
+CMD_ASCII = 0x7E
+CMD_EXIT = 0x7F
+
+# CMD_GET_VEC fields, each cell's readings come in this order
+FIELD_VOLTAGE = 0x01
+FIELD_CURRENT = 0x02
+FIELD_BUCK = 0x04
+FIELD_LDO = 0x08
+
+STATUS_OK = 0x00
+STATUS_BAD_CRC = 0x01
+STATUS_UNKNOWN_COMMAND = 0x02
+STATUS_BAD_ARGUMENT = 0x03
+
+
+class ProtocolError(Exception):
+    pass
+
+
+class StreamFrame:
+    """One telemetry frame pushed by the STREAM command."""
+
+    def __init__(self, seq, timestamp_us, drops, voltages, currents, buck, ldo):
+        self.seq = seq
+        self.timestamp_us = timestamp_us
+        self.drops = drops
+        self.voltages = voltages
+        self.currents = currents
+        self.buck = buck
+        self.ldo = ldo
+
+    def __repr__(self):
+        return f"StreamFrame(seq={self.seq}, timestamp_us={self.timestamp_us}, drops={self.drops})"
+
+
+def parse_stream_line(line: str):
+    """Parse an ASCII 'STREAM:' line, returns None for anything else."""
+    if not line.startswith("STREAM:"):
+        return None
+    parts = line[len("STREAM:"):].split(",")
+    if len(parts) != 3 + 64:
+        return None
+    values = [float(p) for p in parts[3:]]
+    return StreamFrame(int(parts[0]), int(parts[1]), int(parts[2]),
+                       values[0:16], values[16:32], values[32:48], values[48:64])
+
+
+def parse_stream_payload(payload: bytes):
+    """Parse the payload of a CMD_STREAM_FRAME frame."""
+    seq, timestamp, drops = struct.unpack_from("<3I", payload, 0)
+    voltages = struct.unpack_from("<16H", payload, 12)
+    currents = struct.unpack_from("<16i", payload, 44)
+    buck = struct.unpack_from("<16H", payload, 108)
+    ldo = struct.unpack_from("<16H", payload, 140)
+    return StreamFrame(seq, timestamp, drops,
+                       [fixed_to_volts(v) for v in voltages],
+                       [ua / 1e6 for ua in currents],
+                       [fixed_to_volts(v) for v in buck],
+                       [fixed_to_volts(v) for v in ldo])
+
+
+def crc16(data: bytes, crc: int = 0xFFFF) -> int:
+    """CRC-16/CCITT-FALSE, polynomial 0x1021."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode(seq: int, cmd: int, payload: bytes = b"") -> bytes:
+    """Build a complete frame."""
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload too long")
+    body = bytes([len(payload), seq & 0xFF, cmd]) + payload
+    return bytes([SOF]) + body + struct.pack("<H", crc16(body))
+
+
+def volts_to_fixed(volts: float) -> int:
+    """Volts to the wire format (uint16, 100 uV units)."""
+    return max(0, min(0xFFFF, int(round(volts * 10000))))
+
+
+def fixed_to_volts(value: int) -> float:
+    return value / 10000.0
+
+
+class FrameDecoder:
+    """Incremental decoder, yields (seq, cmd, payload, crc_ok) tuples."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data: bytes):
+        self.buffer.extend(data)
+        frames = []
+        while True:
+            start = self.buffer.find(bytes([SOF]))
+            if start < 0:
+                self.buffer.clear()
+                break
+            del self.buffer[:start]
+            if len(self.buffer) < 4:
+                break
+            total = 4 + self.buffer[1] + 2
+            if len(self.buffer) < total:
+                break
+            frame = bytes(self.buffer[:total])
+            del self.buffer[:total]
+            crc_ok = crc16(frame[1:-2]) == struct.unpack("<H", frame[-2:])[0]
+            frames.append((frame[2], frame[3], frame[4:-2], crc_ok))
+        return frames
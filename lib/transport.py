@@ -0,0 +1,67 @@
+import select
+import socket
+from urllib.parse import urlparse
+
+import serial
+
+# Port of the firmware's TCP command server
+DEFAULT_TCP_PORT = 5025
+
+
+class TcpTransport:
+    """TCP connection to the firmware's command server over Ethernet.
+
+    Offers the parts of serial.Serial the clients use, so either one can sit
+    under them. The firmware speaks the same ASCII commands as over USB;
+    binary framing and STREAM stay on USB, telemetry comes over UDP instead.
+    """
+
+    def __init__(self, host, port=DEFAULT_TCP_PORT, timeout=None, connect_timeout=5.0):
+        self._sock = socket.create_connection((host, port), timeout=connect_timeout)
+        self._sock.settimeout(None)
+        self._sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.timeout = timeout
+        self.is_open = True
+
+    @property
+    def local_address(self):
+        """Address of this host as the firmware sees it."""
+        return self._sock.getsockname()[0]
+
+    @property
+    def in_waiting(self):
+        if not self._readable(0):
+            return 0
+        return len(self._sock.recv(65536, socket.MSG_PEEK))
+
+    def read(self, size=1):
+        if not self._readable(self.timeout):
+            return b""
+        data = self._sock.recv(size)
+        if not data:
+            raise ConnectionError("connection closed by the cell simulator")
+        return data
+
+    def write(self, data):
+        self._sock.sendall(data)
+        return len(data)
+
+    def reset_input_buffer(self):
+        while self._readable(0) and self._sock.recv(65536):
+            pass
+
+    def close(self):
+        self._sock.close()
+        self.is_open = False
+
+    def _readable(self, timeout):
+        readable, _, _ = select.select([self._sock], [], [], timeout)
+        return bool(readable)
+
+
+def open_transport(port, baudrate=115200, timeout=None):
+    """Open a serial port by name, or the Ethernet command server as "tcp://host[:port]"."""
+    if port.startswith("tcp://"):
+        url = urlparse(port)
+        return TcpTransport(url.hostname, url.port or DEFAULT_TCP_PORT, timeout)
+    return serial.Serial(port, baudrate, timeout=timeout)
@@ -75,18 +75,15 @@ def main():
     voltages = cellsim.getAllVoltages()
     print(f"Voltages: {voltages}")
 
-    # Create a rainbow pattern from 1V to 4V across the 16 channels
+    # Create a rainbow pattern from 1V to 4V across the 16 channels, all set
+    # with one command
     print("\nSetting rainbow voltage pattern...")
-    for i in range(16):
-        voltage = 1.0 + (3.0 * i / 15)  # Spread 1V to 4V across 16 channels
-        cellsim.setVoltage(i + 1, voltage)
+    cellsim.setVoltages([1.0 + (3.0 * i / 15) for i in range(16)])
 
     time.sleep(1)
-    voltages = cellsim.getAllVoltages()
-    print(f"Voltages: {voltages}")
-
-    currents = cellsim.getAllCurrents()
-    print(f"Currents: {currents}")
+    readings = cellsim.getReadings(fields="VI")
+    print(f"Voltages: {readings['V']}")
+    print(f"Currents: {readings['I']}")
 
     cellsim.enableOutputAll()
     time.sleep(1)